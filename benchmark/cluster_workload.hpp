@@ -0,0 +1,407 @@
+#ifndef CLUSTER_WORKLOAD_H
+#define CLUSTER_WORKLOAD_H
+
+#include "microbench.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Synthetic events and the benchmarks every tree's Cluster class shares
+// The four cluster libraries differ in their constructors and their frequency detection but agree on
+// the tracking methods, so these are templated on a function that makes a cluster at a position:
+//     auto make = [](unsigned int x, unsigned int y) { return Cluster(x, y, color, alpha); };
+// Every benchmark takes the cluster count as its first argument, the per-event ones take the event
+// rate of the whole sensor in events per second as their second.
+// The sustain and birth benchmarks add and remove clusters through a store with the methods of
+// cpp_live_tracking's ClusterPool, the other trees use VectorStore.
+namespace workload {
+
+inline constexpr int width = 640;
+inline constexpr int height = 480;
+inline constexpr int blurScale = 5;
+inline constexpr double clusterInitThresh = 0.9;
+inline constexpr unsigned int clusterSustainThresh = 18;
+inline constexpr int clusterSustainTime = 35000;
+inline constexpr double radiusGrowth = 1.0007;
+inline constexpr double radiusShrink = 0.998;
+inline constexpr double alpha = 0.1;
+
+// events handed to the per-event benchmarks in each iteration
+inline constexpr size_t blockSize = 4096;
+
+// the benchmarked ranges, from one bee to a busy hive entrance and from a quiet scene to a saturated sensor
+inline const std::vector<int64_t> clusterCounts{1, 5, 20, 100, 256};
+inline const std::vector<int64_t> eventRates{100000, 1000000, 10000000};
+
+struct SyntheticEvent {
+    int64_t timestamp;
+    uint16_t x, y;
+    bool polarity;
+    // index of the bee the event came from, -1 for noise
+    int source;
+};
+
+// small deterministic generator so every run sees the same events
+class Random {
+    private:
+        uint64_t state;
+
+    public:
+        explicit Random(uint64_t seed) : state(seed * 0x9E3779B97F4A7C15ull + 1) {}
+
+        uint32_t next() {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return (uint32_t)(state >> 16);
+        }
+
+        int below(int limit) { return next() % limit; }
+
+        double unit() { return (next() & 0xFFFFFF) / (double)0x1000000; }
+};
+
+// where bee number index sits, spread over the sensor and at least a cluster apart for up to 108 bees
+// the next 108 sit half a cell to the right of the first, overlapping them, and then the grid starts over
+// every event stays on the sensor: the last column plus the offset and the event spread ends at x 638
+inline void beePosition(int index, unsigned int &x, unsigned int &y) {
+    const int columns = 12, rows = 9;
+    const int offset = (index / (columns * rows)) % 2 * 26;
+    x = 30 + (index % columns) * 52 + offset;
+    y = 30 + ((index / columns) % rows) * 52;
+}
+
+// three quarters of the events come from within 10 pixels of a bee (inside a fresh cluster's radius),
+// the rest are noise anywhere on the sensor, a third of all events are on events
+inline std::vector<SyntheticEvent> makeEvents(size_t count, int bees, int64_t rate, uint64_t seed = 1) {
+    Random random(seed);
+    std::vector<SyntheticEvent> events;
+    events.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        SyntheticEvent event;
+        event.timestamp = (int64_t)(i * 1e6 / rate);
+        event.polarity = random.below(3) == 0;
+        if (bees > 0 && random.below(4) != 0) {
+            event.source = random.below(bees);
+            unsigned int x, y;
+            beePosition(event.source, x, y);
+            event.x = x + random.below(21) - 10;
+            event.y = y + random.below(21) - 10;
+        } else {
+            event.source = -1;
+            event.x = random.below(width);
+            event.y = random.below(height);
+        }
+        events.push_back(event);
+    }
+    return events;
+}
+
+// The clusters in one std::vector, removing one moves the last into its place
+template <typename ClusterType>
+class VectorStore {
+    private:
+        std::vector<ClusterType> clusters;
+
+    public:
+        explicit VectorStore(size_t capacity) { clusters.reserve(capacity); }
+
+        template <typename... Args>
+        void emplace(Args &&...args) {
+            clusters.emplace_back(std::forward<Args>(args)...);
+        }
+
+        void removeAt(size_t index) {
+            if (index != clusters.size() - 1) {
+                clusters[index] = clusters.back();
+            }
+            clusters.pop_back();
+        }
+
+        void clear() { clusters.clear(); }
+
+        ClusterType &operator[](size_t index) { return clusters[index]; }
+
+        ClusterType *begin() { return clusters.data(); }
+
+        ClusterType *end() { return clusters.data() + clusters.size(); }
+
+        size_t size() const { return clusters.size(); }
+};
+
+template <typename Make>
+auto makeClusters(int count, Make make) {
+    std::vector<decltype(make(0u, 0u))> clusters;
+    clusters.reserve(count);
+    for (int i = 0; i < count; i++) {
+        unsigned int x, y;
+        beePosition(i, x, y);
+        clusters.push_back(make(x, y));
+    }
+    return clusters;
+}
+
+// distance from each event to every cluster, the first thing the trackers do with an event
+template <typename Make>
+void benchDistance(microbench::State &state, Make make) {
+    auto clusters = makeClusters(state.arg(0), make);
+    std::vector<SyntheticEvent> events = makeEvents(blockSize, state.arg(0), state.arg(1));
+
+    while (state.keepRunning()) {
+        double total = 0;
+        for (const SyntheticEvent &event : events) {
+            for (auto &cluster : clusters) {
+                total += cluster.distance(event.x, event.y);
+            }
+        }
+        microbench::doNotOptimize(total);
+    }
+    state.setItemsProcessed(state.iterations() * blockSize);
+}
+
+template <typename Make>
+void benchInRange(microbench::State &state, Make make) {
+    auto clusters = makeClusters(state.arg(0), make);
+    std::vector<SyntheticEvent> events = makeEvents(blockSize, state.arg(0), state.arg(1));
+
+    while (state.keepRunning()) {
+        int hits = 0;
+        for (const SyntheticEvent &event : events) {
+            for (auto &cluster : clusters) {
+                hits += cluster.inRange(event.x, event.y);
+            }
+        }
+        microbench::doNotOptimize(hits);
+    }
+    state.setItemsProcessed(state.iterations() * blockSize);
+}
+
+template <typename Make>
+void benchBorderRange(microbench::State &state, Make make) {
+    auto clusters = makeClusters(state.arg(0), make);
+    std::vector<SyntheticEvent> events = makeEvents(blockSize, state.arg(0), state.arg(1));
+
+    while (state.keepRunning()) {
+        int hits = 0;
+        for (const SyntheticEvent &event : events) {
+            for (auto &cluster : clusters) {
+                hits += cluster.borderRange(event.x, event.y);
+            }
+        }
+        microbench::doNotOptimize(hits);
+    }
+    state.setItemsProcessed(state.iterations() * blockSize);
+}
+
+// the cluster an event came from moves towards it
+template <typename Make>
+void benchShift(microbench::State &state, Make make) {
+    auto clusters = makeClusters(state.arg(0), make);
+    std::vector<SyntheticEvent> events = makeEvents(blockSize, state.arg(0), state.arg(1));
+
+    while (state.keepRunning()) {
+        for (const SyntheticEvent &event : events) {
+            if (event.source >= 0) {
+                clusters[event.source].shift(event.x, event.y);
+            }
+        }
+        microbench::doNotOptimize(clusters.data());
+    }
+    state.setItemsProcessed(state.iterations() * blockSize);
+}
+
+// every cluster carries on with its velocity for the time since the last event
+template <typename Make>
+void benchContMomentum(microbench::State &state, Make make) {
+    auto clusters = makeClusters(state.arg(0), make);
+    std::vector<SyntheticEvent> events = makeEvents(blockSize, state.arg(0), state.arg(1));
+
+    while (state.keepRunning()) {
+        int64_t prevTime = events.front().timestamp;
+        for (const SyntheticEvent &event : events) {
+            for (auto &cluster : clusters) {
+                cluster.contMomentum(event.timestamp, prevTime);
+            }
+            prevTime = event.timestamp;
+        }
+        microbench::doNotOptimize(clusters.data());
+    }
+    state.setItemsProcessed(state.iterations() * blockSize);
+}
+
+// growth for events just outside a cluster, and the shrink every cluster gets at each update
+template <typename Make>
+void benchUpdateRadius(microbench::State &state, Make make) {
+    auto clusters = makeClusters(state.arg(0), make);
+    std::vector<SyntheticEvent> events = makeEvents(blockSize, state.arg(0), state.arg(1));
+
+    while (state.keepRunning()) {
+        for (const SyntheticEvent &event : events) {
+            if (event.source >= 0) {
+                clusters[event.source].updateRadius(radiusGrowth);
+            }
+        }
+        for (auto &cluster : clusters) {
+            cluster.updateRadius(radiusShrink);
+        }
+        microbench::doNotOptimize(clusters.data());
+    }
+    state.setItemsProcessed(state.iterations() * blockSize);
+}
+
+// The whole per-event step of the trackers: nearest cluster, then shift and count the event if it is
+// inside or grow the cluster if it is just outside
+template <typename Make>
+void benchNearestCluster(microbench::State &state, Make make) {
+    auto clusters = makeClusters(state.arg(0), make);
+    std::vector<SyntheticEvent> events = makeEvents(blockSize, state.arg(0), state.arg(1));
+    std::vector<double> distances(clusters.size());
+
+    while (state.keepRunning()) {
+        int64_t prevTime = events.front().timestamp;
+        for (const SyntheticEvent &event : events) {
+            if (event.polarity) {
+                continue;
+            }
+            for (size_t i = 0; i < clusters.size(); i++) {
+                distances[i] = clusters[i].distance(event.x, event.y);
+                clusters[i].contMomentum(event.timestamp, prevTime);
+            }
+            size_t nearest = std::min_element(distances.begin(), distances.end()) - distances.begin();
+            if (clusters[nearest].inRange(event.x, event.y)) {
+                clusters[nearest].shift(event.x, event.y);
+            } else if (clusters[nearest].borderRange(event.x, event.y)) {
+                clusters[nearest].updateRadius(radiusGrowth);
+            }
+            prevTime = event.timestamp;
+        }
+        microbench::doNotOptimize(clusters.data());
+    }
+    state.setItemsProcessed(state.iterations() * blockSize);
+}
+
+// The check every clusterSustainTime that removes clusters with too few events, in the same
+// swap-with-last walk the cpp_live_tracking tracker uses. How many survive depends on the event rate:
+// each cluster gets its share of the bee events in one sustain period, give or take 75%
+// newEvent is how the per-event loop counts events, so addEvent lets each tree call its own version
+template <template <typename> class Store, typename Make, typename AddEvent>
+void benchSustain(microbench::State &state, Make make, AddEvent addEvent) {
+    const int count = state.arg(0);
+    const double expected = state.arg(1) * (clusterSustainTime / 1e6) * 0.75 * (2.0 / 3.0) / count;
+
+    Store<decltype(make(0u, 0u))> prototypes(count);
+    for (int i = 0; i < count; i++) {
+        unsigned int x, y;
+        beePosition(i, x, y);
+        prototypes.emplace(make(x, y));
+    }
+    Random random(count);
+    for (auto &cluster : prototypes) {
+        // only whether the count reaches the threshold matters, so stop there
+        unsigned int events = (unsigned int)std::min(expected * (0.25 + 1.5 * random.unit()), (double)clusterSustainThresh);
+        for (unsigned int i = 0; i < events; i++) {
+            addEvent(cluster);
+        }
+    }
+
+    // culling changes the clusters, so it works through fresh copies and only pauses to refill them
+    std::vector<decltype(prototypes)> copies(64, prototypes);
+    size_t next = 0;
+    while (state.keepRunning()) {
+        if (next == copies.size()) {
+            state.pauseTiming();
+            std::fill(copies.begin(), copies.end(), prototypes);
+            next = 0;
+            state.resumeTiming();
+        }
+
+        auto &clusters = copies[next++];
+        for (size_t i = clusters.size(); i > 0; i--) {
+            if (!clusters[i - 1].aboveThreshold(clusterSustainThresh)) {
+                clusters.removeAt(i - 1);
+            } else {
+                clusters[i - 1].resetEvents();
+            }
+        }
+        microbench::doNotOptimize(clusters.begin());
+    }
+    state.setItemsProcessed(state.iterations() * count);
+}
+
+// The search of the blurred time surface for regions hot enough to start a cluster, with twice as
+// many hot regions as the cluster limit, half of them next to another so the overlap check rejects them
+// Past 108 clusters the bees overlap and the search finds no room for the rest, so one item is a
+// cluster actually made
+template <template <typename> class Store, typename Make>
+void benchBirth(microbench::State &state, Make make) {
+    const int maxClusters = state.arg(0);
+    const int columns = width / blurScale, rows = height / blurScale;
+
+    std::vector<double> blurred(columns * rows);
+    Random random(maxClusters);
+    for (double &value : blurred) {
+        value = 0.5 * random.unit();
+    }
+    for (int i = 0; i < maxClusters; i++) {
+        unsigned int x, y;
+        beePosition(i, x, y);
+        blurred[(y / blurScale) * columns + x / blurScale] = 1;
+        blurred[(y / blurScale) * columns + x / blurScale + 1] = 1;
+    }
+
+    Store<decltype(make(0u, 0u))> clusters(maxClusters);
+    while (state.keepRunning()) {
+        clusters.clear();
+        for (int j = 0; j < rows; j++) {
+            for (int i = 0; i < columns; i++) {
+                if (blurred[j * columns + i] <= clusterInitThresh || (int)clusters.size() >= maxClusters) {
+                    continue;
+                }
+                bool alreadyAdded = false;
+                for (auto &cluster : clusters) {
+                    if (cluster.otherClusterRange(i * blurScale, j * blurScale)) {
+                        alreadyAdded = true;
+                        break;
+                    }
+                }
+                if (!alreadyAdded) {
+                    clusters.emplace(make(i * blurScale, j * blurScale));
+                }
+            }
+        }
+        microbench::doNotOptimize(clusters.begin());
+    }
+    state.setItemsProcessed(state.iterations() * clusters.size());
+}
+
+// adds the benchmarks above to a suite, addEvent is how the tree's per-event loop counts an event
+// birthIterations fixes the iteration count of the birth benchmark for clusters that are costly to make
+// Store holds the clusters of the sustain and birth benchmarks, the way the tree's tracker holds them
+template <template <typename> class Store = VectorStore, typename Make, typename AddEvent>
+void addCommonBenchmarks(microbench::Suite &suite, Make make, AddEvent addEvent, int64_t birthIterations = 0) {
+    const std::vector<std::string> perEvent{"clusters", "rate"};
+    suite.add("distance", [make](microbench::State &state) { benchDistance(state, make); })
+        .argNames(perEvent).ranges({clusterCounts, eventRates});
+    suite.add("inRange", [make](microbench::State &state) { benchInRange(state, make); })
+        .argNames(perEvent).ranges({clusterCounts, eventRates});
+    suite.add("borderRange", [make](microbench::State &state) { benchBorderRange(state, make); })
+        .argNames(perEvent).ranges({clusterCounts, eventRates});
+    suite.add("shift", [make](microbench::State &state) { benchShift(state, make); })
+        .argNames(perEvent).ranges({clusterCounts, eventRates});
+    suite.add("contMomentum", [make](microbench::State &state) { benchContMomentum(state, make); })
+        .argNames(perEvent).ranges({clusterCounts, eventRates});
+    suite.add("updateRadius", [make](microbench::State &state) { benchUpdateRadius(state, make); })
+        .argNames(perEvent).ranges({clusterCounts, eventRates});
+    suite.add("nearestCluster", [make](microbench::State &state) { benchNearestCluster(state, make); })
+        .argNames(perEvent).ranges({clusterCounts, eventRates});
+    suite.add("sustain", [make, addEvent](microbench::State &state) { benchSustain<Store>(state, make, addEvent); })
+        .argNames(perEvent).ranges({clusterCounts, eventRates});
+    suite.add("birth", [make](microbench::State &state) { benchBirth<Store>(state, make); })
+        .argNames({"clusters"}).ranges({clusterCounts}).iterations(birthIterations);
+}
+
+}
+
+#endif
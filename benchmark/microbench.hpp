@@ -0,0 +1,353 @@
+#ifndef MICROBENCH_H
+#define MICROBENCH_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <time.h>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A small stand-in for Google Benchmark, header only so the cluster benchmarks build with nothing but
+// the libraries the trees already use. The loop and the JSON output follow Google Benchmark, so its
+// compare.py can diff two result files:
+//
+//     void benchShift(microbench::State &state) {
+//         ... setup ...
+//         while (state.keepRunning()) {
+//             ... timed work ...
+//         }
+//         state.setItemsProcessed(state.iterations() * eventsPerIteration);
+//     }
+//
+//     microbench::Suite suite("cluster");
+//     suite.add("shift", benchShift).argNames({"clusters", "rate"}).ranges({{1, 20}, {100000, 1000000}});
+//     return suite.run(argc, argv);
+namespace microbench {
+
+// keeps the compiler from dropping a result that is never used
+// CPU time of the calling thread, std::clock is too coarse for runs that pause every iteration
+inline double threadCpuSeconds() {
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+template <typename T>
+inline void doNotOptimize(const T &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+class State {
+    private:
+        std::vector<int64_t> args;
+        int64_t maxIterations, count{0};
+        int64_t items{0};
+        bool timing{false};
+        std::chrono::steady_clock::time_point realStart;
+        double cpuStart{0};
+        double realSeconds{0}, cpuSeconds{0};
+
+    public:
+        State(const std::vector<int64_t> &args, int64_t maxIterations) : args(args), maxIterations(maxIterations) {}
+
+        int64_t arg(size_t index) const { return args.at(index); }
+
+        // true while there are iterations left, the timer runs from the first call to the last
+        bool keepRunning() {
+            if (count == 0) {
+                resumeTiming();
+            }
+            if (count < maxIterations) {
+                count++;
+                return true;
+            }
+            pauseTiming();
+            return false;
+        }
+
+        // for setup inside the loop that should not be counted
+        void pauseTiming() {
+            if (timing) {
+                realSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - realStart).count();
+                cpuSeconds += threadCpuSeconds() - cpuStart;
+                timing = false;
+            }
+        }
+
+        void resumeTiming() {
+            if (!timing) {
+                cpuStart = threadCpuSeconds();
+                realStart = std::chrono::steady_clock::now();
+                timing = true;
+            }
+        }
+
+        int64_t iterations() const { return count; }
+
+        // events, samples or clusters handled in total, reported as items_per_second
+        void setItemsProcessed(int64_t processed) { items = processed; }
+
+        int64_t itemsProcessed() const { return items; }
+
+        double getRealSeconds() const { return realSeconds; }
+
+        double getCpuSeconds() const { return cpuSeconds; }
+};
+
+class Benchmark {
+    private:
+        std::string name;
+        std::function<void(State &)> function;
+        std::vector<std::string> names;
+        std::vector<std::vector<int64_t>> values;
+        int64_t fixedIterations{0};
+
+        friend class Suite;
+
+    public:
+        Benchmark(const std::string &name, std::function<void(State &)> function) : name(name), function(function) {}
+
+        // names of the arguments, used in the run names and as JSON fields
+        Benchmark &argNames(const std::vector<std::string> &argumentNames) {
+            names = argumentNames;
+            return *this;
+        }
+
+        // runs every combination of the given values, the first argument changes slowest
+        Benchmark &ranges(const std::vector<std::vector<int64_t>> &argumentValues) {
+            values = argumentValues;
+            return *this;
+        }
+
+        // for benchmarks that cannot run for as long as the minimum time asks for
+        Benchmark &iterations(int64_t count) {
+            fixedIterations = count;
+            return *this;
+        }
+
+        std::vector<std::vector<int64_t>> argSets() const {
+            std::vector<std::vector<int64_t>> sets{{}};
+            for (const std::vector<int64_t> &options : values) {
+                std::vector<std::vector<int64_t>> next;
+                for (const std::vector<int64_t> &set : sets) {
+                    for (int64_t value : options) {
+                        next.push_back(set);
+                        next.back().push_back(value);
+                    }
+                }
+                sets = next;
+            }
+            return sets;
+        }
+
+        std::string runName(const std::vector<int64_t> &args) const {
+            std::string result = name;
+            for (size_t i = 0; i < args.size(); i++) {
+                result += "/" + (i < names.size() ? names[i] + ":" : "") + std::to_string(args[i]);
+            }
+            return result;
+        }
+};
+
+struct Result {
+    std::string name, runName;
+    std::vector<std::string> argNames;
+    std::vector<int64_t> args;
+    int64_t iterations;
+    double realTime, cpuTime, itemsPerSecond;
+    // "mean", "median" or "stddev" for the rows --repetitions adds, empty for a run
+    std::string aggregate;
+};
+
+class Suite {
+    private:
+        std::string name;
+        std::vector<Benchmark> benchmarks;
+
+        static State measure(const Benchmark &benchmark, const std::vector<int64_t> &args, double minTime) {
+            // the same search as Google Benchmark: grow the count until one run lasts the minimum time
+            int64_t iterations = benchmark.fixedIterations > 0 ? benchmark.fixedIterations : 1;
+            while (true) {
+                State state(args, iterations);
+                benchmark.function(state);
+
+                double seconds = state.getRealSeconds();
+                if (benchmark.fixedIterations > 0 || seconds >= minTime || iterations >= 1000000000) {
+                    return state;
+                }
+                double multiplier = minTime * 1.4 / std::max(seconds, 1e-9);
+                if (seconds / minTime < 0.1) {
+                    multiplier = std::min(multiplier, 10.0);
+                }
+                iterations = std::max(iterations + 1, (int64_t)(iterations * multiplier));
+            }
+        }
+
+        void writeJson(std::ostream &out, const std::string &executable, const std::vector<Result> &results) const {
+            char date[64];
+            std::time_t now = std::time(nullptr);
+            std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", std::localtime(&now));
+
+            out << "{\n  \"context\": {\n";
+            out << "    \"date\": \"" << date << "\",\n";
+            out << "    \"executable\": \"" << executable << "\",\n";
+            out << "    \"suite\": \"" << name << "\",\n";
+            out << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+#ifdef NDEBUG
+            out << "    \"library_build_type\": \"release\"\n";
+#else
+            out << "    \"library_build_type\": \"debug\"\n";
+#endif
+            out << "  },\n  \"benchmarks\": [";
+            for (size_t i = 0; i < results.size(); i++) {
+                const Result &result = results[i];
+                out << (i ? "," : "") << "\n    {\n";
+                out << "      \"name\": \"" << result.runName << (result.aggregate.empty() ? "" : "_" + result.aggregate) << "\",\n";
+                out << "      \"run_name\": \"" << result.runName << "\",\n";
+                out << "      \"run_type\": \"" << (result.aggregate.empty() ? "iteration" : "aggregate") << "\",\n";
+                if (!result.aggregate.empty()) {
+                    out << "      \"aggregate_name\": \"" << result.aggregate << "\",\n";
+                }
+                out << "      \"family\": \"" << result.name << "\",\n";
+                for (size_t a = 0; a < result.args.size() && a < result.argNames.size(); a++) {
+                    out << "      \"" << result.argNames[a] << "\": " << result.args[a] << ",\n";
+                }
+                out << "      \"iterations\": " << result.iterations << ",\n";
+                out << "      \"real_time\": " << result.realTime << ",\n";
+                out << "      \"cpu_time\": " << result.cpuTime << ",\n";
+                out << "      \"time_unit\": \"ns\",\n";
+                out << "      \"items_per_second\": " << result.itemsPerSecond << "\n";
+                out << "    }";
+            }
+            out << "\n  ]\n}\n";
+        }
+
+        // the mean, median and standard deviation of the times and rates of repeated runs of one benchmark
+        static std::vector<Result> aggregates(const std::vector<Result> &runs) {
+            auto field = [&runs](double Result::*member) {
+                std::vector<double> values;
+                for (const Result &run : runs) {
+                    values.push_back(run.*member);
+                }
+                std::sort(values.begin(), values.end());
+                double mean = 0;
+                for (double value : values) {
+                    mean += value / values.size();
+                }
+                double variance = 0;
+                for (double value : values) {
+                    variance += (value - mean) * (value - mean) / (values.size() - 1);
+                }
+                size_t middle = values.size() / 2;
+                double median = values.size() % 2 ? values[middle] : (values[middle - 1] + values[middle]) / 2;
+                return std::vector<double>{mean, median, std::sqrt(variance)};
+            };
+            std::vector<double> real = field(&Result::realTime), cpu = field(&Result::cpuTime),
+                items = field(&Result::itemsPerSecond);
+
+            std::vector<Result> rows;
+            const char *names[] = {"mean", "median", "stddev"};
+            for (int i = 0; i < 3; i++) {
+                Result row = runs.front();
+                row.realTime = real[i];
+                row.cpuTime = cpu[i];
+                row.itemsPerSecond = items[i];
+                row.aggregate = names[i];
+                rows.push_back(row);
+            }
+            return rows;
+        }
+
+        static void print(const Result &result) {
+            std::string rowName = result.runName + (result.aggregate.empty() ? "" : "_" + result.aggregate);
+            printf("%-56s %14.1f %14.1f %12lld %16.4g\n", rowName.c_str(), result.realTime, result.cpuTime,
+                (long long)result.iterations, result.itemsPerSecond);
+            fflush(stdout);
+        }
+
+    public:
+        explicit Suite(const std::string &name) : name(name) {}
+
+        Benchmark &add(const std::string &benchmarkName, std::function<void(State &)> function) {
+            benchmarks.emplace_back(benchmarkName, function);
+            return benchmarks.back();
+        }
+
+        // --filter=<text> only runs benchmarks whose run name contains text
+        // --json=<path> writes the results there as well as printing them
+        // --min-time=<seconds> how long each run should last, 0.5 by default
+        // --repetitions=<n> runs each benchmark n times and adds rows with the mean, median and standard deviation
+        int run(int argc, char *argv[]) const {
+            std::string filter, jsonPath;
+            double minTime = 0.5;
+            int repetitions = 1;
+            for (int i = 1; i < argc; i++) {
+                std::string arg = argv[i];
+                if (arg.rfind("--filter=", 0) == 0) {
+                    filter = arg.substr(9);
+                } else if (arg.rfind("--json=", 0) == 0) {
+                    jsonPath = arg.substr(7);
+                } else if (arg.rfind("--min-time=", 0) == 0) {
+                    minTime = std::stod(arg.substr(11));
+                } else if (arg.rfind("--repetitions=", 0) == 0) {
+                    repetitions = std::max(1, std::stoi(arg.substr(14)));
+                } else {
+                    std::cerr << "Unknown argument: " << arg << std::endl;
+                    std::cerr << "Usage: " << argv[0] << " [--filter=<text>] [--json=<path>] [--min-time=<seconds>] [--repetitions=<n>]" << std::endl;
+                    return EXIT_FAILURE;
+                }
+            }
+
+            std::vector<Result> results;
+            printf("%-56s %14s %14s %12s %16s\n", "Benchmark", "Time (ns)", "CPU (ns)", "Iterations", "Items/s");
+            for (const Benchmark &benchmark : benchmarks) {
+                for (const std::vector<int64_t> &args : benchmark.argSets()) {
+                    std::string runName = benchmark.runName(args);
+                    if (runName.find(filter) == std::string::npos) {
+                        continue;
+                    }
+
+                    std::vector<Result> runs;
+                    for (int repetition = 0; repetition < repetitions; repetition++) {
+                        State state = measure(benchmark, args, minTime);
+                        double iterations = std::max<int64_t>(state.iterations(), 1);
+                        Result result{benchmark.name, runName, benchmark.names, args, state.iterations(),
+                            state.getRealSeconds() * 1e9 / iterations, state.getCpuSeconds() * 1e9 / iterations,
+                            state.getRealSeconds() > 0 ? state.itemsProcessed() / state.getRealSeconds() : 0.0};
+                        print(result);
+                        runs.push_back(result);
+                    }
+                    results.insert(results.end(), runs.begin(), runs.end());
+                    if (repetitions > 1) {
+                        for (const Result &row : aggregates(runs)) {
+                            print(row);
+                            results.push_back(row);
+                        }
+                    }
+                }
+            }
+
+            if (!jsonPath.empty()) {
+                std::ofstream file(jsonPath);
+                if (!file.is_open()) {
+                    std::cerr << "Could not write " << jsonPath << std::endl;
+                    return EXIT_FAILURE;
+                }
+                writeJson(file, argv[0], results);
+            }
+            return 0;
+        }
+};
+
+}
+
+#endif
@@ -0,0 +1,20 @@
+#!/bin/sh
+# Builds the cluster microbenchmarks of all four trees with optimisations on and runs them,
+# writing one Google Benchmark style JSON file per tree
+# usage: benchmark/run_cluster_benchmarks.sh [results-directory] [benchmark arguments...]
+set -e
+cd "$(dirname "$0")/.."
+
+results=${1:-benchmark/results/$(date +%Y-%m-%d_%H%M%S)}
+[ $# -gt 0 ] && shift
+mkdir -p "$results"
+
+for tree in cpp_live_tracking delay_wingbeat forced_oscillators fourier_wingbeat_detection
+do
+	# a separate build directory, so the cluster/build the front ends link against keeps its settings
+	cmake -S $tree/cluster -B $tree/cluster/bench_build -DCMAKE_BUILD_TYPE=Release
+	cmake --build $tree/cluster/bench_build --target cluster_bench
+	$tree/cluster/bench_build/cluster_bench --json="$results/$tree.json" "$@"
+done
+
+echo "Results written to $results"
@@ -1,105 +1,151 @@
 #include "cluster.hpp"
 
-int Cluster::globId = 0;
+std::atomic<int> clusterGlobId{0};
 
-Cluster::Cluster(unsigned int x, unsigned int y, cv::viz::Color color, float alpha) {
+template <typename Real>
+BasicCluster<Real>::BasicCluster(unsigned int x, unsigned int y, cv::viz::Color color, float alpha) {
     this->alpha = alpha;
-    this->x = (double)x;
-    this->y = (double)y;
-    this->prev_x = (double)x;
-    this->prev_y = (double)y;
+    this->x = (Real)x;
+    this->y = (Real)y;
+    this->prev_x = (Real)x;
+    this->prev_y = (Real)y;
     this->color = color;
-    this->id = globId++;
+    this->id = clusterGlobId++;
 }
 
-Cluster::Cluster(unsigned int x, unsigned int y, float alpha) {
+template <typename Real>
+BasicCluster<Real>::BasicCluster(unsigned int x, unsigned int y, float alpha) {
     this->alpha = alpha;
-    this->x = (double)x;
-    this->y = (double)y;
-    this->prev_x = (double)x;
-    this->prev_y = (double)y;
-    this->id = globId++;
-}
-
-double Cluster::distance(unsigned int x, unsigned int y) {
+    this->x = (Real)x;
+    this->y = (Real)y;
+    this->prev_x = (Real)x;
+    this->prev_y = (Real)y;
+    this->id = clusterGlobId++;
+}
+
+template <typename Real>
+BasicCluster<Real>::BasicCluster(const BasicClusterState<Real> &state) {
+    id = state.id;
+    side = state.side;
+    eventCount = state.eventCount;
+    posIndex = state.posIndex;
+    newFrequency = state.newFrequency;
+    x = state.x;
+    y = state.y;
+    prev_x = state.prevX;
+    prev_y = state.prevY;
+    alpha = state.alpha;
+    radius = state.radius;
+    vel_x = state.velX;
+    vel_y = state.velY;
+    color = cv::viz::Color(state.color[0], state.color[1], state.color[2]);
+}
+
+template <typename Real>
+double BasicCluster<Real>::distance(unsigned int x, unsigned int y) {
     //return pow(pow(x - this->x, 2) + pow(y - this->y, 2), 0.5);
-    return std::max(fabs((double)x - this->x), fabs((double)y - this->y));
+    return numeric::toDouble(std::max(numeric::abs((Real)x - this->x), numeric::abs((Real)y - this->y)));
 }
 
-bool Cluster::inRange(unsigned int x, unsigned int y) {
-    return distance(x, y) < radius;
+template <typename Real>
+bool BasicCluster<Real>::inRange(unsigned int x, unsigned int y) {
+    return distance(x, y) < numeric::toDouble(radius);
 }
 
-bool Cluster::borderRange(unsigned int x, unsigned int y) {
-    return distance(x, y) < radius * 1.33;
+template <typename Real>
+bool BasicCluster<Real>::borderRange(unsigned int x, unsigned int y) {
+    return distance(x, y) < numeric::toDouble(radius * 1.33);
 }
 
-bool Cluster::otherClusterRange(unsigned int x, unsigned int y) {
-    return distance(x, y) < radius * 2;
+template <typename Real>
+bool BasicCluster<Real>::otherClusterRange(unsigned int x, unsigned int y) {
+    return distance(x, y) < numeric::toDouble(radius * 2);
 }
 
-void Cluster::shift(unsigned int x, unsigned int y) {
-    this->x = (1 - alpha) * this->x + alpha * (double)x;
-    this->y = (1 - alpha) * this->y + alpha * (double)y;
+template <typename Real>
+void BasicCluster<Real>::shift(unsigned int x, unsigned int y) {
+    this->x = numeric::blend<Real>(alpha, this->x, (Real)x);
+    this->y = numeric::blend<Real>(alpha, this->y, (Real)y);
 }
 
-void Cluster::contMomentum(int64_t eventT, int64_t prevT) {
-    x = x + vel_x * (eventT - prevT);
-    y = y + vel_y * (eventT - prevT);
+template <typename Real>
+void BasicCluster<Real>::contMomentum(int64_t eventT, int64_t prevT) {
+    x = x + numeric::travel<Real>(vel_x, eventT - prevT);
+    y = y + numeric::travel<Real>(vel_y, eventT - prevT);
 }
 
-void Cluster::updateVelocity(unsigned int delay) {
-    vel_x = (x - prev_x) / (double)delay;
-    vel_y = (y - prev_y) / (double)delay;
+template <typename Real>
+void BasicCluster<Real>::updateVelocity(unsigned int delay) {
+    vel_x = numeric::Fine<Real>(x - prev_x) / delay;
+    vel_y = numeric::Fine<Real>(y - prev_y) / delay;
 
     prev_x = x;
     prev_y = y;
 }
 
-void Cluster::updateRadius(float growthFactor) {
+template <typename Real>
+void BasicCluster<Real>::updateRadius(float growthFactor) {
     radius *= growthFactor * ((40-radius)/15);
 }
 
-bool Cluster::aboveThreshold(unsigned int threshold) {
+template <typename Real>
+bool BasicCluster<Real>::aboveThreshold(unsigned int threshold) {
     return eventCount >= threshold;
 }
 
-bool Cluster::aboveThreshold(unsigned int threshold, unsigned int width, unsigned int height) {
+template <typename Real>
+bool BasicCluster<Real>::aboveThreshold(unsigned int threshold, unsigned int width, unsigned int height) {
     return eventCount >= threshold && x >= 0 && y >= 0 && x <= width && y <= height;
 }
 
-void Cluster::newEvent() {
+template <typename Real>
+void BasicCluster<Real>::newEvent() {
     eventCount++;
 }
 
 
-void Cluster::resetEvents() {
+template <typename Real>
+void BasicCluster<Real>::resetEvents() {
     eventCount = 0;
 }
 
-int Cluster::getSide(int width, int height) {
+template <typename Real>
+int BasicCluster<Real>::getSide(int width, int height) {
+  return getSide(EntranceBox{width*0.4, width*0.9, height*0.15, height*0.85, 5});
+}
 
-  double leftSide = (double)(width*0.4);
-  double rightSide = (double)(width*0.9);
-  double top = (double)(height*0.85);
-  double bottom = (double)(height*0.15);
+template <typename Real>
+int BasicCluster<Real>::getSide(const EntranceBox &entrance) const {
+  double margin = entrance.margin;
 
-  if (x > (leftSide + 5) && x < (rightSide - 5) && y > (bottom + 5) && y < (top - 5))
+  if (x > (entrance.left + margin) && x < (entrance.right - margin) && y > (entrance.top + margin) && y < (entrance.bottom - margin))
     return 1;
-  else if ((x < (leftSide - 5) || x > (rightSide + 5)) || (y < (bottom - 5) || y > (top + 5)))
+  else if ((x < (entrance.left - margin) || x > (entrance.right + margin)) || (y < (entrance.top - margin) || y > (entrance.bottom + margin)))
     return -1;
   return 0;
+}
 
-  /*
+template <typename Real>
+int BasicCluster<Real>::getCenterLineSide(int width) const {
   if (x < (double)(width/2 - 10))
     return -1;
   else if (x > (double)(width/2 + 10))
     return 1;
-  return 0;*/
+  return 0;
+}
+
+template <typename Real>
+int BasicCluster<Real>::updateSide(int width, int height) {
+  return updateSide(EntranceBox{width*0.4, width*0.9, height*0.15, height*0.85, 5});
+}
+
+template <typename Real>
+int BasicCluster<Real>::updateSide(const EntranceBox &entrance) {
+  return crossTo(getSide(entrance));
 }
 
-int Cluster::updateSide(int width, int height) {
-  int newSide = getSide(width, height);
+template <typename Real>
+int BasicCluster<Real>::crossTo(int newSide) {
   if (newSide != side && newSide != 0) {
     bool sideZero = (side == 0);
     side = newSide;
@@ -109,33 +155,74 @@ int Cluster::updateSide(int width, int height) {
   return 0;
 }
 
-void Cluster::draw(cv::Mat img) {
+template <typename Real>
+void BasicCluster<Real>::draw(cv::Mat img) {
     cv::rectangle(
         img, 
-        cv::Point(int(x - radius / 2), int(y - radius / 2)), 
-        cv::Point(int(x + radius / 2), int(y + radius / 2)), 
+        cv::Point(int(x - (Real)radius / 2), int(y - (Real)radius / 2)), 
+        cv::Point(int(x + (Real)radius / 2), int(y + (Real)radius / 2)), 
         color);
 }
 
-float Cluster::getRadius() {
-  return radius;
+template <typename Real>
+float BasicCluster<Real>::getRadius() const {
+  return (float)radius;
 }
-int Cluster::getX() {
-  return x;
+template <typename Real>
+int BasicCluster<Real>::getX() const {
+  return (int)x;
 }
-int Cluster::getY() {
-  return y;
+template <typename Real>
+int BasicCluster<Real>::getY() const {
+  return (int)y;
 }
-int Cluster::getID() {
+template <typename Real>
+int BasicCluster<Real>::getID() const {
   return id;
 }
+template <typename Real>
+cv::viz::Color BasicCluster<Real>::getColor() const {
+  return color;
+}
+
+template <typename Real>
+BasicClusterMotion<Real> BasicCluster<Real>::getMotion() const {
+  return {x, y, vel_x, vel_y, radius, alpha, eventCount};
+}
+
+template <typename Real>
+void BasicCluster<Real>::setMotion(const BasicClusterMotion<Real> &motion) {
+  x = motion.x;
+  y = motion.y;
+  vel_x = motion.velX;
+  vel_y = motion.velY;
+  radius = motion.radius;
+  alpha = motion.alpha;
+  eventCount = motion.eventCount;
+}
+
+template <typename Real>
+BasicClusterState<Real> BasicCluster<Real>::getState() const {
+  return {id, side, eventCount, posIndex, newFrequency, x, y, prev_x, prev_y, alpha, radius, vel_x, vel_y,
+    {color[0], color[1], color[2]}};
+}
 
 // overloading outstream operator to print info in csv format
-std::ostream& operator<<(std::ostream& out, const Cluster& src) {
+template <typename Real>
+std::ostream& operator<<(std::ostream& out, const BasicCluster<Real>& src) {
     out << src.x << "," << src.y << "," << src.radius << "," << src.vel_x << "," << src.vel_y << ", ";
     return out;
 }
 
-bool Cluster::operator==(const Cluster& comp) {
+template <typename Real>
+bool BasicCluster<Real>::operator==(const BasicCluster& comp) {
     return id == comp.id;
 }
+
+// the number types the trackers can be built with
+template class BasicCluster<double>;
+template class BasicCluster<float>;
+template class BasicCluster<Fixed16>;
+template std::ostream& operator<<(std::ostream& out, const BasicCluster<double>& src);
+template std::ostream& operator<<(std::ostream& out, const BasicCluster<float>& src);
+template std::ostream& operator<<(std::ostream& out, const BasicCluster<Fixed16>& src);
@@ -1,25 +1,70 @@
+#ifndef CLUSTER_H
+#define CLUSTER_H
+
 #include <opencv2/viz/types.hpp>
 #include <iostream>
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
 #include <cstdlib>
 #include <tgmath.h>
+#include <atomic>
+#include "numeric.hpp"
+
+// the part of a cluster that changes with every event
+// trackers copy this out so they can run the per-event loops over all clusters at once
+template <typename Real>
+struct BasicClusterMotion {
+    Real x, y;
+    numeric::Fine<Real> velX, velY, radius, alpha;
+    unsigned int eventCount;
+};
+
+using ClusterMotion = BasicClusterMotion<TrackerReal>;
+
+// everything a cluster holds, so trackers can write it to a checkpoint and build the cluster again
+template <typename Real>
+struct BasicClusterState {
+    int id, side;
+    unsigned int eventCount, posIndex;
+    bool newFrequency;
+    Real x, y, prevX, prevY;
+    numeric::Fine<Real> alpha, radius, velX, velY;
+    // blue, green and red
+    double color[3];
+};
+
+// the box clusters are counted crossing, in pixels, top is the smaller y
+// a cluster is inside once it is margin pixels within every edge and outside once it is margin pixels past one
+struct EntranceBox {
+    double left, right, top, bottom, margin;
+};
 
-class Cluster {
+// the ids handed out to clusters, shared by every number type
+// atomic so trackers running on different threads still hand out unique ids
+extern std::atomic<int> clusterGlobId;
+
+// Real is the number type of the position, velocity and radius, see TrackerReal in numeric.hpp
+// cluster.cpp holds the double, float and Fixed16 versions
+template <typename Real>
+class BasicCluster {
     private:
-        static int globId;
         int id, side{0};
         unsigned int eventCount{0}, posIndex{0};
         bool newFrequency{false};
-        double x, y, prev_x, prev_y;
-        double alpha, radius{25.0}, vel_x{0.0}, vel_y{0.0};
+        Real x, y, prev_x, prev_y;
+        numeric::Fine<Real> alpha;
+        numeric::Fine<Real> radius{25.0}, vel_x{0.0}, vel_y{0.0};
         cv::viz::Color color;
 
     public:
-        Cluster(unsigned int x, unsigned int y, cv::viz::Color color, float alpha);
+        BasicCluster(unsigned int x, unsigned int y, cv::viz::Color color, float alpha);
+
+        BasicCluster(unsigned int x, unsigned int y, float alpha);
 
-        Cluster(unsigned int x, unsigned int y, float alpha);
+        // the cluster getState() was called on, with the same id
+        explicit BasicCluster(const BasicClusterState<Real> &state);
 
+        // in pixels as a double whatever Real is, for the front ends that keep their own distance lists
         double distance(unsigned int x, unsigned int y);
 
         bool inRange(unsigned int x, unsigned int y);
@@ -44,14 +89,48 @@ class Cluster {
 
         int getSide(int width, int height);
 
+        int getSide(const EntranceBox &entrance) const;
+
+        // -1 left of the vertical center line, 1 right of it, 0 within 10 pixels of it
+        int getCenterLineSide(int width) const;
+
         int updateSide(int width, int height);
 
+        int updateSide(const EntranceBox &entrance);
+
+        // records the side the cluster is on now (0 keeps the last one), returns the crossing updateSide counts
+        int crossTo(int newSide);
+
         void resetEvents();
 
         void draw(cv::Mat img);
 
-        friend std::ostream& operator<<(std::ostream& out, const Cluster& src);
+        float getRadius() const;
 
-        bool operator==(const Cluster& comp);
+        int getX() const;
+
+        int getY() const;
+
+        int getID() const;
+
+        cv::viz::Color getColor() const;
+
+        BasicClusterMotion<Real> getMotion() const;
+
+        void setMotion(const BasicClusterMotion<Real> &motion);
+
+        BasicClusterState<Real> getState() const;
+
+        template <typename R>
+        friend std::ostream& operator<<(std::ostream& out, const BasicCluster<R>& src);
+
+        bool operator==(const BasicCluster& comp);
 
 };
+
+template <typename Real>
+std::ostream& operator<<(std::ostream& out, const BasicCluster<Real>& src);
+
+using Cluster = BasicCluster<TrackerReal>;
+
+#endif
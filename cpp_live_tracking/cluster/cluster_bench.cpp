@@ -0,0 +1,14 @@
+#include "cluster.hpp"
+#include <tracker/cluster_pool.hpp>
+#include <cluster_workload.hpp>
+
+// Microbenchmarks for the cpp_live_tracking cluster library, see benchmark/README.md
+// The sustain and birth benchmarks keep the clusters in the tracker's ClusterPool
+int main(int argc, char *argv[]) {
+    microbench::Suite suite("cpp_live_tracking/cluster");
+
+    auto make = [](unsigned int x, unsigned int y) { return Cluster(x, y, workload::alpha); };
+    workload::addCommonBenchmarks<ClusterPool>(suite, make, [](Cluster &cluster) { cluster.newEvent(); });
+
+    return suite.run(argc, argv);
+}
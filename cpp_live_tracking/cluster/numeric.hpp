@@ -0,0 +1,210 @@
+#ifndef NUMERIC_H
+#define NUMERIC_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <type_traits>
+
+// Fixed point with fractionBits of the 32 bits after the binary point, Fixed16 (Q16.16) is the one
+// the tracker uses for positions, radii and surface values, for boards without a fast FPU
+// Fixed16 holds -32768 to 32767.99998 in steps of 1/65536 (about 0.000015). Conversions, products and
+// quotients are rounded to the nearest step and saturate at the ends of the range. Sums and differences
+// do not saturate, the tracker's positions, radii and surface values stay well inside the range.
+// Multiplying or dividing by an integer (a time in microseconds, a cell count) keeps the integer whole,
+// so a velocity times a long gap does not overflow on the way.
+template <int fractionBits>
+class Fixed {
+    private:
+        static constexpr int64_t one = int64_t(1) << fractionBits;
+
+        int32_t raw{0};
+
+        // n / d rounded to the nearest integer, half away from zero
+        static constexpr int64_t roundedDivide(int64_t n, int64_t d) {
+            return ((n < 0) == (d < 0) ? n + d / 2 : n - d / 2) / d;
+        }
+
+    public:
+        static constexpr int32_t saturate(int64_t value) {
+            return (int32_t)std::clamp<int64_t>(value, std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max());
+        }
+
+        constexpr Fixed() = default;
+
+        template <typename T, std::enable_if_t<std::is_arithmetic_v<T>, int> = 0>
+        constexpr Fixed(T value) {
+            if constexpr (std::is_floating_point_v<T>) {
+                double scaled = std::clamp((double)value * one, (double)std::numeric_limits<int32_t>::min(),
+                    (double)std::numeric_limits<int32_t>::max());
+                raw = (int32_t)(scaled < 0 ? scaled - 0.5 : scaled + 0.5);
+            } else {
+                raw = saturate((int64_t)value * one);
+            }
+        }
+
+        // from another format, rounded when bits are dropped
+        template <int otherBits>
+        explicit constexpr Fixed(Fixed<otherBits> value) {
+            if constexpr (otherBits <= fractionBits) {
+                raw = saturate((int64_t)value.getRaw() << (fractionBits - otherBits));
+            } else {
+                raw = saturate(roundedDivide(value.getRaw(), int64_t(1) << (otherBits - fractionBits)));
+            }
+        }
+
+        static constexpr Fixed fromRaw(int32_t raw) {
+            Fixed value;
+            value.raw = raw;
+            return value;
+        }
+
+        constexpr int32_t getRaw() const { return raw; }
+
+        constexpr double toDouble() const { return (double)raw / one; }
+
+        explicit constexpr operator double() const { return toDouble(); }
+
+        explicit constexpr operator float() const { return (float)toDouble(); }
+
+        // towards zero, like a double cast to int
+        explicit constexpr operator int() const { return (int)(raw / one); }
+
+        friend constexpr Fixed operator+(Fixed a, Fixed b) { return fromRaw(a.raw + b.raw); }
+
+        friend constexpr Fixed operator-(Fixed a, Fixed b) { return fromRaw(a.raw - b.raw); }
+
+        friend constexpr Fixed operator-(Fixed a) { return fromRaw(-a.raw); }
+
+        friend constexpr Fixed operator*(Fixed a, Fixed b) {
+            return fromRaw(saturate(((int64_t)a.raw * b.raw + (one >> 1)) >> fractionBits));
+        }
+
+        friend constexpr Fixed operator/(Fixed a, Fixed b) {
+            return fromRaw(saturate(roundedDivide((int64_t)a.raw * one, b.raw)));
+        }
+
+        template <typename Integer, std::enable_if_t<std::is_integral_v<Integer>, int> = 0>
+        friend constexpr Fixed operator*(Fixed a, Integer n) { return fromRaw(saturate(a.raw * (int64_t)n)); }
+
+        template <typename Integer, std::enable_if_t<std::is_integral_v<Integer>, int> = 0>
+        friend constexpr Fixed operator/(Fixed a, Integer n) { return fromRaw(saturate(roundedDivide(a.raw, (int64_t)n))); }
+
+        constexpr Fixed &operator+=(Fixed b) { return *this = *this + b; }
+
+        constexpr Fixed &operator-=(Fixed b) { return *this = *this - b; }
+
+        constexpr Fixed &operator*=(Fixed b) { return *this = *this * b; }
+
+        constexpr Fixed &operator/=(Fixed b) { return *this = *this / b; }
+
+        friend constexpr bool operator==(Fixed a, Fixed b) = default;
+
+        friend constexpr auto operator<=>(Fixed a, Fixed b) = default;
+
+        friend std::ostream &operator<<(std::ostream &out, Fixed value) { return out << value.toDouble(); }
+};
+
+using Fixed16 = Fixed<16>;
+
+// The number type of the tracking engine (cluster positions, velocities and radii, and the blurred
+// time surface), chosen when building with -DTRACKER_NUMERIC=double|float|fixed
+// The cluster and tracker libraries hold all three, so a tool can also name one directly, e.g.
+// BasicTracker<Fixed16>, but build every directory with the same setting
+#if defined(TRACKER_NUMERIC_FIXED)
+using TrackerReal = Fixed16;
+#elif defined(TRACKER_NUMERIC_FLOAT)
+using TrackerReal = float;
+#else
+using TrackerReal = double;
+#endif
+
+// the calls the tracking engine makes on its numbers that are spelled differently for fixed point
+namespace numeric {
+    inline double abs(double value) { return std::fabs(value); }
+
+    inline float abs(float value) { return std::fabs(value); }
+
+    template <int bits>
+    constexpr Fixed<bits> abs(Fixed<bits> value) { return value < Fixed<bits>() ? -value : value; }
+
+    // the length of (a, b), the squares of a Fixed16 distance overflow it so they are summed as raw integers
+    inline double hypot(double a, double b) { return std::sqrt(a * a + b * b); }
+
+    inline float hypot(float a, float b) { return std::sqrt(a * a + b * b); }
+
+    template <int bits>
+    inline Fixed<bits> hypot(Fixed<bits> a, Fixed<bits> b) {
+        double rawA = a.getRaw(), rawB = b.getRaw();
+        return Fixed<bits>::fromRaw(Fixed<bits>::saturate(std::llround(std::sqrt(rawA * rawA + rawB * rawB))));
+    }
+
+    constexpr double toDouble(double value) { return value; }
+
+    constexpr double toDouble(float value) { return value; }
+
+    template <int bits>
+    constexpr double toDouble(Fixed<bits> value) { return value.toDouble(); }
+
+    // The values that change in steps too small for Q16.16, which are Q8.24 (up to 128 in steps of
+    // 0.00000006) when Real is Fixed16 and Real otherwise:
+    //  - velocities, in pixels per microsecond, a bee's are around 0.0001 and Q16.16 only resolves them
+    //    to 15 pixels a second, so the tracks drift
+    //  - the cluster radius, which settles where growth and shrinking balance and moves by less than a
+    //    Q16.16 step there, rounding every step pushes it off that balance
+    //  - alpha, 0.1 is 0.1000061 in Q16.16 and that error moves a cluster by about 0.00015 pixels with
+    //    every event it takes in, enough to put events on the other side of its radius
+    template <typename Real>
+    struct FineOf {
+        using type = Real;
+    };
+
+    template <>
+    struct FineOf<Fixed16> {
+        using type = Fixed<24>;
+    };
+
+    template <typename Real>
+    using Fine = typename FineOf<Real>::type;
+
+    // how far a velocity moves in a number of microseconds, as a position
+    template <typename Real>
+    constexpr Real travel(Fine<Real> velocity, int64_t microseconds) {
+        if constexpr (std::is_same_v<Real, Fixed16>) {
+            // the product is only rounded back to Q16.16 at the end
+            int64_t product = (int64_t)velocity.getRaw() * microseconds;
+            return Fixed16::fromRaw(Fixed16::saturate((product + (1 << 7)) >> 8));
+        } else {
+            return velocity * microseconds;
+        }
+    }
+
+    // (1 - alpha) * from + alpha * to, how far a cluster moves towards an event
+    template <typename Real>
+    constexpr Real blend(Fine<Real> alpha, Real from, Real to) {
+        if constexpr (std::is_same_v<Real, Fixed16>) {
+            // in Q16.40 and rounded once at the end, so a cluster that stays put is not pulled off by rounding
+            const int64_t one = int64_t(1) << 24;
+            int64_t sum = (one - alpha.getRaw()) * from.getRaw() + (int64_t)alpha.getRaw() * to.getRaw();
+            return Fixed16::fromRaw(Fixed16::saturate((sum + (one >> 1)) >> 24));
+        } else {
+            return (1 - alpha) * from + alpha * to;
+        }
+    }
+
+    // the name printed by the tools and benchmarks
+    template <typename Real>
+    constexpr const char *name() {
+        if constexpr (std::is_same_v<Real, double>) {
+            return "double";
+        } else if constexpr (std::is_same_v<Real, float>) {
+            return "float";
+        } else {
+            return "fixed";
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef CAMERA_SOURCE_H
+#define CAMERA_SOURCE_H
+
+#include <tracker/event_source.hpp>
+
+#include <dv-processing/core/core.hpp>
+#include <dv-processing/io/camera_capture.hpp>
+
+#include <iostream>
+#include <memory>
+#include <string>
+
+// A camera as an EventSource, kept out of the tracker library so only the live tools need libcaer
+class CameraSource : public EventSource {
+private:
+	dv::io::CameraCapture capture;
+
+public:
+	CameraSource(const std::string &cameraName, dv::io::CameraCapture::CameraType type) : capture(cameraName, type) {}
+
+	// for the bias and hold settings, which only a real camera has
+	dv::io::CameraCapture &getCapture() {
+		return capture;
+	}
+
+	std::optional<cv::Size> getEventResolution() const override {
+		return capture.getEventResolution();
+	}
+
+	bool isRunning() const override {
+		return capture.isRunning();
+	}
+
+	std::optional<dv::EventStore> getNextEventBatch() override {
+		return capture.getNextEventBatch();
+	}
+};
+
+// The camera, or the recording or synthetic scene given with --replay played back as one
+// Returns nothing (after printing why) if the replay cannot be opened
+inline std::unique_ptr<EventSource> openEventSource(const EventSourceOptions &options,
+	dv::io::CameraCapture::CameraType type = dv::io::CameraCapture::CameraType::Any) {
+	if (options.replay.empty()) {
+		return std::make_unique<CameraSource>("", type);
+	}
+
+	auto camera = std::make_unique<VirtualCamera>(options);
+	if (!camera->isOpen()) {
+		std::cerr << "Could not replay " << options.replay << ": " << camera->getError() << std::endl;
+		return nullptr;
+	}
+	std::cout << "Replaying " << options.replay << " instead of reading from a camera" << std::endl;
+	return camera;
+}
+
+// prints how the replay went, nothing for a real camera
+inline void printReplayStats(EventSource &source) {
+	if (auto *camera = dynamic_cast<VirtualCamera *>(&source)) {
+		std::cout << std::endl << camera->getStats().summary() << std::endl;
+	}
+}
+
+#endif
@@ -1,6 +1,8 @@
 // based on https://gitlab.com/inivation/dv/dv-processing/-/blob/rel_1.5/samples/io/aedat4-player.cpp
 
 #include <cluster/cluster.hpp>
+#include <tracker/recording_reader.hpp>
+#include <tracker/recording_index.hpp>
 
 #define LIBCAER_FRAMECPP_OPENCV_INSTALLED 0
 
@@ -26,9 +28,7 @@ using namespace cv;
 
 float readClusterLog(int * strIndex, string line);
 
-int main(void) {
-
-	namedWindow("Tracker Image");
+int main(int argc, char* argv[]) {
 
 	int64_t nextFrame = -1;
 	int64_t nextTime = -1;
@@ -37,23 +37,61 @@ int main(void) {
 
 	string filePath = "./event_log_10_7_board.aedat4";
 	//string filePath = "./event_log_beehive_9_18_hori.aedat4";
-	//cin >> filePath;
+	string logPath = "./cluster_log_10_7_board.csv";
+	//string logPath = "./cluster_log_beehive_9_18_hori.csv";
+
+	// recording and cluster log paths, --start=h:mm:ss / --end=h:mm:ss to only show part of the recording,
+	// and --reader=dv|mapped
+	RecordingRange range;
+	ReaderKind readerKind = ReaderKind::dv;
+	vector<string> positional;
+	for (int i = 1; i < argc; i++) {
+		bool ok = true;
+		if (range.parseArgument(argv[i], ok) || parseReaderArgument(argv[i], readerKind, ok)) {
+			if (!ok) {
+				cerr << "Could not read " << argv[i] << endl;
+				return (EXIT_FAILURE);
+			}
+			continue;
+		}
+		positional.push_back(argv[i]);
+	}
+	if (positional.size() > 0)
+		filePath = positional[0];
+	if (positional.size() > 1)
+		logPath = positional[1];
 
 	fstream clusterLog;
-	clusterLog.open("./cluster_log_10_7_board.csv");
-	//clusterLog.open("./cluster_log_beehive_9_18_hori.csv");
+	clusterLog.open(logPath);
 
-	auto reader = dv::io::MonoCameraRecording(filePath);
+	RecordingReader reader(filePath, readerKind);
 	string line;
 	getline(clusterLog, line);
 
-	// handler defines what happens when each stream has data
-	// streams include events, frames, and IMU
-	dv::io::DataReadHandler handler;
-
 	int64_t lastTimeStamp = -1;
 
-	const int imageWidth = 640, imageHeight = 480;
+	// retrieve the event resolution stored in the recording
+	std::optional<cv::Size> resolutionWrapper = reader.getEventResolution();
+	if (!reader.isOpen() || !resolutionWrapper.has_value()) {
+		cerr << "Could not read recording: " << reader.getError() << endl;
+		return (EXIT_FAILURE);
+	}
+
+	// move to the start of the range, and past the log rows from before it
+	if (!range.seek(reader, filePath))
+		return (EXIT_FAILURE);
+	if (range.isRequested()) {
+		std::streampos rowStart = clusterLog.tellg();
+		string row;
+		while (getline(clusterLog, row) && row.size() >= 16 && stol(row.substr(0, 16)) < range.getFrom())
+			rowStart = clusterLog.tellg();
+		clusterLog.clear();
+		clusterLog.seekg(rowStart);
+	}
+
+	namedWindow("Tracker Image");
+
+	const int imageWidth = resolutionWrapper.value().width, imageHeight = resolutionWrapper.value().height;
 	Mat tsImg(imageHeight, imageWidth, CV_8UC3, Scalar(1));
 
 	vector<float> cluster_x = vector<float>();
@@ -61,8 +99,8 @@ int main(void) {
 	vector<float> cluster_r = vector<float>();
 
 	// define a function for when the file reader encounters an event packet
-	handler.mEventHandler = [&tsImg, &lastTimeStamp, &imageWidth, &imageHeight,
-	&nextFrame, &clusterLog, &nextTime, &cluster_x, &cluster_y, &cluster_r, &line](const dv::EventStore &nextEvent) {
+	auto handleEvents = [&tsImg, &lastTimeStamp, &imageWidth, &imageHeight,
+	&nextFrame, &clusterLog, &nextTime, &cluster_x, &cluster_y, &cluster_r, &line](std::span<const dv::Event> nextEvent) {
 		const double imgScaleFactor = 0.7;
 
 	// Frame rate is used to control the display
@@ -81,23 +119,20 @@ int main(void) {
 		string strTimestamp;
 
 
-		if (nextEvent.isEmpty())
+		if (nextEvent.empty())
 			return;
 
 		// make sure you get the first timestamp
 		if (lastTimeStamp < 0)
-			lastTimeStamp = nextEvent.getLowestTime();
+			lastTimeStamp = nextEvent.front().timestamp();
 
 		// use total time elapsed from end of last packet to end of this one
 		// to determine the delay length
-		int64_t timeElapsed = nextEvent.getHighestTime() - lastTimeStamp;
-		lastTimeStamp = nextEvent.getHighestTime();
-
-		// extract the events from the EventStore
-		dv::cvector<dv::Event> events = nextEvent.toPacket().elements;
+		int64_t timeElapsed = nextEvent.back().timestamp() - lastTimeStamp;
+		lastTimeStamp = nextEvent.back().timestamp();
 
-		for (int k = 0; k < (events.size()); k++) {
-			dv::Event event = events.at(k);
+		// the events are read in place from the decoded packet
+		for (const dv::Event &event : nextEvent) {
 
 			int64_t timeStamp = event.timestamp();
 			uint16_t x = event.x();
@@ -133,20 +168,24 @@ int main(void) {
 				cluster_r = vector<float>();
 
 				strIndex ++;
-				if (line[strIndex] != ',') {
-					while (line[strIndex] != ',' && line[strIndex] != '\n') {
+				// each cluster keeps its own column, so empty columns can sit between clusters
+				while (strIndex < (int)line.size() && line[strIndex] != '\n') {
+					if (line[strIndex] == ',') {
+						// skip the five empty values of an unused column
+						strIndex += 5;
+						continue;
+					}
 
-						float values[5];
-						for (int i = 0; i < 5; i ++) {
-							values[i] = readClusterLog(&strIndex, line);
-						}
+					float values[5];
+					for (int i = 0; i < 5; i ++) {
+						values[i] = readClusterLog(&strIndex, line);
+					}
 
-						cluster_x.push_back(values[0]);
-						cluster_y.push_back(values[1]);
-						cluster_r.push_back(values[2]);
+					cluster_x.push_back(values[0]);
+					cluster_y.push_back(values[1]);
+					cluster_r.push_back(values[2]);
 
-						strIndex ++;
-					}
+					strIndex ++;
 				}
 				line = tempLine;
 			}
@@ -174,9 +213,15 @@ int main(void) {
 
 	};
 
-	// automatically reads the file to the end, calling the correct handler
-	// when data is found in the corresponding stream
-	reader.run(handler);
+	// reads the file to the end of the range on a second thread, a few packets ahead of the handler
+	std::span<const dv::Event> nextEvent;
+	while (reader.next(nextEvent) && !range.isPast(nextEvent)) {
+		handleEvents(range.clip(nextEvent));
+	}
+	printf("%s\n", reader.getStats().summary().c_str());
+	if (!reader.getError().empty()) {
+		cerr << "Stopped reading recording: " << reader.getError() << endl;
+	}
 
 	// Close automatically done by destructor.
 
@@ -0,0 +1,133 @@
+#include <tracker/tracker.hpp>
+#include <tracker/tracker_config.hpp>
+#include <tracker/read_ahead.hpp>
+#include <tracker/recording_reader.hpp>
+#include <tracker/recording_compactor.hpp>
+#include "constants.hpp"
+
+#include <dv-processing/core/core.hpp>
+#include <dv-processing/io/mono_camera_recording.hpp>
+
+#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Rewrites a recording the way the recorder does with its compaction options: split into files by
+// size or time, optionally keeping only the events near the entrance or a cluster, with any compression.
+// The output is then replayed through a new tracker and its counts are compared with the original's,
+// so a filter that loses crossings shows up straight away.
+int main(int argc, char* argv[])
+{
+	CompactionConfig compaction;
+	bool verify = true;
+	ReaderKind readerKind = ReaderKind::dv;
+	std::vector<std::string> positional;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool ok = true;
+		if (parseCompactionArgument(argv[i], compaction, ok) || parseReaderArgument(argv[i], readerKind, ok))
+		{
+			if (!ok)
+			{
+				std::cerr << "Could not read " << argv[i] << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+		else if (std::strcmp(argv[i], "--no-verify") == 0)
+		{
+			verify = false;
+		}
+		else
+		{
+			positional.push_back(argv[i]);
+		}
+	}
+	if (positional.size() != 2)
+	{
+		std::cout << "Usage: ./compact_recording.exe <input.aedat4> <output-prefix> [--rotate-mb=N] [--rotate-minutes=N] [--filter] "
+			"[--margin=pixels] [--pre-roll=ms] [--compression=none|lz4|lz4-high|zstd|zstd-high] [--no-verify] [--reader=dv|mapped]" << std::endl;
+		return EXIT_FAILURE;
+	}
+	const std::string inputPath = positional[0], outputPrefix = positional[1];
+
+	dv::io::MonoCameraRecording reader(inputPath);
+	std::optional<cv::Size> resolutionWrapper = reader.getEventResolution();
+	if (!resolutionWrapper.has_value())
+	{
+		std::cerr << "Could not retrieve event resolution from recording" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	// the same settings file as the other tools, both trackers below use it
+	Tracker tracker(resolutionWrapper.value());
+	TrackerConfig trackerConfig = tracker.getConfig();
+	if (std::filesystem::exists(constants::trackerSettings))
+	{
+		readTrackerConfig(constants::trackerSettings, trackerConfig);
+	}
+	tracker.setConfig(trackerConfig);
+
+	RecordingCompactor compactor(outputPrefix, reader.getCameraName(), resolutionWrapper.value(), compaction);
+	ReadAhead readAhead(reader);
+	dv::EventStore events;
+	while (readAhead.next(events))
+	{
+		tracker.processEvents(events);
+		compactor.write(events, tracker);
+	}
+	compactor.finish(tracker);
+	if (!readAhead.getError().empty())
+	{
+		std::cerr << "Stopped reading recording: " << readAhead.getError() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::error_code error;
+	double inputMegabytes = std::filesystem::file_size(inputPath, error) / 1e6;
+	double outputMegabytes = 0;
+	for (const std::string &file : compactor.getFiles())
+	{
+		outputMegabytes += std::filesystem::file_size(file, error) / 1e6;
+	}
+	printf("Wrote %zu files, %.1f MB from %.1f MB (%.1f%%)\n", compactor.getFiles().size(), outputMegabytes, inputMegabytes,
+		100.0 * outputMegabytes / inputMegabytes);
+	printf("Kept %llu of %llu events (%.1f%%)\n", (unsigned long long)compactor.getEventsKept(),
+		(unsigned long long)compactor.getEventsIn(), 100.0 * compactor.getEventsKept() / std::max<uint64_t>(1, compactor.getEventsIn()));
+	if (!verify)
+	{
+		return 0;
+	}
+
+	// the files are replayed in order through one tracker, as if they were still one recording,
+	// --reader= picks what reads them back
+	Tracker replay(resolutionWrapper.value());
+	replay.setConfig(trackerConfig);
+	for (const std::string &file : compactor.getFiles())
+	{
+		RecordingReader output(file, readerKind);
+		std::span<const dv::Event> packet;
+		while (output.next(packet))
+		{
+			replay.processEvents(packet);
+		}
+		if (!output.isOpen() || !output.getError().empty())
+		{
+			std::cerr << "Could not read back " << file << ": " << output.getError() << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	printf("Original: %d crossed, %d net\n", tracker.getTotalCrossing(), tracker.getNetCrossing());
+	printf("Replayed: %d crossed, %d net\n", replay.getTotalCrossing(), replay.getNetCrossing());
+	if (replay.getTotalCrossing() != tracker.getTotalCrossing() || replay.getNetCrossing() != tracker.getNetCrossing())
+	{
+		std::cerr << "The compacted recording does not give the same counts, try a larger --margin or --pre-roll" << std::endl;
+		return EXIT_FAILURE;
+	}
+	return 0;
+}
@@ -1,4 +1,11 @@
 #include <cluster/cluster.hpp>
+#include <tracker/tracker.hpp>
+#include <tracker/tracker_config.hpp>
+#include <tracker/renderer.hpp>
+#include <tracker/load_governor.hpp>
+#include <tracker/async_log.hpp>
+#include <tracker/track_publisher.hpp>
+#include "camera_source.hpp"
 #include "constants.hpp"
 
 #include <dv-processing/core/core.hpp>
@@ -17,214 +24,171 @@
 #include <csignal>
 #include <chrono>
 #include <cstdlib>
+#include <thread>
 
 int main(int argc, char* argv[])
 {
-	// choice of colors
-	const int numColors = 8;
-	int colorIndex = 0;
-	const cv::viz::Color colors[numColors] = {cv::viz::Color::amethyst(), cv::viz::Color::navy(),
-                                	cv::viz::Color::orange(), cv::viz::Color::red(),
-									cv::viz::Color::yellow(), cv::viz::Color::pink(),
-									cv::viz::Color::lime(), cv::viz::Color::cyan()};
-
-	cv::namedWindow("Tracker Image");
-
-	std::vector<Cluster> clusters = std::vector<Cluster>();
-
-	// create a capture object to read events from any DVS device connected
-	dv::io::CameraCapture capture("", dv::io::CameraCapture::CameraType::DVS);
+	// read events from any DVS device connected, or with --replay from a recording played back like one
+	EventSourceOptions sourceOptions;
+	bool shedding = true;
+	std::string publishName;
+	for (int i = 1; i < argc; i++)
+	{
+		bool ok = true;
+		if (std::string(argv[i]) == "--no-shedding")
+		{
+			shedding = false;
+		}
+		else if (!(parseEventSourceArgument(argv[i], sourceOptions, ok) || parsePublishArgument(argv[i], publishName, ok)) || !ok)
+		{
+			std::cerr << "Could not read " << argv[i] << std::endl;
+			std::cerr << "Options: [--replay=<recording.aedat4|synthetic:<settings>>] [--speed=<N|max>] [--buffer=<packets>] [--reader=dv|mapped] [--no-shedding]"
+				" [--publish=<name>]" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+	std::unique_ptr<EventSource> source = openEventSource(sourceOptions, dv::io::CameraCapture::CameraType::DVS);
+	if (!source)
+	{
+		return EXIT_FAILURE;
+	}
+	EventSource &capture = *source;
 
 	// initialize to negative values to signal needed update
 	// all timestamps are 64-bit ints to avoid overflow/wraparound
-    int64_t nextTime = capture.getTimestampOffset();
-    int64_t nextFrame = capture.getTimestampOffset();
-    int64_t nextSustain = capture.getTimestampOffset();
-	int64_t prevTime = capture.getTimestampOffset();
+	int64_t nextFrame = -1;
 
 	// retrieve the event resolution
 	std::optional<cv::Size> resolutionWrapper = capture.getEventResolution();
 
-	int imageWidth, imageHeight;
-	int netCrossing = 0, totalCrossing = 0;
-
-	// extract the width and height of the camera resolution
-	if (resolutionWrapper.has_value())
-	{
-		imageWidth = resolutionWrapper.value().width;
-		imageHeight = resolutionWrapper.value().height;
-	} 
-	else
+	if (!resolutionWrapper.has_value())
 	{
 		std::cerr << "Could not retrieve camera resolution" << std::endl;
+		return EXIT_FAILURE;
 	}
 
-	// Initializes a screen - its grayscale but uses 3 channels so that clusters can be drawn on the screen in RGB
-	cv::Mat tsImg(imageHeight, imageWidth, CV_8UC3, cv::Scalar(1));
-	// Initializes the blurred time surface, used to control the creation of new clusters
-	cv::Mat tsBlurred(imageHeight / constants::blurScale, imageWidth / constants::blurScale, CV_64FC1, cv::Scalar(0));
+	Tracker tracker(resolutionWrapper.value());
+
+	// tracker settings are read from the settings file now and again whenever it is saved,
+	// the tracker switches to them between batches without losing its clusters
+	TrackerConfig trackerConfig = tracker.getConfig();
+	TrackerConfigWatcher settings(constants::trackerSettings, trackerConfig, [&tracker](const TrackerConfig &config) { tracker.requestConfig(config); });
+	tracker.setConfig(trackerConfig);
+	// the window is drawn on the main thread while events are processed on another one,
+	// it keeps the time surface from the off events handed to it
+	Renderer renderer("Tracker Image", resolutionWrapper.value());
+	renderer.reportTo(tracker.getStats());
+	StatsDump statsDump(constants::trackerStats, std::chrono::seconds(constants::statsPeriod));
+
+	// when processing falls behind the camera, the governor gives up the window first, then the tracker's work
+	// on on events and last some of the events away from the entrance, instead of letting the backlog grow
+	GovernorConfig governorConfig;
+	governorConfig.speed = sourceOptions.speed;
+	// the on event tier saves nothing when the tracker skips on events anyway
+	governorConfig.dropOnEvents = Tracker::usesOnEvents;
+	LoadGovernor governor(governorConfig);
+
+	// the counts are printed on a thread of their own, not between packets
+	AsyncLog console(std::cout);
+	// cluster states and crossings for other processes on this machine, see tracker/track_ring.hpp
+	TrackRingWriter ring;
+	if (!publishName.empty() && !ring.open(publishName))
+	{
+		return EXIT_FAILURE;
+	}
 
-	// infinite loop as long as a shutdown signal is not sent
-	while (capture.isRunning())
+	std::thread trackingThread([&capture, &tracker, &renderer, &statsDump, &nextFrame, &governor, &console, &ring, shedding]()
 	{
-		auto eventsWrapper = capture.getNextEventBatch();
-		// if there have been events
-		if (eventsWrapper.has_value())
+		int lastTotalCrossing = 0;
+
+		// infinite loop as long as a shutdown signal is not sent
+		while (capture.isRunning())
 		{
-			dv::EventStore events = eventsWrapper.value();
+			auto eventsWrapper = capture.getNextEventBatch();
+			// if there have been events
+			if (!eventsWrapper.has_value())
+			{
+				continue;
+			}
 
-			// loop through each event in the batch
-			for (int i = 0; i < events.size(); i++)
+			if (shedding)
 			{
-				dv::Event event = events.at(i);
+				governor.update(eventsWrapper.value().getHighestTime());
+				tracker.setDropOnEvents(!governor.onEventsEnabled());
+			}
 
-				int64_t timeStamp = event.timestamp();
-				uint16_t x = event.x();
-				uint16_t y = event.y();
-				bool pol = event.polarity();
+			// the tracker takes the whole batch at once, the loop after it only keeps the time surface and the window going
+			// while shedding, both get the events the governor kept
+			auto trackAndDraw = [&](const auto &events)
+			{
+				tracker.processEvents(events);
+				statsDump.update(tracker.getStats());
+				publishTracks(ring, tracker, eventsWrapper.value().getHighestTime());
 
-				// only update on off spikes
-				if (!pol) 
+				if (tracker.getTotalCrossing() != lastTotalCrossing)
 				{
-					// Updates the time surface - this is purely for visualization purposes at this point
-					tsImg.at<cv::Vec3b>(y, x) = cv::Vec3b(255, 255, 255);
-					// Increases the value of the corresponding region in the blurred time surface
-					tsBlurred.at<double>(y / constants::blurScale, x / constants::blurScale) += constants::blurIncreaseFactor;
-
-					// Finds the distance of the event from each existing cluster
-					Cluster *minCluster = NULL;
-					double minDistance = imageWidth + imageHeight;
+					TRACKER_STAGE(tracker.getStats().stage(Stage::logging));
+					lastTotalCrossing = tracker.getTotalCrossing();
+					console.write(CrossingCountMessage{tracker.getTotalCrossing(), tracker.getNetCrossing()});
+				}
 
-					for (int i = 0; i < clusters.size(); i++) 
+				// loop through each event in the batch
+				for (const dv::Event &event : events)
+				{
+					if (event.polarity() && !governor.onEventsEnabled())
 					{
-						double newDist = clusters.at(i).distance(x, y);
-
-						// keep track of the min dist and the cluster associated with it
-						if (newDist < minDistance) 
-						{
-							minDistance = newDist;
-							minCluster = &clusters.at(i);
-						}
-
-						// continue movement based on velocity and time elapsed
-						clusters.at(i).contMomentum(timeStamp, prevTime);
+						continue;
 					}
+					int64_t timeStamp = event.timestamp();
 
-					if (minCluster != NULL)
+					if (nextFrame < 0)
 					{
-						// If the event is inside the closest cluster, it updates the location of that cluster
-						if ((*minCluster).inRange(x, y)) 
-						{
-							clusters.at(minDistance).shift(x, y);
-							clusters.at(minDistance).newEvent();
-
-						} // If there is an event very near but outside the cluster, increase the cluster's radius
-						else if ((*minCluster).borderRange(x, y)) 
-						{
-							clusters.at(minDistance).updateRadius(constants::radiusGrowth);
-						}
+						nextFrame = timeStamp;
 					}
 
-					prevTime = timeStamp;
-				} // end polarity check
-
-				// exponential decay of blurred time surface
-				tsBlurred *= constants::scaleFactor;
-				// enforce maximum value of 1
-				threshold(tsBlurred, tsBlurred, 1, 1, cv::THRESH_TRUNC);
-
-				// only update clusters after a certain period of time
-				// this is a costly computation, so is not performed with every event
-				if (timeStamp > nextTime) 
-				{
-					nextTime += constants::delayTime;
-
-					// check of clusters need to be deleted
-					if (timeStamp > nextSustain) 
+					// only update on off spikes
+					if (!event.polarity() && governor.surfaceEnabled())
 					{
-						nextSustain += constants::clusterSustainTime;
-
-						for (int i = 0; i < clusters.size(); i ++) 
-						{
-							// delete a cluster if it did not have enough events
-							Cluster cluster = clusters.at(i);
-							if (!cluster.aboveThreshold(constants::clusterSustainThresh, imageWidth, imageHeight))
-							{
-								clusters.erase(remove(clusters.begin(), clusters.end(), cluster), clusters.end());
-							}
-							else // if it's above the threshold, reset the number of events
-							{
-								clusters.at(i).resetEvents();
-							}
-						}
+						// Updates the time surface - this is purely for visualization purposes at this point
+						renderer.addEvent(event.x(), event.y());
 					}
 
-					for (int i = 0; i < imageWidth / constants::blurScale && clusters.size() < constants::maxClusters; i++) 
-					{
-						for (int j = 0; j < imageHeight / constants::blurScale && clusters.size() < constants::maxClusters; j++) 
-						{
-							// Adds a new cluster if three criteria are met:
-							// The region must be greater than the cluster initialization threshold
-							// The region can't be inside an already existing cluster
-							// There can't be more clusters than the max limit
-							if (tsBlurred.at<double>(j,i) > constants::clusterInitThresh) 
-							{
-								bool alreadyAdded = false;
-
-								// check that it is not inside an already existing cluster
-								for (Cluster cluster : clusters) 
-								{
-									if (cluster.otherClusterRange(i * constants::blurScale, j * constants::blurScale)) 
-									{
-										alreadyAdded = true;
-									}
-								}
-
-								// create a new cluster if it doesn't already exist
-								if (!alreadyAdded) 
-								{
-									Cluster newCluster = Cluster(i * constants::blurScale, j * constants::blurScale, colors[colorIndex++ % numColors], constants::alpha);
-									clusters.push_back(newCluster);
-								}
-							}
-						}
-					} // end blurred matrix loop
-
-					// update the velocity and shrink the radius
-					for (int i = 0; i < clusters.size(); i++) 
-					{
-						clusters.at(i).updateVelocity(constants::delayTime);
-						clusters.at(i).updateRadius(constants::radiusShrink);
-						int newCrossing = clusters.at(i).updateSide(imageWidth, imageHeight);
-	     				if (newCrossing != 0) 
-	     				{
-	     					netCrossing -= newCrossing;
-	     					totalCrossing++;
-	     					std::cout << "Total Crossed: " << totalCrossing << "\t Net Crossed: " << netCrossing << "\r";
-	              			std::cout.flush();
-						}
-					} // end cluster updates
 					// display update condition
 					if (timeStamp > nextFrame)
 					{
 						nextFrame += constants::displayTime;
-						// copy of time surface matrix to draw clusters on
-						cv::Mat trackImg(imageHeight, imageWidth, CV_8UC3, cv::Scalar(1));
-						tsImg.copyTo(trackImg);
-						// draw each cluster
-						for (Cluster cluster : clusters)
+						// hand a snapshot to the render thread, this does not wait for the window to be drawn
+						if (governor.renderEnabled())
 						{
-							cluster.draw(trackImg);
+							renderer.submit(tracker, timeStamp);
 						}
-						cv::imshow("Tracker Image", trackImg);
-						cv::waitKey(1);
 
 						// time surface exponential decay
-						tsImg *= constants::imgScaleFactor;
+						renderer.nextFrame();
 					}
 				}
+			};
+
+			if (governor.isShedding())
+			{
+				governor.shed(eventsWrapper.value(), tracker.getEntrance(), trackAndDraw);
+			}
+			else
+			{
+				trackAndDraw(eventsWrapper.value());
 			}
 		}
+		renderer.stop();
+	});
+
+	renderer.run();
+	trackingThread.join();
+	console.close();
+	statsDump.write(tracker.getStats());
+	printReplayStats(capture);
+	if (shedding)
+	{
+		std::cout << governor.getStats().summary() << std::endl;
 	}
 	return 0;
-}
\ No newline at end of file
+}
@@ -1,4 +1,11 @@
 #include <cluster/cluster.hpp>
+#include <tracker/tracker.hpp>
+#include <tracker/tracker_config.hpp>
+#include <tracker/recording_compactor.hpp>
+#include <tracker/checkpoint.hpp>
+#include <tracker/async_log.hpp>
+#include <tracker/track_publisher.hpp>
+#include "camera_source.hpp"
 #include "constants.hpp"
 
 #include <dv-processing/core/core.hpp>
@@ -16,6 +23,7 @@
 #include <atomic>
 #include <csignal>
 #include <chrono>
+#include <cstdio>
 #include <future>
 #include <thread>
 
@@ -26,25 +34,93 @@ static std::string inputWait()
 	return input;
 }
 
+// one row of the cluster log, copied out of the tracker on the event thread and written to the file on the
+// log's thread
+struct ClusterRowMessage
+{
+	struct Column
+	{
+		bool present;
+		double x, y, radius, velX, velY;
+	};
+
+	int64_t timeStamp;
+	int totalCrossing, netCrossing;
+	// a cluster keeps the same column for as long as it exists
+	Column columns[constants::maxClusters];
+
+	static void format(const ClusterRowMessage &message, std::string &text)
+	{
+		char field[160];
+		snprintf(field, sizeof(field), "%lld: %d,%d, ", (long long)message.timeStamp, message.totalCrossing, message.netCrossing);
+		text += field;
+		for (const Column &column : message.columns)
+		{
+			if (column.present)
+			{
+				// the same as writing the cluster to a stream
+				snprintf(field, sizeof(field), "%g,%g,%g,%g,%g, ", column.x, column.y, column.radius, column.velX, column.velY);
+				text += field;
+			}
+			else // create empty columns if no cluster exists
+			{
+				text += ",,,,,";
+			}
+		}
+		text += '\n';
+	}
+};
+
 int main(int argc, char* argv[])
 {
 	// initialize to negative values to signal needed update
 	// all timestamps are 64-bit ints to avoid overflow/wraparound
-    int64_t nextTime = -1;
     int64_t nextFrame = -1;
-    int64_t nextSustain = -1;
-	int64_t prevTime = -1;
 
-    int netCrossing = 0;
-    int totalCrossing = 0;
+    int lastTotalCrossing = 0;
 
-    std::vector<Cluster> clusters = std::vector<Cluster>();
+	// the compaction options (the same as compact_recording.exe) split the event log up and compress it,
+	// the replay options play a recording back instead of using a camera
+	// the checkpoint options keep the counts and clusters over a restart
+	CompactionConfig compaction;
+	EventSourceOptions sourceOptions;
+	CheckpointOptions checkpointOptions;
+	std::string publishName;
+	for (int i = 1; i < argc; i++)
+	{
+		bool ok = true;
+		if (!(parseCompactionArgument(argv[i], compaction, ok) || parseEventSourceArgument(argv[i], sourceOptions, ok)
+			|| parseCheckpointArgument(argv[i], checkpointOptions, ok) || parsePublishArgument(argv[i], publishName, ok)) || !ok)
+		{
+			std::cerr << "Could not read " << argv[i] << std::endl;
+			std::cerr << "Options: [--rotate-mb=N] [--rotate-minutes=N] [--compression=none|lz4|lz4-high|zstd|zstd-high]" << std::endl;
+			std::cerr << "  [--replay=<recording.aedat4|synthetic:<settings>>] [--speed=<N|max>] [--buffer=<packets>] [--reader=dv|mapped]" << std::endl;
+			std::cerr << "  [--checkpoint=<file>] [--checkpoint-every=<seconds>] [--resume=<file>] [--publish=<name>]" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+	// the dropped events still decay the blurred time surface and time the cluster updates, so a filtered
+	// log would not replay to the same counts, and this log is the only copy of the events
+	if (compaction.filter)
+	{
+		std::cerr << "--filter is not available while recording, the filtered log would not replay to the same counts. "
+			"Use compact_recording.exe on a copy instead" << std::endl;
+		return EXIT_FAILURE;
+	}
 
 	// create a capture object to read events from any DVS device connected
-	dv::io::CameraCapture capture("");
+	std::unique_ptr<EventSource> source = openEventSource(sourceOptions);
+	if (!source)
+	{
+		return EXIT_FAILURE;
+	}
+	EventSource &capture = *source;
 
-	capture.setDVSGlobalHold(false);
-	capture.setDVSBiasSensitivity(dv::io::CameraCapture::BiasSensitivity::High);
+	if (auto *camera = dynamic_cast<CameraSource *>(source.get()))
+	{
+		camera->getCapture().setDVSGlobalHold(false);
+		camera->getCapture().setDVSBiasSensitivity(dv::io::CameraCapture::BiasSensitivity::High);
+	}
 	
 	// retrieve the event resolution
 	std::optional<cv::Size> resolutionWrapper = capture.getEventResolution();
@@ -60,15 +136,34 @@ int main(int argc, char* argv[])
 	else 
 	{
 		std::cerr << "Could not retrieve camera resolution" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	Tracker tracker(resolutionWrapper.value());
+
+	// carry on counting from where the last run stopped, the settings file still applies on top
+	CheckpointPosition position;
+	bool resumed = false;
+	if (!checkpointOptions.resume.empty())
+	{
+		if (!tracker.loadCheckpoint(checkpointOptions.resume, position))
+		{
+			return EXIT_FAILURE;
+		}
+		resumed = true;
+		lastTotalCrossing = tracker.getTotalCrossing();
+		std::cout << "Resumed from " << checkpointOptions.resume << " with " << tracker.getTotalCrossing() << " crossed" << std::endl;
 	}
 
-	// Initializes the blurred time surface, used to control the creation of new clusters
-    cv::Mat tsBlurred(imageHeight / constants::blurScale, imageWidth / constants::blurScale, CV_64FC1, cv::Scalar(0));
+	// tracker settings are read from the settings file now and again whenever it is saved,
+	// the tracker switches to them between batches without losing its clusters
+	TrackerConfig trackerConfig = tracker.getConfig();
+	TrackerConfigWatcher settings(constants::trackerSettings, trackerConfig, [&tracker](const TrackerConfig &config) { tracker.requestConfig(config); });
+	tracker.setConfig(trackerConfig);
 	cv::Mat tsImg(imageHeight, imageWidth, CV_8UC3, cv::Scalar(1));
 
-	// configure log file for events
-	auto config = dv::io::MonoCameraWriter::EventOnlyConfig("Xplorer", cv::Size(imageWidth, imageHeight));
-	dv::io::MonoCameraWriter eventLog("./event_log_001.aedat4", config);
+	// configure log files for events, event_log_001.aedat4 and on, by default everything goes into one file
+	RecordingCompactor eventLog("./event_log", "Xplorer", cv::Size(imageWidth, imageHeight), compaction);
 
 	// log file for clusters
 	std::ofstream clusterLog;
@@ -129,178 +224,95 @@ int main(int argc, char* argv[])
 					tsImg *= constants::imgScaleFactor;
 				}
 			}
-			eventLog.writeEvents(events);
+			eventLog.write(events, tracker);
 		}
 	}
+	// checkpoints are written every --checkpoint-every seconds, on SIGUSR1, and on SIGTERM or Ctrl+C before
+	// the recorder stops, from here on so Ctrl+C still quits straight away while waiting for the input
+	CheckpointSchedule checkpoints(checkpointOptions);
+
+	// the counts and the cluster log are written on threads of their own, not between events
+	AsyncLog console(std::cout);
+	AsyncLog clusterRows(clusterLog);
+	ClusterRowMessage row;
+	// cluster states and crossings for other processes on this machine, see tracker/track_ring.hpp
+	TrackRingWriter ring;
+	if (!publishName.empty() && !ring.open(publishName))
+	{
+		return EXIT_FAILURE;
+	}
+
 	// infinite loop as long as a shutdown signal is not sent
-	while (capture.isRunning())
+	while (capture.isRunning() && !checkpoints.isStopping())
 	{
 		std::optional<dv::EventStore> eventsWrapper = capture.getNextEventBatch();
 		// if there have been events
 		if (eventsWrapper.has_value())
 		{
 			dv::EventStore events = eventsWrapper.value();
+			if (events.isEmpty())
+			{
+				continue;
+			}
 
-			// loop through each event in the batch
-			for (int i = 0; i < events.size(); i++)
+			// the camera's clock started again with this run, the timers carry on from the checkpoint's time
+			if (resumed)
 			{
-        		dv::Event event = events.at(i);
+				tracker.shiftTime(events.getLowestTime() - position.time);
+				resumed = false;
+			}
 
+			// loop through each event in the batch
+			for (const dv::Event &event : events)
+			{
 				int64_t timeStamp = event.timestamp();
-				uint16_t x = event.x();
-				uint16_t y = event.y();
-				bool pol = event.polarity();
 
-				// set initial timestamps
-				if (prevTime < 0)
-				{
-					prevTime = timeStamp;
-				}
-				if (nextTime < 0)
+				// log the clusters every time they are updated
+				if (!tracker.processEvent(timeStamp, event.x(), event.y(), event.polarity()))
 				{
-					nextTime = timeStamp;
-				}
-				if (nextFrame < 0)
-				{
-					nextFrame = timeStamp;
+					continue;
 				}
-				if (nextSustain < 0)
-				{
-					nextSustain = timeStamp;
-				}
-				// only update on off spikes
-				if (!pol)
+
+				TRACKER_STAGE(tracker.getStats().stage(Stage::logging));
+				publishTracks(ring, tracker, timeStamp);
+				if (tracker.getTotalCrossing() != lastTotalCrossing)
 				{
-					// Updates the time surface - this is purely for visualization purposes at this point
-					// Increases the value of the corresponding region in the blurred time surface
-					tsBlurred.at<double>(y / constants::blurScale, x / constants::blurScale) += constants::blurIncreaseFactor;
-					// Finds the distance of the event from each existing cluster
-					Cluster *minCluster = NULL;
-					double minDistance = imageWidth + imageHeight;
-					for (int i = 0; i < clusters.size(); i++)
-					{
-						double newDist = clusters.at(i).distance(x, y);
-						// keep track of the min dist and the cluster associated with it
-						if (newDist < minDistance)
-						{
-							minDistance = newDist;
-							minCluster = &clusters.at(i);
-						}
-						// continue movement based on velocity and time elapsed
-						clusters.at(i).contMomentum(timeStamp, prevTime);
-					}
-					if (minCluster != NULL)
-					{
-						// If the event is inside the closest cluster, it updates the location of that cluster
-						if ((*minCluster).inRange(x, y))
-						{
-							clusters.at(minDistance).shift(x, y);
-							clusters.at(minDistance).newEvent();
-						} // If there is an event very near but outside the cluster, increase the cluster's radius
-						else if ((*minCluster).borderRange(x, y))
-						{
-							clusters.at(minDistance).updateRadius(constants::radiusGrowth);
-            			}
-					}
-					prevTime = timeStamp;
+					lastTotalCrossing = tracker.getTotalCrossing();
+					console.write(CrossingCountMessage{tracker.getTotalCrossing(), tracker.getNetCrossing(), tracker.getLastCrossingID()});
 				}
-				tsBlurred *= constants::scaleFactor;
-				// enforce maximum value of 1
-				threshold(tsBlurred, tsBlurred, 1, 1, cv::THRESH_TRUNC);
-				// only update clusters after a certain period of time
-				// this is a costly computation, so is not performed with every event
-				if (timeStamp > nextTime)
+
+				// log cluster information to file
+				row.timeStamp = timeStamp;
+				row.totalCrossing = tracker.getTotalCrossing();
+				row.netCrossing = tracker.getNetCrossing();
+				for (int i = 0; i < constants::maxClusters; i++)
 				{
-					nextTime += constants::delayTime;
-					// check of clusters need to be deleted
-					if (timeStamp > nextSustain) 
+					const Cluster *cluster = tracker.getClusters().atSlot(i);
+					if (cluster != NULL)
 					{
-						nextSustain += constants::clusterSustainTime;
-						for (int i = 0; i < clusters.size(); i++)
-						{
-							// delete a cluster if it did not have enough events
-              				Cluster cluster = clusters.at(i);
-							if (!cluster.aboveThreshold(constants::clusterSustainThresh, imageWidth, imageHeight))
-							{
-								clusters.erase(clusters.begin() + i);
-								i--;
-							}
-							else 
-							{// if it's above the threshold, reset the number of events
-								clusters.at(i).resetEvents();
-							}
-						}
+						BasicClusterMotion<TrackerReal> motion = cluster->getMotion();
+						row.columns[i] = {true, numeric::toDouble(motion.x), numeric::toDouble(motion.y), numeric::toDouble(motion.radius),
+							numeric::toDouble(motion.velX), numeric::toDouble(motion.velY)};
 					}
-					for (int i = 0; i < imageWidth / constants::blurScale  && clusters.size() < constants::maxClusters; i++)
+					else
 					{
-						for (int j = 0; j < imageHeight / constants::blurScale  && clusters.size() < constants::maxClusters; j++)
-						{
-							// Adds a new cluster if three criteria are met:
-                           	// The region must be greater than the cluster initialization threshold
-                           	// The region can't be inside an already existing cluster
-                           	// There can't be more clusters than the max limit
-							if (tsBlurred.at<double>(j,i) > constants::clusterInitThresh)
-							{
-								bool alreadyAdded = false;
-
-								// check that it is not inside an already existing cluster
-								for (Cluster cluster : clusters)
-								{
-									if (cluster.otherClusterRange(i * constants::blurScale, j * constants::blurScale))
-									{
-										alreadyAdded = true;
-									}
-								}
-
-								// create a new cluster if it doesn't already exist
-								if (!alreadyAdded)
-								{
-									Cluster newCluster = Cluster(i * constants::blurScale, j * constants::blurScale, constants::alpha);
-									clusters.push_back(newCluster);
-								}
-							}
-						}
-					} // end blurred matrix loop
-
-					// update the velocity and shrink the radius
-					for (int i = 0; i < clusters.size(); i ++)
-					{
-						clusters.at(i).updateVelocity(constants::delayTime);
-						clusters.at(i).updateRadius(constants::radiusShrink);
-
-            			int newCrossing = clusters.at(i).updateSide(imageWidth, imageHeight);
-            			if (newCrossing != 0) 
-            			{
-              				netCrossing -= newCrossing;
-              				totalCrossing++;
-
-              				std::cout << "Total Crossed: " << totalCrossing << "\t Net Crossed: " << netCrossing << "\r";
-	              			std::cout.flush();
-            			}
-					}
-					clusterLog << timeStamp << ": ";
-          			clusterLog << totalCrossing << ",";
-          			clusterLog << netCrossing << ", ";
-
-					// log cluster information to file
-					for (int i = 0; i < constants::maxClusters; i++) 
-					{
-						if (i < clusters.size())
-						{
-							clusterLog << clusters.at(i);
-						}
-						else // create empty columns if no cluster exists
-						{
-							clusterLog << ",,,,,";
-						}
+						row.columns[i].present = false;
 					}
-					clusterLog << std::endl;
 				}
-
+				clusterRows.write(row);
 			}
 			// log events
-			eventLog.writeEvents(events);
+			eventLog.write(events, tracker);
+
+			if (checkpoints.due(events.getHighestTime()))
+			{
+				tracker.saveCheckpoint(checkpoints.getPath(), {events.getHighestTime(), 0, 0});
+			}
 		}
 	}
+	console.close();
+	clusterRows.close();
+	eventLog.finish(tracker);
+	printReplayStats(capture);
 	return 0;
 }
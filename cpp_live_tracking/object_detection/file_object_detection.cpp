@@ -1,4 +1,10 @@
 #include <cluster/cluster.hpp>
+#include <tracker/tracker.hpp>
+#include <tracker/tracker_config.hpp>
+#include <tracker/renderer.hpp>
+#include <tracker/recording_reader.hpp>
+#include <tracker/recording_index.hpp>
+#include <tracker/async_log.hpp>
 #include "constants.hpp"
 
 #define LIBCAER_FRAMECPP_OPENCV_INSTALLED 0
@@ -18,247 +24,181 @@
 #include <csignal>
 #include <chrono>
 #include <cstdlib>
+#include <thread>
+#include <vector>
 
 int main(int argc, char* argv[])
 {
-	cv::namedWindow("Tracker Image");
-
 	std::string filePath = "./event_log_09_04_23.aedat4";
+	int blurScale = constants::blurScale;
+	int readAheadDepth = constants::readAhead;
+	RecordingRange range;
+	ReaderKind readerKind = ReaderKind::dv;
+
+	// Obtain filePath and optionally the blur scale, read-ahead depth, time range and reader from command line
+	std::vector<std::string> positional;
+	for (int i = 1; i < argc; i++)
+	{
+		bool ok = true;
+		if (range.parseArgument(argv[i], ok) || parseReaderArgument(argv[i], readerKind, ok))
+		{
+			if (!ok)
+			{
+				std::cerr << "Could not read " << argv[i] << std::endl;
+				return EXIT_FAILURE;
+			}
+			continue;
+		}
+		positional.push_back(argv[i]);
+	}
 
-	// Obtain filePath from command line
-	if (argc == 1)
+	if (positional.empty())
 	{
 		std::cout << "No additional command line arguments give." << std::endl;
 		std::cout << "Defaulting to path: " << filePath << std::endl;
-		std::cout << "To specifiy the file path at runtime, use: ./file_object_detection.exe <path-to-aedat4>" << std::endl;
+		std::cout << "To specifiy the file path at runtime, use: ./file_object_detection.exe <path-to-aedat4> [blur-scale] [read-ahead-packets] [--start=h:mm:ss] [--end=h:mm:ss] [--reader=dv|mapped]" << std::endl;
 	}
-	else if (argc > 1)
+	else
 	{
-		filePath = argv[1];
+		filePath = positional[0];
 		std::cout << "Found specified path: " << filePath << std::endl;
-		if (argc > 2)
+		if (positional.size() > 1)
+		{
+			blurScale = std::atoi(positional[1].c_str());
+			std::cout << "Using blur scale: " << blurScale << std::endl;
+		}
+		if (positional.size() > 2)
+		{
+			readAheadDepth = std::atoi(positional[2].c_str());
+			std::cout << "Reading ahead by: " << readAheadDepth << " packets" << std::endl;
+		}
+		if (positional.size() > 3)
 		{
 			std::cout << "Additional command line arguments found but not used..." << std::endl;
 		}
 	}
-    
-  	auto reader = dv::io::MonoCameraRecording(filePath);
-	dv::io::DataReadHandler handler;
-  	
-	const int imageWidth = 640;
-	const int imageHeight = 480;
 
-	// Initializes a screen - its grayscale but uses 3 channels so that clusters can be drawn on the screen in RGB
-	cv::Mat tsImg(imageHeight, imageWidth, CV_8UC3, cv::Scalar(1));
-	// Initializes the blurred time surface, used to control the creation of new clusters
-	cv::Mat tsBlurred(imageHeight / constants::blurScale, imageWidth / constants::blurScale, CV_64FC1, cv::Scalar(0));
+	// the recording is read and decoded on its own thread, readAheadDepth packets ahead of the tracker
+	RecordingReader reader(filePath, readerKind, readAheadDepth);
 
-	int64_t lastTimeStamp = -1;
-	
-	// initialize to negative values to signal needed update
-	// all timestamps are 64-bit ints to avoid overflow/wraparound
-	int64_t nextTime = -1;
-	int64_t nextFrame = -1;
-	int64_t nextSustain = -1;
-	int64_t prevTime = -1;
+	// retrieve the event resolution stored in the recording
+	std::optional<cv::Size> resolutionWrapper = reader.getEventResolution();
+	if (!reader.isOpen() || !resolutionWrapper.has_value())
+	{
+		std::cerr << "Could not read recording: " << reader.getError() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	// with --start and --reader=mapped the recording's index is used to jump straight to the first packet of the range
+	if (!range.seek(reader, filePath))
+	{
+		return EXIT_FAILURE;
+	}
 
-	std::vector<Cluster> clusters = std::vector<Cluster>();
+	const int imageWidth = resolutionWrapper.value().width;
+	const int imageHeight = resolutionWrapper.value().height;
+	std::cout << "Event resolution: " << imageWidth << "x" << imageHeight << std::endl;
 
-	int colorIndex = 0;
-	int netCrossing = 0;
-	int totalCrossing = 0;
+	Tracker tracker(resolutionWrapper.value(), blurScale);
 
-	// define a function for when the file reader encounters an event packet
-	handler.mEventHandler = [&tsImg, &tsBlurred, &lastTimeStamp, &nextTime, &nextFrame, &nextSustain, &prevTime,
-					&clusters, &imageWidth, &imageHeight, /* &constants::blurScale, */ &colorIndex, &netCrossing, &totalCrossing](const dv::EventStore &nextEvent)
+	// tracker settings are read from the settings file now and again whenever it is saved,
+	// the tracker switches to them between batches without losing its clusters
+	TrackerConfig trackerConfig = tracker.getConfig();
+	// a blur scale given on the command line wins over the settings file
+	TrackerSettings commandLine;
+	if (positional.size() > 1)
 	{
+		commandLine.push_back({"blurScale", std::to_string(blurScale)});
+	}
+	TrackerConfigWatcher settings(constants::trackerSettings, trackerConfig, [&tracker](const TrackerConfig &config) { tracker.requestConfig(config); },
+		commandLine);
+	tracker.setConfig(trackerConfig);
+	// the window is drawn on the main thread while the recording is processed on another one,
+	// it keeps the time surface from the off events handed to it
+	Renderer renderer("Tracker Image", resolutionWrapper.value());
+	renderer.reportTo(tracker.getStats());
+	StatsDump statsDump(constants::trackerStats, std::chrono::seconds(constants::statsPeriod));
 
-	    	// choice of colors
-	    	const int numColors = 8;
-		const cv::viz::Color colors[numColors] = {cv::viz::Color::amethyst(), cv::viz::Color::blue(),
-									cv::viz::Color::orange(), cv::viz::Color::red(),
-									cv::viz::Color::yellow(), cv::viz::Color::pink(),
-									cv::viz::Color::lime(), cv::viz::Color::cyan()};
+	int64_t nextFrame = -1;
+	int lastTotalCrossing = 0;
+	// the counts are printed on a thread of their own, not between packets
+	AsyncLog console(std::cout);
 
-		if (nextEvent.isEmpty())
+	// define a function for when the file reader encounters an event packet
+	auto handleEvents = [&renderer, &tracker, &statsDump, &nextFrame, &lastTotalCrossing, &console](std::span<const dv::Event> nextEvent)
+	{
+		if (nextEvent.empty())
 		{
 			return;
 		}
 
-		// make sure you get the first timestamp
-		if (lastTimeStamp < 0)
+		// the tracker takes the whole batch at once, the loop below only keeps the time surface and the window going
+		tracker.processEvents(nextEvent);
+		statsDump.update(tracker.getStats());
+
+		if (tracker.getTotalCrossing() != lastTotalCrossing)
 		{
-			lastTimeStamp = nextEvent.getLowestTime();
+			TRACKER_STAGE(tracker.getStats().stage(Stage::logging));
+			lastTotalCrossing = tracker.getTotalCrossing();
+			console.write(CrossingCountMessage{tracker.getTotalCrossing(), tracker.getNetCrossing()});
 		}
 
-		// use total time elapsed from end of last packet to end of this one
-		// to determine the delay length
-		int64_t timeElapsed = nextEvent.getHighestTime() - lastTimeStamp;
-		lastTimeStamp = nextEvent.getHighestTime();
-		// extract the events from the EventStore
-		dv::cvector<dv::Event> events = nextEvent.toPacket().elements;
-
 		// loop through each event in the batch
-		for (int i = 0; i < events.size(); i++)
+		for (const dv::Event &event : nextEvent)
 		{
-			dv::Event event = events.at(i);
 			int64_t timeStamp = event.timestamp();
-			uint16_t x = event.x();
-			uint16_t y = event.y();
-			bool pol = event.polarity();
 
-			// set initial timestamps
-			if (prevTime < 0)
-			{
-				prevTime = timeStamp;
-			}
-			if (nextTime < 0)
-			{
-				nextTime = timeStamp;
-			}
 			if (nextFrame < 0)
 			{
 				nextFrame = timeStamp;
 			}
-			if (nextSustain < 0)
-			{
-				nextSustain = timeStamp;
-			}
 			// only update on off spikes
-			if (!pol)
+			if (!event.polarity())
 			{
 				// Updates the time surface - this is purely for visualization purposes at this point
-				tsImg.at<cv::Vec3b>(y, x) = cv::Vec3b(255, 255, 255);
-				// Increases the value of the corresponding region in the blurred time surface
-				tsBlurred.at<double>(y / constants::blurScale, x / constants::blurScale) += constants::blurIncreaseFactor;
-				// Finds the distance of the event from each existing cluster
-				std::vector<double> distances = std::vector<double>();
-				for (int i = 0; i < clusters.size(); i++)
-				{
-					distances.push_back(clusters.at(i).distance(x, y));
-					// continue movement based on velocity and time elapsed
-					clusters.at(i).contMomentum(timeStamp, prevTime);
-				}
-				if (!clusters.empty()) 
-				{
-					// retrieve the closest cluster
-		            	int minDistance = distance(begin(distances), min_element(begin(distances), end(distances)));
-					Cluster minCluster = clusters.at(distance(begin(distances), min_element(begin(distances), end(distances))));
-					// If the event is inside the closest cluster, it updates the location of that cluster
-					if (minCluster.inRange(x, y))
-					{
-						clusters.at(minDistance).shift(x, y);
-						clusters.at(minDistance).newEvent();
-					} // If there is an event very near but outside the cluster, increase the cluster's radius
-					else if (minCluster.borderRange(x, y)) 
-					{
-						clusters.at(minDistance).updateRadius(constants::radiusGrowth);
-	      	      	}
-				}
-				prevTime = timeStamp;
+				renderer.addEvent(event.x(), event.y());
 			}
-			// exponential decay of blurred time surface
-			tsBlurred *= constants::scaleFactor;
-			// enforce maximum value of 1
-			threshold(tsBlurred, tsBlurred, 1, 1, cv::THRESH_TRUNC);
 
-			// only update clusters after a certain period of time
-			// this is a costly computation, so is not performed with every event
-			if (timeStamp > nextTime)
-			{
-				nextTime += constants::delayTime;
-				// check of clusters need to be deleted
-				if (timeStamp > nextSustain)
-				{
-					nextSustain += constants::clusterSustainTime;
-					for (int i = 0; i < clusters.size(); i ++)
-					{
-						// delete a cluster if it did not have enough events
-						Cluster cluster = clusters.at(i);
-						if (!cluster.aboveThreshold(constants::clusterSustainThresh, imageWidth, imageHeight))
-						{
-							clusters.erase(remove(clusters.begin(), clusters.end(), cluster), clusters.end());
-						}
-						else // if it's above the threshold, reset the number of events
-						{
-							clusters.at(i).resetEvents();
-						}
-					}
-				}
-				for (int i = 0; i < imageWidth / constants::blurScale; i++)
-				{
-					for (int j = 0; j < imageHeight / constants::blurScale; j++)
-					{
-						// Adds a new cluster if three criteria are met:
-	                           	// The region must be greater than the cluster initialization threshold
-	                           	// The region can't be inside an already existing cluster
-	                           	// There can't be more clusters than the max limit
-						if (tsBlurred.at<double>(j,i) > constants::clusterInitThresh && clusters.size() < constants::maxClusters)
-						{
-							bool alreadyAdded = false;
-							// check that it is not inside an already existing cluster
-							for (Cluster cluster : clusters)
-							{
-								if (cluster.otherClusterRange(i * constants::blurScale, j * constants::blurScale))
-								{
-									alreadyAdded = true;
-								}
-							}
-							// create a new cluster if it doesn't already exist
-							if (!alreadyAdded)
-							{
-								Cluster newCluster = Cluster(i * constants::blurScale, j * constants::blurScale, colors[colorIndex++ % numColors], constants::alpha);
-								clusters.push_back(newCluster);
-							}
-						}
-					}
-				}
-				// update the velocity and shrink the radius
-				for (int i = 0; i < clusters.size(); i ++)
-				{
-					clusters.at(i).updateVelocity(constants::delayTime);
-					clusters.at(i).updateRadius(constants::radiusShrink);
-	          			int newCrossing = clusters.at(i).updateSide(imageWidth, imageHeight);
-	           			if (newCrossing != 0)
-	           			{
-	              			netCrossing -= newCrossing;
-	              			totalCrossing += abs(newCrossing);
-	              			std::cout << "Total Crossed: " << totalCrossing << "\t Net Crossed: " << netCrossing << " Last crossed: " << i << "\r";
-	              			std::cout.flush();
-	            		}
-				}
-			}
 			// display update condition
 			if (timeStamp > nextFrame)
 			{
 				nextFrame += constants::displayTime;
-				// copy of time surface matrix to draw clusters on
-				cv::Mat trackImg(imageHeight, imageWidth, CV_8UC3, cv::Scalar(1));
-				tsImg.copyTo(trackImg);
-
-				cv::rectangle(trackImg, cv::Point(imageWidth*0.4, imageHeight*0.15), cv::Point(imageWidth*0.9, imageHeight*0.85), cv::viz::Color::red());
-				cv::rectangle(trackImg, cv::Point(imageWidth*0.4 + 5, imageHeight*0.15 + 5), cv::Point(imageWidth*0.9 - 5, imageHeight*0.85 - 5), cv::viz::Color::blue());
-	          	cv::rectangle(trackImg, cv::Point(imageWidth*0.4 - 5, imageHeight*0.15 - 5), cv::Point(imageWidth*0.9 + 5, imageHeight*0.85 + 5), cv::viz::Color::blue());
-
-				cv::Mat resized;
-	          		//resize(tsBlurred, resized, Size(imageWidth, imageHeight));
-				// draw each cluster
-				for (Cluster cluster : clusters)
-				{
-					cluster.draw(trackImg);
-	           			//cluster.draw(resized);
-				}
-	          		//imshow("Blurred Image",resized);
-	          		cv::imshow("Tracker Image", trackImg);
-	          		//resizeWindow("Blurred Image", imageHeight, imageWidth);
-				cv::waitKey(1);
+				// hand a snapshot to the render thread, this does not wait for the window to be drawn
+				renderer.submit(tracker, timeStamp);
 				// time surface exponential decay
-				tsImg *= constants::imgScaleFactor;
+				renderer.nextFrame();
 			}
 		}
 	};
 
-	reader.run(handler);
+	auto start = std::chrono::steady_clock::now();
+	double seconds = 0;
+
+	std::thread trackingThread([&reader, &range, &handleEvents, &renderer, &start, &seconds]()
+	{
+		std::span<const dv::Event> nextEvent;
+		while (reader.next(nextEvent) && !range.isPast(nextEvent))
+		{
+			handleEvents(range.clip(nextEvent));
+		}
+		seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		renderer.stop();
+	});
+
+	renderer.run();
+	trackingThread.join();
+	console.close();
+	statsDump.write(tracker.getStats());
+
 	printf("End of recording.\n");
+	printf("Processed %lld events in %.2f s (%.0f events/s) at %dx%d with blur scale %d\n",
+		(long long)tracker.getEventCount(), seconds, tracker.getEventCount() / seconds, imageWidth, imageHeight, tracker.getBlurScale());
+	printf("%s\n", reader.getStats().summary().c_str());
+	if (!reader.getError().empty())
+	{
+		std::cerr << "Stopped reading recording: " << reader.getError() << std::endl;
+	}
+	printf("Rendered %lld of %lld frames (%lld dropped, %lld time surface events lost)\n", (long long)renderer.getFramesRendered(),
+		(long long)renderer.getFramesSubmitted(), (long long)renderer.getFramesDropped(), (long long)renderer.getEventsLost());
 	return 0;
 }
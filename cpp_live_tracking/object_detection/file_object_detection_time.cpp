@@ -1,4 +1,11 @@
 #include "../cluster/cluster.hpp"
+#include <tracker/tracker.hpp>
+#include <tracker/tracker_config.hpp>
+#include <tracker/recording_reader.hpp>
+#include <tracker/recording_index.hpp>
+#include <tracker/checkpoint.hpp>
+#include <tracker/async_log.hpp>
+#include <tracker/track_publisher.hpp>
 #include "constants.hpp"
 
 #define LIBCAER_FRAMECPP_OPENCV_INSTALLED 0
@@ -18,23 +25,46 @@
 #include <csignal>
 #include <chrono>
 #include <cstdlib>
+#include <vector>
 
 int main(int argc, char* argv[])
 {
 	std::string filePath = "./event_log_10_7_board.aedat4";
+	RecordingRange range;
+	CheckpointOptions checkpointOptions;
+	std::string publishName;
+	ReaderKind readerKind = ReaderKind::dv;
+
+	// Obtain filePath and optionally a time range, checkpoints, a ring to publish to and the reader from command line
+	std::vector<std::string> positional;
+	for (int i = 1; i < argc; i++)
+	{
+		bool ok = true;
+		if (range.parseArgument(argv[i], ok) || parseCheckpointArgument(argv[i], checkpointOptions, ok)
+			|| parsePublishArgument(argv[i], publishName, ok) || parseReaderArgument(argv[i], readerKind, ok))
+		{
+			if (!ok)
+			{
+				std::cerr << "Could not read " << argv[i] << std::endl;
+				return EXIT_FAILURE;
+			}
+			continue;
+		}
+		positional.push_back(argv[i]);
+	}
 
-	// Obtain filePath from command line
-	if (argc == 1)
+	if (positional.empty())
 	{
 		std::cout << "No additional command line arguments give." << std::endl;
 		std::cout << "Defaulting to path: " << filePath << std::endl;
-		std::cout << "To specifiy the file path at runtime, use: ./file_object_detection.exe <path-to-aedat4>" << std::endl;
+		std::cout << "To specifiy the file path at runtime, use: ./file_object_detection_time.exe <path-to-aedat4> [--start=h:mm:ss] [--end=h:mm:ss]"
+			" [--checkpoint=<file>] [--checkpoint-every=<seconds>] [--resume=<file>] [--publish=<name>] [--reader=dv|mapped]" << std::endl;
 	}
-	else if (argc > 1)
+	else
 	{
-		filePath = argv[1];
+		filePath = positional[0];
 		std::cout << "Found specified path: " << filePath << std::endl;
-		if (argc > 2)
+		if (positional.size() > 1)
 		{
 			std::cout << "Additional command line arguments found but not used..." << std::endl;
 		}
@@ -47,210 +77,130 @@ int main(int argc, char* argv[])
 	std::chrono::minutes logPeriod(5);
 
 	timeLog << std::chrono::duration_cast<std::chrono::minutes> (std::chrono::system_clock::now() - start).count() << std::endl;
-    
-	while (true) {
-  	auto reader = dv::io::MonoCameraRecording(filePath);
-	dv::io::DataReadHandler handler;
-  	
-	const int imageWidth = 640;
-	const int imageHeight = 480;
 
-	// Initializes a screen - its grayscale but uses 3 channels so that clusters can be drawn on the screen in RGB
-	cv::Mat tsImg(imageHeight, imageWidth, CV_8UC3, cv::Scalar(1));
-	// Initializes the blurred time surface, used to control the creation of new clusters
-	cv::Mat tsBlurred(imageHeight / constants::blurScale, imageWidth / constants::blurScale, CV_64FC1, cv::Scalar(0));
+	// checkpoints are written every --checkpoint-every seconds of recording, on SIGUSR1, and on SIGTERM or
+	// Ctrl+C before stopping, so a long replay that is stopped carries on with --resume from where it was
+	CheckpointSchedule checkpoints(checkpointOptions);
+	bool stopped = false;
+	// checkpoints name the recording they were taken on, and are only resumed on that one
+	uint64_t recordingSize = 0;
+	int64_t recordingTime = 0;
+	recordingStamp(filePath, recordingSize, recordingTime);
+
+	while (!stopped) {
+	// the recording is read and decoded on a second thread, the tracker reads the events in place
+	RecordingReader reader(filePath, readerKind);
+
+	// retrieve the event resolution stored in the recording
+	std::optional<cv::Size> resolutionWrapper = reader.getEventResolution();
+	if (!reader.isOpen() || !resolutionWrapper.has_value())
+	{
+		std::cerr << "Could not read recording: " << reader.getError() << std::endl;
+		return EXIT_FAILURE;
+	}
+	if (!range.seek(reader, filePath))
+	{
+		return EXIT_FAILURE;
+	}
 
-	int64_t lastTimeStamp = -1;
-	
-	// initialize to negative values to signal needed update
-	// all timestamps are 64-bit ints to avoid overflow/wraparound
-	int64_t nextTime = -1;
-	int64_t nextFrame = -1;
-	int64_t nextSustain = -1;
-	int64_t prevTime = -1;
+	// all tracking state is allocated up front, the loop below does not allocate
+	Tracker tracker(resolutionWrapper.value());
 
-	std::vector<Cluster> clusters = std::vector<Cluster>();
+	// a resumed run starts in the packet the checkpoint was taken in, after the events already tracked
+	CheckpointPosition position;
+	uint64_t skip = 0;
+	if (!checkpointOptions.resume.empty())
+	{
+		if (!tracker.loadCheckpoint(checkpointOptions.resume, position))
+		{
+			return EXIT_FAILURE;
+		}
+		if (!resumeRecording(reader, filePath, checkpointOptions.resume, position))
+		{
+			return EXIT_FAILURE;
+		}
+		skip = position.packetEvents;
+		std::cout << "Resumed from " << checkpointOptions.resume << " with " << tracker.getTotalCrossing() << " crossed" << std::endl;
+		// only the first pass over the recording resumes
+		checkpointOptions.resume.clear();
+	}
 
-	int colorIndex = 0;
-	int netCrossing = 0;
-	int totalCrossing = 0;
+	// tracker settings are read from the settings file now and again whenever it is saved,
+	// the tracker switches to them between batches without losing its clusters
+	TrackerConfig trackerConfig = tracker.getConfig();
+	TrackerConfigWatcher settings(constants::trackerSettings, trackerConfig, [&tracker](const TrackerConfig &config) { tracker.requestConfig(config); });
+	tracker.setConfig(trackerConfig);
+	StatsDump statsDump(constants::trackerStats, std::chrono::seconds(constants::statsPeriod));
+	int lastTotalCrossing = 0;
+	// the counts are printed on a thread of their own, not between packets
+	AsyncLog console(std::cout);
+	// cluster states and crossings for other processes on this machine, see tracker/track_ring.hpp
+	TrackRingWriter ring;
+	if (!publishName.empty() && !ring.open(publishName))
+	{
+		return EXIT_FAILURE;
+	}
 
-	// define a function for when the file reader encounters an event packet
-	handler.mEventHandler = [&tsImg, &tsBlurred, &lastTimeStamp, &nextTime, &nextFrame, &nextSustain, &prevTime,
-					&clusters, &imageWidth, &imageHeight, /* &constants::blurScale, */ &colorIndex, &netCrossing, &totalCrossing,
-					&start, &lastLog, &timeLog](const dv::EventStore &nextEvent)
+	std::span<const dv::Event> packet;
+	while (reader.next(packet) && !range.isPast(packet))
 	{
+		std::span<const dv::Event> nextEvent = range.clip(packet.subspan(std::min<size_t>(skip, packet.size())));
+		skip = 0;
+		if (nextEvent.empty())
+		{
+			continue;
+		}
 
-	    	// choice of colors
-	    	const int numColors = 8;
-		const cv::viz::Color colors[numColors] = {cv::viz::Color::amethyst(), cv::viz::Color::blue(),
-									cv::viz::Color::orange(), cv::viz::Color::red(),
-									cv::viz::Color::yellow(), cv::viz::Color::pink(),
-									cv::viz::Color::lime(), cv::viz::Color::cyan()};
+		// the events are read in place from the decoded packet instead of being copied out
+		tracker.processEvents(nextEvent);
+		statsDump.update(tracker.getStats());
+		publishTracks(ring, tracker, nextEvent.back().timestamp());
 
-		if (nextEvent.isEmpty())
+		position = {nextEvent.back().timestamp(), reader.getPacketNumber(), reader.getPacketOffset(),
+			(uint64_t)(nextEvent.data() + nextEvent.size() - packet.data()), recordingSize, recordingTime};
+		if (checkpoints.due(position.time))
 		{
-			return;
+			tracker.saveCheckpoint(checkpoints.getPath(), position);
 		}
-
-		// make sure you get the first timestamp
-		if (lastTimeStamp < 0)
+		if (checkpoints.isStopping())
 		{
-			lastTimeStamp = nextEvent.getLowestTime();
+			stopped = true;
+			break;
 		}
 
-		// use total time elapsed from end of last packet to end of this one
-		// to determine the delay length
-		int64_t timeElapsed = nextEvent.getHighestTime() - lastTimeStamp;
-		lastTimeStamp = nextEvent.getHighestTime();
-		// extract the events from the EventStore
-		dv::cvector<dv::Event> events = nextEvent.toPacket().elements;
-
-		// loop through each event in the batch
-		for (int i = 0; i < events.size(); i++)
+		TRACKER_STAGE(tracker.getStats().stage(Stage::logging));
+		if (tracker.getTotalCrossing() != lastTotalCrossing)
 		{
-			dv::Event event = events.at(i);
-			int64_t timeStamp = event.timestamp();
-			uint16_t x = event.x();
-			uint16_t y = event.y();
-			bool pol = event.polarity();
-
-			// set initial timestamps
-			if (prevTime < 0)
-			{
-				prevTime = timeStamp;
-			}
-			if (nextTime < 0)
-			{
-				nextTime = timeStamp;
-			}
-			if (nextFrame < 0)
-			{
-				nextFrame = timeStamp;
-			}
-			if (nextSustain < 0)
-			{
-				nextSustain = timeStamp;
-			}
-			// only update on off spikes
-			if (!pol)
-			{
-				// Updates the time surface - this is purely for visualization purposes at this point
-				tsImg.at<cv::Vec3b>(y, x) = cv::Vec3b(255, 255, 255);
-				// Increases the value of the corresponding region in the blurred time surface
-				tsBlurred.at<double>(y / constants::blurScale, x / constants::blurScale) += constants::blurIncreaseFactor;
-				// Finds the distance of the event from each existing cluster
-				std::vector<double> distances = std::vector<double>();
-				for (int i = 0; i < clusters.size(); i++)
-				{
-					distances.push_back(clusters.at(i).distance(x, y));
-					// continue movement based on velocity and time elapsed
-					clusters.at(i).contMomentum(timeStamp, prevTime);
-				}
-				if (!clusters.empty()) 
-				{
-					// retrieve the closest cluster
-		            	int minDistance = distance(begin(distances), min_element(begin(distances), end(distances)));
-					Cluster minCluster = clusters.at(distance(begin(distances), min_element(begin(distances), end(distances))));
-					// If the event is inside the closest cluster, it updates the location of that cluster
-					if (minCluster.inRange(x, y))
-					{
-						clusters.at(minDistance).shift(x, y);
-						clusters.at(minDistance).newEvent();
-					} // If there is an event very near but outside the cluster, increase the cluster's radius
-					else if (minCluster.borderRange(x, y)) 
-					{
-						clusters.at(minDistance).updateRadius(constants::radiusGrowth);
-	      	      	}
-				}
-				prevTime = timeStamp;
-			}
-			// exponential decay of blurred time surface
-			tsBlurred *= constants::scaleFactor;
-			// enforce maximum value of 1
-			threshold(tsBlurred, tsBlurred, 1, 1, cv::THRESH_TRUNC);
-
-			// only update clusters after a certain period of time
-			// this is a costly computation, so is not performed with every event
-			if (timeStamp > nextTime)
-			{
-				nextTime += constants::delayTime;
-				// check of clusters need to be deleted
-				if (timeStamp > nextSustain)
-				{
-					nextSustain += constants::clusterSustainTime;
-					for (int i = 0; i < clusters.size(); i ++)
-					{
-						// delete a cluster if it did not have enough events
-						Cluster cluster = clusters.at(i);
-						if (!cluster.aboveThreshold(constants::clusterSustainThresh))
-						{
-							clusters.erase(remove(clusters.begin(), clusters.end(), cluster), clusters.end());
-						}
-						else // if it's above the threshold, reset the number of events
-						{
-							clusters.at(i).resetEvents();
-						}
-					}
-				}
-				for (int i = 0; i < imageWidth / constants::blurScale; i++)
-				{
-					for (int j = 0; j < imageHeight / constants::blurScale; j++)
-					{
-						// Adds a new cluster if three criteria are met:
-	                           	// The region must be greater than the cluster initialization threshold
-	                           	// The region can't be inside an already existing cluster
-	                           	// There can't be more clusters than the max limit
-						if (tsBlurred.at<double>(j,i) > constants::clusterInitThresh && clusters.size() < constants::maxClusters)
-						{
-							bool alreadyAdded = false;
-							// check that it is not inside an already existing cluster
-							for (Cluster cluster : clusters)
-							{
-								if (cluster.otherClusterRange(i * constants::blurScale, j * constants::blurScale))
-								{
-									alreadyAdded = true;
-								}
-							}
-							// create a new cluster if it doesn't already exist
-							if (!alreadyAdded)
-							{
-								Cluster newCluster = Cluster(i * constants::blurScale, j * constants::blurScale, colors[colorIndex++ % numColors], constants::alpha);
-								clusters.push_back(newCluster);
-							}
-						}
-					}
-				}
-				// update the velocity and shrink the radius
-				for (int i = 0; i < clusters.size(); i ++)
-				{
-					clusters.at(i).updateVelocity(constants::delayTime);
-					clusters.at(i).updateRadius(constants::radiusShrink);
-	          			int newCrossing = clusters.at(i).updateSide(imageWidth, imageHeight);
-	           			if (newCrossing != 0)
-	           			{
-	              			netCrossing -= newCrossing;
-	              			totalCrossing += abs(newCrossing);
-	              			std::cout << "Total Crossed: " << totalCrossing << "\t Net Crossed: " << netCrossing << "\r";
-	              			std::cout.flush();
-	            		}
-				}
-			}
-			// display update condition
-			if (timeStamp > nextFrame)
-			{
-				nextFrame += constants::displayTime;
-				
-				tsImg *= constants::imgScaleFactor;
-			}
+			lastTotalCrossing = tracker.getTotalCrossing();
+			console.write(CrossingCountMessage{tracker.getTotalCrossing(), tracker.getNetCrossing()});
+		}
 
-			if (std::chrono::duration_cast<std::chrono::minutes>(std::chrono::system_clock::now() - lastLog).count() > 5) {
-				timeLog << std::chrono::duration_cast<std::chrono::minutes> (std::chrono::system_clock::now() - start).count() << std::endl;
-			}
+		if (std::chrono::system_clock::now() - lastLog > logPeriod) {
+			lastLog = std::chrono::system_clock::now();
+			timeLog << std::chrono::duration_cast<std::chrono::minutes> (lastLog - start).count() << std::endl;
 		}
-	};
+	}
+	console.close();
+	if (!reader.getError().empty())
+	{
+		std::cerr << "Stopped reading recording: " << reader.getError() << std::endl;
+		return EXIT_FAILURE;
+	}
+	statsDump.write(tracker.getStats());
+	std::cout << std::endl << reader.getStats().summary() << std::endl;
+
+	// the end of a range is where the next part of a split up replay resumes
+	if (checkpoints.isEnabled() && position.time >= 0 && !stopped)
+	{
+		tracker.saveCheckpoint(checkpoints.getPath(), position);
+	}
 
-	reader.run(handler);
+	// a time range is reprocessed once, the whole recording is replayed over and over
+	if (range.isRequested() || stopped)
+	{
+		printf("Total Crossed: %d\t Net Crossed: %d\n", tracker.getTotalCrossing(), tracker.getNetCrossing());
+		break;
+	}
 	}
 	printf("End of recording.\n");
 	return 0;
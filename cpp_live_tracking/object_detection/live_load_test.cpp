@@ -0,0 +1,197 @@
+#include <tracker/tracker.hpp>
+#include <tracker/tracker_config.hpp>
+#include <tracker/time_surface.hpp>
+#include <tracker/event_source.hpp>
+#include <tracker/load_governor.hpp>
+#include "constants.hpp"
+
+#include <dv-processing/core/core.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Load tests the live tracking loop without a camera: a recording or synthetic scene is played back
+// through a VirtualCamera at each of a list of speeds, and the events go through the same work as in
+// cpp_object_detection.exe (the tracker and the time surface, without the window). For every speed it
+// prints the packets dropped because the loop fell behind and the latency from a packet arriving to it
+// being processed, then the fastest speed that dropped nothing. The full speed run gives the most
+// events per second the loop can take on this machine. With --shedding the loop runs under a
+// LoadGovernor as in the live tool, and the time spent in each load shedding tier is printed as well.
+int main(int argc, char* argv[])
+{
+	EventSourceOptions options;
+	std::vector<double> speeds = {1, 2, 4, 8, 16, 0};
+	std::vector<std::string> positional;
+	bool shedding = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool ok = true;
+		if (arg.rfind("--speeds=", 0) == 0)
+		{
+			speeds.clear();
+			std::string list = arg.substr(arg.find('=') + 1);
+			std::replace(list.begin(), list.end(), ',', ' ');
+			std::istringstream fields(list);
+			std::string speed;
+			while (fields >> speed)
+			{
+				EventSourceOptions check;
+				if (!parseEventSourceArgument("--speed=" + speed, check, ok) || !ok)
+				{
+					std::cerr << "Could not read the speed " << speed << std::endl;
+					return EXIT_FAILURE;
+				}
+				speeds.push_back(check.speed);
+			}
+		}
+		else if (arg == "--shedding")
+		{
+			shedding = true;
+		}
+		else if (parseEventSourceArgument(arg, options, ok))
+		{
+			if (!ok)
+			{
+				std::cerr << "Could not read " << arg << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+		else
+		{
+			positional.push_back(arg);
+		}
+	}
+	if (positional.size() != 1 || speeds.empty())
+	{
+		std::cerr << "Usage: ./live_load_test.exe <recording.aedat4|synthetic:<settings>> [--speeds=1,2,4,8,16,max] [--buffer=<packets>] [--reader=dv|mapped]"
+			" [--shedding]" << std::endl;
+		return EXIT_FAILURE;
+	}
+	options.replay = positional[0];
+
+	TrackerConfig trackerConfig;
+	if (std::filesystem::exists(constants::trackerSettings) && !readTrackerConfig(constants::trackerSettings, trackerConfig))
+	{
+		return EXIT_FAILURE;
+	}
+
+	double sustained = -1;
+	for (double speed : speeds)
+	{
+		options.speed = speed;
+		VirtualCamera camera(options);
+		if (!camera.isOpen())
+		{
+			std::cerr << "Could not replay " << options.replay << ": " << camera.getError() << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		Tracker tracker(camera.getEventResolution().value());
+		tracker.setConfig(trackerConfig);
+		TimeSurface tsImg(camera.getEventResolution().value());
+		int64_t nextFrame = -1;
+		GovernorConfig governorConfig;
+		governorConfig.speed = speed;
+		// the on event tier saves nothing when the tracker skips on events anyway
+		governorConfig.dropOnEvents = Tracker::usesOnEvents;
+		LoadGovernor governor(governorConfig);
+
+		while (camera.isRunning())
+		{
+			auto eventsWrapper = camera.getNextEventBatch();
+			if (!eventsWrapper.has_value())
+			{
+				continue;
+			}
+
+			if (shedding)
+			{
+				governor.update(eventsWrapper.value().getHighestTime());
+				tracker.setDropOnEvents(!governor.onEventsEnabled());
+			}
+			auto track = [&](const auto &events)
+			{
+				tracker.processEvents(events);
+				for (const dv::Event &event : events)
+				{
+					if (event.polarity() && !governor.onEventsEnabled())
+					{
+						continue;
+					}
+					if (nextFrame < 0)
+					{
+						nextFrame = event.timestamp();
+					}
+					if (!event.polarity() && governor.surfaceEnabled())
+					{
+						tsImg.addEvent(event.x(), event.y());
+					}
+					if (event.timestamp() > nextFrame)
+					{
+						nextFrame += constants::displayTime;
+						tsImg.nextFrame();
+					}
+				}
+			};
+			if (governor.isShedding())
+			{
+				governor.shed(eventsWrapper.value(), tracker.getEntrance(), track);
+			}
+			else
+			{
+				track(eventsWrapper.value());
+			}
+		}
+		if (!camera.getError().empty())
+		{
+			std::cerr << "Stopped reading recording: " << camera.getError() << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		if (speed == speeds.front())
+		{
+			printf("%10s %9s %9s %8s %10s %10s %10s %8s %9s\n", "Speed", "Packets", "Dropped", "Drop %", "p50 ms", "p99 ms", "Max ms",
+				"Mev/s", "Crossed");
+		}
+		VirtualCameraStats stats = camera.getStats();
+		uint64_t offered = stats.packets + stats.droppedPackets;
+		char speedText[16];
+		snprintf(speedText, sizeof(speedText), speed > 0 ? "%gx" : "max", speed);
+		printf("%10s %9llu %9llu %8.2f %10.2f %10.2f %10.2f %8.2f %9d\n", speedText, (unsigned long long)stats.packets,
+			(unsigned long long)stats.droppedPackets, offered > 0 ? 100.0 * stats.droppedPackets / offered : 0.0,
+			stats.latency.percentile(50) / 1000.0, stats.latency.percentile(99) / 1000.0, stats.latency.max() / 1000.0,
+			stats.eventRate() / 1e6, tracker.getTotalCrossing());
+		if (stats.maxLag > 1000 && speed > 0)
+		{
+			printf("%10s playback fell behind by up to %.2f ms, reading the recording did not keep up or had no core to itself\n", "",
+				stats.maxLag / 1000.0);
+		}
+		if (shedding)
+		{
+			printf("%10s %s\n", "", governor.getStats().summary().c_str());
+		}
+		fflush(stdout);
+
+		if (speed > 0 && stats.droppedPackets == 0 && speed > sustained)
+		{
+			sustained = speed;
+		}
+	}
+
+	if (sustained > 0)
+	{
+		printf("Keeps up at %gx real time without dropping packets\n", sustained);
+	}
+	else
+	{
+		printf("Dropped packets at every speed tried\n");
+	}
+	return 0;
+}
@@ -0,0 +1,130 @@
+#include <tracker/tracking_pipeline.hpp>
+#include "constants.hpp"
+
+#include <dv-processing/core/core.hpp>
+#include <dv-processing/io/mono_camera_recording.hpp>
+
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <vector>
+
+// Runs the same per-packet work as the DV tracker module (user_tracker_module) on a recording,
+// without the DV runtime, and reports how long each packet took.
+// Every packet is read into memory before timing starts, so only the tracking is measured.
+int main(int argc, char* argv[])
+{
+	std::string filePath = "./event_log_09_04_23.aedat4";
+	int maxTrackers = constants::maxClusters;
+
+	if (argc == 1)
+	{
+		std::cout << "No additional command line arguments give." << std::endl;
+		std::cout << "Defaulting to path: " << filePath << std::endl;
+		std::cout << "To specifiy the file path at runtime, use: ./module_harness.exe <path-to-aedat4> [max-trackers]" << std::endl;
+	}
+	else if (argc > 1)
+	{
+		filePath = argv[1];
+		std::cout << "Found specified path: " << filePath << std::endl;
+		if (argc > 2)
+		{
+			maxTrackers = std::atoi(argv[2]);
+			std::cout << "Using max trackers: " << maxTrackers << std::endl;
+		}
+		if (argc > 3)
+		{
+			std::cout << "Additional command line arguments found but not used..." << std::endl;
+		}
+	}
+
+	auto reader = dv::io::MonoCameraRecording(filePath);
+
+	std::optional<cv::Size> resolutionWrapper = reader.getEventResolution();
+	if (!resolutionWrapper.has_value())
+	{
+		std::cerr << "Could not retrieve event resolution from recording" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	// the packets arrive in the same sizes the recorder wrote them, which is how the camera module sends them
+	std::vector<dv::EventStore> packets;
+	int64_t totalEvents = 0;
+	while (auto events = reader.getNextEventBatch())
+	{
+		if (!events->isEmpty())
+		{
+			totalEvents += events->size();
+			packets.push_back(*events);
+		}
+	}
+	if (packets.empty())
+	{
+		std::cerr << "No events found in recording" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	TrackingPipeline pipeline(resolutionWrapper.value(), std::max(maxTrackers, constants::maxClusters));
+	Tracker &tracker = pipeline.getTracker();
+	TrackerConfig trackerConfig = tracker.getConfig();
+	trackerConfig.maxClusters = maxTrackers;
+	// the same settings file as the other tools, so a tuned config can be timed before it is deployed,
+	// a max-trackers given on the command line wins over it
+	TrackerSettings commandLine;
+	if (argc > 2)
+	{
+		commandLine.push_back({"maxClusters", std::to_string(maxTrackers)});
+	}
+	TrackerConfigWatcher settings(constants::trackerSettings, trackerConfig, [&tracker](const TrackerConfig &config) { tracker.requestConfig(config); },
+		commandLine);
+	tracker.setConfig(trackerConfig);
+
+	std::vector<double> latencies;
+	latencies.reserve(packets.size());
+	// packets that took longer to process than the time they cover, the module would fall behind on these
+	int64_t lateCount = 0;
+	int64_t frameCount = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	for (const dv::EventStore &packet : packets)
+	{
+		auto packetStart = std::chrono::steady_clock::now();
+
+		if (pipeline.processPacket(packet))
+		{
+			// the module sends this out as its frame output
+			const cv::Mat &frame = pipeline.drawFrame();
+			frameCount += !frame.empty();
+		}
+
+		double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - packetStart).count();
+		latencies.push_back(micros);
+		if (micros > packet.getHighestTime() - packet.getLowestTime())
+		{
+			lateCount++;
+		}
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	double recordingSeconds = (packets.back().getHighestTime() - packets.front().getLowestTime()) / 1e6;
+
+	std::vector<double> sorted = latencies;
+	std::sort(sorted.begin(), sorted.end());
+	auto percentile = [&sorted](double p)
+	{
+		return sorted[std::min(sorted.size() - 1, (size_t)(p / 100.0 * sorted.size()))];
+	};
+
+	printf("Processed %zu packets, %lld events in %.3f s (%.0f events/s, %.1fx real time)\n",
+		packets.size(), (long long)totalEvents, seconds, totalEvents / seconds, recordingSeconds / seconds);
+	printf("Drew %lld frames, counted %d crossings (net %d)\n", (long long)frameCount, tracker.getTotalCrossing(), tracker.getNetCrossing());
+	printf("Packet latency (us): p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n",
+		percentile(50), percentile(90), percentile(99), percentile(99.9), sorted.back());
+	printf("Packets slower than real time: %lld of %zu\n", (long long)lateCount, packets.size());
+#if TRACKER_STATS
+	// the tracker's own breakdown of where the time went, in the same form the other tools log it
+	tracker.getStats().writeJson(std::cout);
+	std::cout << std::endl;
+#endif
+	return 0;
+}
@@ -0,0 +1,408 @@
+#include <tracker/tracker.hpp>
+#include <tracker/mapped_recording.hpp>
+#include <tracker/recording_reader.hpp>
+#include "constants.hpp"
+
+#include <dv-processing/core/core.hpp>
+#include <dv-processing/io/mono_camera_recording.hpp>
+#include <dv-processing/io/mono_camera_writer.hpp>
+
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+// Reads a recording with dv::io::MonoCameraRecording and with MappedRecording and compares them
+// Both readers touch every event (a checksum over the timestamps and coordinates), with --track
+// the events go through a Tracker as well. The passes alternate which reader goes first, so neither
+// one always gets the page cache warmed by the other. To measure reading from disk rather than from
+// memory, drop the page cache before each pass (echo 1 > /proc/sys/vm/drop_caches as root).
+//
+// With --check=<list> it reads every recording in the list (regression/readers.txt) as it is and
+// rewritten by dv-processing uncompressed, LZ4, LZ4 high, ZSTD and ZSTD high, and fails unless both
+// readers hand out the same packets with the same events for every one of them.
+struct ReadResult
+{
+	double seconds{0};
+	int64_t events{0};
+	uint64_t checksum{0};
+	int crossings{0};
+};
+
+static uint64_t mix(uint64_t checksum, const dv::Event &event)
+{
+	return checksum * 31 + (uint64_t)event.timestamp() + ((uint64_t)event.x() << 20) + ((uint64_t)event.y() << 40) + event.polarity();
+}
+
+static bool readWithDv(const std::string &filePath, bool track, ReadResult &result)
+{
+	auto start = std::chrono::steady_clock::now();
+	auto reader = dv::io::MonoCameraRecording(filePath);
+	std::optional<cv::Size> resolutionWrapper = reader.getEventResolution();
+	if (!resolutionWrapper.has_value())
+	{
+		std::cerr << "Could not retrieve event resolution from recording" << std::endl;
+		return false;
+	}
+	std::unique_ptr<Tracker> tracker;
+	if (track)
+	{
+		tracker = std::make_unique<Tracker>(resolutionWrapper.value());
+	}
+
+	while (auto events = reader.getNextEventBatch())
+	{
+		if (events->isEmpty())
+		{
+			continue;
+		}
+		for (const dv::Event &event : *events)
+		{
+			result.checksum = mix(result.checksum, event);
+		}
+		result.events += events->size();
+		if (tracker)
+		{
+			tracker->processEvents(*events);
+		}
+	}
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	result.crossings = tracker ? tracker->getTotalCrossing() : 0;
+	return true;
+}
+
+static bool readMapped(const std::string &filePath, bool track, ReadResult &result)
+{
+	auto start = std::chrono::steady_clock::now();
+	MappedRecording reader(filePath);
+	std::optional<cv::Size> resolutionWrapper = reader.getEventResolution();
+	if (!reader.isOpen() || !resolutionWrapper.has_value())
+	{
+		std::cerr << "Could not open recording: " << reader.getError() << std::endl;
+		return false;
+	}
+	std::unique_ptr<Tracker> tracker;
+	if (track)
+	{
+		tracker = std::make_unique<Tracker>(resolutionWrapper.value());
+	}
+
+	std::span<const dv::Event> events;
+	while (reader.next(events))
+	{
+		if (events.empty())
+		{
+			continue;
+		}
+		for (const dv::Event &event : events)
+		{
+			result.checksum = mix(result.checksum, event);
+		}
+		if (tracker)
+		{
+			tracker->processEvents(events);
+		}
+	}
+	if (!reader.getError().empty())
+	{
+		std::cerr << "Reading stopped early: " << reader.getError() << std::endl;
+		return false;
+	}
+	result.events = reader.getEventsRead();
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	result.crossings = tracker ? tracker->getTotalCrossing() : 0;
+	return true;
+}
+
+static bool sameEvent(const dv::Event &a, const dv::Event &b)
+{
+	return a.timestamp() == b.timestamp() && a.x() == b.x() && a.y() == b.y() && a.polarity() == b.polarity();
+}
+
+// Reads a recording with both readers side by side and compares them packet by packet,
+// returns the first difference, empty if there is none
+static std::string compareReaders(const std::string &filePath, int64_t &packets, int64_t &events)
+{
+	RecordingReader dvReader(filePath, ReaderKind::dv), mappedReader(filePath, ReaderKind::mapped);
+	if (!dvReader.isOpen())
+	{
+		return "dv could not open it: " + dvReader.getError();
+	}
+	if (!mappedReader.isOpen())
+	{
+		return "mapped could not open it: " + mappedReader.getError();
+	}
+	if (dvReader.getEventResolution() != mappedReader.getEventResolution())
+	{
+		return "the readers found different resolutions";
+	}
+
+	std::ostringstream difference;
+	std::span<const dv::Event> dvEvents, mappedEvents;
+	packets = 0;
+	events = 0;
+	while (true)
+	{
+		bool dvMore = dvReader.next(dvEvents);
+		bool mappedMore = mappedReader.next(mappedEvents);
+		if (!dvMore || !mappedMore)
+		{
+			if (dvMore != mappedMore)
+			{
+				difference << (dvMore ? "mapped" : "dv") << " stopped after " << packets << " packets, the other did not";
+			}
+			break;
+		}
+		if (dvEvents.size() != mappedEvents.size())
+		{
+			difference << "packet " << packets << " has " << dvEvents.size() << " events from dv and " << mappedEvents.size() << " from mapped";
+			break;
+		}
+		auto mismatch = std::mismatch(dvEvents.begin(), dvEvents.end(), mappedEvents.begin(), sameEvent);
+		if (mismatch.first != dvEvents.end())
+		{
+			difference << "event " << (mismatch.first - dvEvents.begin()) << " of packet " << packets << " differs";
+			break;
+		}
+		packets++;
+		events += dvEvents.size();
+	}
+	if (difference.tellp() > 0)
+	{
+		return difference.str();
+	}
+	if (!dvReader.getError().empty())
+	{
+		return "dv stopped early: " + dvReader.getError();
+	}
+	if (!mappedReader.getError().empty())
+	{
+		return "mapped stopped early: " + mappedReader.getError();
+	}
+	return "";
+}
+
+// rewrites the event packets of a recording with dv-processing's writer, as the Recorder would with that compression
+static bool writeCopy(const std::string &source, const std::string &target, dv::CompressionType compression)
+{
+	try
+	{
+		dv::io::MonoCameraRecording reader(source);
+		std::optional<cv::Size> resolutionWrapper = reader.getEventResolution();
+		if (!resolutionWrapper.has_value())
+		{
+			std::cerr << "Could not retrieve event resolution from " << source << std::endl;
+			return false;
+		}
+		dv::io::MonoCameraWriter writer(target, dv::io::MonoCameraWriter::EventOnlyConfig(reader.getCameraName(), resolutionWrapper.value(), compression));
+		while (auto events = reader.getNextEventBatch())
+		{
+			if (!events->isEmpty())
+			{
+				writer.writeEvents(*events);
+			}
+		}
+	}
+	catch (const std::exception &exception)
+	{
+		std::cerr << "Could not write " << target << ": " << exception.what() << std::endl;
+		return false;
+	}
+	return true;
+}
+
+// one recording of the list as it is and in every compression, returns false if the readers differed on any
+static bool checkRecording(const std::string &filePath)
+{
+	struct Copy
+	{
+		const char *name;
+		std::string path;
+		dv::CompressionType compression;
+	};
+	const std::filesystem::path directory = std::filesystem::temp_directory_path();
+	std::vector<Copy> copies = {{"as recorded", filePath, dv::CompressionType::NONE}};
+	for (auto [name, compression] : {std::pair{"none", dv::CompressionType::NONE}, std::pair{"lz4", dv::CompressionType::LZ4},
+		std::pair{"lz4-high", dv::CompressionType::LZ4_HIGH}, std::pair{"zstd", dv::CompressionType::ZSTD},
+		std::pair{"zstd-high", dv::CompressionType::ZSTD_HIGH}})
+	{
+		copies.push_back({name, (directory / (std::string("reader_check_") + name + ".aedat4")).string(), compression});
+	}
+
+	bool passed = true;
+	for (const Copy &copy : copies)
+	{
+		bool written = copy.path == filePath || writeCopy(filePath, copy.path, copy.compression);
+		int64_t packets = 0, events = 0;
+		std::string difference = written ? compareReaders(copy.path, packets, events) : "could not write the copy";
+
+		// the same copy once more with each reader on its own, for the MB/s of each compression
+		ReadResult dvResult, mappedResult;
+		struct stat info;
+		double megabytes = stat(copy.path.c_str(), &info) == 0 ? info.st_size / 1e6 : 0;
+		bool timed = difference.empty() && readWithDv(copy.path, false, dvResult) && readMapped(copy.path, false, mappedResult);
+
+		printf("%-12s %9.1f MB %10lld packets %14lld events", copy.name, megabytes, (long long)packets, (long long)events);
+		if (timed)
+		{
+			printf("  dv %8.1f MB/s  mapped %8.1f MB/s", megabytes / dvResult.seconds, megabytes / mappedResult.seconds);
+		}
+		printf("  %s\n", difference.empty() ? "PASS" : "FAIL");
+		if (!difference.empty())
+		{
+			printf("    %s\n", difference.c_str());
+			passed = false;
+		}
+		if (copy.path != filePath)
+		{
+			std::filesystem::remove(copy.path);
+		}
+	}
+	return passed;
+}
+
+// Checks every recording in a list, one path per line relative to the list, # starts a comment
+// Recordings that are not there are skipped, returns false if the list cannot be read or a check failed
+static bool checkList(const std::string &listPath)
+{
+	std::ifstream list(listPath);
+	if (!list.is_open())
+	{
+		std::cerr << "Could not open " << listPath << std::endl;
+		return false;
+	}
+	const std::filesystem::path directory = std::filesystem::path(listPath).parent_path();
+	int checked = 0, failed = 0, skipped = 0;
+	std::string line;
+	while (std::getline(list, line))
+	{
+		std::istringstream fields(line.substr(0, line.find('#')));
+		std::string name;
+		if (!(fields >> name))
+		{
+			continue;
+		}
+		const std::string filePath = (directory / name).string();
+		if (!std::filesystem::exists(filePath))
+		{
+			printf("%s: SKIP, not there\n", filePath.c_str());
+			skipped++;
+			continue;
+		}
+		printf("%s\n", filePath.c_str());
+		checked++;
+		if (!checkRecording(filePath))
+		{
+			failed++;
+		}
+	}
+	printf("%d recordings, %d failed, %d skipped\n", checked, failed, skipped);
+	return failed == 0;
+}
+
+static void report(const char *name, const ReadResult &result, double megabytes)
+{
+	printf("%-10s %8.3f s  %9.1f MB/s  %12.0f events/s  %lld events", name, result.seconds,
+		megabytes / result.seconds, result.events / result.seconds, (long long)result.events);
+	if (result.crossings > 0)
+	{
+		printf("  %d crossings", result.crossings);
+	}
+	printf("\n");
+}
+
+int main(int argc, char* argv[])
+{
+	std::string filePath, checkPath;
+	bool track = false;
+	int passes = 2;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strncmp(argv[i], "--check=", 8) == 0)
+		{
+			checkPath = argv[i] + 8;
+		}
+		else if (std::strcmp(argv[i], "--track") == 0)
+		{
+			track = true;
+		}
+		else if (std::strncmp(argv[i], "--passes=", 9) == 0)
+		{
+			passes = std::max(1, std::atoi(argv[i] + 9));
+		}
+		else if (filePath.empty())
+		{
+			filePath = argv[i];
+		}
+		else
+		{
+			std::cout << "Additional command line arguments found but not used..." << std::endl;
+		}
+	}
+	if (!checkPath.empty())
+	{
+		return checkList(checkPath) ? 0 : EXIT_FAILURE;
+	}
+	if (filePath.empty())
+	{
+		std::cout << "To compare the readers, use: ./reader_bench.exe <path-to-aedat4> [--track] [--passes=N]" << std::endl;
+		std::cout << "To check that they read the same events, use: ./reader_bench.exe --check=<recording-list>" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	struct stat info;
+	if (stat(filePath.c_str(), &info) != 0)
+	{
+		std::cerr << "Could not find " << filePath << std::endl;
+		return EXIT_FAILURE;
+	}
+	double megabytes = info.st_size / 1e6;
+	printf("%s: %.1f MB%s\n", filePath.c_str(), megabytes, track ? ", with tracking" : "");
+
+	bool same = true;
+	for (int pass = 0; pass < passes; pass++)
+	{
+		ReadResult dvResult, mappedResult;
+		bool ok;
+		if (pass % 2 == 0)
+		{
+			ok = readWithDv(filePath, track, dvResult) && readMapped(filePath, track, mappedResult);
+		}
+		else
+		{
+			ok = readMapped(filePath, track, mappedResult) && readWithDv(filePath, track, dvResult);
+		}
+		if (!ok)
+		{
+			return EXIT_FAILURE;
+		}
+
+		printf("pass %d\n", pass + 1);
+		report("dv", dvResult, megabytes);
+		report("mapped", mappedResult, megabytes);
+		printf("%-10s %8.2fx\n", "speedup", dvResult.seconds / mappedResult.seconds);
+
+		if (dvResult.events != mappedResult.events || dvResult.checksum != mappedResult.checksum
+			|| dvResult.crossings != mappedResult.crossings)
+		{
+			same = false;
+		}
+	}
+
+	if (!same)
+	{
+		std::cerr << "The readers did not return the same events" << std::endl;
+		return EXIT_FAILURE;
+	}
+	return 0;
+}
@@ -3,6 +3,12 @@ mkdir ../cluster/build
 cd ../cluster/build
 CC=gcc-10 CXX=g++-10 cmake ..
 make all
+cd ../..
+rm -rf tracker/build
+mkdir tracker/build
+cd tracker/build
+CC=gcc-10 CXX=g++-10 cmake ..
+make all
 cd ../../object_detection
 rm -rf build
 mkdir build
@@ -0,0 +1,1100 @@
+#include <tracker/cluster_pool.hpp>
+#include <tracker/tracking_pipeline.hpp>
+#include <tracker/tracker_config.hpp>
+#include <tracker/synthetic_scene.hpp>
+#include <tracker/load_governor.hpp>
+#include <tracker/recording_reader.hpp>
+#include "constants.hpp"
+
+#include <dv-processing/core/core.hpp>
+#include <dv-processing/io/mono_camera_writer.hpp>
+
+#include <sys/resource.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <span>
+#include <sstream>
+#include <vector>
+
+// Replays the reference recordings in a cases file through the whole tracker, without a window, and checks
+// the crossing counts, the crossings and the cluster tracks against the golden outputs checked in next to it.
+// Prints the throughput and peak memory of every case, exits with a failure if any case is out of tolerance.
+//
+// Each line of the cases file is "<name> <source> [settings-file]", where the source is an .aedat4 file,
+// "synthetic:<settings>" for a generated scene (see SyntheticSceneConfig), or "recorded:<settings>" for a
+// generated scene written to an LZ4 recording in the temp directory first and read back from it like a
+// recording, and the optional settings file is read like tracker_settings.cfg. Recordings are read with
+// RecordingReader, --reader=mapped picks the mapped reader. Paths are relative to the cases file, goldens are golden/<name>.golden.
+// Cases whose recording is not there are skipped, so the large recordings do not have to be on every machine.
+// Every case also fails if tracking a packet allocates once the first steadyAfter microseconds have been tracked.
+// Before the cases, the checks below run on their own and are reported as one row each (not with --case).
+
+// cluster positions are written down at this interval of event time
+static const int64_t sampleInterval = 100000;
+// event time after the start of a case from which the tracker must not allocate
+static const int64_t steadyAfter = 1000000;
+
+// every allocation in the program is counted, a case reads the count before and after each packet
+// All the replaceable forms of operator new are replaced, so an aligned, nothrow or array allocation
+// is counted as well, whatever the standard library's own versions of them call
+static std::atomic<uint64_t> allocations{0};
+
+// nullptr if there is no memory, alignment 0 for the default one
+static void *countedAllocate(std::size_t size, std::size_t alignment)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if (size == 0)
+	{
+		size = 1;
+	}
+	if (alignment == 0)
+	{
+		return std::malloc(size);
+	}
+	// aligned_alloc wants a size that is a multiple of the alignment
+	return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+static void *countedNew(std::size_t size, std::size_t alignment)
+{
+	if (void *memory = countedAllocate(size, alignment))
+	{
+		return memory;
+	}
+	throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size)
+{
+	return countedNew(size, 0);
+}
+
+void *operator new[](std::size_t size)
+{
+	return countedNew(size, 0);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+	return countedNew(size, (std::size_t)alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return countedNew(size, (std::size_t)alignment);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+	return countedAllocate(size, 0);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+	return countedAllocate(size, 0);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+	return countedAllocate(size, (std::size_t)alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+	return countedAllocate(size, (std::size_t)alignment);
+}
+
+// not inlined, where gcc can see the free() it takes the pointer for one from a mismatched new
+// malloc and aligned_alloc memory are both given back with free(), so every delete ends up here
+[[gnu::noinline]] void operator delete(void *memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+	::operator delete(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+	::operator delete(memory);
+}
+
+void operator delete[](void *memory, std::size_t) noexcept
+{
+	::operator delete(memory);
+}
+
+void operator delete(void *memory, std::align_val_t) noexcept
+{
+	::operator delete(memory);
+}
+
+void operator delete[](void *memory, std::align_val_t) noexcept
+{
+	::operator delete(memory);
+}
+
+void operator delete(void *memory, std::size_t, std::align_val_t) noexcept
+{
+	::operator delete(memory);
+}
+
+void operator delete[](void *memory, std::size_t, std::align_val_t) noexcept
+{
+	::operator delete(memory);
+}
+
+void operator delete(void *memory, const std::nothrow_t &) noexcept
+{
+	::operator delete(memory);
+}
+
+void operator delete[](void *memory, const std::nothrow_t &) noexcept
+{
+	::operator delete(memory);
+}
+
+void operator delete(void *memory, std::align_val_t, const std::nothrow_t &) noexcept
+{
+	::operator delete(memory);
+}
+
+void operator delete[](void *memory, std::align_val_t, const std::nothrow_t &) noexcept
+{
+	::operator delete(memory);
+}
+
+struct Tolerances
+{
+	// crossings the counts may be off by, and golden crossings that may have no match
+	int crossings = 0;
+	// microseconds a crossing may move and still match
+	int64_t crossingTime = 20000;
+	// pixels and radius a cluster may be off by and still match
+	double position = 2;
+	double radius = 1;
+	// fraction of the golden cluster positions that may have no match
+	double tracks = 0.01;
+};
+
+struct TrackSample
+{
+	int64_t timestamp;
+	// x, y and radius of every cluster
+	std::vector<std::array<double, 3>> clusters;
+};
+
+struct ReplayOutput
+{
+	int64_t events = 0;
+	int totalCrossing = 0, netCrossing = 0;
+	// timestamp and direction
+	std::vector<std::pair<int64_t, int>> crossings;
+	std::vector<TrackSample> samples;
+};
+
+struct ReplayCase
+{
+	std::string name, source, settings;
+};
+
+static double peakRssMB()
+{
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+	return usage.ru_maxrss / 1024.0;
+#endif
+}
+
+static void writeGolden(const std::string &path, const std::string &source, const ReplayOutput &output)
+{
+	std::ofstream file(path);
+	file << "# golden output of replay_regression.exe, rewrite with --update only after checking the change is wanted\n";
+	file << "source " << source << "\n";
+	file << "sampleInterval " << sampleInterval << "\n";
+	file << "events " << output.events << "\n";
+	file << "totalCrossing " << output.totalCrossing << "\n";
+	file << "netCrossing " << output.netCrossing << "\n";
+	for (const auto &crossing : output.crossings)
+	{
+		file << "crossing " << crossing.first << " " << crossing.second << "\n";
+	}
+	file.precision(6);
+	for (const TrackSample &sample : output.samples)
+	{
+		file << "sample " << sample.timestamp << " " << sample.clusters.size();
+		for (const auto &cluster : sample.clusters)
+		{
+			file << " " << cluster[0] << " " << cluster[1] << " " << cluster[2];
+		}
+		file << "\n";
+	}
+}
+
+static bool readGolden(const std::string &path, ReplayOutput &output)
+{
+	std::ifstream file(path);
+	if (!file.is_open())
+	{
+		return false;
+	}
+	std::string line;
+	while (std::getline(file, line))
+	{
+		std::istringstream fields(line);
+		std::string key;
+		fields >> key;
+		if (key == "events")
+		{
+			fields >> output.events;
+		}
+		else if (key == "totalCrossing")
+		{
+			fields >> output.totalCrossing;
+		}
+		else if (key == "netCrossing")
+		{
+			fields >> output.netCrossing;
+		}
+		else if (key == "crossing")
+		{
+			std::pair<int64_t, int> crossing;
+			fields >> crossing.first >> crossing.second;
+			output.crossings.push_back(crossing);
+		}
+		else if (key == "sample")
+		{
+			TrackSample sample;
+			size_t count = 0;
+			fields >> sample.timestamp >> count;
+			sample.clusters.resize(count);
+			for (auto &cluster : sample.clusters)
+			{
+				fields >> cluster[0] >> cluster[1] >> cluster[2];
+			}
+			output.samples.push_back(sample);
+		}
+	}
+	return true;
+}
+
+// matches each golden cluster to the closest unused replayed one, returns the clusters left without a match on either side
+static int unmatchedClusters(const TrackSample &golden, const TrackSample &replayed, const Tolerances &tolerances)
+{
+	std::vector<bool> used(replayed.clusters.size(), false);
+	int unmatched = 0;
+	for (const auto &expected : golden.clusters)
+	{
+		int best = -1;
+		double bestDistance = tolerances.position;
+		for (size_t i = 0; i < replayed.clusters.size(); i++)
+		{
+			const auto &actual = replayed.clusters[i];
+			double distance = std::max(std::fabs(actual[0] - expected[0]), std::fabs(actual[1] - expected[1]));
+			if (!used[i] && distance <= bestDistance && std::fabs(actual[2] - expected[2]) <= tolerances.radius)
+			{
+				best = i;
+				bestDistance = distance;
+			}
+		}
+		if (best < 0)
+		{
+			unmatched++;
+		}
+		else
+		{
+			used[best] = true;
+		}
+	}
+	return unmatched + std::count(used.begin(), used.end(), false);
+}
+
+// returns the reasons the replay is out of tolerance, empty if it passes
+static std::vector<std::string> compare(const ReplayOutput &golden, const ReplayOutput &replayed, const Tolerances &tolerances)
+{
+	std::vector<std::string> failures;
+	auto fail = [&failures](const std::string &what, double expected, double actual)
+	{
+		std::ostringstream reason;
+		reason << what << " expected " << expected << " got " << actual;
+		failures.push_back(reason.str());
+	};
+
+	if (golden.events != replayed.events)
+	{
+		// the input itself is different, nothing else can be compared
+		fail("events", golden.events, replayed.events);
+		return failures;
+	}
+	if (std::abs(golden.totalCrossing - replayed.totalCrossing) > tolerances.crossings)
+	{
+		fail("totalCrossing", golden.totalCrossing, replayed.totalCrossing);
+	}
+	if (std::abs(golden.netCrossing - replayed.netCrossing) > tolerances.crossings)
+	{
+		fail("netCrossing", golden.netCrossing, replayed.netCrossing);
+	}
+
+	std::vector<bool> used(replayed.crossings.size(), false);
+	int unmatched = 0;
+	for (const auto &expected : golden.crossings)
+	{
+		bool found = false;
+		for (size_t i = 0; i < replayed.crossings.size() && !found; i++)
+		{
+			const auto &actual = replayed.crossings[i];
+			if (!used[i] && actual.second == expected.second && std::abs(actual.first - expected.first) <= tolerances.crossingTime)
+			{
+				used[i] = found = true;
+			}
+		}
+		unmatched += !found;
+	}
+	if (unmatched > tolerances.crossings)
+	{
+		fail("unmatched crossings", 0, unmatched);
+	}
+
+	if (golden.samples.size() != replayed.samples.size())
+	{
+		fail("track samples", golden.samples.size(), replayed.samples.size());
+	}
+	else
+	{
+		int64_t clusters = 0, unmatchedTracks = 0;
+		for (size_t i = 0; i < golden.samples.size(); i++)
+		{
+			clusters += golden.samples[i].clusters.size();
+			unmatchedTracks += unmatchedClusters(golden.samples[i], replayed.samples[i], tolerances);
+		}
+		double fraction = clusters > 0 ? (double)unmatchedTracks / clusters : (double)(unmatchedTracks > 0);
+		if (fraction > tolerances.tracks)
+		{
+			fail("unmatched track fraction", 0, fraction);
+		}
+	}
+	return failures;
+}
+
+// The ClusterPool behaviour the tracker relies on, with ints for clusters
+static std::vector<std::string> checkClusterPool()
+{
+	std::vector<std::string> failures;
+	auto check = [&failures](bool ok, const char *what)
+	{
+		if (!ok)
+		{
+			failures.push_back(what);
+		}
+	};
+
+	// the sustain check walks the packed array backwards and removes clusters as it goes, each swap brings
+	// an already visited cluster into the gap, so every cluster is visited once
+	{
+		ClusterPool<int> pool(10);
+		std::vector<ClusterHandle> handles;
+		for (int i = 0; i < 10; i++)
+		{
+			handles.push_back(pool.emplace(i));
+		}
+		std::vector<int> visited;
+		for (size_t i = pool.size(); i > 0; i--)
+		{
+			visited.push_back(pool[i - 1]);
+			if (pool[i - 1] % 2 != 0)
+			{
+				pool.removeAt(i - 1);
+			}
+		}
+		std::sort(visited.begin(), visited.end());
+		check(visited == std::vector<int>({0, 1, 2, 3, 4, 5, 6, 7, 8, 9}), "the backwards walk did not visit every cluster once");
+		check(pool.size() == 5, "the backwards walk removed the wrong number of clusters");
+		for (int i = 0; i < 10; i++)
+		{
+			const int *value = pool.get(handles[i]);
+			check(i % 2 == 0 ? value != nullptr && *value == i : value == nullptr,
+				"a handle points at the wrong cluster after the backwards walk");
+		}
+	}
+
+	// a handle to a removed cluster stays invalid once its slot has been reused
+	{
+		ClusterPool<int> pool(2);
+		ClusterHandle first = pool.emplace(1);
+		pool.remove(first);
+		ClusterHandle second = pool.emplace(2);
+		check(second.slot == first.slot && second != first, "the freed slot was not reused with a new generation");
+		check(pool.get(first) == nullptr, "a stale handle still finds a cluster");
+		check(!pool.remove(first) && pool.size() == 1, "removing through a stale handle removed the new cluster");
+		check(pool.get(second) != nullptr && *pool.get(second) == 2, "the new cluster is not found by its own handle");
+	}
+
+	// checkpoints put clusters back in given slots, after other slots have gone through the free list
+	{
+		ClusterPool<int> pool(4);
+		std::vector<ClusterHandle> handles;
+		for (int i = 0; i < 4; i++)
+		{
+			handles.push_back(pool.emplace(i));
+		}
+		pool.remove(handles[1]);
+		pool.remove(handles[3]);
+		ClusterHandle reused = pool.emplace(30);
+		check(reused.slot == 3, "the most recently freed slot was not handed out first");
+		check(pool.emplaceAt(3, 31).slot == ClusterHandle::invalidSlot, "emplaceAt took a slot that is in use");
+		check(pool.emplaceAt(7, 70).slot == ClusterHandle::invalidSlot, "emplaceAt took a slot past the capacity");
+		ClusterHandle placed = pool.emplaceAt(1, 10);
+		check(placed.slot == 1 && pool.atSlot(1) != nullptr && *pool.atSlot(1) == 10, "emplaceAt did not fill the free slot");
+		check(pool.full() && !pool.emplace(99).valid(), "the pool is not full once every slot is taken again");
+		check(pool.get(handles[1]) == nullptr, "the handle from before emplaceAt finds the new cluster");
+	}
+	return failures;
+}
+
+// what a tracker has done so far, for comparing a resumed run with one that was never stopped
+struct TrackerSummary
+{
+	int totalCrossing, netCrossing;
+	int64_t events;
+	std::vector<std::pair<int64_t, int>> crossings;
+	std::vector<std::array<double, 3>> clusters;
+
+	bool operator==(const TrackerSummary &other) const = default;
+};
+
+template <typename Policies>
+static void trackPackets(BasicTracker<TrackerReal, Policies> &tracker, const std::vector<dv::EventStore> &packets, size_t from,
+	size_t to, TrackerSummary &summary)
+{
+	for (size_t i = from; i < to; i++)
+	{
+		tracker.processEvents(packets[i]);
+		for (const CrossingRecord &crossing : tracker.getCrossings())
+		{
+			summary.crossings.emplace_back(crossing.timestamp, crossing.direction);
+		}
+	}
+	summary.totalCrossing = tracker.getTotalCrossing();
+	summary.netCrossing = tracker.getNetCrossing();
+	summary.events = tracker.getEventCount();
+	summary.clusters.clear();
+	for (const BasicCluster<TrackerReal> &cluster : tracker.getClusters())
+	{
+		BasicClusterState<TrackerReal> state = cluster.getState();
+		summary.clusters.push_back(
+			{numeric::toDouble(state.x), numeric::toDouble(state.y), numeric::toDouble(state.radius)});
+	}
+}
+
+// saves a checkpoint halfway through, loads it into a new tracker that finishes the scene, and expects
+// the same crossings and clusters as a tracker that ran straight through
+template <typename Policies>
+static void checkResume(const char *name, const std::vector<dv::EventStore> &packets, cv::Size resolution,
+	const std::string &path, std::vector<std::string> &failures)
+{
+	TrackerSummary straight, resumed;
+	BasicTracker<TrackerReal, Policies> whole(resolution);
+	trackPackets(whole, packets, 0, packets.size(), straight);
+
+	const size_t half = packets.size() / 2;
+	{
+		BasicTracker<TrackerReal, Policies> first(resolution);
+		trackPackets(first, packets, 0, half, resumed);
+		if (!first.saveCheckpoint(path, CheckpointPosition()))
+		{
+			failures.push_back(std::string(name) + ": could not save a checkpoint");
+			return;
+		}
+	}
+	BasicTracker<TrackerReal, Policies> second(resolution);
+	CheckpointPosition position;
+	if (!second.loadCheckpoint(path, position))
+	{
+		failures.push_back(std::string(name) + ": could not load its own checkpoint");
+		return;
+	}
+	trackPackets(second, packets, half, packets.size(), resumed);
+	if (!(resumed == straight))
+	{
+		failures.push_back(std::string(name) + ": resuming from a checkpoint halfway changed the crossings or clusters");
+	}
+}
+
+// Checkpoints taken halfway through a synthetic scene carry on exactly, for each tracker the tools build,
+// and a tracker refuses a checkpoint from one with other policies
+static std::vector<std::string> checkCheckpoints()
+{
+	std::vector<std::string> failures;
+	SyntheticSceneConfig sceneConfig;
+	parseSyntheticScene("bees=20,seconds=10,seed=6", sceneConfig);
+	SyntheticScene scene(sceneConfig);
+	std::vector<dv::EventStore> packets;
+	dv::EventStore packet;
+	while (scene.nextPacket(packet))
+	{
+		if (!packet.isEmpty())
+		{
+			packets.push_back(packet);
+		}
+	}
+
+	const std::string path = (std::filesystem::temp_directory_path() / "replay_regression.checkpoint").string();
+	checkResume<LiveTrackingPolicies>("live", packets, sceneConfig.resolution, path, failures);
+	checkResume<CenterLinePolicies>("center line", packets, sceneConfig.resolution, path, failures);
+	checkResume<DelayWingbeatPolicies>("delay wingbeat", packets, sceneConfig.resolution, path, failures);
+	checkResume<FourierWingbeatPolicies>("fourier wingbeat", packets, sceneConfig.resolution, path, failures);
+	checkResume<ForcedOscillatorPolicies>("forced oscillator", packets, sceneConfig.resolution, path, failures);
+
+	// the last checkpoint written is a delay wingbeat one, then a center line one: neither is a live tracker's
+	std::ostringstream refusals;
+	std::streambuf *cerrBuffer = std::cerr.rdbuf(refusals.rdbuf());
+	CheckpointPosition position;
+	BasicTracker<TrackerReal, LiveTrackingPolicies> live(sceneConfig.resolution);
+	bool loadedDelayWingbeat = live.loadCheckpoint(path, position);
+	BasicTracker<TrackerReal, CenterLinePolicies>(sceneConfig.resolution).saveCheckpoint(path, position);
+	bool loadedCenterLine = live.loadCheckpoint(path, position);
+	std::cerr.rdbuf(cerrBuffer);
+	if (loadedDelayWingbeat || loadedCenterLine)
+	{
+		failures.push_back("a live tracker loaded a checkpoint from a tracker with other policies");
+	}
+	std::filesystem::remove(path);
+	return failures;
+}
+
+// Drives a LoadGovernor the way the live tool does with a scene that arrives faster than it can be
+// tracked for its first 4 seconds, then slowly enough to catch up. The wall clock is simulated from how
+// long each packet took in that model, so the check does not depend on the machine
+template <typename Policies>
+static void checkGovernor(const char *name, const std::vector<dv::EventStore> &packets, cv::Size resolution,
+	std::vector<std::string> &failures)
+{
+	using Clock = LoadGovernor::Clock;
+	BasicTracker<TrackerReal, Policies> tracker(resolution);
+	GovernorConfig config;
+	config.dropOnEvents = BasicTracker<TrackerReal, Policies>::usesOnEvents;
+	LoadGovernor governor(config);
+
+	// the tiers the governor should go through, up one at a time and back down the same way
+	std::vector<LoadTier> expected;
+	for (int tier = 0; tier < (int)LoadTier::count; tier++)
+	{
+		if ((LoadTier)tier != LoadTier::dropOnEvents || config.dropOnEvents)
+		{
+			expected.push_back((LoadTier)tier);
+		}
+	}
+	for (int i = (int)expected.size() - 2; i >= 0; i--)
+	{
+		expected.push_back(expected[i]);
+	}
+
+	std::vector<LoadTier> visited = {governor.getTier()};
+	Clock::time_point now = Clock::now();
+	const int64_t start = packets.front().getLowestTime();
+	int64_t previous = start;
+	for (const dv::EventStore &packet : packets)
+	{
+		governor.update(packet.getHighestTime(), now);
+		tracker.setDropOnEvents(!governor.onEventsEnabled());
+		if (governor.getTier() != visited.back())
+		{
+			visited.push_back(governor.getTier());
+		}
+		if (governor.isShedding())
+		{
+			governor.shed(packet, tracker.getEntrance(), [&tracker](std::span<const dv::Event> kept) { tracker.processEvents(kept); });
+		}
+		else
+		{
+			tracker.processEvents(packet);
+		}
+
+		// twice as long as the packet covers while overloaded, a fifth of it afterwards
+		const int64_t covered = packet.getHighestTime() - previous;
+		previous = packet.getHighestTime();
+		now += std::chrono::microseconds(packet.getHighestTime() - start < 4000000 ? 2 * covered : covered / 5);
+	}
+
+	if (visited != expected)
+	{
+		std::string order;
+		for (LoadTier tier : visited)
+		{
+			order += std::string(order.empty() ? "" : " -> ") + loadTierName(tier);
+		}
+		failures.push_back(std::string(name) + ": the tiers went " + order);
+	}
+	GovernorStats stats = governor.getStats(now);
+	for (int tier = 1; tier < (int)LoadTier::count; tier++)
+	{
+		bool used = (LoadTier)tier != LoadTier::dropOnEvents || config.dropOnEvents;
+		if (used != (stats.entered[tier] > 0) || used != (stats.seconds[tier] > 0))
+		{
+			failures.push_back(std::string(name) + ": " + loadTierName((LoadTier)tier) + " was entered " + std::to_string(stats.entered[tier])
+				+ " times for " + std::to_string(stats.seconds[tier]) + " s");
+		}
+	}
+	if (stats.outsideEventsDropped == 0 || stats.maxLag <= config.raiseLag)
+	{
+		failures.push_back(std::string(name) + ": no events were dropped outside the entrance or the lag never passed raiseLag");
+	}
+}
+
+// The governor sheds load in order while a scene comes in faster than it is tracked and restores it in
+// order once the tracker has caught up, for a tracker that ignores on events and for one that uses them
+static std::vector<std::string> checkLoadGovernor()
+{
+	std::vector<std::string> failures;
+	SyntheticSceneConfig sceneConfig;
+	parseSyntheticScene("bees=20,seconds=20,seed=7", sceneConfig);
+	SyntheticScene scene(sceneConfig);
+	std::vector<dv::EventStore> packets;
+	dv::EventStore packet;
+	while (scene.nextPacket(packet))
+	{
+		if (!packet.isEmpty())
+		{
+			packets.push_back(packet);
+		}
+	}
+	checkGovernor<LiveTrackingPolicies>("live", packets, sceneConfig.resolution, failures);
+	checkGovernor<DelayWingbeatPolicies>("delay wingbeat", packets, sceneConfig.resolution, failures);
+	return failures;
+}
+
+// feeds a wingbeat estimator a wing flapping at frequency Hz for two seconds, an off event every 100 us
+// for the first half of each beat and an on event for the second, and expects the frequency of the
+// period it gives, to the nearest Hz, within tolerance Hz
+template <typename Wingbeat>
+static void checkWingbeat(const char *name, int frequency, double tolerance, std::vector<std::string> &failures)
+{
+	typename Wingbeat::State state{};
+	const double beat = 1e6 / frequency;
+	for (int64_t timestamp = 1000000; timestamp < 3000000; timestamp += 100)
+	{
+		double into = std::fmod(timestamp - 1000000, beat);
+		Wingbeat::event(state, timestamp, into >= beat / 2);
+	}
+	int period = Wingbeat::period(state);
+	if (period <= 0 || std::abs(std::round(1e6 / period) - frequency) > tolerance)
+	{
+		failures.push_back(std::string(name) + ": a " + std::to_string(frequency) + " Hz wing beat gave a period of " +
+			std::to_string(period) + " us");
+	}
+}
+
+// Every wingbeat estimator finds the frequency of a steady wing beat in the band the trees looked in, to
+// within its resolution: a 4 Hz bin of the DFT, the 5 Hz between two forced oscillators
+static std::vector<std::string> checkWingbeats()
+{
+	std::vector<std::string> failures;
+	for (int frequency : {200, 230})
+	{
+		checkWingbeat<DelayWingbeat>("delay wingbeat", frequency, 2, failures);
+		checkWingbeat<FourierWingbeat>("fourier wingbeat", frequency, 4, failures);
+		checkWingbeat<ForcedOscillatorWingbeat>("forced oscillator", frequency, 5, failures);
+	}
+	return failures;
+}
+
+// where the allocation counter check keeps its pointers, so the compiler cannot drop a new and delete pair
+static void *volatile allocationSink;
+
+// Every form of new is counted, so a tracker that allocates through one of them cannot pass the cases
+static std::vector<std::string> checkAllocationCounter()
+{
+	struct alignas(64) Line
+	{
+		char bytes[64];
+	};
+	const std::pair<const char *, std::function<void()>> forms[] = {
+		{"new", [] { allocationSink = new int(1); delete (int *)allocationSink; }},
+		{"new[]", [] { allocationSink = new int[4]; delete[] (int *)allocationSink; }},
+		{"aligned new", [] { allocationSink = new Line; delete (Line *)allocationSink; }},
+		{"aligned new[]", [] { allocationSink = new Line[4]; delete[] (Line *)allocationSink; }},
+		{"nothrow new", [] { allocationSink = new (std::nothrow) int(1); delete (int *)allocationSink; }},
+		{"nothrow new[]", [] { allocationSink = new (std::nothrow) int[4]; delete[] (int *)allocationSink; }},
+		{"aligned nothrow new", [] { allocationSink = new (std::nothrow) Line; delete (Line *)allocationSink; }},
+		{"aligned nothrow new[]", [] { allocationSink = new (std::nothrow) Line[4]; delete[] (Line *)allocationSink; }},
+	};
+
+	std::vector<std::string> failures;
+	for (const auto &[name, allocate] : forms)
+	{
+		uint64_t before = allocations.load(std::memory_order_relaxed);
+		allocate();
+		uint64_t counted = allocations.load(std::memory_order_relaxed) - before;
+		if (counted != 1)
+		{
+			failures.push_back(std::string(name) + " was counted " + std::to_string(counted) + " times instead of once");
+		}
+		if (std::string(name).find("aligned") == 0 && (uintptr_t)allocationSink % alignof(Line) != 0)
+		{
+			failures.push_back(std::string(name) + " returned memory that is not aligned to " + std::to_string(alignof(Line)));
+		}
+	}
+	return failures;
+}
+
+// writes a generated scene to an AEDAT4 recording with dv-processing's writer, as the Recorder would
+static bool writeRecording(const SyntheticSceneConfig &sceneConfig, const std::string &path)
+{
+	try
+	{
+		dv::io::MonoCameraWriter writer(path, dv::io::MonoCameraWriter::EventOnlyConfig("synthetic", sceneConfig.resolution));
+		SyntheticScene scene(sceneConfig);
+		dv::EventStore packet;
+		while (scene.nextPacket(packet))
+		{
+			if (!packet.isEmpty())
+			{
+				writer.writeEvents(packet);
+			}
+		}
+	}
+	catch (const std::exception &exception)
+	{
+		std::cerr << "Could not write " << path << ": " << exception.what() << std::endl;
+		return false;
+	}
+	return true;
+}
+
+// runs a check and prints its row, returns false if it failed
+static bool runCheck(const char *name, std::vector<std::string> (*check)())
+{
+	std::vector<std::string> failures = check();
+	printf("%-24s %12s %10s %10s %10s %9s  %s\n", name, "-", "-", "-", "-", "-", failures.empty() ? "PASS" : "FAIL");
+	for (const std::string &failure : failures)
+	{
+		printf("    %s\n", failure.c_str());
+	}
+	return failures.empty();
+}
+
+int main(int argc, char* argv[])
+{
+	std::string casesPath = "./regression/cases.txt";
+	std::string onlyCase, jsonPath;
+	bool update = false;
+	Tolerances tolerances;
+	ReaderKind readerKind = ReaderKind::dv;
+	bool readerOk = true;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		auto value = [&arg]() { return arg.substr(arg.find('=') + 1); };
+		if (arg == "--update")
+		{
+			update = true;
+		}
+		else if (arg.rfind("--case=", 0) == 0)
+		{
+			onlyCase = value();
+		}
+		else if (arg.rfind("--json=", 0) == 0)
+		{
+			jsonPath = value();
+		}
+		else if (arg.rfind("--crossing-tolerance=", 0) == 0)
+		{
+			tolerances.crossings = std::stoi(value());
+		}
+		else if (arg.rfind("--time-tolerance=", 0) == 0)
+		{
+			tolerances.crossingTime = std::stoll(value());
+		}
+		else if (arg.rfind("--position-tolerance=", 0) == 0)
+		{
+			tolerances.position = std::stod(value());
+		}
+		else if (arg.rfind("--radius-tolerance=", 0) == 0)
+		{
+			tolerances.radius = std::stod(value());
+		}
+		else if (arg.rfind("--track-tolerance=", 0) == 0)
+		{
+			tolerances.tracks = std::stod(value());
+		}
+		else if (arg.rfind("--", 0) != 0)
+		{
+			casesPath = arg;
+		}
+		else if (!parseReaderArgument(arg, readerKind, readerOk) || !readerOk)
+		{
+			std::cerr << "Unknown argument: " << arg << std::endl;
+			std::cerr << "Usage: ./replay_regression.exe [cases-file] [--update] [--case=<name>] [--json=<path>]" << std::endl;
+			std::cerr << "  [--crossing-tolerance=<count>] [--time-tolerance=<us>] [--position-tolerance=<px>]" << std::endl;
+			std::cerr << "  [--radius-tolerance=<px>] [--track-tolerance=<fraction>] [--reader=dv|mapped]" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::ifstream casesFile(casesPath);
+	if (!casesFile.is_open())
+	{
+		std::cerr << "Could not open cases file: " << casesPath << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::filesystem::path baseDir = std::filesystem::path(casesPath).parent_path();
+
+	std::vector<ReplayCase> cases;
+	std::string line;
+	while (std::getline(casesFile, line))
+	{
+		line = line.substr(0, line.find('#'));
+		ReplayCase replayCase;
+		std::istringstream(line) >> replayCase.name >> replayCase.source >> replayCase.settings;
+		if (!replayCase.source.empty() && (onlyCase.empty() || onlyCase == replayCase.name))
+		{
+			cases.push_back(replayCase);
+		}
+	}
+
+	std::ofstream json;
+	if (!jsonPath.empty())
+	{
+		json.open(jsonPath);
+		json << "[";
+	}
+
+	int failed = 0, skipped = 0;
+	bool firstJson = true;
+	printf("%-24s %12s %10s %10s %10s %9s  %s\n", "Case", "Events", "Seconds", "Mev/s", "Crossings", "Peak MB", "Result");
+	int checksFailed = 0;
+	if (onlyCase.empty())
+	{
+		checksFailed += !runCheck("allocation_counter", checkAllocationCounter);
+		checksFailed += !runCheck("cluster_pool", checkClusterPool);
+		checksFailed += !runCheck("checkpoint_resume", checkCheckpoints);
+		checksFailed += !runCheck("load_governor", checkLoadGovernor);
+		checksFailed += !runCheck("wingbeat_estimators", checkWingbeats);
+	}
+	for (const ReplayCase &replayCase : cases)
+	{
+		// every case reads its packets one at a time, so the peak memory is the tracker's and not the recording's
+		cv::Size resolution;
+		std::function<bool(std::span<const dv::Event> &)> nextPacket;
+		std::unique_ptr<SyntheticScene> scene;
+		dv::EventStore scenePacket;
+		std::vector<dv::Event> sceneEvents;
+		std::unique_ptr<RecordingReader> reader;
+		std::filesystem::path recording, written;
+		const std::string synthetic = "synthetic:", recorded = "recorded:";
+		if (replayCase.source.rfind(synthetic, 0) == 0)
+		{
+			SyntheticSceneConfig sceneConfig;
+			if (!parseSyntheticScene(replayCase.source.substr(synthetic.size()), sceneConfig))
+			{
+				std::cerr << replayCase.name << ": could not read " << replayCase.source << std::endl;
+				failed++;
+				continue;
+			}
+			scene = std::make_unique<SyntheticScene>(sceneConfig);
+			resolution = sceneConfig.resolution;
+			nextPacket = [&scene, &scenePacket, &sceneEvents](std::span<const dv::Event> &events)
+			{
+				if (!scene->nextPacket(scenePacket))
+				{
+					return false;
+				}
+				sceneEvents.assign(scenePacket.begin(), scenePacket.end());
+				events = sceneEvents;
+				return true;
+			};
+		}
+		else
+		{
+			if (replayCase.source.rfind(recorded, 0) == 0)
+			{
+				SyntheticSceneConfig sceneConfig;
+				if (!parseSyntheticScene(replayCase.source.substr(recorded.size()), sceneConfig))
+				{
+					std::cerr << replayCase.name << ": could not read " << replayCase.source << std::endl;
+					failed++;
+					continue;
+				}
+				written = std::filesystem::temp_directory_path() / ("replay_regression_" + replayCase.name + ".aedat4");
+				if (!writeRecording(sceneConfig, written.string()))
+				{
+					failed++;
+					continue;
+				}
+				recording = written;
+			}
+			else
+			{
+				recording = baseDir / replayCase.source;
+				if (!std::filesystem::exists(recording))
+				{
+					printf("%-24s %12s %10s %10s %10s %9s  SKIP (no %s)\n", replayCase.name.c_str(), "-", "-", "-", "-", "-", recording.string().c_str());
+					skipped++;
+					continue;
+				}
+			}
+			reader = std::make_unique<RecordingReader>(recording.string(), readerKind);
+			if (!reader->isOpen())
+			{
+				std::cerr << replayCase.name << ": could not read " << recording.string() << ": " << reader->getError() << std::endl;
+				reader.reset();
+				if (!written.empty())
+				{
+					std::filesystem::remove(written);
+				}
+				failed++;
+				continue;
+			}
+			resolution = reader->getEventResolution().value();
+			nextPacket = [&reader](std::span<const dv::Event> &events) { return reader->next(events); };
+		}
+
+		// the defaults from constants.hpp unless the case names a settings file, never tracker_settings.cfg
+		TrackingPipeline pipeline(resolution);
+		pipeline.setFramesEnabled(false);
+		Tracker &tracker = pipeline.getTracker();
+		if (!replayCase.settings.empty())
+		{
+			TrackerConfig trackerConfig = tracker.getConfig();
+			if (!readTrackerConfig((baseDir / replayCase.settings).string(), trackerConfig))
+			{
+				failed++;
+				continue;
+			}
+			tracker.setConfig(trackerConfig);
+		}
+
+		ReplayOutput output;
+		std::span<const dv::Event> packet;
+		int64_t nextSample = -1, steadyFrom = -1;
+		uint64_t steadyAllocations = 0;
+		std::chrono::steady_clock::duration trackingTime{0};
+		while (nextPacket(packet))
+		{
+			if (packet.empty())
+			{
+				continue;
+			}
+
+			if (steadyFrom < 0)
+			{
+				steadyFrom = packet.front().timestamp() + steadyAfter;
+			}
+
+			// only the tracking is timed, not reading or generating the events
+			uint64_t allocationsBefore = allocations.load(std::memory_order_relaxed);
+			auto start = std::chrono::steady_clock::now();
+			pipeline.processPacket(packet);
+			trackingTime += std::chrono::steady_clock::now() - start;
+			if (packet.front().timestamp() >= steadyFrom)
+			{
+				steadyAllocations += allocations.load(std::memory_order_relaxed) - allocationsBefore;
+			}
+
+			output.events += packet.size();
+			for (const CrossingRecord &crossing : tracker.getCrossings())
+			{
+				output.crossings.emplace_back(crossing.timestamp, crossing.direction);
+			}
+
+			int64_t timeStamp = packet.back().timestamp();
+			if (nextSample < 0 || timeStamp >= nextSample)
+			{
+				nextSample = timeStamp + sampleInterval;
+				TrackSample sample{timeStamp, {}};
+				for (const Cluster &cluster : tracker.getClusters())
+				{
+					sample.clusters.push_back({(double)cluster.getX(), (double)cluster.getY(), cluster.getRadius()});
+				}
+				output.samples.push_back(sample);
+			}
+		}
+		output.totalCrossing = tracker.getTotalCrossing();
+		output.netCrossing = tracker.getNetCrossing();
+		std::string readError = reader ? reader->getError() : "";
+		reader.reset();
+		if (!written.empty())
+		{
+			std::filesystem::remove(written);
+		}
+
+		double seconds = std::chrono::duration<double>(trackingTime).count();
+		double eventsPerSecond = seconds > 0 ? output.events / seconds : 0.0;
+		double peakMB = peakRssMB();
+
+		std::string goldenPath = (baseDir / "golden" / (replayCase.name + ".golden")).string();
+		std::vector<std::string> failures;
+		std::string result;
+		if (update)
+		{
+			std::filesystem::create_directories(baseDir / "golden");
+			writeGolden(goldenPath, replayCase.source, output);
+			result = "UPDATED";
+		}
+		else
+		{
+			ReplayOutput golden;
+			if (!readGolden(goldenPath, golden))
+			{
+				failures.push_back("no golden output at " + goldenPath + ", create it with --update");
+			}
+			else
+			{
+				failures = compare(golden, output, tolerances);
+			}
+			if (steadyAllocations > 0)
+			{
+				failures.push_back(std::to_string(steadyAllocations) + " allocations while tracking after the first "
+					+ std::to_string(steadyAfter / 1000) + " ms");
+			}
+			if (!readError.empty())
+			{
+				failures.push_back("the recording could not be read to the end: " + readError);
+			}
+			result = failures.empty() ? "PASS" : "FAIL";
+			failed += !failures.empty();
+		}
+
+		printf("%-24s %12lld %10.3f %10.2f %10d %9.1f  %s\n", replayCase.name.c_str(), (long long)output.events, seconds,
+			eventsPerSecond / 1e6, output.totalCrossing, peakMB, result.c_str());
+		for (const std::string &failure : failures)
+		{
+			printf("    %s\n", failure.c_str());
+		}
+		fflush(stdout);
+
+		if (json.is_open())
+		{
+			json << (firstJson ? "" : ",") << "\n  {\"case\": \"" << replayCase.name << "\", \"events\": " << output.events
+				<< ", \"seconds\": " << seconds << ", \"events_per_s\": " << eventsPerSecond
+				<< ", \"peak_rss_mb\": " << peakMB << ", \"total_crossing\": " << output.totalCrossing
+				<< ", \"net_crossing\": " << output.netCrossing << ", \"result\": \"" << result << "\"}";
+			firstJson = false;
+		}
+	}
+
+	if (json.is_open())
+	{
+		json << "\n]\n";
+	}
+
+	// the peak is for the whole process, so it only grows from case to case, run one --case for its own figure
+	printf("%zu cases, %d failed, %d skipped, %d checks failed\n", cases.size(), failed, skipped, checksFailed);
+	return failed + checksFailed > 0 ? EXIT_FAILURE : 0;
+}
@@ -0,0 +1,200 @@
+#include <tracker/parameter_sweep.hpp>
+#include <tracker/tracker_config.hpp>
+#include <tracker/recording_reader.hpp>
+#include <tracker/recording_index.hpp>
+#include <tracker/synthetic_scene.hpp>
+#include "constants.hpp"
+
+#include <dv-processing/core/core.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Tries every combination of tracker settings in a grid file on one recording and prints a table of
+// the crossing counts, cluster lifetimes and tracking time of each. The recording is read and decoded
+// once and every packet goes to all the trackers, which run on a thread pool, so a sweep of 100 settings
+// costs about 100 times the tracking and once the reading.
+//
+// The grid file has the names of tracker_settings.cfg with a list of values each, for example
+//     clusterInitThresh = 0.3, 0.4, 0.5
+//     alpha = 0.1, 0.2
+// Settings with one value, and those that are not in the grid, come from tracker_settings.cfg when it
+// is in the current directory and from constants.hpp otherwise.
+int main(int argc, char* argv[])
+{
+	RecordingRange range;
+	ReaderKind readerKind = ReaderKind::dv;
+	int threads = 0;
+	std::string csvPath;
+	std::vector<std::string> positional;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		auto value = [&arg]() { return arg.substr(arg.find('=') + 1); };
+		bool ok = true;
+		if (range.parseArgument(arg, ok) || parseReaderArgument(arg, readerKind, ok))
+		{
+			if (!ok)
+			{
+				std::cerr << "Could not read " << arg << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+		else if (arg.rfind("--threads=", 0) == 0)
+		{
+			threads = std::atoi(value().c_str());
+		}
+		else if (arg.rfind("--csv=", 0) == 0)
+		{
+			csvPath = value();
+		}
+		else if (arg.rfind("--", 0) != 0)
+		{
+			positional.push_back(arg);
+		}
+		else
+		{
+			positional.clear();
+			break;
+		}
+	}
+	if (positional.size() != 2)
+	{
+		std::cerr << "Usage: ./sweep_parameters.exe <recording.aedat4|synthetic:<settings>> <grid-file> [--threads=N] [--csv=<path>]" << std::endl;
+		std::cerr << "  [--start=h:mm:ss] [--end=h:mm:ss] [--reader=dv|mapped]" << std::endl;
+		return EXIT_FAILURE;
+	}
+	const std::string source = positional[0], gridPath = positional[1];
+
+	TrackerConfig base;
+	if (std::filesystem::exists(constants::trackerSettings) && !readTrackerConfig(constants::trackerSettings, base))
+	{
+		return EXIT_FAILURE;
+	}
+	SweepGrid grid;
+	if (!readSweepGrid(gridPath, base, grid))
+	{
+		return EXIT_FAILURE;
+	}
+
+	// a synthetic scene is generated in packets, a recording is read in place and copied once into the sweep
+	const std::string synthetic = "synthetic:";
+	std::unique_ptr<RecordingReader> reader;
+	std::unique_ptr<SyntheticScene> scene;
+	cv::Size resolution;
+	if (source.rfind(synthetic, 0) == 0)
+	{
+		SyntheticSceneConfig sceneConfig;
+		if (!parseSyntheticScene(source.substr(synthetic.size()), sceneConfig))
+		{
+			std::cerr << "Could not read " << source << std::endl;
+			return EXIT_FAILURE;
+		}
+		scene = std::make_unique<SyntheticScene>(sceneConfig);
+		resolution = sceneConfig.resolution;
+	}
+	else
+	{
+		reader = std::make_unique<RecordingReader>(source, readerKind);
+		std::optional<cv::Size> resolutionWrapper = reader->getEventResolution();
+		if (!reader->isOpen() || !resolutionWrapper.has_value())
+		{
+			std::cerr << "Could not read recording: " << reader->getError() << std::endl;
+			return EXIT_FAILURE;
+		}
+		if (!range.seek(*reader, source))
+		{
+			return EXIT_FAILURE;
+		}
+		resolution = resolutionWrapper.value();
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	ParameterSweep sweep(resolution, grid.points, threads);
+	printf("Sweeping %zu settings on %d threads\n", sweep.size(), sweep.getThreads());
+	fflush(stdout);
+
+	if (scene)
+	{
+		dv::EventStore packet;
+		while (scene->nextPacket(packet))
+		{
+			sweep.addPacket(packet);
+		}
+	}
+	else
+	{
+		std::span<const dv::Event> packet;
+		while (reader->next(packet) && !range.isPast(packet))
+		{
+			sweep.addPacket(range.clip(packet));
+		}
+		if (!reader->getError().empty())
+		{
+			std::cerr << "Stopped reading recording: " << reader->getError() << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+	sweep.finish();
+	double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::ofstream csv;
+	if (!csvPath.empty())
+	{
+		csv.open(csvPath);
+		for (const std::string &name : grid.names)
+		{
+			csv << name << ",";
+		}
+		csv << "totalCrossing,netCrossing,clusters,meanLifetimeMs,medianLifetimeMs,seconds\n";
+	}
+
+	printf("%5s", "#");
+	for (const std::string &name : grid.names)
+	{
+		printf(" %*s", (int)std::max<size_t>(name.size(), 8), name.c_str());
+	}
+	printf(" %8s %6s %9s %13s %15s %9s %8s\n", "Crossed", "Net", "Clusters", "Mean life ms", "Median life ms", "Seconds", "Mev/s");
+
+	double trackingSeconds = 0;
+	for (size_t i = 0; i < sweep.size(); i++)
+	{
+		const SweepResult &result = sweep.getResult(i);
+		trackingSeconds += result.seconds;
+
+		printf("%5zu", i + 1);
+		for (size_t n = 0; n < grid.names.size(); n++)
+		{
+			printf(" %*s", (int)std::max<size_t>(grid.names[n].size(), 8), grid.points[i].values[n].c_str());
+		}
+		printf(" %8d %6d %9lld %13.1f %15.1f %9.3f %8.2f\n", result.totalCrossing, result.netCrossing, (long long)result.clusters,
+			result.meanLifetime() / 1000, result.medianLifetime() / 1000, result.seconds,
+			result.seconds > 0 ? sweep.getEvents() / result.seconds / 1e6 : 0.0);
+
+		if (csv.is_open())
+		{
+			for (const std::string &value : grid.points[i].values)
+			{
+				csv << value << ",";
+			}
+			csv << result.totalCrossing << "," << result.netCrossing << "," << result.clusters << ","
+				<< result.meanLifetime() / 1000 << "," << result.medianLifetime() / 1000 << "," << result.seconds << "\n";
+		}
+	}
+
+	printf("%llu events in %llu packets, %.2f s of tracking over all settings in %.2f s\n", (unsigned long long)sweep.getEvents(),
+		(unsigned long long)sweep.getPackets(), trackingSeconds, wallSeconds);
+	if (reader)
+	{
+		std::cout << reader->getStats().summary() << std::endl;
+	}
+	return 0;
+}
@@ -3,39 +3,28 @@
 
 #include <dv-sdk/module.hpp>
 #include "constants.hpp"
-#include "../cluster/cluster.hpp"
-#include <opencv2/imgproc.hpp>
-#include <vector>
-
-#define NUM_COLORS 8
+#include <tracker/tracking_pipeline.hpp>
 
 class BeeTrackingModule : public dv::ModuleBase {
 private:
-	// choice of colors
-    int colorIndex = 0, maxTrackers = 20, clusterSustain = 18;
-	double clusterInit = 0.9, clusterAlpha = 0.1;
-    const cv::viz::Color colors[NUM_COLORS] = {cv::viz::Color::amethyst(), cv::viz::Color::navy(),
-                                  cv::viz::Color::orange(), cv::viz::Color::red(),
-                                  cv::viz::Color::yellow(), cv::viz::Color::pink(),
-                                  cv::viz::Color::lime(), cv::viz::Color::cyan()};
-
-    std::vector<Cluster> clusters = std::vector<Cluster>();
+	// the most trackers the max_trackers option can ask for, the tracker is sized for this many up front
+	static constexpr int maxTrackersLimit = 100;
 
-    int64_t nextTime = 0;
-    int64_t nextFrame = 0;
-    int64_t nextSustain = 0;
-	int64_t prevTime = 0;
+	// the tracking itself lives in the tracker library so it can also be run without the DV runtime
+	TrackingPipeline pipeline;
+	bool frameOutput = true;
+	// how often the cluster states are sent, in microseconds, 0 turns them off
+	int64_t stateInterval = 0;
+	int64_t nextState = -1;
+	// how often the tracker's stats are logged, in microseconds of event time, 0 turns them off
+	int64_t statsInterval = 0;
+	int64_t nextStats = -1;
 
-    // retrieve the event resolution
-	cv::Size resolution;
+	void sendCrossings();
 
-	int imageWidth, imageHeight;
-  	int netCrossing = 0, totalCrossing = 0;
+	void sendClusterStates(int64_t timeStamp);
 
-    // Initializes a screen - its grayscale but uses 3 channels so that clusters can be drawn on the screen in RGB
-    cv::Mat tsImg;
-	// Initializes the blurred time surface, used to control the creation of new clusters
-    cv::Mat tsBlurred;
+	void logStats();
 
 public:
 	static void initInputs(dv::InputDefinitionList &in) {
@@ -44,6 +33,12 @@ public:
 
 	static void initOutputs(dv::OutputDefinitionList &out) {
 		out.addFrameOutput("trackers");
+		// Compact outputs for recording and counting, both use the standard bounding box type
+		// crossings: one box per crossing at the cluster's position, confidence is the direction
+		// (1 into the entrance, -1 out of it), label is "<cluster id> <in|out> <vel x> <vel y>" in pixels per ms
+		// clusters: every cluster's box at a fixed interval, label is the cluster id
+		out.addOutput("crossings", dv::BoundingBoxPacket::TableType::identifier);
+		out.addOutput("clusters", dv::BoundingBoxPacket::TableType::identifier);
 	}
 
 	static const char *initDescription() {
@@ -51,10 +46,26 @@ public:
 	}
 
 	static void initConfigOptions(dv::RuntimeConfig &config) {
-		config.add("max_trackers", dv::ConfigOption::intOption("Max number of trackers", 20, 1, 100));
+		config.add("max_trackers", dv::ConfigOption::intOption("Max number of trackers", 20, 1, maxTrackersLimit));
 		config.add("cluster_init_thresh", dv::ConfigOption::doubleOption("Threshold to intiailize a cluster", 0.9, 0.0, 1.0));
-		config.add("cluster_sustain_thresh", dv::ConfigOption::intOption("Number of events to keep a cluster active (in thousands)", 35, 1, 50));
+		config.add("cluster_sustain_thresh", dv::ConfigOption::intOption("Number of events to keep a cluster active", constants::clusterSustainThresh, 1, 50));
 		config.add("cluster_alpha", dv::ConfigOption::doubleOption("Amount each event affects the movement of a cluster", 0.1, 0.0, 1.0));
+		config.add("blur_scale", dv::ConfigOption::intOption("Size in pixels of the regions new clusters are looked for in", constants::blurScale, 1, 100));
+		config.add("blur_levels", dv::ConfigOption::intOption("Levels of coarser regions used to speed up looking for new clusters", constants::blurLevels, 1, 8));
+		config.add("blur_decay", dv::ConfigOption::doubleOption("Decay of the blurred time surface with every event", constants::scaleFactor, 0.9, 1.0));
+		config.add("blur_increase", dv::ConfigOption::doubleOption("Amount each event adds to its region of the blurred time surface", constants::blurIncreaseFactor, 0.0, 1.0));
+		config.add("update_period", dv::ConfigOption::intOption("Microseconds between cluster updates", constants::delayTime, 100, 100000));
+		config.add("sustain_period", dv::ConfigOption::intOption("Microseconds between checks for clusters to remove", constants::clusterSustainTime, 100, 1000000));
+		config.add("radius_growth", dv::ConfigOption::doubleOption("Growth of a cluster when an event lands just outside it", constants::radiusGrowth, 1.0, 1.1));
+		config.add("radius_shrink", dv::ConfigOption::doubleOption("Shrinkage of a cluster at every update", constants::radiusShrink, 0.9, 1.0));
+		config.add("entrance_left", dv::ConfigOption::doubleOption("Left edge of the entrance box, as a fraction of the width", constants::entranceLeft, 0.0, 1.0));
+		config.add("entrance_right", dv::ConfigOption::doubleOption("Right edge of the entrance box, as a fraction of the width", constants::entranceRight, 0.0, 1.0));
+		config.add("entrance_top", dv::ConfigOption::doubleOption("Top edge of the entrance box, as a fraction of the height", constants::entranceTop, 0.0, 1.0));
+		config.add("entrance_bottom", dv::ConfigOption::doubleOption("Bottom edge of the entrance box, as a fraction of the height", constants::entranceBottom, 0.0, 1.0));
+		config.add("entrance_margin", dv::ConfigOption::doubleOption("Pixels a cluster has to be past an entrance edge to change side", constants::entranceMargin, 0.0, 50.0));
+		config.add("frame_output", dv::ConfigOption::boolOption("Draw the trackers frame, turn off when only the counts are needed", true));
+		config.add("state_interval", dv::ConfigOption::intOption("Milliseconds between cluster state records, 0 for none", 100, 0, 10000));
+		config.add("stats_interval", dv::ConfigOption::intOption("Seconds between logging the tracker's stage timings as JSON, 0 for none", 0, 0, 3600));
 		/* Model for allowing configuration
 		config.add("red", dv::ConfigOption::intOption("Value of the red color component", 255, 0, 255));
 		config.add("green", dv::ConfigOption::intOption("Value of the green color component", 255, 0, 255));
@@ -63,22 +74,36 @@ public:
 		config.setPriorityOptions({"max_trackers"});
 	}
 
-	BeeTrackingModule() {
+	BeeTrackingModule() : pipeline(inputs.getEventInput("events").size(), maxTrackersLimit) {
 		outputs.getFrameOutput("trackers").setup(inputs.getEventInput("events"));
-		resolution = inputs.getEventInput("events").size();
-
-        imageWidth = resolution.width;
-		imageHeight = resolution.height;
-
-		tsImg = cv::Mat(imageHeight, imageWidth, CV_8UC3, cv::Scalar(1));
-		tsBlurred = cv::Mat(imageHeight / constants::blurScale, imageWidth / constants::blurScale, CV_64FC1, cv::Scalar(0));
 	}
 
 	void configUpdate() override {
-		maxTrackers = config.getInt("max_trackers");
-		clusterInit = config.getDouble("cluster_init_thresh");
-		clusterAlpha = config.getDouble("cluster_alpha");
-		clusterSustain = config.getDouble("cluster_sustain_thresh") * 1000;
+		// swapped in at the start of the next packet, the clusters and counts are kept
+		TrackerConfig trackerConfig;
+		trackerConfig.maxClusters = config.getInt("max_trackers");
+		trackerConfig.clusterInitThresh = config.getDouble("cluster_init_thresh");
+		trackerConfig.alpha = config.getDouble("cluster_alpha");
+		trackerConfig.clusterSustainThresh = config.getInt("cluster_sustain_thresh");
+		trackerConfig.blurScale = config.getInt("blur_scale");
+		trackerConfig.blurLevels = config.getInt("blur_levels");
+		trackerConfig.scaleFactor = config.getDouble("blur_decay");
+		trackerConfig.blurIncreaseFactor = config.getDouble("blur_increase");
+		trackerConfig.delayTime = config.getInt("update_period");
+		trackerConfig.clusterSustainTime = config.getInt("sustain_period");
+		trackerConfig.radiusGrowth = config.getDouble("radius_growth");
+		trackerConfig.radiusShrink = config.getDouble("radius_shrink");
+		trackerConfig.entranceLeft = config.getDouble("entrance_left");
+		trackerConfig.entranceRight = config.getDouble("entrance_right");
+		trackerConfig.entranceTop = config.getDouble("entrance_top");
+		trackerConfig.entranceBottom = config.getDouble("entrance_bottom");
+		trackerConfig.entranceMargin = config.getDouble("entrance_margin");
+		pipeline.getTracker().requestConfig(trackerConfig);
+
+		frameOutput = config.getBool("frame_output");
+		pipeline.setFramesEnabled(frameOutput);
+		stateInterval = (int64_t)config.getInt("state_interval") * 1000;
+		statsInterval = (int64_t)config.getInt("stats_interval") * 1000000;
 	}
 
 	void run() override;
@@ -0,0 +1,249 @@
+#include <tracker/stream_server.hpp>
+#include <tracker/tracker_config.hpp>
+#include <tracker/event_source.hpp>
+#include "camera_source.hpp"
+#include "constants.hpp"
+
+#include <dv-processing/core/core.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Tracks several hives in one process: every stream in the streams file gets its own tracker, fed
+// by a camera, a recording or a synthetic scene, and the trackers share one pool of threads (see
+// StreamServer). Every few seconds it prints the throughput, lag, drops and CPU use of each stream,
+// and once every source has finished the totals and crossings.
+//
+// Each line of the streams file is "<name> <source> [options]", where the source is "camera" (the
+// first camera found), "camera:<name>" for a given camera, an .aedat4 file or "synthetic:<settings>".
+// Recordings and synthetic scenes are played back in real time like a camera. The options are
+// --speed=<N|max>, --buffer=<packets> and --reader=dv|mapped as for --replay, --cpu=<share> for the
+// share of one core the stream may use, and --settings=<file> for a settings file read like
+// tracker_settings.cfg (which is used otherwise). Paths are relative to the streams file, # starts a
+// comment.
+
+struct StreamLine
+{
+	StreamConfig config;
+	EventSourceOptions source;
+	std::string camera;
+	bool isCamera = false;
+	std::string settings;
+};
+
+static bool readStreams(const std::string &path, std::vector<StreamLine> &streams)
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		std::cerr << "Could not open " << path << std::endl;
+		return false;
+	}
+	std::filesystem::path baseDir = std::filesystem::path(path).parent_path();
+	std::string line;
+	int number = 0;
+	while (std::getline(file, line))
+	{
+		number++;
+		line = line.substr(0, line.find('#'));
+		std::istringstream fields(line);
+		StreamLine stream;
+		std::string source, option;
+		if (!(fields >> stream.config.name >> source))
+		{
+			continue;
+		}
+
+		const std::string camera = "camera";
+		if (source == camera || source.rfind(camera + ":", 0) == 0)
+		{
+			stream.isCamera = true;
+			stream.camera = source.size() > camera.size() ? source.substr(camera.size() + 1) : "";
+		}
+		else if (source.rfind("synthetic:", 0) == 0)
+		{
+			stream.source.replay = source;
+		}
+		else
+		{
+			stream.source.replay = (baseDir / source).string();
+		}
+
+		while (fields >> option)
+		{
+			bool ok = true;
+			if (option.rfind("--cpu=", 0) == 0)
+			{
+				std::istringstream value(option.substr(option.find('=') + 1));
+				ok = static_cast<bool>(value >> stream.config.cpuBudget) && value.eof() && stream.config.cpuBudget >= 0;
+			}
+			else if (option.rfind("--settings=", 0) == 0)
+			{
+				stream.settings = (baseDir / option.substr(option.find('=') + 1)).string();
+			}
+			else if (!parseEventSourceArgument(option, stream.source, ok))
+			{
+				ok = false;
+			}
+			if (!ok)
+			{
+				std::cerr << path << ":" << number << ": could not read " << option << std::endl;
+				return false;
+			}
+		}
+		// a camera only ever goes at the speed of the hive
+		stream.config.speed = stream.isCamera ? 1 : stream.source.speed;
+		streams.push_back(stream);
+	}
+	return true;
+}
+
+static void printStats(const std::vector<StreamStats> &all)
+{
+	printf("%-16s %10s %8s %10s %10s %8s %7s %6s %8s %8s\n", "Stream", "Events", "Mev/s", "Lag ms", "Max ms", "Drop %",
+		"CPU %", "Held", "Crossed", "Net");
+	for (const StreamStats &stats : all)
+	{
+		uint64_t offered = stats.events + stats.droppedEvents;
+		printf("%-16s %10llu %8.2f %10.1f %10.1f %8.2f %7.1f %6llu %8d %8d%s\n", stats.name.c_str(),
+			(unsigned long long)stats.events, stats.eventRate() / 1e6, stats.lag / 1000.0, stats.maxLag / 1000.0,
+			offered > 0 ? 100.0 * stats.droppedEvents / offered : 0.0, 100.0 * stats.cpuShare(),
+			(unsigned long long)stats.throttled, stats.totalCrossing, stats.netCrossing, stats.finished ? " done" : "");
+	}
+	fflush(stdout);
+}
+
+int main(int argc, char* argv[])
+{
+	int threads = 0;
+	uint64_t quantum = 65536;
+	double report = 5;
+	std::vector<std::string> positional;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		std::string value = arg.substr(arg.find('=') + 1);
+		try
+		{
+			if (arg.rfind("--threads=", 0) == 0)
+			{
+				threads = std::stoi(value);
+			}
+			else if (arg.rfind("--quantum=", 0) == 0)
+			{
+				quantum = std::stoull(value);
+			}
+			else if (arg.rfind("--report=", 0) == 0)
+			{
+				report = std::stod(value);
+			}
+			else
+			{
+				positional.push_back(arg);
+			}
+		}
+		catch (const std::exception &)
+		{
+			std::cerr << "Could not read " << arg << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+	if (positional.size() != 1)
+	{
+		std::cerr << "Usage: ./tracking_server.exe <streams-file> [--threads=N] [--quantum=<events per turn>]"
+			" [--report=<seconds>]" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::vector<StreamLine> lines;
+	if (!readStreams(positional[0], lines))
+	{
+		return EXIT_FAILURE;
+	}
+	if (lines.empty())
+	{
+		std::cerr << "No streams in " << positional[0] << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	TrackerConfig defaultConfig;
+	if (std::filesystem::exists(constants::trackerSettings) && !readTrackerConfig(constants::trackerSettings, defaultConfig))
+	{
+		return EXIT_FAILURE;
+	}
+
+	StreamServer server(threads, quantum);
+	for (StreamLine &line : lines)
+	{
+		TrackerConfig trackerConfig = defaultConfig;
+		if (!line.settings.empty() && !readTrackerConfig(line.settings, trackerConfig))
+		{
+			return EXIT_FAILURE;
+		}
+
+		std::unique_ptr<EventSource> source;
+		if (line.isCamera)
+		{
+			source = std::make_unique<CameraSource>(line.camera, dv::io::CameraCapture::CameraType::Any);
+		}
+		else
+		{
+			// the server polls every source in turn, none may wait for its packets
+			line.source.wait = 0;
+			auto camera = std::make_unique<VirtualCamera>(line.source);
+			if (!camera->isOpen())
+			{
+				std::cerr << line.config.name << ": could not replay " << line.source.replay << ": " << camera->getError() << std::endl;
+				return EXIT_FAILURE;
+			}
+			source = std::move(camera);
+		}
+		if (!source->getEventResolution().has_value())
+		{
+			std::cerr << line.config.name << ": the source has no event resolution" << std::endl;
+			return EXIT_FAILURE;
+		}
+		server.addStream(line.config, std::move(source), trackerConfig);
+	}
+
+	std::cout << "Tracking " << server.size() << " streams on " << server.getThreads() << " threads" << std::endl;
+	auto started = std::chrono::steady_clock::now();
+	server.start();
+	auto nextReport = started + std::chrono::duration<double>(report);
+	while (server.isRunning())
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		if (report > 0 && std::chrono::steady_clock::now() >= nextReport)
+		{
+			std::cout << std::endl;
+			printStats(server.getStats());
+			nextReport += std::chrono::duration<double>(report);
+		}
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+	std::vector<StreamStats> all = server.getStats();
+	std::cout << std::endl << "Finished after " << seconds << " s, " << server.getSteals() << " turns stolen between threads"
+		<< std::endl;
+	printStats(all);
+
+	// a stream kept up if nothing was dropped and it was never more than 100 ms behind its sensor
+	int keptUp = 0;
+	uint64_t events = 0;
+	for (const StreamStats &stats : all)
+	{
+		keptUp += stats.droppedPackets == 0 && stats.maxLag < 100000 ? 1 : 0;
+		events += stats.events;
+	}
+	printf("%d of %zu streams kept up, %.2f Mev/s in total\n", keptUp, all.size(), seconds > 0 ? events / seconds / 1e6 : 0.0);
+	return 0;
+}
@@ -0,0 +1,85 @@
+// Writes a copy of a recording at a higher resolution, used to measure tracker throughput on larger sensors
+// Every event is repeated over the block of output pixels that its input pixel maps onto,
+// which approximates the event density a higher resolution sensor produces for the same scene
+
+#include <tracker/read_ahead.hpp>
+
+#define LIBCAER_FRAMECPP_OPENCV_INSTALLED 0
+
+#include <dv-processing/core/core.hpp>
+#include <dv-processing/io/mono_camera_recording.hpp>
+#include <dv-processing/io/mono_camera_writer.hpp>
+
+#include <iostream>
+#include <cstdlib>
+#include <string>
+
+int main(int argc, char* argv[])
+{
+	if (argc < 5)
+	{
+		std::cout << "Usage: ./upsample_recording.exe <input.aedat4> <output.aedat4> <width> <height>" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::string inputPath = argv[1];
+	std::string outputPath = argv[2];
+	cv::Size outputSize(std::atoi(argv[3]), std::atoi(argv[4]));
+
+	dv::io::MonoCameraRecording reader(inputPath);
+
+	std::optional<cv::Size> resolutionWrapper = reader.getEventResolution();
+	if (!resolutionWrapper.has_value())
+	{
+		std::cerr << "Could not retrieve event resolution from recording" << std::endl;
+		return EXIT_FAILURE;
+	}
+	cv::Size inputSize = resolutionWrapper.value();
+
+	auto config = dv::io::MonoCameraWriter::EventOnlyConfig(reader.getCameraName(), outputSize);
+	dv::io::MonoCameraWriter writer(outputPath, config);
+
+	double scaleX = (double)outputSize.width / inputSize.width;
+	double scaleY = (double)outputSize.height / inputSize.height;
+
+	std::cout << "Upsampling " << inputSize.width << "x" << inputSize.height << " to "
+		<< outputSize.width << "x" << outputSize.height << std::endl;
+
+	int64_t eventsIn = 0, eventsOut = 0;
+
+	// the input is read and decoded on a second thread while this one upsamples and compresses the output
+	ReadAhead readAhead(reader);
+	dv::EventStore events;
+	while (readAhead.next(events))
+	{
+		dv::EventStore upsampled;
+		for (const dv::Event &event : events)
+		{
+			// the block of output pixels covered by this input pixel
+			int startX = (int)(event.x() * scaleX);
+			int endX = std::max((int)((event.x() + 1) * scaleX), startX + 1);
+			int startY = (int)(event.y() * scaleY);
+			int endY = std::max((int)((event.y() + 1) * scaleY), startY + 1);
+
+			for (int x = startX; x < endX && x < outputSize.width; x++)
+			{
+				for (int y = startY; y < endY && y < outputSize.height; y++)
+				{
+					upsampled.emplace_back(event.timestamp(), x, y, event.polarity());
+				}
+			}
+		}
+
+		eventsIn += events.size();
+		eventsOut += upsampled.size();
+		writer.writeEvents(upsampled);
+	}
+
+	if (!readAhead.getError().empty())
+	{
+		std::cerr << "Stopped reading recording: " << readAhead.getError() << std::endl;
+	}
+	std::cout << readAhead.getStats().summary() << std::endl;
+	std::cout << "Wrote " << eventsOut << " events from " << eventsIn << " input events to " << outputPath << std::endl;
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,56 @@
+# Checks of the beetracker module, run with ctest in python/build or
+#     PYTHONPATH=python/build python3 -m unittest -v python/test_tracker_bindings.py
+import unittest
+
+import numpy as np
+
+import beetracker
+
+
+def events(coordinates, polarity=0):
+    array = np.zeros(len(coordinates), beetracker.event_dtype)
+    array["timestamp"] = np.arange(len(coordinates)) * 10
+    array["x"] = [x for x, _ in coordinates]
+    array["y"] = [y for _, y in coordinates]
+    array["polarity"] = polarity
+    return array
+
+
+class EventCheckTest(unittest.TestCase):
+    def assertRefused(self, array, message):
+        tracker = beetracker.Tracker(640, 480)
+        with self.assertRaisesRegex(ValueError, message):
+            tracker.process(array)
+        # nothing was tracked before the bad event was found
+        self.assertEqual(tracker.event_count, 0)
+
+    def test_negative_coordinates(self):
+        self.assertRefused(events([(10, 10), (-1, 10)]), r"event 1 at \(-1, 10\) is outside the 640x480 sensor")
+        self.assertRefused(events([(10, -5)]), "outside the 640x480 sensor")
+
+    def test_coordinates_past_the_sensor(self):
+        self.assertRefused(events([(640, 0)]), "outside")
+        self.assertRefused(events([(0, 480)]), "outside")
+        self.assertRefused(events([(1279, 719)]), "outside")
+
+    def test_wider_fields_are_checked_before_narrowing(self):
+        wide = np.zeros(1, [("timestamp", "<i8"), ("x", "<i4"), ("y", "<i4"), ("polarity", "u1")])
+        wide["x"] = 65536 + 5
+        self.assertRefused(wide, r"\(65541, 0\)")
+
+    def test_polarity(self):
+        array = events([(10, 10), (20, 20)])
+        array["polarity"][1] = 2
+        self.assertRefused(array, "event 1 has polarity 2, not 0 or 1")
+
+    def test_good_events_are_tracked(self):
+        tracker = beetracker.Tracker(640, 480)
+        tracker.process(events([(0, 0), (639, 479)], polarity=1))
+        self.assertEqual(tracker.event_count, 2)
+        synthetic = beetracker.synthetic_events("bees=6,seconds=5,seed=1")
+        tracker.process(synthetic)
+        self.assertEqual(tracker.event_count, 2 + len(synthetic))
+
+
+if __name__ == "__main__":
+    unittest.main()
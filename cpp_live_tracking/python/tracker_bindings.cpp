@@ -0,0 +1,401 @@
+#include <tracker/tracker.hpp>
+#include <tracker/tracker_config.hpp>
+#include <tracker/synthetic_scene.hpp>
+
+#include <boost/python.hpp>
+#include <boost/python/numpy.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace py = boost::python;
+namespace np = boost::python::numpy;
+
+// The tracker for Python, see the README
+// Events come in as a NumPy structured array with timestamp, x, y and polarity fields. An array laid out
+// like dv::Event (event_dtype, which is also what dv-processing's EventStore.numpy() gives) is tracked
+// where it is. Any other layout is read field by field into a small buffer first. The GIL is released
+// while the events are tracked, so trackers in different Python threads run at the same time.
+
+static_assert(sizeof(dv::Event) == 16, "event_dtype describes dv::Event");
+
+// one row of Tracker.clusters(), clusterDtype describes it
+struct ClusterRow {
+    int32_t id;
+    // the side of the counting boundary the cluster is on
+    int32_t side;
+    double x, y, radius;
+    // pixels per microsecond
+    double velX, velY;
+    // events since the last sustain check
+    uint32_t events;
+    // microseconds between wing beats, -1 without an estimate
+    int32_t wingbeatPeriod;
+};
+
+// events read field by field are tracked this many at a time
+static const size_t chunkSize = 1 << 16;
+
+// raises a Python exception of the given type
+[[noreturn]] static void raise(PyObject *type, const std::string &message) {
+    PyErr_SetString(type, message.c_str());
+    throw py::error_already_set();
+}
+
+// lets other Python threads run for as long as it is in scope
+class ReleaseGil {
+    private:
+        PyThreadState *state;
+
+    public:
+        ReleaseGil() : state(PyEval_SaveThread()) {}
+
+        ~ReleaseGil() { PyEval_RestoreThread(state); }
+};
+
+static np::dtype makeDtype(py::list names, py::list formats, py::list offsets, size_t itemsize) {
+    py::dict spec;
+    spec["names"] = names;
+    spec["formats"] = formats;
+    spec["offsets"] = offsets;
+    spec["itemsize"] = itemsize;
+    return np::dtype(spec);
+}
+
+template <typename... Items>
+static py::list list(Items... items) {
+    py::list values;
+    (values.append(items), ...);
+    return values;
+}
+
+// the dtype of dv::Event
+static np::dtype eventDtype() {
+    return makeDtype(list("timestamp", "x", "y", "polarity"), list("<i8", "<i2", "<i2", "u1"), list(0, 8, 10, 12), sizeof(dv::Event));
+}
+
+static np::dtype crossingDtype() {
+    return makeDtype(list("timestamp", "cluster_id", "direction", "x", "y", "vel_x", "vel_y"),
+        list("<i8", "<i4", "<i4", "<f8", "<f8", "<f8", "<f8"),
+        list(offsetof(CrossingRecord, timestamp), offsetof(CrossingRecord, clusterID), offsetof(CrossingRecord, direction),
+            offsetof(CrossingRecord, x), offsetof(CrossingRecord, y), offsetof(CrossingRecord, velX), offsetof(CrossingRecord, velY)),
+        sizeof(CrossingRecord));
+}
+
+static np::dtype clusterDtype() {
+    return makeDtype(list("id", "side", "x", "y", "radius", "vel_x", "vel_y", "events", "wingbeat_period"),
+        list("<i4", "<i4", "<f8", "<f8", "<f8", "<f8", "<f8", "<u4", "<i4"),
+        list(offsetof(ClusterRow, id), offsetof(ClusterRow, side), offsetof(ClusterRow, x), offsetof(ClusterRow, y),
+            offsetof(ClusterRow, radius), offsetof(ClusterRow, velX), offsetof(ClusterRow, velY), offsetof(ClusterRow, events),
+            offsetof(ClusterRow, wingbeatPeriod)),
+        sizeof(ClusterRow));
+}
+
+// a new array of count rows of dtype, filled from rows
+template <typename Row>
+static np::ndarray toArray(const np::dtype &dtype, const Row *rows, size_t count) {
+    np::ndarray array = np::empty(py::make_tuple(count), dtype);
+    if (count > 0) {
+        std::memcpy(array.get_data(), rows, count * sizeof(Row));
+    }
+    return array;
+}
+
+// where one field of the caller's events is and what integer it holds
+struct EventField {
+    size_t offset;
+    char kind;
+    size_t size;
+
+    int64_t read(const char *event) const {
+        const char *at = event + offset;
+        switch (size) {
+            case 1: return kind == 'i' ? (int64_t)*(const int8_t *)at : (int64_t)*(const uint8_t *)at;
+            case 2: {
+                int16_t value;
+                std::memcpy(&value, at, 2);
+                return kind == 'u' ? (int64_t)(uint16_t)value : (int64_t)value;
+            }
+            case 4: {
+                int32_t value;
+                std::memcpy(&value, at, 4);
+                return kind == 'u' ? (int64_t)(uint32_t)value : (int64_t)value;
+            }
+            default: {
+                int64_t value;
+                std::memcpy(&value, at, 8);
+                return value;
+            }
+        }
+    }
+};
+
+// The caller's events, checked with the GIL held before it is released
+struct EventArray {
+    const char *data;
+    size_t count;
+    ptrdiff_t stride;
+    EventField timestamp, x, y, polarity;
+    // laid out like dv::Event, contiguous and aligned, so it can be tracked where it is
+    bool native;
+
+    explicit EventArray(const np::ndarray &events) {
+        if (events.get_nd() != 1) {
+            raise(PyExc_ValueError, "events must be a one dimensional array");
+        }
+        py::object fields = events.get_dtype().attr("fields");
+        if (fields.is_none()) {
+            raise(PyExc_TypeError, "events must be a structured array with timestamp, x, y and polarity fields");
+        }
+        timestamp = field(fields, "timestamp");
+        x = field(fields, "x");
+        y = field(fields, "y");
+        polarity = field(fields, "polarity");
+
+        data = events.get_data();
+        count = events.shape(0);
+        stride = events.strides(0);
+        native = stride == (ptrdiff_t)sizeof(dv::Event) && reinterpret_cast<uintptr_t>(data) % alignof(dv::Event) == 0 &&
+            timestamp.offset == 0 && timestamp.size == 8 && timestamp.kind == 'i' && x.offset == 8 && x.size == 2 &&
+            x.kind == 'i' && y.offset == 10 && y.size == 2 && y.kind == 'i' && polarity.offset == 12 && polarity.size == 1;
+    }
+
+    // fields is the dtype's read only mapping of name to (type, offset)
+    static EventField field(const py::object &fields, const char *name) {
+        if (!fields.contains(name)) {
+            raise(PyExc_TypeError, std::string("events have no ") + name + " field");
+        }
+        py::object type = fields[name][0];
+        char kind = py::extract<std::string>(type.attr("kind"))()[0];
+        bool nativeOrder = py::extract<bool>(type.attr("isnative"));
+        if ((kind != 'i' && kind != 'u' && kind != 'b') || !nativeOrder) {
+            raise(PyExc_TypeError, std::string("the ") + name + " field must hold native integers or booleans");
+        }
+        return {py::extract<size_t>(fields[name][1]), kind, py::extract<size_t>(type.attr("itemsize"))};
+    }
+
+    // raises ValueError for the first event off a sensor of this size or with a polarity other than 0 or 1,
+    // the tracker indexes its surfaces with the coordinates unchecked and the native path reads the
+    // polarity byte as a bool
+    void check(cv::Size resolution) const {
+        for (size_t i = 0; i < count; i++) {
+            const char *event = data + (ptrdiff_t)i * stride;
+            int64_t eventX = x.read(event), eventY = y.read(event), eventPolarity = polarity.read(event);
+            if (eventX < 0 || eventX >= resolution.width || eventY < 0 || eventY >= resolution.height) {
+                raise(PyExc_ValueError, "event " + std::to_string(i) + " at (" + std::to_string(eventX) + ", " + std::to_string(eventY) +
+                    ") is outside the " + std::to_string(resolution.width) + "x" + std::to_string(resolution.height) + " sensor");
+            }
+            if (eventPolarity != 0 && eventPolarity != 1) {
+                raise(PyExc_ValueError, "event " + std::to_string(i) + " has polarity " + std::to_string(eventPolarity) + ", not 0 or 1");
+            }
+        }
+    }
+
+    dv::Event at(size_t index) const {
+        const char *event = data + (ptrdiff_t)index * stride;
+        return dv::Event(timestamp.read(event), (int16_t)x.read(event), (int16_t)y.read(event), polarity.read(event) != 0);
+    }
+};
+
+template <typename Policies>
+class PyTracker {
+    private:
+        BasicTracker<TrackerReal, Policies> tracker;
+        // one Python thread at a time per tracker, the GIL no longer keeps them apart
+        std::mutex mutex;
+        std::vector<CrossingRecord> crossings;
+        std::vector<dv::Event> chunk;
+        int64_t lastTime{-1};
+
+        void track(std::span<const dv::Event> events) {
+            tracker.processEvents(events);
+            crossings.insert(crossings.end(), tracker.getCrossings().begin(), tracker.getCrossings().end());
+            lastTime = events.back().timestamp();
+        }
+
+        // runs function under the mutex with the GIL released, so a thread waiting for another one's
+        // process call does not hold up every other Python thread. function must not touch Python objects
+        template <typename Function>
+        auto locked(Function &&function) {
+            ReleaseGil release;
+            std::lock_guard<std::mutex> lock(mutex);
+            return function();
+        }
+
+    public:
+        PyTracker(int width, int height, int blurScale) : tracker(cv::Size(width, height), blurScale) {}
+
+        np::ndarray process(const np::ndarray &events) {
+            EventArray array(events);
+            // the resolution never changes, so it needs no lock
+            array.check(tracker.getResolution());
+            {
+                ReleaseGil release;
+                std::lock_guard<std::mutex> lock(mutex);
+                crossings.clear();
+                if (array.count == 0) {
+                    // nothing to track
+                } else if (array.native) {
+                    // in pieces so the tracker's crossing records never run out, see getMissedCrossings
+                    std::span<const dv::Event> all(reinterpret_cast<const dv::Event *>(array.data), array.count);
+                    for (size_t start = 0; start < array.count; start += chunkSize) {
+                        track(all.subspan(start, std::min(chunkSize, array.count - start)));
+                    }
+                } else {
+                    chunk.reserve(chunkSize);
+                    for (size_t start = 0; start < array.count; start += chunkSize) {
+                        chunk.clear();
+                        for (size_t i = start; i < std::min(array.count, start + chunkSize); i++) {
+                            chunk.push_back(array.at(i));
+                        }
+                        track(chunk);
+                    }
+                }
+            }
+            return toArray(crossingDtype(), crossings.data(), crossings.size());
+        }
+
+        np::ndarray clusters() {
+            std::vector<ClusterRow> rows = locked([&] {
+                std::vector<ClusterRow> rows;
+                const auto &pool = tracker.getClusters();
+                for (size_t i = 0; i < pool.size(); i++) {
+                    BasicClusterState<TrackerReal> state = pool[i].getState();
+                    rows.push_back({state.id, state.side, numeric::toDouble(state.x), numeric::toDouble(state.y),
+                        numeric::toDouble(state.radius), numeric::toDouble(state.velX), numeric::toDouble(state.velY), state.eventCount,
+                        tracker.getWingbeatPeriod(i)});
+                }
+                return rows;
+            });
+            return toArray(clusterDtype(), rows.data(), rows.size());
+        }
+
+        void setSetting(const std::string &name, const py::object &value) {
+            std::string text = py::extract<std::string>(py::str(value));
+            bool set = locked([&] {
+                TrackerConfig config = tracker.getConfig();
+                if (!setTrackerSetting(config, name, text)) {
+                    return false;
+                }
+                tracker.setConfig(config);
+                return true;
+            });
+            if (!set) {
+                raise(PyExc_ValueError, "no tracker setting " + name + " that takes " + text);
+            }
+        }
+
+        void readSettings(const std::string &path) {
+            bool read = locked([&] {
+                TrackerConfig config = tracker.getConfig();
+                if (!readTrackerConfig(path, config)) {
+                    return false;
+                }
+                tracker.setConfig(config);
+                return true;
+            });
+            if (!read) {
+                raise(PyExc_ValueError, "could not read the settings file " + path);
+            }
+        }
+
+        void saveCheckpoint(const std::string &path) {
+            bool saved = locked([&] {
+                CheckpointPosition position;
+                position.time = lastTime;
+                return tracker.saveCheckpoint(path, position);
+            });
+            if (!saved) {
+                raise(PyExc_IOError, "could not write the checkpoint " + path);
+            }
+        }
+
+        void loadCheckpoint(const std::string &path) {
+            bool loaded = locked([&] {
+                CheckpointPosition position;
+                if (!tracker.loadCheckpoint(path, position)) {
+                    return false;
+                }
+                lastTime = position.time;
+                return true;
+            });
+            if (!loaded) {
+                raise(PyExc_ValueError, "could not load the checkpoint " + path);
+            }
+        }
+
+        int getTotalCrossing() { return locked([&] { return tracker.getTotalCrossing(); }); }
+
+        int getNetCrossing() { return locked([&] { return tracker.getNetCrossing(); }); }
+
+        int64_t getEventCount() { return locked([&] { return tracker.getEventCount(); }); }
+
+        int64_t getLastTime() { return locked([&] { return lastTime; }); }
+};
+
+template <typename Policies>
+static void bindTracker(const char *name, const char *doc) {
+    using Tracker = PyTracker<Policies>;
+    py::class_<Tracker, boost::noncopyable>(name, doc,
+        py::init<int, int, int>((py::arg("width"), py::arg("height"), py::arg("blur_scale") = constants::blurScale)))
+        .def("process", &Tracker::process, (py::arg("events")),
+            "Tracks a structured array of events, oldest first, and returns the crossings they led to. "
+            "Raises ValueError, before tracking any of them, if an event is off the sensor or its polarity is not 0 or 1. "
+            "The array must not change until this returns")
+        .def("clusters", &Tracker::clusters, "The clusters as they are now")
+        .def("set_setting", &Tracker::setSetting, (py::arg("name"), py::arg("value")),
+            "Sets one setting of tracker_settings.cfg, such as set_setting('alpha', 0.1)")
+        .def("read_settings", &Tracker::readSettings, (py::arg("path")), "Reads a settings file like tracker_settings.cfg")
+        .def("save_checkpoint", &Tracker::saveCheckpoint, (py::arg("path")))
+        .def("load_checkpoint", &Tracker::loadCheckpoint, (py::arg("path")))
+        .add_property("total_crossing", &Tracker::getTotalCrossing)
+        .add_property("net_crossing", &Tracker::getNetCrossing)
+        .add_property("event_count", &Tracker::getEventCount)
+        .add_property("last_time", &Tracker::getLastTime, "Timestamp of the last event tracked, -1 before any");
+}
+
+// a generated recording (see SyntheticScene) as one array of event_dtype
+static np::ndarray syntheticEvents(const std::string &spec) {
+    SyntheticSceneConfig config;
+    if (!parseSyntheticScene(spec, config)) {
+        raise(PyExc_ValueError, "could not read the scene " + spec);
+    }
+    std::vector<dv::Event> events;
+    {
+        ReleaseGil release;
+        SyntheticScene scene(config);
+        dv::EventStore packet;
+        while (scene.nextPacket(packet)) {
+            for (const dv::Event &event : packet) {
+                events.push_back(event);
+            }
+            packet = dv::EventStore();
+        }
+    }
+    return toArray(eventDtype(), events.data(), events.size());
+}
+
+BOOST_PYTHON_MODULE(beetracker) {
+    np::initialize();
+    py::scope().attr("__doc__") = "The cpp_live_tracking tracker for NumPy event arrays";
+
+    bindTracker<LiveTrackingPolicies>("Tracker", "Counts bees crossing the entrance box, like every cpp_live_tracking tool");
+    bindTracker<CenterLinePolicies>("CenterLineTracker",
+        "Counts crossings of the vertical center line, like the forced_oscillators and fourier_wingbeat_detection trees");
+    bindTracker<DelayWingbeatPolicies>("DelayWingbeatTracker",
+        "The delay_wingbeat tracker, on events time each cluster's wing beats (the wingbeat_period column of clusters())");
+    bindTracker<FourierWingbeatPolicies>("FourierWingbeatTracker",
+        "The fourier_wingbeat_detection tracker, a DFT of each cluster's on and off events gives its wingbeat_period");
+    bindTracker<ForcedOscillatorPolicies>("ForcedOscillatorTracker",
+        "The forced_oscillators tracker, each cluster's off events drive oscillators from 190 to 245 Hz for its wingbeat_period");
+
+    py::scope().attr("event_dtype") = eventDtype();
+    py::scope().attr("numeric") = numeric::name<TrackerReal>();
+    py::def("synthetic_events", &syntheticEvents, (py::arg("scene") = ""),
+        "The events of a generated scene such as 'bees=6,seconds=20,seed=1', see synthetic_scene.hpp");
+}
@@ -0,0 +1,119 @@
+#include "async_log.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+AsyncLog::AsyncLog(std::ostream &out, size_t capacity, size_t batchSize, std::chrono::microseconds idle)
+    : out(out), capacity(std::max(roundUp(capacity), 4 * alignment)), batchSize(batchSize), idle(idle),
+      ring(new std::byte[this->capacity]) {
+    thread = std::thread(&AsyncLog::run, this);
+}
+
+AsyncLog::~AsyncLog() {
+    close();
+}
+
+bool AsyncLog::push(Format format, const void *message, uint32_t size) {
+    const size_t needed = sizeof(Header) + roundUp(size);
+    uint64_t position = head.load(std::memory_order_relaxed);
+    size_t offset = position % capacity;
+    // a message is never split over the end of the ring, the rest of it is skipped instead
+    size_t padding = capacity - offset < needed ? capacity - offset : 0;
+    if (!running.load(std::memory_order_relaxed) ||
+        position + padding + needed - tail.load(std::memory_order_acquire) > capacity) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    if (padding > 0) {
+        Header pad{nullptr, 0};
+        std::memcpy(ring.get() + offset, &pad, sizeof(Header));
+        position += padding;
+        offset = 0;
+    }
+    Header header{format, size};
+    std::memcpy(ring.get() + offset, &header, sizeof(Header));
+    std::memcpy(ring.get() + offset + sizeof(Header), message, size);
+    head.store(position + needed, std::memory_order_release);
+    return true;
+}
+
+bool AsyncLog::drain(std::string &batch) {
+    uint64_t position = tail.load(std::memory_order_relaxed);
+    const uint64_t end = head.load(std::memory_order_acquire);
+    if (position == end) {
+        return false;
+    }
+
+    while (position != end) {
+        size_t offset = position % capacity;
+        Header header;
+        std::memcpy(&header, ring.get() + offset, sizeof(Header));
+        if (header.format == nullptr) {
+            position += capacity - offset;
+            continue;
+        }
+        header.format(ring.get() + offset + sizeof(Header), batch);
+        position += sizeof(Header) + roundUp(header.size);
+
+        // the message's bytes are free again once it is text
+        if (batch.size() >= batchSize) {
+            tail.store(position, std::memory_order_release);
+            writeBatch(batch);
+        }
+    }
+    tail.store(position, std::memory_order_release);
+    return true;
+}
+
+void AsyncLog::writeBatch(std::string &batch) {
+    uint64_t lost = dropped.load(std::memory_order_relaxed);
+    if (lost != reportedDrops) {
+        char text[64];
+        snprintf(text, sizeof(text), "\n%llu log messages dropped\n", (unsigned long long)(lost - reportedDrops));
+        batch += text;
+        reportedDrops = lost;
+    }
+    if (batch.empty()) {
+        return;
+    }
+    out.write(batch.data(), batch.size());
+    out.flush();
+    batch.clear();
+}
+
+void AsyncLog::run() {
+    std::string batch;
+    batch.reserve(batchSize + 1024);
+    while (true) {
+        // everything written before close() is in the ring by the time it clears running
+        bool stopping = !running.load(std::memory_order_acquire);
+        bool found = drain(batch);
+        writeBatch(batch);
+        if (stopping) {
+            return;
+        }
+        if (!found) {
+            std::this_thread::sleep_for(idle);
+        }
+    }
+}
+
+void AsyncLog::close() {
+    if (!thread.joinable()) {
+        return;
+    }
+    running.store(false, std::memory_order_release);
+    thread.join();
+}
+
+void CrossingCountMessage::format(const CrossingCountMessage &message, std::string &text) {
+    char line[96];
+    if (message.lastID >= 0) {
+        snprintf(line, sizeof(line), "Total Crossed: %d\t Net Crossed: %d Last crossed: %d\r", message.total, message.net,
+            message.lastID);
+    } else {
+        snprintf(line, sizeof(line), "Total Crossed: %d\t Net Crossed: %d\r", message.total, message.net);
+    }
+    text += line;
+}
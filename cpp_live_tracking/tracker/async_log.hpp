@@ -0,0 +1,103 @@
+#ifndef ASYNC_LOG_H
+#define ASYNC_LOG_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+// A log whose messages are turned into text and written by a thread of its own, so the event thread
+// never formats, waits on the stream or allocates to log something
+// A message is a small struct with a static format(const Message &, std::string &text) that appends its
+// text. write() copies the struct as it is into a ring of bytes allocated up front, and the log's thread
+// formats whatever it finds there into one batch, writes the batch to the stream and flushes it. The ring
+// has one writer and one reader and no lock. A message that does not fit is dropped and counted instead
+// of waiting for room, the log's thread writes how many were lost.
+class AsyncLog {
+    private:
+        using Format = void (*)(const std::byte *message, std::string &text);
+
+        // in front of every message in the ring, a header without a format pads the ring to its end
+        struct Header {
+            Format format;
+            uint32_t size;
+        };
+
+        // every message starts on a multiple of this, so a header always fits before the end of the ring
+        static constexpr size_t alignment = sizeof(Header);
+
+        static constexpr size_t roundUp(size_t size) { return (size + alignment - 1) / alignment * alignment; }
+
+        std::ostream &out;
+        const size_t capacity;
+        const size_t batchSize;
+        const std::chrono::microseconds idle;
+        std::unique_ptr<std::byte[]> ring;
+
+        // bytes written and read since the start, only write() stores head and only the log's thread tail
+        alignas(64) std::atomic<uint64_t> head{0};
+        alignas(64) std::atomic<uint64_t> tail{0};
+        alignas(64) std::atomic<uint64_t> dropped{0};
+        std::atomic<bool> running{true};
+        uint64_t reportedDrops{0};
+        std::thread thread;
+
+        template <typename Message>
+        static void formatMessage(const std::byte *bytes, std::string &text) {
+            // the bytes are only aligned for the header, copied out for the message's own alignment
+            Message message;
+            std::memcpy(&message, bytes, sizeof(Message));
+            Message::format(message, text);
+        }
+
+        bool push(Format format, const void *message, uint32_t size);
+
+        // formats the messages in the ring into batch, writing it out whenever it is full
+        bool drain(std::string &batch);
+
+        void writeBatch(std::string &batch);
+
+        void run();
+
+    public:
+        // capacity is the size of the ring in bytes, a batch is written once it has batchSize bytes of text
+        // or the ring is empty, and an empty ring is looked at again after idle
+        explicit AsyncLog(std::ostream &out, size_t capacity = 1 << 20, size_t batchSize = 64 << 10,
+            std::chrono::microseconds idle = std::chrono::microseconds(1000));
+
+        ~AsyncLog();
+
+        AsyncLog(const AsyncLog &) = delete;
+
+        AsyncLog &operator=(const AsyncLog &) = delete;
+
+        // one thread only, the same one every time. Returns false when the message was dropped
+        template <typename Message>
+        bool write(const Message &message) {
+            static_assert(std::is_trivially_copyable_v<Message>, "log messages are copied into the ring as bytes");
+            return push(&formatMessage<Message>, &message, sizeof(Message));
+        }
+
+        // writes every message still in the ring and stops the log's thread, the stream is free to use
+        // from here on and write() drops everything
+        void close();
+
+        uint64_t getDropped() const { return dropped.load(std::memory_order_relaxed); }
+};
+
+// The running count the live tools print over itself on the console
+struct CrossingCountMessage {
+    int total, net;
+    // the cluster that crossed most recently, left out when negative
+    int lastID{-1};
+
+    static void format(const CrossingCountMessage &message, std::string &text);
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef BINARY_IO_H
+#define BINARY_IO_H
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Fixed size values written to and read from the binary files the tracker library keeps (recording
+// indexes and checkpoints) as they are in memory, so the files are only read back on the same platform
+// Reads return false at the end of the file or on a short read
+
+template <typename T>
+void writeValue(std::ostream &out, T value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+bool readValue(std::istream &in, T &value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    return (bool)in.read(reinterpret_cast<char *>(&value), sizeof(T));
+}
+
+inline void writeString(std::ostream &out, const std::string &text) {
+    writeValue<uint32_t>(out, text.size());
+    out.write(text.data(), text.size());
+}
+
+inline bool readString(std::istream &in, std::string &text) {
+    uint32_t size;
+    if (!readValue(in, size) || size > (1 << 16)) {
+        return false;
+    }
+    text.resize(size);
+    return (bool)in.read(text.data(), size);
+}
+
+// a vector as its length and its elements
+template <typename T>
+void writeVector(std::ostream &out, const std::vector<T> &values) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    writeValue<uint64_t>(out, values.size());
+    out.write(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(T));
+}
+
+// reads a vector written by writeVector that has to hold exactly size elements
+template <typename T>
+bool readVector(std::istream &in, std::vector<T> &values, size_t size) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    uint64_t stored;
+    if (!readValue(in, stored) || stored != size) {
+        return false;
+    }
+    values.resize(size);
+    return (bool)in.read(reinterpret_cast<char *>(values.data()), size * sizeof(T));
+}
+
+#endif
@@ -0,0 +1,251 @@
+#include "blur_pyramid.hpp"
+#include "binary_io.hpp"
+#include <cmath>
+
+// values below this are treated as fully decayed
+static const double decayFloor = 1e-15;
+
+// parents are sums of their children, but rounding can leave them a hair under the child
+// a few steps of the number type, anything larger only makes the birth scan look at more cells
+template <typename Real>
+static Real sumTolerance() {
+    if constexpr (std::is_same_v<Real, double>) {
+        return 1e-9;
+    } else if constexpr (std::is_same_v<Real, float>) {
+        return 1e-4f;
+    } else {
+        return Fixed16::fromRaw(16);
+    }
+}
+
+template <typename Real>
+BasicBlurPyramid<Real>::BasicBlurPyramid(cv::Size resolution, int blurScale, int numLevels, double decayFactor, double increaseFactor) {
+    this->resolution = resolution;
+    this->blurScale = blurScale;
+    this->decayFactor = decayFactor;
+    this->increaseFactor = increaseFactor;
+    this->decayStep = decayFactor;
+    this->increaseStep = increaseFactor;
+
+    // round up so the edge cells cover the leftover pixels
+    int cols = (resolution.width + blurScale - 1) / blurScale;
+    int rows = (resolution.height + blurScale - 1) / blurScale;
+
+    for (int i = 0; i < std::max(numLevels, 1); i++) {
+        Level level;
+        level.cols = cols;
+        level.rows = rows;
+        level.values.assign(cols * rows, Real(0));
+        level.stamps.assign(cols * rows, 0);
+        levels.push_back(level);
+
+        if (cols == 1 && rows == 1) {
+            break;
+        }
+        cols = (cols + 1) / 2;
+        rows = (rows + 1) / 2;
+    }
+
+    buildDecayTable();
+    candidates.reserve(levels.front().cols * levels.front().rows);
+}
+
+template <typename Real>
+void BasicBlurPyramid<Real>::buildDecayTable() {
+    // decayTable[k] is the factor applied by k events, built by repeated multiplication
+    // to match decaying the whole surface once per event
+    decayTable.clear();
+    double factor = 1.0;
+    while (factor > decayFloor && decayTable.size() < (1 << 20)) {
+        decayTable.push_back((Real)factor);
+        factor *= decayFactor;
+    }
+}
+
+template <typename Real>
+void BasicBlurPyramid<Real>::settle() {
+    for (Level &level : levels) {
+        for (size_t i = 0; i < level.values.size(); i++) {
+            // a cell written by increment() is already ahead of eventIndex and owes nothing
+            if (level.stamps[i] < eventIndex) {
+                level.values[i] = decayed(level, i);
+                level.stamps[i] = eventIndex;
+            }
+        }
+    }
+}
+
+template <typename Real>
+void BasicBlurPyramid<Real>::sumParents() {
+    for (size_t i = 1; i < levels.size(); i++) {
+        const Level &below = levels[i - 1];
+        Level &level = levels[i];
+        std::fill(level.values.begin(), level.values.end(), Real(0));
+        for (int row = 0; row < below.rows; row++) {
+            for (int col = 0; col < below.cols; col++) {
+                level.values[(row / 2) * level.cols + col / 2] += below.values[row * below.cols + col];
+            }
+        }
+        std::fill(level.stamps.begin(), level.stamps.end(), eventIndex);
+    }
+}
+
+template <typename Real>
+void BasicBlurPyramid<Real>::setFactors(double decayFactor, double increaseFactor) {
+    // the decay owed so far was at the old rate
+    settle();
+    this->increaseFactor = increaseFactor;
+    this->increaseStep = increaseFactor;
+    if (decayFactor != this->decayFactor) {
+        this->decayFactor = decayFactor;
+        this->decayStep = decayFactor;
+        buildDecayTable();
+    }
+}
+
+template <typename Real>
+BasicBlurPyramid<Real> BasicBlurPyramid<Real>::rescaled(int blurScale, int numLevels) const {
+    BasicBlurPyramid result(resolution, blurScale, numLevels, decayFactor, increaseFactor);
+    result.eventIndex = eventIndex;
+
+    // pixel range covered by a cell along one axis
+    auto span = [](int cell, int scale, int size) {
+        return std::make_pair(cell * scale, std::min((cell + 1) * scale, size));
+    };
+
+    const Level &oldFine = levels.front();
+    Level &newFine = result.levels.front();
+    for (int row = 0; row < oldFine.rows; row++) {
+        auto oldRows = span(row, this->blurScale, resolution.height);
+        for (int col = 0; col < oldFine.cols; col++) {
+            double value = numeric::toDouble(at(col, row));
+            if (value == 0.0) {
+                continue;
+            }
+            auto oldCols = span(col, this->blurScale, resolution.width);
+            double oldArea = (double)(oldRows.second - oldRows.first) * (oldCols.second - oldCols.first);
+
+            for (int newRow = oldRows.first / blurScale; newRow * blurScale < oldRows.second; newRow++) {
+                auto newRows = span(newRow, blurScale, resolution.height);
+                int height = std::min(oldRows.second, newRows.second) - std::max(oldRows.first, newRows.first);
+                for (int newCol = oldCols.first / blurScale; newCol * blurScale < oldCols.second; newCol++) {
+                    auto newCols = span(newCol, blurScale, resolution.width);
+                    int width = std::min(oldCols.second, newCols.second) - std::max(oldCols.first, newCols.first);
+                    newFine.values[newRow * newFine.cols + newCol] += (Real)(value * height * width / oldArea);
+                }
+            }
+        }
+    }
+
+    // the surface never holds more than 1 in a cell
+    for (Real &value : newFine.values) {
+        value = std::min(value, Real(1));
+    }
+    std::fill(newFine.stamps.begin(), newFine.stamps.end(), eventIndex);
+    result.sumParents();
+    return result;
+}
+
+template <typename Real>
+Real BasicBlurPyramid<Real>::decayed(const Level &level, size_t index) const {
+    int64_t elapsed = eventIndex - level.stamps[index];
+    if (elapsed <= 0) {
+        return level.values[index];
+    }
+    if ((size_t)elapsed < decayTable.size()) {
+        return level.values[index] * decayTable[elapsed];
+    }
+    return (Real)(numeric::toDouble(level.values[index]) * std::pow(decayFactor, (double)elapsed));
+}
+
+template <typename Real>
+void BasicBlurPyramid<Real>::increment(unsigned int x, unsigned int y) {
+    int col = x / blurScale;
+    int row = y / blurScale;
+
+    // the increment is followed by this event's decay and then truncated to 1,
+    // so the stored value is already the one seen after the next call to decay()
+    Level &fine = levels.front();
+    size_t index = row * fine.cols + col;
+    Real previous = decayed(fine, index);
+    Real value = std::min((previous + increaseStep) * decayStep, Real(1));
+    Real change = value - previous * decayStep;
+
+    fine.values[index] = value;
+    fine.stamps[index] = eventIndex + 1;
+
+    for (size_t i = 1; i < levels.size(); i++) {
+        col /= 2;
+        row /= 2;
+
+        Level &level = levels[i];
+        index = row * level.cols + col;
+        level.values[index] = decayed(level, index) * decayStep + change;
+        level.stamps[index] = eventIndex + 1;
+    }
+}
+
+template <typename Real>
+Real BasicBlurPyramid<Real>::at(int col, int row) const {
+    const Level &fine = levels.front();
+    return decayed(fine, row * fine.cols + col);
+}
+
+template <typename Real>
+void BasicBlurPyramid<Real>::collect(int level, int col, int row, Real threshold) {
+    const Level &current = levels[level];
+    Real value = decayed(current, row * current.cols + col);
+
+    if (level == 0) {
+        if (value > threshold) {
+            candidates.emplace_back(col, row);
+        }
+        return;
+    }
+
+    // no child can be above the threshold if their sum is not
+    if (value <= threshold - sumTolerance<Real>()) {
+        return;
+    }
+
+    const Level &below = levels[level - 1];
+    for (int i = col * 2; i < std::min(col * 2 + 2, below.cols); i++) {
+        for (int j = row * 2; j < std::min(row * 2 + 2, below.rows); j++) {
+            collect(level - 1, i, j, threshold);
+        }
+    }
+}
+
+template <typename Real>
+void BasicBlurPyramid<Real>::save(std::ostream &out) const {
+    writeValue<int64_t>(out, eventIndex);
+    writeValue<uint32_t>(out, levels.size());
+    for (const Level &level : levels) {
+        writeVector(out, level.values);
+        writeVector(out, level.stamps);
+    }
+}
+
+template <typename Real>
+bool BasicBlurPyramid<Real>::load(std::istream &in) {
+    int64_t index;
+    uint32_t count;
+    if (!readValue(in, index) || !readValue(in, count) || count != levels.size()) {
+        return false;
+    }
+
+    std::vector<Level> loaded = levels;
+    for (Level &level : loaded) {
+        if (!readVector(in, level.values, level.values.size()) || !readVector(in, level.stamps, level.stamps.size())) {
+            return false;
+        }
+    }
+    levels = std::move(loaded);
+    eventIndex = index;
+    return true;
+}
+
+// the number types the trackers can be built with
+template class BasicBlurPyramid<double>;
+template class BasicBlurPyramid<float>;
+template class BasicBlurPyramid<Fixed16>;
@@ -0,0 +1,121 @@
+#ifndef BLUR_PYRAMID_H
+#define BLUR_PYRAMID_H
+
+#include <cluster/numeric.hpp>
+
+#include <opencv2/core.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+// The blurred time surface breaks the image into blurScale x blurScale cells and keeps a decaying
+// count of the OFF events that landed in each cell. New clusters are only created in cells that
+// pass the initialization threshold.
+//
+// Two things keep this cheap on large sensors:
+//  - decay is lazy: each cell remembers the event index it was last written at and the decay for
+//    the events in between is applied when the cell is read, so an event costs O(levels) instead
+//    of a multiply over the whole surface
+//  - coarser levels hold the sum of their 2x2 children, so the birth scan only descends into
+//    regions where some fine cell can possibly be above the threshold
+//
+// Cells on the right and bottom edge cover whatever is left of the image when the resolution
+// is not a multiple of blurScale.
+//
+// Real is the number type of the cell values, see TrackerReal in numeric.hpp. The factors are kept
+// as doubles as well, the decay table is built with them and then converted.
+template <typename Real>
+class BasicBlurPyramid {
+    private:
+        struct Level {
+            int cols, rows;
+            std::vector<Real> values;
+            std::vector<int64_t> stamps;
+        };
+
+        std::vector<Level> levels;
+        std::vector<Real> decayTable;
+        std::vector<std::pair<int, int>> candidates;
+        cv::Size resolution;
+        int blurScale;
+        double decayFactor, increaseFactor;
+        // the factors as Real, for the arithmetic of increment()
+        Real decayStep, increaseStep;
+        int64_t eventIndex{0};
+
+        Real decayed(const Level &level, size_t index) const;
+
+        void buildDecayTable();
+
+        // applies the pending decay to every cell so all stamps are the current event index
+        void settle();
+
+        // recomputes every coarser level as the sum of the level below, after settle()
+        void sumParents();
+
+        void collect(int level, int col, int row, Real threshold);
+
+    public:
+        BasicBlurPyramid(cv::Size resolution, int blurScale, int numLevels, double decayFactor, double increaseFactor);
+
+        // advances the surface by one event, decaying every cell once
+        void decay() { eventIndex++; }
+
+        // adds an event at pixel (x, y) to its cell and to every coarser cell above it
+        void increment(unsigned int x, unsigned int y);
+
+        // current value of a cell on the finest level
+        Real at(int col, int row) const;
+
+        // changes how fast cells decay and how much an event adds, the current values are kept
+        // allocates, so it belongs between batches and not in the event loop
+        void setFactors(double decayFactor, double increaseFactor);
+
+        // the same surface with a different cell size, each old cell's value is spread over the new
+        // cells by how much of it they cover
+        BasicBlurPyramid rescaled(int blurScale, int numLevels) const;
+
+        // writes the cell values and their pending decay for a checkpoint
+        void save(std::ostream &out) const;
+
+        // reads what save() wrote, into a surface built with the same resolution, scale and levels
+        // returns false if it was not, the surface is then left as it was
+        bool load(std::istream &in);
+
+        // calls callback(col, row) for every fine cell above threshold in column-major order,
+        // which is the order the full surface scan visits them in
+        // the callback returns false to stop the scan early
+        template <typename Callback>
+        void forEachAbove(Real threshold, Callback callback) {
+            candidates.clear();
+
+            const Level &top = levels.back();
+            for (int col = 0; col < top.cols; col++) {
+                for (int row = 0; row < top.rows; row++) {
+                    collect(levels.size() - 1, col, row, threshold);
+                }
+            }
+
+            std::sort(candidates.begin(), candidates.end());
+            for (const auto &cell : candidates) {
+                if (!callback(cell.first, cell.second)) {
+                    return;
+                }
+            }
+        }
+
+        int cols() const { return levels.front().cols; }
+
+        int rows() const { return levels.front().rows; }
+
+        int getBlurScale() const { return blurScale; }
+
+        int getNumLevels() const { return levels.size(); }
+};
+
+using BlurPyramid = BasicBlurPyramid<TrackerReal>;
+
+#endif
@@ -0,0 +1,69 @@
+#include "checkpoint.hpp"
+
+#include <csignal>
+#include <cstdlib>
+
+namespace {
+
+volatile std::sig_atomic_t checkpointRequested = 0;
+volatile std::sig_atomic_t stopRequested = 0;
+
+void onCheckpointSignal(int signal) {
+    checkpointRequested = 1;
+    if (signal != SIGUSR1) {
+        stopRequested = 1;
+    }
+}
+
+} // namespace
+
+bool parseCheckpointArgument(const std::string &argument, CheckpointOptions &options, bool &ok) {
+    size_t equals = argument.find('=');
+    std::string name = argument.substr(0, equals);
+    std::string value = equals == std::string::npos ? "" : argument.substr(equals + 1);
+
+    if (name == "--checkpoint") {
+        options.path = value;
+        ok = !value.empty();
+    } else if (name == "--resume") {
+        options.resume = value;
+        ok = !value.empty();
+    } else if (name == "--checkpoint-every") {
+        char *end = nullptr;
+        options.period = std::strtod(value.c_str(), &end);
+        ok = !value.empty() && *end == '\0' && options.period > 0;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+CheckpointSchedule::CheckpointSchedule(const CheckpointOptions &options) : options(options) {
+    if (isEnabled()) {
+        std::signal(SIGUSR1, onCheckpointSignal);
+        std::signal(SIGTERM, onCheckpointSignal);
+        std::signal(SIGINT, onCheckpointSignal);
+    }
+}
+
+bool CheckpointSchedule::due(int64_t sensorTime) {
+    if (!isEnabled()) {
+        return false;
+    }
+    if (next < 0) {
+        next = sensorTime + (int64_t)(options.period * 1e6);
+    }
+    if (checkpointRequested) {
+        checkpointRequested = 0;
+        return true;
+    }
+    if (sensorTime >= next) {
+        next = sensorTime + (int64_t)(options.period * 1e6);
+        return true;
+    }
+    return false;
+}
+
+bool CheckpointSchedule::isStopping() const {
+    return isEnabled() && stopRequested && !checkpointRequested;
+}
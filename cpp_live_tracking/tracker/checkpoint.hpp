@@ -0,0 +1,61 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <object_detection/constants.hpp>
+
+#include <cstdint>
+#include <string>
+
+// Where in its source the tracker was when a checkpoint was written, so a tool can carry on from there
+struct CheckpointPosition {
+    // timestamp of the last event the tracker processed
+    int64_t time{-1};
+    // for a recording: the packet holding that event, by number (RecordingReader::getPacketNumber())
+    // and where it starts in the file (getPacketOffset(), mapped reader only), and how many of the
+    // packet's events had been processed, all 0 for a camera
+    int64_t packetNumber{0};
+    uint64_t packetOffset{0};
+    uint64_t packetEvents{0};
+    // the recording's size and modification time (see recordingStamp()), so it is only resumed
+    // on the recording it was taken on, both 0 for a camera
+    uint64_t recordingSize{0};
+    int64_t recordingTime{0};
+};
+
+// What a tool was asked to do with checkpoints, see parseCheckpointArgument
+struct CheckpointOptions {
+    // where checkpoints are written, none are without --checkpoint
+    std::string path;
+    // the checkpoint to start from, --resume
+    std::string resume;
+    // seconds of sensor time between checkpoints
+    double period{constants::checkpointPeriod};
+};
+
+// Reads --checkpoint=<file>, --checkpoint-every=<seconds> and --resume=<file>, returns false for any
+// other argument, ok is set to false if the value cannot be read
+bool parseCheckpointArgument(const std::string &argument, CheckpointOptions &options, bool &ok);
+
+// Decides when a tool writes its checkpoint: every period of sensor time, straight away on SIGUSR1, and
+// once more on SIGTERM or SIGINT before the tool stops
+// The signal handlers are only installed when a checkpoint path was given, they only set flags
+class CheckpointSchedule {
+    private:
+        CheckpointOptions options;
+        int64_t next{-1};
+
+    public:
+        explicit CheckpointSchedule(const CheckpointOptions &options);
+
+        bool isEnabled() const { return !options.path.empty(); }
+
+        const std::string &getPath() const { return options.path; }
+
+        // after each packet, with the timestamp of the last event processed
+        bool due(int64_t sensorTime);
+
+        // true once SIGTERM or SIGINT arrived, after due() has returned true for it
+        bool isStopping() const;
+};
+
+#endif
@@ -0,0 +1,170 @@
+#ifndef CLUSTER_POOL_H
+#define CLUSTER_POOL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// Refers to a cluster in a ClusterPool
+// The slot stays the same for the whole life of the cluster and the generation changes every time
+// the slot is reused, so a handle to a removed cluster never points at the cluster that replaced it
+struct ClusterHandle {
+    static constexpr uint32_t invalidSlot = std::numeric_limits<uint32_t>::max();
+
+    uint32_t slot{invalidSlot};
+    uint32_t generation{0};
+
+    bool valid() const { return slot != invalidSlot; }
+
+    bool operator==(const ClusterHandle &comp) const { return slot == comp.slot && generation == comp.generation; }
+
+    bool operator!=(const ClusterHandle &comp) const { return !(*this == comp); }
+};
+
+// Fixed capacity storage for clusters
+// Live clusters are packed at the front of one array so the per-event loops run over contiguous memory
+// Removing a cluster moves the last one into its place, so removal never shifts the array and
+// never invalidates the handles of the other clusters
+// Nothing is allocated after construction
+template <typename ClusterType>
+class ClusterPool {
+    private:
+        std::vector<ClusterType> dense;
+        std::vector<uint32_t> denseSlots;
+        std::vector<uint32_t> slotIndices;
+        std::vector<uint32_t> generations;
+        std::vector<uint32_t> freeSlots;
+
+    public:
+        explicit ClusterPool(size_t capacity) {
+            dense.reserve(capacity);
+            denseSlots.reserve(capacity);
+            slotIndices.assign(capacity, 0);
+            generations.assign(capacity, 0);
+
+            // hand out the low slots first
+            freeSlots.reserve(capacity);
+            for (size_t i = capacity; i > 0; i--) {
+                freeSlots.push_back(i - 1);
+            }
+        }
+
+        // constructs a cluster in a free slot, returns an invalid handle when the pool is full
+        template <typename... Args>
+        ClusterHandle emplace(Args &&...args) {
+            if (freeSlots.empty()) {
+                return ClusterHandle();
+            }
+
+            uint32_t slot = freeSlots.back();
+            freeSlots.pop_back();
+
+            slotIndices[slot] = dense.size();
+            dense.emplace_back(std::forward<Args>(args)...);
+            denseSlots.push_back(slot);
+
+            return ClusterHandle{slot, generations[slot]};
+        }
+
+        // constructs a cluster in a given free slot, to put clusters back where a checkpoint had them
+        // returns an invalid handle when the slot is taken or out of range
+        template <typename... Args>
+        ClusterHandle emplaceAt(uint32_t slot, Args &&...args) {
+            auto free = std::find(freeSlots.begin(), freeSlots.end(), slot);
+            if (free == freeSlots.end()) {
+                return ClusterHandle();
+            }
+            freeSlots.erase(free);
+
+            slotIndices[slot] = dense.size();
+            dense.emplace_back(std::forward<Args>(args)...);
+            denseSlots.push_back(slot);
+
+            return ClusterHandle{slot, generations[slot]};
+        }
+
+        // removes the cluster at a position in the packed array by moving the last cluster into it
+        void removeAt(size_t index) {
+            uint32_t slot = denseSlots[index];
+            size_t last = dense.size() - 1;
+
+            if (index != last) {
+                std::swap(dense[index], dense[last]);
+                denseSlots[index] = denseSlots[last];
+                slotIndices[denseSlots[index]] = index;
+            }
+
+            dense.pop_back();
+            denseSlots.pop_back();
+
+            generations[slot]++;
+            freeSlots.push_back(slot);
+        }
+
+        // removes every cluster, the handles to them stop being valid
+        void clear() {
+            while (!dense.empty()) {
+                removeAt(dense.size() - 1);
+            }
+        }
+
+        bool remove(ClusterHandle handle) {
+            if (get(handle) == nullptr) {
+                return false;
+            }
+            removeAt(slotIndices[handle.slot]);
+            return true;
+        }
+
+        // returns nullptr if the cluster has been removed
+        ClusterType *get(ClusterHandle handle) {
+            if (!handle.valid() || handle.slot >= generations.size() || generations[handle.slot] != handle.generation
+                    || !occupied(handle.slot)) {
+                return nullptr;
+            }
+            return &dense[slotIndices[handle.slot]];
+        }
+
+        // the cluster living in a slot, or nullptr if the slot is free
+        const ClusterType *atSlot(uint32_t slot) const {
+            if (!occupied(slot)) {
+                return nullptr;
+            }
+            return &dense[slotIndices[slot]];
+        }
+
+        bool occupied(uint32_t slot) const {
+            size_t index = slotIndices[slot];
+            return index < denseSlots.size() && denseSlots[index] == slot;
+        }
+
+        ClusterHandle handleAt(size_t index) const {
+            uint32_t slot = denseSlots[index];
+            return ClusterHandle{slot, generations[slot]};
+        }
+
+        ClusterType &operator[](size_t index) { return dense[index]; }
+
+        const ClusterType &operator[](size_t index) const { return dense[index]; }
+
+        ClusterType *begin() { return dense.data(); }
+
+        ClusterType *end() { return dense.data() + dense.size(); }
+
+        const ClusterType *begin() const { return dense.data(); }
+
+        const ClusterType *end() const { return dense.data() + dense.size(); }
+
+        size_t size() const { return dense.size(); }
+
+        size_t capacity() const { return generations.size(); }
+
+        bool empty() const { return dense.empty(); }
+
+        bool full() const { return freeSlots.empty(); }
+};
+
+#endif
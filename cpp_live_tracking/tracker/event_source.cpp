@@ -0,0 +1,187 @@
+#include "event_source.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+bool parseEventSourceArgument(const std::string &argument, EventSourceOptions &options, bool &ok) {
+    size_t equals = argument.find('=');
+    std::string name = argument.substr(0, equals);
+    std::string value = equals == std::string::npos ? "" : argument.substr(equals + 1);
+    char *end = nullptr;
+    double number = std::strtod(value.c_str(), &end);
+    bool numeric = !value.empty() && *end == '\0' && number > 0;
+
+    if (name == "--replay") {
+        options.replay = value;
+        ok = !value.empty();
+    } else if (name == "--speed") {
+        options.speed = value == "max" ? 0 : number;
+        ok = value == "max" || numeric;
+    } else if (name == "--buffer") {
+        options.buffer = (int)number;
+        ok = numeric && number >= 1;
+    } else {
+        return parseReaderArgument(argument, options.reader, ok);
+    }
+    return true;
+}
+
+std::string VirtualCameraStats::summary() const {
+    char speedText[32];
+    if (speed > 0) {
+        snprintf(speedText, sizeof(speedText), "%gx", speed);
+    } else {
+        snprintf(speedText, sizeof(speedText), "full speed");
+    }
+    uint64_t offered = packets + droppedPackets;
+    char line[512];
+    snprintf(line, sizeof(line),
+        "Replay at %s: %llu packets taken at %.2f Mev/s, %llu dropped (%.2f%%, %llu events) with a %d packet buffer, "
+        "latency p50 %.2f ms p99 %.2f ms max %.2f ms, playback fell behind by up to %.2f ms",
+        speedText, (unsigned long long)packets, eventRate() / 1e6, (unsigned long long)droppedPackets,
+        offered > 0 ? 100.0 * droppedPackets / offered : 0.0, (unsigned long long)droppedEvents, buffer,
+        latency.percentile(50) / 1000.0, latency.percentile(99) / 1000.0, latency.max() / 1000.0, maxLag / 1000.0);
+    return line;
+}
+
+VirtualCamera::VirtualCamera(const EventSourceOptions &options) : options(options) {
+    stats.speed = options.speed;
+    stats.buffer = options.buffer;
+
+    const std::string synthetic = "synthetic:";
+    if (options.replay.rfind(synthetic, 0) == 0) {
+        SyntheticSceneConfig sceneConfig;
+        if (!parseSyntheticScene(options.replay.substr(synthetic.size()), sceneConfig)) {
+            error = "could not read " + options.replay;
+            return;
+        }
+        scene = std::make_unique<SyntheticScene>(sceneConfig);
+        resolution = sceneConfig.resolution;
+    } else {
+        recording = std::make_unique<RecordingReader>(options.replay, options.reader);
+        if (!recording->isOpen()) {
+            error = recording->getError();
+            return;
+        }
+        resolution = recording->getEventResolution();
+    }
+    thread = std::thread(&VirtualCamera::play, this);
+}
+
+VirtualCamera::~VirtualCamera() {
+    stop();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+std::string VirtualCamera::getError() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return error;
+}
+
+bool VirtualCamera::read(dv::EventStore &packet) {
+    if (scene) {
+        return scene->nextPacket(packet);
+    }
+    // packets wait in the buffer after the reader has moved on, so each one is a store of its own
+    return recording->next(packet);
+}
+
+void VirtualCamera::play() {
+    // the first packet arrives straight away, every later one once the time since the first has passed
+    int64_t firstTime = -1;
+    Clock::time_point start;
+    dv::EventStore packet;
+    while (read(packet)) {
+        if (packet.isEmpty()) {
+            continue;
+        }
+        if (firstTime < 0) {
+            firstTime = packet.getLowestTime();
+            start = Clock::now();
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        if (options.speed > 0) {
+            // a packet is complete once its last event has happened
+            auto due = start + std::chrono::microseconds((int64_t)((packet.getHighestTime() - firstTime) / options.speed));
+            auto now = Clock::now();
+            if (now > due) {
+                stats.maxLag = std::max<int64_t>(stats.maxLag, std::chrono::duration_cast<std::chrono::microseconds>(now - due).count());
+            } else if (taken.wait_until(lock, due, [this]() { return stopping; })) {
+                break;
+            }
+            if (buffer.size() >= (size_t)options.buffer) {
+                stats.droppedPackets++;
+                stats.droppedEvents += packet.size();
+                continue;
+            }
+        } else {
+            taken.wait(lock, [this]() { return stopping || buffer.size() < (size_t)options.buffer; });
+            if (stopping) {
+                break;
+            }
+        }
+        buffer.push_back({std::move(packet), Clock::now()});
+        arrived.notify_one();
+        packet = dv::EventStore();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (recording && error.empty()) {
+        error = recording->getError();
+    }
+    finished = true;
+    arrived.notify_all();
+}
+
+bool VirtualCamera::isRunning() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return isOpen() && !stopping && !(finished && buffer.empty());
+}
+
+std::optional<dv::EventStore> VirtualCamera::getNextEventBatch() {
+    std::unique_lock<std::mutex> lock(mutex);
+    auto now = Clock::now();
+    if (holding) {
+        stats.latency.record(std::chrono::duration_cast<std::chrono::microseconds>(now - *holding).count());
+        holding.reset();
+    }
+
+    arrived.wait_for(lock, std::chrono::microseconds(options.wait), [this]() { return !buffer.empty() || finished || stopping; });
+    if (buffer.empty()) {
+        return std::nullopt;
+    }
+    Arrival arrival = std::move(buffer.front());
+    buffer.pop_front();
+    taken.notify_one();
+
+    if (stats.packets == 0) {
+        firstArrival = arrival.time;
+    }
+    holding = arrival.time;
+    lastTaken = Clock::now();
+    stats.packets++;
+    stats.events += arrival.events.size();
+    return std::move(arrival.events);
+}
+
+void VirtualCamera::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    taken.notify_all();
+    arrived.notify_all();
+}
+
+VirtualCameraStats VirtualCamera::getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    VirtualCameraStats copy = stats;
+    if (copy.packets > 0) {
+        copy.seconds = std::chrono::duration<double>(lastTaken - firstArrival).count();
+    }
+    return copy;
+}
@@ -0,0 +1,137 @@
+#ifndef EVENT_SOURCE_H
+#define EVENT_SOURCE_H
+
+#include <object_detection/constants.hpp>
+#include "recording_reader.hpp"
+#include "stats.hpp"
+#include "synthetic_scene.hpp"
+
+#include <dv-processing/core/core.hpp>
+#include <opencv2/core.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+// Where a live tool gets its events: a camera, or a recording played back as if it were one
+// The calls are the ones the tools already made on dv::io::CameraCapture
+class EventSource {
+    public:
+        virtual ~EventSource() = default;
+
+        virtual std::optional<cv::Size> getEventResolution() const = 0;
+
+        // false once no more events will come
+        virtual bool isRunning() const = 0;
+
+        // the events that arrived since the last call, nothing if none have yet
+        virtual std::optional<dv::EventStore> getNextEventBatch() = 0;
+};
+
+// What the live tools were asked to read from, see parseEventSourceArgument
+struct EventSourceOptions {
+    // empty for the camera, otherwise an .aedat4 file or "synthetic:<settings>" (see SyntheticSceneConfig)
+    std::string replay;
+    // what reads a recording, --reader=
+    ReaderKind reader{ReaderKind::dv};
+    // 1 plays back in real time, 4 four times as fast, 0 as fast as the tool takes the packets
+    double speed{1};
+    int buffer{constants::cameraBuffer};
+    // microseconds getNextEventBatch waits for a packet when none has arrived, 0 returns straight away
+    // for a caller that polls several sources
+    int64_t wait{10000};
+};
+
+// Reads --replay=<recording.aedat4|synthetic:<settings>>, --speed=<N|max>, --buffer=<packets> and --reader=dv|mapped,
+// returns false for any other argument, ok is set to false if the value cannot be read
+bool parseEventSourceArgument(const std::string &argument, EventSourceOptions &options, bool &ok);
+
+// how a replay went, from the tool's side of the camera
+struct VirtualCameraStats {
+    double speed{1};
+    int buffer{0};
+    // packets and events that reached the tool, and those dropped because the buffer was full
+    uint64_t packets{0}, events{0}, droppedPackets{0}, droppedEvents{0};
+    // microseconds from a packet arriving to the tool asking for the next one, so the time it waited
+    // in the buffer plus the time the tool took to process it
+    Histogram latency;
+    // microseconds the playback itself fell behind the recording, reading or generating too slowly
+    int64_t maxLag{0};
+    // from the first packet arriving to the last one being taken
+    double seconds{0};
+
+    double eventRate() const { return seconds > 0 ? events / seconds : 0.0; }
+
+    std::string summary() const;
+};
+
+// Plays a recording or a synthetic scene back like a camera, so the live tools and their threads can
+// be run and load tested without one
+// A thread reads the packets ahead and lets each one arrive when the time it covers has passed, at
+// the chosen speed, so the tool sees the camera's packet cadence. Arrived packets wait in a buffer of
+// a fixed number of packets, as they do between libcaer and the application, and a packet that
+// arrives when the buffer is full is dropped. At full speed nothing is dropped, packets arrive as fast
+// as the tool takes them, which gives the highest event rate the tool can sustain.
+class VirtualCamera : public EventSource {
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Arrival {
+            dv::EventStore events;
+            Clock::time_point time;
+        };
+
+        EventSourceOptions options;
+        std::unique_ptr<RecordingReader> recording;
+        std::unique_ptr<SyntheticScene> scene;
+        std::optional<cv::Size> resolution;
+
+        mutable std::mutex mutex;
+        std::condition_variable arrived, taken;
+        std::deque<Arrival> buffer;
+        bool finished{false}, stopping{false};
+        std::string error;
+        VirtualCameraStats stats;
+        std::thread thread;
+
+        // the packet the tool is working on, the latency is measured when it asks for the next one
+        std::optional<Clock::time_point> holding;
+        Clock::time_point firstArrival, lastTaken;
+
+        // the next packet of the recording or scene, false at the end
+        bool read(dv::EventStore &packet);
+
+        void play();
+
+    public:
+        explicit VirtualCamera(const EventSourceOptions &options);
+
+        ~VirtualCamera();
+
+        VirtualCamera(const VirtualCamera &) = delete;
+        VirtualCamera &operator=(const VirtualCamera &) = delete;
+
+        // false if the recording or scene could not be opened, getError() says why
+        bool isOpen() const { return resolution.has_value(); }
+
+        std::string getError();
+
+        std::optional<cv::Size> getEventResolution() const override { return resolution; }
+
+        bool isRunning() const override;
+
+        // waits options.wait for a packet instead of returning straight away, so the tools' loops do not spin
+        std::optional<dv::EventStore> getNextEventBatch() override;
+
+        // ends the playback early, isRunning() is false afterwards
+        void stop();
+
+        VirtualCameraStats getStats();
+};
+
+#endif
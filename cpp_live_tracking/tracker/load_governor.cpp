@@ -0,0 +1,116 @@
+#include "load_governor.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+const char *loadTierName(LoadTier tier) {
+    switch (tier) {
+        case LoadTier::none: return "none";
+        case LoadTier::pauseSurface: return "pause time surface";
+        case LoadTier::skipRendering: return "skip rendering";
+        case LoadTier::dropOnEvents: return "drop on events";
+        case LoadTier::subsampleOutside: return "subsample outside entrance";
+        default: return "unknown";
+    }
+}
+
+std::string GovernorStats::summary() const {
+    std::string text = "Load shedding:";
+    char part[128];
+    for (int i = 0; i < (int)LoadTier::count; i++) {
+        snprintf(part, sizeof(part), "%s %s %.1f s (%llu times)", i == 0 ? "" : ",", loadTierName((LoadTier)i), seconds[i],
+            (unsigned long long)entered[i]);
+        text += part;
+    }
+    snprintf(part, sizeof(part), ", dropped %llu events outside the entrance, lag up to %.1f ms",
+        (unsigned long long)outsideEventsDropped, maxLag / 1000.0);
+    return text + part;
+}
+
+int64_t SensorLag::update(int64_t sensorTime, std::chrono::steady_clock::time_point now) {
+    if (speed <= 0) {
+        return 0;
+    }
+    if (sensorStart < 0) {
+        sensorStart = sensorTime;
+        wallStart = now;
+    }
+
+    int64_t wall = std::chrono::duration_cast<std::chrono::microseconds>(now - wallStart).count();
+    int64_t offset = (int64_t)(wall * speed) - (sensorTime - sensorStart);
+    minOffset = std::min(minOffset, offset);
+    lag = offset - minOffset;
+    maxLag = std::max(maxLag, lag);
+    return lag;
+}
+
+LoadGovernor::LoadGovernor(const GovernorConfig &config) : config(config), lag(config.speed), kept(shedChunk) {
+    this->config.subsample = std::max(1, config.subsample);
+    tierSince = Clock::now();
+    stats.entered[(int)LoadTier::none] = 1;
+}
+
+LoadTier LoadGovernor::neighbour(int direction) const {
+    LoadTier next = (LoadTier)((int)tier + direction);
+    if (next == LoadTier::dropOnEvents && !config.dropOnEvents) {
+        next = (LoadTier)((int)next + direction);
+    }
+    return next;
+}
+
+void LoadGovernor::setTier(LoadTier next, int64_t sensorTime, Clock::time_point now) {
+    stats.seconds[(int)tier] += std::chrono::duration<double>(now - tierSince).count();
+    stats.entered[(int)next]++;
+    tier = next;
+    tierSince = now;
+    tierSensorTime = sensorTime;
+    low = false;
+}
+
+void LoadGovernor::update(int64_t sensorTime, Clock::time_point now) {
+    // as fast as possible there is no schedule to fall behind
+    if (config.speed <= 0) {
+        return;
+    }
+    if (tierSensorTime < 0) {
+        tierSensorTime = sensorTime;
+        tierSince = now;
+    }
+    lag.update(sensorTime, now);
+    stats.maxLag = lag.getMax();
+
+    if (lag.get() > config.raiseLag) {
+        low = false;
+        if (tier < LoadTier::subsampleOutside && sensorTime - tierSensorTime >= config.raiseTime) {
+            setTier(neighbour(1), sensorTime, now);
+        }
+    } else if (lag.get() < config.lowerLag && tier > LoadTier::none) {
+        if (!low) {
+            low = true;
+            lowSince = sensorTime;
+        } else if (sensorTime - lowSince >= config.lowerTime) {
+            setTier(neighbour(-1), sensorTime, now);
+        }
+    } else {
+        low = false;
+    }
+}
+
+bool LoadGovernor::keep(const dv::Event &event, const EntranceBox &entrance) {
+    if (event.polarity()) {
+        return true;
+    }
+    bool inside = event.x() >= entrance.left - config.margin && event.x() <= entrance.right + config.margin
+        && event.y() >= entrance.top - config.margin && event.y() <= entrance.bottom + config.margin;
+    if (!inside && outsideCount++ % config.subsample != 0) {
+        stats.outsideEventsDropped++;
+        return false;
+    }
+    return true;
+}
+
+GovernorStats LoadGovernor::getStats(Clock::time_point now) const {
+    GovernorStats current = stats;
+    current.seconds[(int)tier] += std::chrono::duration<double>(now - tierSince).count();
+    return current;
+}
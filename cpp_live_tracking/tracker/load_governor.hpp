@@ -0,0 +1,160 @@
+#ifndef LOAD_GOVERNOR_H
+#define LOAD_GOVERNOR_H
+
+#include <cluster/cluster.hpp>
+
+#include <dv-processing/core/core.hpp>
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+// What a live tool gives up when it cannot keep up with the camera, in the order it gives it up
+// Every tier also keeps the ones before it. The tiers before subsampleOutside do not change the counts
+enum class LoadTier {
+    // everything is processed
+    none,
+    // the time surface behind the window stops taking events, it is only drawn
+    pauseSurface,
+    // no frames are drawn, the window freezes on the last one
+    skipRendering,
+    // on events only advance the tracker's surface decay and update timer, which is all they do for
+    // the counts (see BasicTracker::setDropOnEvents), and the tool's own loop skips them
+    // left out for policies that skip on events anyway (GovernorConfig::dropOnEvents)
+    dropOnEvents,
+    // outside the entrance box (grown by a margin) only every subsample-th off event is kept, clusters
+    // far from the entrance move more coarsely until the load drops and the counts can change
+    subsampleOutside,
+    count
+};
+
+const char *loadTierName(LoadTier tier);
+
+struct GovernorConfig {
+    // microseconds of lag that move the governor one tier up, and the lag it has to stay under for
+    // lowerTime before it moves one tier back down, all in sensor time so a replay at any speed
+    // behaves the same
+    int64_t raiseLag{50000};
+    int64_t lowerLag{10000};
+    int64_t lowerTime{1000000};
+    // microseconds a tier is given to work before the next one is added
+    int64_t raiseTime{250000};
+    int subsample{4};
+    double margin{30};
+    // whether the dropOnEvents tier is used, set it to BasicTracker::usesOnEvents
+    bool dropOnEvents{true};
+    // how fast the events come compared with real time, for a replayed camera at --speed, 0 never sheds
+    double speed{1};
+};
+
+// what the governor did over a run
+struct GovernorStats {
+    // wall seconds spent in each tier, and how many times it was entered
+    double seconds[(int)LoadTier::count]{};
+    uint64_t entered[(int)LoadTier::count]{};
+    uint64_t outsideEventsDropped{0};
+    int64_t maxLag{0};
+
+    std::string summary() const;
+};
+
+// How far the processing of a stream has fallen behind its sensor, in microseconds
+// The lag is how much more wall time (times the replay speed) than sensor time has passed since the
+// start, less the smallest that difference has been, so the fixed delay of the camera does not count.
+// It is the sensor time waiting behind getNextEventBatch, it rises while that backlog grows and falls
+// while the tool catches up.
+class SensorLag {
+    private:
+        double speed;
+        int64_t sensorStart{-1}, minOffset{0}, lag{0}, maxLag{0};
+        std::chrono::steady_clock::time_point wallStart;
+
+    public:
+        // at speed 0 (as fast as possible) there is no schedule to fall behind and the lag stays 0
+        explicit SensorLag(double speed = 1) : speed(speed) {}
+
+        // with the newest timestamp of each packet, before it is processed, and the time it was taken
+        int64_t update(int64_t sensorTime, std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+        int64_t get() const { return lag; }
+
+        int64_t getMax() const { return maxLag; }
+};
+
+// Watches how far the processing of a live tool has fallen behind the sensor and sheds load in tiers
+// to catch up, then restores them one at a time once it has
+class LoadGovernor {
+    public:
+        static constexpr size_t shedChunk = 1 << 14;
+        using Clock = std::chrono::steady_clock;
+
+    private:
+
+        GovernorConfig config;
+        LoadTier tier{LoadTier::none};
+        GovernorStats stats;
+
+        SensorLag lag;
+        Clock::time_point tierSince;
+        // sensor time the current tier started, and the lag last went under lowerLag
+        int64_t tierSensorTime{-1}, lowSince{0};
+        bool low{false};
+        uint64_t outsideCount{0};
+
+        // the events kept when subsampling, sized once and handed on whenever it fills up
+        std::vector<dv::Event> kept;
+
+        void setTier(LoadTier next, int64_t sensorTime, Clock::time_point now);
+
+        // the tier one up or down from the current one, past those that are left out
+        LoadTier neighbour(int direction) const;
+
+        // false for an off event outside the grown box that the subsampling drops
+        bool keep(const dv::Event &event, const EntranceBox &entrance);
+
+    public:
+        explicit LoadGovernor(const GovernorConfig &config = GovernorConfig());
+
+        // with the newest timestamp of each packet, before it is processed, and the time it was taken
+        void update(int64_t sensorTime, Clock::time_point now = Clock::now());
+
+        LoadTier getTier() const { return tier; }
+
+        // true when the packet has to go through shed() instead of straight to the tracker
+        bool isShedding() const { return tier >= LoadTier::subsampleOutside; }
+
+        bool surfaceEnabled() const { return tier < LoadTier::pauseSurface; }
+
+        bool renderEnabled() const { return tier < LoadTier::skipRendering; }
+
+        bool onEventsEnabled() const { return tier < LoadTier::dropOnEvents; }
+
+        // hands the events of a packet the current tier keeps to track as std::span<const dv::Event>, in
+        // pieces of at most shedChunk events in order, each valid only during its call
+        // on events are all kept, so the tracker's surface decay and update timer still see them
+        template <typename Track>
+        void shed(const dv::EventStore &events, const EntranceBox &entrance, Track &&track) {
+            size_t count = 0;
+            for (const dv::Event &event : events) {
+                if (!keep(event, entrance)) {
+                    continue;
+                }
+                kept[count++] = event;
+                if (count == kept.size()) {
+                    track(std::span<const dv::Event>(kept.data(), count));
+                    count = 0;
+                }
+            }
+            if (count > 0) {
+                track(std::span<const dv::Event>(kept.data(), count));
+            }
+        }
+
+        int64_t getLag() const { return lag.get(); }
+
+        // the time in the current tier is added up to now
+        GovernorStats getStats(Clock::time_point now = Clock::now()) const;
+};
+
+#endif
@@ -0,0 +1,69 @@
+#include "async_log.hpp"
+#include <microbench.hpp>
+
+#include <fstream>
+#include <memory>
+
+// Microbenchmarks of a crossing count message written the way the tools used to (formatted onto the
+// stream and flushed on the event thread) against AsyncLog, all to /dev/null so no disk is timed
+// Build with optimisations on, see benchmark/README.md in the repository root
+
+static CrossingCountMessage message(int64_t i) {
+    return {(int)i, (int)(i % 7) - 3, (int)(i % 20)};
+}
+
+// what the tools did: format, write and flush on the event thread
+static void benchStream(microbench::State &state) {
+    std::ofstream out("/dev/null");
+    int64_t i = 0;
+    while (state.keepRunning()) {
+        CrossingCountMessage next = message(i++);
+        out << "Total Crossed: " << next.total << "\t Net Crossed: " << next.net << " Last crossed: " << next.lastID << "\r";
+        out.flush();
+    }
+    state.setItemsProcessed(state.iterations());
+}
+
+// what the event thread pays: copying the message into the ring
+// A full ring is emptied with the timer stopped, so every message counted is one the log kept
+static void benchAsyncWrite(microbench::State &state) {
+    std::ofstream out("/dev/null");
+    auto log = std::make_unique<AsyncLog>(out, 64 << 20);
+    int64_t i = 0;
+    while (state.keepRunning()) {
+        CrossingCountMessage next = message(i++);
+        if (!log->write(next)) {
+            state.pauseTiming();
+            log = std::make_unique<AsyncLog>(out, 64 << 20);
+            log->write(next);
+            state.resumeTiming();
+        }
+    }
+    state.setItemsProcessed(state.iterations());
+}
+
+// the whole log, until every message is on the stream: waits for room instead of dropping, and stops
+// the timer only once the log's thread has written the last batch
+static void benchAsyncTotal(microbench::State &state) {
+    std::ofstream out("/dev/null");
+    AsyncLog log(out, state.arg(0) << 10);
+    int64_t i = 0;
+    while (state.keepRunning()) {
+        CrossingCountMessage next = message(i++);
+        while (!log.write(next)) {
+            std::this_thread::yield();
+        }
+    }
+    state.resumeTiming();
+    log.close();
+    state.pauseTiming();
+    state.setItemsProcessed(state.iterations());
+}
+
+int main(int argc, char *argv[]) {
+    microbench::Suite suite("cpp_live_tracking/tracker");
+    suite.add("crossing/stream", benchStream);
+    suite.add("crossing/asyncWrite", benchAsyncWrite);
+    suite.add("crossing/asyncTotal", benchAsyncTotal).argNames({"ringKiB"}).ranges({{64, 1024}});
+    return suite.run(argc, argv);
+}
@@ -0,0 +1,464 @@
+#include "mapped_recording.hpp"
+
+#include <lz4frame.h>
+#include <zstd.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+// the flatbuffer Event struct that dv::Event is generated from: int64 timestamp, int16 x, int16 y,
+// bool polarity and padding, so the events vector in a packet can be used as dv::Event in place
+static_assert(sizeof(dv::Event) == 16, "dv::Event does not match the AEDAT4 event layout");
+
+namespace {
+
+const char versionLine[] = "#!AER-DAT4.0\r\n";
+const size_t versionSize = sizeof(versionLine) - 1;
+const size_t packetHeaderSize = 8;
+
+template <typename T>
+T load(const uint8_t *p) {
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+// Just enough of the flatbuffers wire format to read the two tables the reader needs
+// A table starts with the offset back to its vtable, the vtable lists where each field is in the table
+class FlatTable {
+    private:
+        const uint8_t *begin, *end, *table{nullptr};
+        const uint8_t *vtable{nullptr};
+        uint16_t vtableSize{0};
+
+    public:
+        // buffer is a whole flatbuffer, with or without the 4 byte size prefix, identifier is its file identifier
+        FlatTable(const uint8_t *buffer, size_t size, const char *identifier) : begin(buffer), end(buffer + size) {
+            // the identifier sits after the root offset, and after the size prefix as well if there is one
+            for (size_t prefix : {(size_t)4, (size_t)0}) {
+                if (size < prefix + 8 || std::memcmp(buffer + prefix + 4, identifier, 4) != 0) {
+                    continue;
+                }
+                const uint8_t *root = buffer + prefix;
+                const uint8_t *start = root + load<uint32_t>(root);
+                if (start < root || start + 4 > end) {
+                    return;
+                }
+                const uint8_t *vt = start - load<int32_t>(start);
+                if (vt < begin || vt + 4 > end) {
+                    return;
+                }
+                vtableSize = load<uint16_t>(vt);
+                if (vt + vtableSize > end) {
+                    return;
+                }
+                table = start;
+                vtable = vt;
+                return;
+            }
+        }
+
+        bool valid() const { return table != nullptr; }
+
+        // where field number index is in the table, nullptr if it was left at its default
+        const uint8_t *field(int index, size_t size) const {
+            size_t entry = 4 + 2 * (size_t)index;
+            if (entry + 2 > vtableSize) {
+                return nullptr;
+            }
+            uint16_t offset = load<uint16_t>(vtable + entry);
+            if (offset == 0 || table + offset + size > end) {
+                return nullptr;
+            }
+            return table + offset;
+        }
+
+        template <typename T>
+        T scalar(int index, T fallback) const {
+            const uint8_t *p = field(index, sizeof(T));
+            return p ? load<T>(p) : fallback;
+        }
+
+        // strings and vectors: the length, then the data it returns
+        const uint8_t *vector(int index, uint32_t &length) const {
+            const uint8_t *p = field(index, 4);
+            if (p == nullptr) {
+                return nullptr;
+            }
+            const uint8_t *target = p + load<uint32_t>(p);
+            if (target + 4 > end) {
+                return nullptr;
+            }
+            length = load<uint32_t>(target);
+            return target + 4;
+        }
+
+        const uint8_t *limit() const { return end; }
+};
+
+// the value of <attr key="name" ...>value</attr> at or after from, -1 if there is none
+int attrAfter(const std::string &xml, size_t from, const std::string &name) {
+    size_t key = xml.find("key=\"" + name + "\"", from);
+    if (key == std::string::npos) {
+        return -1;
+    }
+    size_t value = xml.find('>', key);
+    if (value == std::string::npos) {
+        return -1;
+    }
+    return std::atoi(xml.c_str() + value + 1);
+}
+
+} // namespace
+
+MappedRecording::MappedRecording(const std::string &path, int depth) : slots(std::max(depth, 1) + 1) {
+    stats.depth = (int)slots.size() - 1;
+    fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "could not open " + path + ": " + std::strerror(errno);
+        return;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        error = "could not read the size of " + path;
+        return;
+    }
+    mapSize = (size_t)info.st_size;
+    void *mapped = mmap(nullptr, mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED) {
+        error = "could not map " + path + ": " + std::strerror(errno);
+        mapSize = 0;
+        return;
+    }
+    map = static_cast<const uint8_t *>(mapped);
+    // the packets are read front to back once, so the kernel can read well ahead and drop pages behind
+    madvise(mapped, mapSize, MADV_SEQUENTIAL);
+
+    if (!readHeader()) {
+        eventStream = -1;
+        return;
+    }
+
+    if (compression == Compression::lz4 || compression == Compression::lz4High) {
+        LZ4F_dctx *context = nullptr;
+        if (LZ4F_isError(LZ4F_createDecompressionContext(&context, LZ4F_VERSION))) {
+            error = "could not create an LZ4 decompression context";
+            eventStream = -1;
+            return;
+        }
+        lz4 = context;
+    } else if (compression == Compression::zstd || compression == Compression::zstdHigh) {
+        zstd = ZSTD_createDCtx();
+        if (zstd == nullptr) {
+            error = "could not create a ZSTD decompression context";
+            eventStream = -1;
+            return;
+        }
+    }
+
+    decoder = std::thread(&MappedRecording::decode, this, dataStart);
+}
+
+MappedRecording::~MappedRecording() {
+    stopDecoder();
+    if (lz4 != nullptr) {
+        LZ4F_freeDecompressionContext(lz4);
+    }
+    if (zstd != nullptr) {
+        ZSTD_freeDCtx(zstd);
+    }
+    if (map != nullptr) {
+        munmap(const_cast<uint8_t *>(map), mapSize);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+bool MappedRecording::readHeader() {
+    if (mapSize < versionSize + 4 || std::memcmp(map, versionLine, versionSize) != 0) {
+        error = "not an AEDAT 4.0 recording";
+        return false;
+    }
+
+    // the IOHeader flatbuffer follows the version line with its size in front
+    size_t headerSize = load<uint32_t>(map + versionSize);
+    if (versionSize + 4 + headerSize > mapSize) {
+        error = "truncated file header";
+        return false;
+    }
+    FlatTable header(map + versionSize, headerSize + 4, "IOHE");
+    if (!header.valid()) {
+        error = "unreadable file header";
+        return false;
+    }
+
+    // IOHeader fields: compression, dataTablePosition, infoNode
+    int32_t type = header.scalar<int32_t>(0, 0);
+    if (type < 0 || type > (int32_t)Compression::zstdHigh) {
+        error = "unknown compression type " + std::to_string(type);
+        return false;
+    }
+    compression = (Compression)type;
+
+    dataStart = versionSize + 4 + headerSize;
+    int64_t tablePosition = header.scalar<int64_t>(1, -1);
+    dataEnd = tablePosition >= (int64_t)dataStart && tablePosition <= (int64_t)mapSize ? (size_t)tablePosition : mapSize;
+
+    // the stream descriptions are an XML document, every output has a node named after its stream id
+    uint32_t length = 0;
+    const uint8_t *text = header.vector(2, length);
+    if (text == nullptr || text + length > header.limit()) {
+        error = "the file header has no stream descriptions";
+        return false;
+    }
+    std::string xml(reinterpret_cast<const char *>(text), length);
+
+    // the first stream of events, the stream node's attributes come before its info node,
+    // so the closest node opened before the type identifier is the stream itself
+    size_t identifier = xml.find(">EVTS<");
+    if (identifier == std::string::npos) {
+        error = "the recording has no event stream";
+        return false;
+    }
+    size_t node = xml.rfind("<node name=\"", identifier);
+    if (node == std::string::npos) {
+        error = "unreadable stream description";
+        return false;
+    }
+    int stream = std::atoi(xml.c_str() + node + 12);
+
+    int width = attrAfter(xml, identifier, "sizeX");
+    int height = attrAfter(xml, identifier, "sizeY");
+    if (width > 0 && height > 0) {
+        resolution = cv::Size(width, height);
+    }
+    eventStream = stream;
+    return true;
+}
+
+size_t MappedRecording::decompress(const uint8_t *data, size_t size, std::vector<uint8_t> &arena, std::string &failure) {
+    size_t in = 0, out = 0;
+    if (lz4 != nullptr) {
+        LZ4F_resetDecompressionContext(lz4);
+    } else {
+        ZSTD_DCtx_reset(zstd, ZSTD_reset_session_only);
+    }
+
+    while (true) {
+        // the arena only grows, and only until it has held the largest packet in the file
+        if (out == arena.size()) {
+            arena.resize(std::max<size_t>(arena.size() * 2, std::max<size_t>(size * 4, 1 << 16)));
+        }
+
+        size_t produced, consumed;
+        bool done;
+        if (lz4 != nullptr) {
+            produced = arena.size() - out;
+            consumed = size - in;
+            size_t hint = LZ4F_decompress(lz4, arena.data() + out, &produced, data + in, &consumed, nullptr);
+            if (LZ4F_isError(hint)) {
+                failure = std::string("LZ4: ") + LZ4F_getErrorName(hint);
+                return 0;
+            }
+            done = hint == 0;
+        } else {
+            ZSTD_inBuffer input{data, size, in};
+            ZSTD_outBuffer output{arena.data(), arena.size(), out};
+            size_t hint = ZSTD_decompressStream(zstd, &output, &input);
+            if (ZSTD_isError(hint)) {
+                failure = std::string("ZSTD: ") + ZSTD_getErrorName(hint);
+                return 0;
+            }
+            produced = output.pos - out;
+            consumed = input.pos - in;
+            done = hint == 0;
+        }
+        in += consumed;
+        out += produced;
+
+        if (done) {
+            return out;
+        }
+        if (produced == 0 && consumed == 0 && out < arena.size()) {
+            failure = "truncated compressed packet";
+            return 0;
+        }
+    }
+}
+
+bool MappedRecording::findEvents(const uint8_t *buffer, size_t size, Slot &slot, std::string &failure) {
+    // EventPacket has a single field, the vector of events
+    FlatTable packet(buffer, size, "EVTS");
+    if (!packet.valid()) {
+        failure = "unreadable event packet";
+        return false;
+    }
+    uint32_t count = 0;
+    const uint8_t *events = packet.vector(0, count);
+    if (events == nullptr) {
+        slot.events = {};
+        return true;
+    }
+    if ((size_t)count * sizeof(dv::Event) > (size_t)(packet.limit() - events)) {
+        failure = "event packet overruns its buffer";
+        return false;
+    }
+
+    // the events are aligned within the flatbuffer, so they are aligned in the arena, but an uncompressed
+    // packet can start anywhere in the file and then has to be copied out before it can be used
+    if (reinterpret_cast<uintptr_t>(events) % alignof(dv::Event) != 0) {
+        size_t bytes = (size_t)count * sizeof(dv::Event);
+        if (slot.arena.size() < bytes) {
+            slot.arena.resize(bytes);
+        }
+        std::memcpy(slot.arena.data(), events, bytes);
+        events = slot.arena.data();
+    }
+    slot.events = std::span<const dv::Event>(reinterpret_cast<const dv::Event *>(events), count);
+    return true;
+}
+
+void MappedRecording::stopDecoder() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    slotFree.notify_all();
+    if (decoder.joinable()) {
+        decoder.join();
+    }
+}
+
+bool MappedRecording::seek(size_t offset) {
+    if (!isOpen() || offset < dataStart || offset > dataEnd) {
+        return false;
+    }
+
+    // the decoder is restarted rather than redirected, whatever it had decoded ahead is thrown away
+    stopDecoder();
+    decoded = handedOut = released = 0;
+    finished = stopping = false;
+    error.clear();
+    decoder = std::thread(&MappedRecording::decode, this, offset);
+    return true;
+}
+
+void MappedRecording::decode(size_t position) {
+    std::string failure;
+
+    while (position + packetHeaderSize <= dataEnd) {
+        int32_t stream = load<int32_t>(map + position);
+        int32_t size = load<int32_t>(map + position + 4);
+        const uint8_t *body = map + position + packetHeaderSize;
+        if (size < 0 || position + packetHeaderSize + (size_t)size > dataEnd) {
+            failure = "truncated packet at byte " + std::to_string(position);
+            break;
+        }
+        position += packetHeaderSize + (size_t)size;
+        if (stream != eventStream) {
+            continue;
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            // depth packets waiting, and the slot next() handed out last is still in use
+            auto room = [this]() { return decoded - handedOut < (uint64_t)stats.depth && decoded - released < slots.size(); };
+            if (!room() && !stopping) {
+                auto start = std::chrono::steady_clock::now();
+                slotFree.wait(lock, [this, &room]() { return stopping || room(); });
+                stats.fullWaits++;
+                stats.readingStall += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
+            if (stopping) {
+                return;
+            }
+        }
+
+        // the slot is not visible to next() until decoded is advanced, so it is filled without the lock
+        Slot &slot = slots[decoded % slots.size()];
+        slot.fileBytes = packetHeaderSize + (size_t)size;
+        slot.offset = position - slot.fileBytes;
+        bool ok;
+        if (compression == Compression::none) {
+            ok = findEvents(body, (size_t)size, slot, failure);
+        } else {
+            size_t length = decompress(body, (size_t)size, slot.arena, failure);
+            ok = length > 0 && findEvents(slot.arena.data(), length, slot, failure);
+        }
+        if (!ok) {
+            failure += " at byte " + std::to_string(slot.offset);
+            break;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            decoded++;
+        }
+        slotReady.notify_one();
+    }
+
+    if (failure.empty() && position < dataEnd) {
+        failure = "truncated packet at byte " + std::to_string(position);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished = true;
+        if (!failure.empty()) {
+            error = failure;
+        }
+    }
+    slotReady.notify_one();
+}
+
+bool MappedRecording::next(std::span<const dv::Event> &events) {
+    if (!isOpen()) {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    // the caller is done with the packet handed out last time
+    if (released < handedOut) {
+        released++;
+        slotFree.notify_one();
+    }
+    if (decoded == handedOut && !finished) {
+        auto start = std::chrono::steady_clock::now();
+        slotReady.wait(lock, [this]() { return decoded > handedOut || finished; });
+        stats.emptyWaits++;
+        stats.processingStall += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    if (decoded == handedOut) {
+        return false;
+    }
+    stats.packets++;
+    stats.occupancySum += decoded - handedOut;
+    stats.maxOccupancy = std::max(stats.maxOccupancy, (int)(decoded - handedOut));
+
+    const Slot &slot = slots[handedOut % slots.size()];
+    handedOut++;
+    lock.unlock();
+    slotFree.notify_one();
+
+    events = slot.events;
+    eventsRead += slot.events.size();
+    bytesRead += slot.fileBytes;
+    packetOffset = slot.offset;
+    return true;
+}
+
+ReadAheadStats MappedRecording::getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+std::string MappedRecording::getError() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return error;
+}
@@ -0,0 +1,119 @@
+#ifndef MAPPED_RECORDING_H
+#define MAPPED_RECORDING_H
+
+#include "read_ahead.hpp"
+
+#include <dv-processing/core/core.hpp>
+#include <opencv2/core.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct LZ4F_dctx_s;
+struct ZSTD_DCtx_s;
+
+// Reads the event stream of an AEDAT4 recording without going through dv::io::MonoCameraRecording
+// The file is memory mapped and a background thread walks its packets, decompressing each event
+// packet (LZ4 or ZSTD, whichever the Recorder was set to) into one of a few reusable arena slots.
+// next() hands out the events of a packet as a read-only span straight into that slot, or straight
+// into the mapping for uncompressed recordings, so no event is copied on the way to the tracker.
+// Errors are reported through isOpen(), next() and getError() instead of exceptions.
+class MappedRecording {
+    private:
+        // AEDAT4 CompressionType
+        enum class Compression { none, lz4, lz4High, zstd, zstdHigh };
+
+        // one decoded packet, the arena keeps its size between packets so it stops allocating once
+        // it has seen the largest packet
+        struct Slot {
+            std::vector<uint8_t> arena;
+            std::span<const dv::Event> events;
+            size_t fileBytes{0};
+            size_t offset{0};
+        };
+
+        int fd{-1};
+        const uint8_t *map{nullptr};
+        size_t mapSize{0};
+
+        Compression compression{Compression::none};
+        int32_t eventStream{-1};
+        std::optional<cv::Size> resolution;
+        // packets run from dataStart up to the data table (or the end of the file)
+        size_t dataStart{0}, dataEnd{0};
+
+        LZ4F_dctx_s *lz4{nullptr};
+        ZSTD_DCtx_s *zstd{nullptr};
+
+        // the decoder fills slots[decoded % size], next() hands out slots[handedOut % size]
+        // a slot is reused once next() has been called again after handing it out
+        std::vector<Slot> slots;
+        std::mutex mutex;
+        std::condition_variable slotFree, slotReady;
+        uint64_t decoded{0}, handedOut{0}, released{0};
+        bool finished{false}, stopping{false};
+        std::string error;
+        ReadAheadStats stats;
+        std::thread decoder;
+
+        uint64_t eventsRead{0}, bytesRead{0};
+        size_t packetOffset{0};
+
+        bool readHeader();
+
+        // walks the packets from the one at position to the end of the data
+        void decode(size_t position);
+
+        void stopDecoder();
+
+        // decompresses one packet body into arena, returns the size of the result or 0 on failure
+        size_t decompress(const uint8_t *data, size_t size, std::vector<uint8_t> &arena, std::string &failure);
+
+        // finds the events vector in an EventPacket flatbuffer
+        bool findEvents(const uint8_t *buffer, size_t size, Slot &slot, std::string &failure);
+
+    public:
+        // depth is how many packets can be decoded and waiting, on top of the one the caller holds
+        explicit MappedRecording(const std::string &path, int depth = constants::readAhead);
+
+        ~MappedRecording();
+
+        MappedRecording(const MappedRecording &) = delete;
+        MappedRecording &operator=(const MappedRecording &) = delete;
+
+        // false if the file could not be mapped or is not an AEDAT4 recording with an event stream
+        bool isOpen() const { return eventStream >= 0; }
+
+        // what went wrong, empty while nothing has
+        std::string getError();
+
+        std::optional<cv::Size> getEventResolution() const { return resolution; }
+
+        // the events of the next event packet, valid until the following call to next() or seek()
+        // returns false at the end of the recording or on a corrupt packet (getError() says which)
+        bool next(std::span<const dv::Event> &events);
+
+        // where the packet handed out by the last next() starts in the file, for RecordingIndex
+        size_t getPacketOffset() const { return packetOffset; }
+
+        // carries on reading from the packet at offset, which has to be a packet boundary
+        // (from getPacketOffset() or a RecordingIndex), returns false if it is outside the data
+        bool seek(size_t offset);
+
+        // totals of what next() has handed out, bytes as stored in the file
+        uint64_t getEventsRead() const { return eventsRead; }
+
+        uint64_t getBytesRead() const { return bytesRead; }
+
+        size_t getFileSize() const { return mapSize; }
+
+        // how far the decoder kept ahead of the caller
+        ReadAheadStats getStats();
+};
+
+#endif
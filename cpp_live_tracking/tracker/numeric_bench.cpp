@@ -0,0 +1,81 @@
+#include "tracker.hpp"
+#include <cluster_workload.hpp>
+
+#include <memory>
+#include <span>
+#include <vector>
+
+// Microbenchmarks of the number types the tracker can be built with (see cluster/numeric.hpp), all
+// three in one run: the whole tracker over the workload's events, and the blurred surface on its own
+// Build with optimisations on, see benchmark/README.md in the repository root
+
+// events made once per run, enough that the tracker is only rebuilt now and then
+static const size_t streamEvents = 1 << 20;
+
+static std::vector<dv::Event> makeStream(int bees, int64_t rate) {
+    std::vector<dv::Event> events;
+    events.reserve(streamEvents);
+    for (const workload::SyntheticEvent &event : workload::makeEvents(streamEvents, bees, rate)) {
+        events.emplace_back(event.timestamp, event.x, event.y, event.polarity);
+    }
+    return events;
+}
+
+template <typename Real>
+void benchTrack(microbench::State &state) {
+    const std::vector<dv::Event> events = makeStream(state.arg(0), state.arg(1));
+    const cv::Size resolution(workload::width, workload::height);
+    auto tracker = std::make_unique<BasicTracker<Real>>(resolution);
+
+    size_t next = 0;
+    while (state.keepRunning()) {
+        // the timestamps cannot start over with the same tracker
+        if (next + workload::blockSize > events.size()) {
+            state.pauseTiming();
+            tracker = std::make_unique<BasicTracker<Real>>(resolution);
+            next = 0;
+            state.resumeTiming();
+        }
+        tracker->processEvents(std::span<const dv::Event>(events.data() + next, workload::blockSize));
+        next += workload::blockSize;
+    }
+    microbench::doNotOptimize(tracker->getTotalCrossing());
+    state.setItemsProcessed(state.iterations() * workload::blockSize);
+}
+
+// the increment and decay the tracker does for every off event
+template <typename Real>
+void benchSurface(microbench::State &state) {
+    const std::vector<dv::Event> events = makeStream(20, state.arg(0));
+    BasicBlurPyramid<Real> surface(cv::Size(workload::width, workload::height), constants::blurScale, constants::blurLevels,
+        constants::scaleFactor, constants::blurIncreaseFactor);
+
+    size_t next = 0;
+    while (state.keepRunning()) {
+        if (next + workload::blockSize > events.size()) {
+            next = 0;
+        }
+        for (size_t i = next; i < next + workload::blockSize; i++) {
+            surface.increment(events[i].x(), events[i].y());
+            surface.decay();
+        }
+        next += workload::blockSize;
+    }
+    microbench::doNotOptimize(surface.at(0, 0));
+    state.setItemsProcessed(state.iterations() * workload::blockSize);
+}
+
+template <typename Real>
+void addBenchmarks(microbench::Suite &suite) {
+    const std::string name = numeric::name<Real>();
+    suite.add("track/" + name, benchTrack<Real>).argNames({"bees", "rate"}).ranges({workload::clusterCounts, workload::eventRates});
+    suite.add("surface/" + name, benchSurface<Real>).argNames({"rate"}).ranges({workload::eventRates});
+}
+
+int main(int argc, char *argv[]) {
+    microbench::Suite suite("cpp_live_tracking/tracker");
+    addBenchmarks<double>(suite);
+    addBenchmarks<float>(suite);
+    addBenchmarks<Fixed16>(suite);
+    return suite.run(argc, argv);
+}
@@ -0,0 +1,270 @@
+#include "parameter_sweep.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+
+bool readSweepGrid(const std::string &path, const TrackerConfig &base, SweepGrid &grid) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Could not open sweep grid: " << path << std::endl;
+        return false;
+    }
+
+    TrackerConfig fixed = base;
+    std::vector<std::string> names;
+    std::vector<std::vector<std::string>> values;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+
+        size_t equals = line.find('=');
+        std::string name;
+        std::istringstream(line.substr(0, equals)) >> name;
+        if (name.empty()) {
+            continue;
+        }
+        if (!isTrackerSetting(name)) {
+            std::cerr << path << ":" << lineNumber << ": unknown setting \"" << name << "\"" << std::endl;
+            return false;
+        }
+        if (std::find(names.begin(), names.end(), name) != names.end()) {
+            std::cerr << path << ":" << lineNumber << ": \"" << name << "\" is already in the grid" << std::endl;
+            return false;
+        }
+
+        // values are separated by commas or spaces
+        std::string list = equals == std::string::npos ? "" : line.substr(equals + 1);
+        std::replace(list.begin(), list.end(), ',', ' ');
+        std::istringstream fields(list);
+        std::vector<std::string> lineValues;
+        std::string value;
+        while (fields >> value) {
+            TrackerConfig check = fixed;
+            if (!setTrackerSetting(check, name, value)) {
+                std::cerr << path << ":" << lineNumber << ": could not read \"" << value << "\" for " << name << std::endl;
+                return false;
+            }
+            lineValues.push_back(value);
+        }
+        if (lineValues.empty()) {
+            std::cerr << path << ":" << lineNumber << ": no values for " << name << std::endl;
+            return false;
+        }
+
+        if (lineValues.size() == 1) {
+            setTrackerSetting(fixed, name, lineValues[0]);
+        } else {
+            names.push_back(name);
+            values.push_back(lineValues);
+        }
+    }
+
+    // every combination, the last setting in the file changes fastest
+    size_t count = 1;
+    for (const auto &options : values) {
+        count *= options.size();
+    }
+    grid.names = names;
+    grid.points.clear();
+    grid.points.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        SweepPoint point{fixed, {}};
+        size_t rest = i;
+        point.values.resize(names.size());
+        for (size_t n = names.size(); n > 0; n--) {
+            const auto &options = values[n - 1];
+            point.values[n - 1] = options[rest % options.size()];
+            setTrackerSetting(point.config, names[n - 1], point.values[n - 1]);
+            rest /= options.size();
+        }
+        grid.points.push_back(point);
+    }
+    return true;
+}
+
+double SweepResult::meanLifetime() const {
+    if (lifetimes.empty()) {
+        return 0;
+    }
+    return std::accumulate(lifetimes.begin(), lifetimes.end(), 0.0) / lifetimes.size();
+}
+
+double SweepResult::medianLifetime() const {
+    if (lifetimes.empty()) {
+        return 0;
+    }
+    std::vector<int64_t> sorted = lifetimes;
+    std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+    return sorted[sorted.size() / 2];
+}
+
+ParameterSweep::ParameterSweep(cv::Size resolution, const std::vector<SweepPoint> &points, int threads, size_t batchEvents)
+    : batchEvents(std::max<size_t>(batchEvents, 1)) {
+    lanes.resize(points.size());
+    for (size_t i = 0; i < points.size(); i++) {
+        const TrackerConfig &config = points[i].config;
+        // built with the point's blur and capacity so setConfig does not have to resample anything
+        lanes[i].tracker = std::make_unique<Tracker>(resolution, config.blurScale, config.blurLevels,
+            std::max(config.maxClusters, constants::maxClusters));
+        lanes[i].tracker->setConfig(config);
+    }
+    for (Batch &batch : batches) {
+        batch.events.reserve(this->batchEvents);
+    }
+
+    if (threads <= 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::max<int>(1, std::min<size_t>(threads, lanes.size()));
+    for (int i = 0; i < threads; i++) {
+        workers.emplace_back(&ParameterSweep::work, this);
+    }
+}
+
+ParameterSweep::~ParameterSweep() {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        waitForBatch(lock);
+        stopping = true;
+    }
+    batchReady.notify_all();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+void ParameterSweep::addPacket(std::span<const dv::Event> packet) {
+    if (packet.empty()) {
+        return;
+    }
+    Batch &batch = batches[filling];
+    batch.events.insert(batch.events.end(), packet.begin(), packet.end());
+    batch.packetEnds.push_back(batch.events.size());
+    events += packet.size();
+    packets++;
+    if (batch.events.size() >= batchEvents) {
+        dispatch();
+    }
+}
+
+void ParameterSweep::addPacket(const dv::EventStore &packet) {
+    Batch &batch = batches[filling];
+    for (const dv::Event &event : packet) {
+        batch.events.push_back(event);
+    }
+    if (!packet.isEmpty()) {
+        batch.packetEnds.push_back(batch.events.size());
+        events += packet.size();
+        packets++;
+    }
+    if (batch.events.size() >= batchEvents) {
+        dispatch();
+    }
+}
+
+void ParameterSweep::finish() {
+    if (!batches[filling].packetEnds.empty()) {
+        dispatch();
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    waitForBatch(lock);
+}
+
+void ParameterSweep::waitForBatch(std::unique_lock<std::mutex> &lock) {
+    batchDone.wait(lock, [this]() { return running == nullptr || workersDone == workers.size(); });
+}
+
+void ParameterSweep::dispatch() {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        waitForBatch(lock);
+        running = &batches[filling];
+        nextLane = 0;
+        workersDone = 0;
+        generation++;
+    }
+    batchReady.notify_all();
+
+    // the workers are finished with the other batch, it can be filled again
+    filling ^= 1;
+    batches[filling].events.clear();
+    batches[filling].packetEnds.clear();
+}
+
+void ParameterSweep::work() {
+    uint64_t seen = 0;
+    while (true) {
+        const Batch *batch;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            batchReady.wait(lock, [this, seen]() { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+            batch = running;
+        }
+
+        // trackers are taken one at a time, so a slow setting does not hold up a whole thread's share
+        for (size_t i = nextLane++; i < lanes.size(); i = nextLane++) {
+            runLane(lanes[i], *batch);
+        }
+
+        // every worker reports in, so nextLane is not reset while one is still taking from it
+        std::lock_guard<std::mutex> lock(mutex);
+        if (++workersDone == workers.size()) {
+            batchDone.notify_all();
+        }
+    }
+}
+
+void ParameterSweep::runLane(Lane &lane, const Batch &batch) {
+    Tracker &tracker = *lane.tracker;
+    std::chrono::steady_clock::duration tracking{0};
+    size_t start = 0;
+    for (size_t end : batch.packetEnds) {
+        std::span<const dv::Event> packet(batch.events.data() + start, end - start);
+        auto begin = std::chrono::steady_clock::now();
+        tracker.processEvents(packet);
+        tracking += std::chrono::steady_clock::now() - begin;
+
+        noteClusters(lane, packet.back().timestamp());
+        start = end;
+    }
+    lane.result.seconds += std::chrono::duration<double>(tracking).count();
+    lane.result.totalCrossing = tracker.getTotalCrossing();
+    lane.result.netCrossing = tracker.getNetCrossing();
+}
+
+void ParameterSweep::noteClusters(Lane &lane, int64_t timestamp) {
+    for (LiveCluster &live : lane.live) {
+        live.seen = false;
+    }
+    for (const Cluster &cluster : lane.tracker->getClusters()) {
+        auto live = std::find_if(lane.live.begin(), lane.live.end(), [&cluster](const LiveCluster &live) {
+            return live.id == cluster.getID();
+        });
+        if (live == lane.live.end()) {
+            lane.live.push_back({cluster.getID(), timestamp, timestamp, true});
+            lane.result.clusters++;
+        } else {
+            live->lastSeen = timestamp;
+            live->seen = true;
+        }
+    }
+    for (size_t i = 0; i < lane.live.size();) {
+        if (lane.live[i].seen) {
+            i++;
+            continue;
+        }
+        lane.result.lifetimes.push_back(lane.live[i].lastSeen - lane.live[i].born);
+        lane.live[i] = lane.live.back();
+        lane.live.pop_back();
+    }
+}
@@ -0,0 +1,138 @@
+#ifndef PARAMETER_SWEEP_H
+#define PARAMETER_SWEEP_H
+
+#include "tracker.hpp"
+#include "tracker_config.hpp"
+
+#include <dv-processing/core/core.hpp>
+#include <opencv2/core.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+// one combination of settings in a sweep
+struct SweepPoint {
+    TrackerConfig config;
+    // the values of the swept settings, in the order of SweepGrid::names, as written in the grid file
+    std::vector<std::string> values;
+};
+
+// The settings a sweep tries
+struct SweepGrid {
+    // the settings with more than one value
+    std::vector<std::string> names;
+    std::vector<SweepPoint> points;
+};
+
+// Reads a grid file of "name = value, value, ..." lines, names are the settings file ones and # starts
+// a comment. Every combination of the values becomes one point, starting from base, so a setting with
+// one value is the same for all of them. Returns false and prints the problem if a line could not be read
+bool readSweepGrid(const std::string &path, const TrackerConfig &base, SweepGrid &grid);
+
+// what one tracker of a sweep did with the recording
+struct SweepResult {
+    int totalCrossing{0}, netCrossing{0};
+    // clusters created, and the event time in microseconds each cluster lived for (those still
+    // alive at the end of the recording are not in it)
+    int64_t clusters{0};
+    std::vector<int64_t> lifetimes;
+    // time spent in Tracker::processEvents
+    double seconds{0};
+
+    double meanLifetime() const;
+
+    double medianLifetime() const;
+};
+
+// Runs one recording through many trackers at once, one per sweep point, so the recording is read
+// and decoded once however many settings are tried
+// Packets are copied into a shared batch, and once the batch is full a pool of threads takes the
+// trackers one at a time and runs each one over the whole batch, packet by packet. The caller
+// fills the next batch in the meantime. Every tracker sees exactly the packets a replay would give it.
+class ParameterSweep {
+    private:
+        struct LiveCluster {
+            int id;
+            int64_t born, lastSeen;
+            bool seen;
+        };
+
+        // a tracker and what has been measured of it so far
+        struct Lane {
+            std::unique_ptr<Tracker> tracker;
+            SweepResult result;
+            std::vector<LiveCluster> live;
+        };
+
+        // events of whole packets, packetEnds is the end of each packet in events
+        struct Batch {
+            std::vector<dv::Event> events;
+            std::vector<size_t> packetEnds;
+        };
+
+        std::vector<Lane> lanes;
+        size_t batchEvents;
+        Batch batches[2];
+        // the batch the caller is filling, the workers run the other one
+        int filling{0};
+
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable batchReady, batchDone;
+        const Batch *running{nullptr};
+        // batches handed to the workers, and workers done with the latest one
+        uint64_t generation{0};
+        size_t workersDone{0};
+        std::atomic<size_t> nextLane{0};
+        bool stopping{false};
+
+        uint64_t events{0}, packets{0};
+
+        void work();
+
+        void runLane(Lane &lane, const Batch &batch);
+
+        // records the clusters that appeared and the ones that are gone since the last packet
+        void noteClusters(Lane &lane, int64_t timestamp);
+
+        // hands the batch being filled to the workers, after they are done with the one before
+        void dispatch();
+
+        void waitForBatch(std::unique_lock<std::mutex> &lock);
+
+    public:
+        // threads 0 uses every core, batchEvents is how many events are collected before the trackers run
+        ParameterSweep(cv::Size resolution, const std::vector<SweepPoint> &points, int threads = 0,
+            size_t batchEvents = 262144);
+
+        ~ParameterSweep();
+
+        ParameterSweep(const ParameterSweep &) = delete;
+        ParameterSweep &operator=(const ParameterSweep &) = delete;
+
+        // copies a packet, the events can be reused as soon as it returns
+        void addPacket(std::span<const dv::Event> packet);
+
+        void addPacket(const dv::EventStore &packet);
+
+        // runs the trackers over what is left, call before reading the results
+        void finish();
+
+        size_t size() const { return lanes.size(); }
+
+        const SweepResult &getResult(size_t point) const { return lanes[point].result; }
+
+        int getThreads() const { return workers.size(); }
+
+        uint64_t getEvents() const { return events; }
+
+        uint64_t getPackets() const { return packets; }
+};
+
+#endif
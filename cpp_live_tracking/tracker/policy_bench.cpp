@@ -0,0 +1,327 @@
+#include "tracker.hpp"
+#include <cluster_workload.hpp>
+
+#include <memory>
+#include <span>
+#include <vector>
+
+// Microbenchmarks of the policy-built trackers (see tracker_policies.hpp) against the same trackers
+// written out by hand for one combination, over the workload's events
+// Both sides share the blurred surface, the pool and the cluster updates, they only differ in how the
+// per-event loop is put together, which is what the policies must not slow down. The hand-written
+// versions have no stage timers, configure with -DTRACKER_STATS=OFF to compare like with like
+// Build with optimisations on, see benchmark/README.md in the repository root
+
+// events made once per run, enough that the tracker is only rebuilt now and then
+static const size_t streamEvents = 1 << 20;
+
+static std::vector<dv::Event> makeStream(int bees, int64_t rate) {
+    std::vector<dv::Event> events;
+    events.reserve(streamEvents);
+    for (const workload::SyntheticEvent &event : workload::makeEvents(streamEvents, bees, rate)) {
+        events.emplace_back(event.timestamp, event.x, event.y, event.polarity);
+    }
+    return events;
+}
+
+// The parts of BasicTracker<double> the hand-written versions share, without crossing records,
+// config changes or stats
+class HandWrittenTracker {
+    protected:
+        cv::Size resolution;
+        TrackerConfig config;
+        EntranceBox entrance;
+        BasicBlurPyramid<double> tsBlurred;
+        ClusterPool<BasicCluster<double>> clusters;
+
+        std::vector<double> posX, posY, alpha, distances, velX, velY, radius;
+        std::vector<unsigned int> clusterEvents;
+
+        // Cluster::updateFreq's state by pool slot, only the delay wingbeat loop uses it
+        struct Wingbeat {
+            int64_t prevTime{-1};
+            int transitionCount{0};
+            float runningAvg{0.0};
+            bool prevPol{true};
+        };
+        std::vector<Wingbeat> wingbeats;
+
+        int64_t nextTime{-1}, nextSustain{-1}, prevTime{-1};
+        int totalCrossing{0};
+
+        void loadMotion() {
+            for (size_t i = 0; i < clusters.size(); i++) {
+                BasicClusterMotion<double> motion = clusters[i].getMotion();
+                posX[i] = motion.x;
+                posY[i] = motion.y;
+                velX[i] = motion.velX;
+                velY[i] = motion.velY;
+                radius[i] = motion.radius;
+                alpha[i] = motion.alpha;
+                clusterEvents[i] = motion.eventCount;
+            }
+        }
+
+        void storeMotion() {
+            for (size_t i = 0; i < clusters.size(); i++) {
+                clusters[i].setMotion({posX[i], posY[i], velX[i], velY[i], radius[i], alpha[i], clusterEvents[i]});
+            }
+        }
+
+        void startTimes(int64_t timeStamp) {
+            if (prevTime < 0) {
+                prevTime = timeStamp;
+            }
+            if (nextTime < 0) {
+                nextTime = timeStamp;
+            }
+            if (nextSustain < 0) {
+                nextSustain = timeStamp;
+            }
+        }
+
+        bool updateDue(int64_t timeStamp) {
+            if (timeStamp > nextTime) {
+                nextTime += config.delayTime;
+                return true;
+            }
+            return false;
+        }
+
+        void tick(int64_t timeStamp, bool centerLine) {
+            if (timeStamp > nextSustain) {
+                nextSustain += config.clusterSustainTime;
+                for (size_t i = clusters.size(); i > 0; i--) {
+                    if (!clusters[i - 1].aboveThreshold(config.clusterSustainThresh, resolution.width, resolution.height)) {
+                        clusters.removeAt(i - 1);
+                    } else {
+                        clusters[i - 1].resetEvents();
+                    }
+                }
+            }
+
+            if ((int)clusters.size() < config.maxClusters) {
+                int blurScale = tsBlurred.getBlurScale();
+                tsBlurred.forEachAbove(config.clusterInitThresh, [this, blurScale](int col, int row) {
+                    for (BasicCluster<double> &cluster : clusters) {
+                        if (cluster.otherClusterRange(col * blurScale, row * blurScale)) {
+                            return true;
+                        }
+                    }
+                    ClusterHandle handle = clusters.emplace(col * blurScale, row * blurScale, cv::viz::Color::red(), config.alpha);
+                    if (handle.valid()) {
+                        wingbeats[handle.slot] = {};
+                    }
+                    return (int)clusters.size() < config.maxClusters;
+                });
+            }
+
+            for (BasicCluster<double> &cluster : clusters) {
+                cluster.updateVelocity(config.delayTime);
+                cluster.updateRadius(config.radiusShrink);
+                int side = centerLine ? cluster.getCenterLineSide(resolution.width) : cluster.getSide(entrance);
+                totalCrossing += abs(cluster.crossTo(side));
+            }
+        }
+
+    public:
+        explicit HandWrittenTracker(cv::Size resolution, int capacity = constants::maxClusters)
+            : resolution(resolution),
+              tsBlurred(resolution, config.blurScale, config.blurLevels, config.scaleFactor, config.blurIncreaseFactor),
+              clusters(capacity),
+              posX(capacity), posY(capacity), alpha(capacity), distances(capacity), velX(capacity), velY(capacity), radius(capacity),
+              clusterEvents(capacity), wingbeats(capacity) {
+            config.maxClusters = std::min(config.maxClusters, capacity);
+            entrance = config.entrance(resolution);
+        }
+
+        int getTotalCrossing() const { return totalCrossing; }
+};
+
+// LiveTrackingPolicies: Chebyshev distance, entrance box, off events only, no wingbeat
+class HandWrittenLive : public HandWrittenTracker {
+    private:
+        bool step(int64_t timeStamp, uint16_t x, uint16_t y, bool polarity) {
+            startTimes(timeStamp);
+
+            if (!polarity) {
+                tsBlurred.increment(x, y);
+
+                const size_t count = clusters.size();
+                const double eventX = x, eventY = y;
+                const int64_t elapsed = timeStamp - prevTime;
+                const double radiusGrowth = (float)config.radiusGrowth;
+
+                for (size_t i = 0; i < count; i++) {
+                    distances[i] = std::max(std::fabs(eventX - posX[i]), std::fabs(eventY - posY[i]));
+                }
+                for (size_t i = 0; i < count; i++) {
+                    posX[i] = posX[i] + velX[i] * elapsed;
+                    posY[i] = posY[i] + velY[i] * elapsed;
+                }
+
+                int minCluster = -1;
+                double minDistance = resolution.width + resolution.height;
+                for (size_t i = 0; i < count; i++) {
+                    if (distances[i] < minDistance) {
+                        minDistance = distances[i];
+                        minCluster = i;
+                    }
+                }
+
+                if (minCluster >= 0) {
+                    double distance = std::max(std::fabs(eventX - posX[minCluster]), std::fabs(eventY - posY[minCluster]));
+                    if (distance < radius[minCluster]) {
+                        posX[minCluster] = (1 - alpha[minCluster]) * posX[minCluster] + alpha[minCluster] * eventX;
+                        posY[minCluster] = (1 - alpha[minCluster]) * posY[minCluster] + alpha[minCluster] * eventY;
+                        clusterEvents[minCluster]++;
+                    } else if (distance < radius[minCluster] * 1.33) {
+                        radius[minCluster] *= radiusGrowth * ((40 - radius[minCluster]) / 15);
+                    }
+                }
+                prevTime = timeStamp;
+            }
+
+            tsBlurred.decay();
+            return updateDue(timeStamp);
+        }
+
+    public:
+        using HandWrittenTracker::HandWrittenTracker;
+
+        void processEvents(std::span<const dv::Event> events) {
+            loadMotion();
+            for (const dv::Event &event : events) {
+                if (step(event.timestamp(), event.x(), event.y(), event.polarity())) {
+                    storeMotion();
+                    tick(event.timestamp(), false);
+                    loadMotion();
+                }
+            }
+            storeMotion();
+        }
+};
+
+// DelayWingbeatPolicies: Chebyshev distance, center line, on events reach the wingbeat timer
+class HandWrittenDelayWingbeat : public HandWrittenTracker {
+    private:
+        bool step(int64_t timeStamp, uint16_t x, uint16_t y, bool polarity) {
+            startTimes(timeStamp);
+
+            if (!polarity) {
+                tsBlurred.increment(x, y);
+            }
+
+            const size_t count = clusters.size();
+            const double eventX = x, eventY = y;
+            const int64_t elapsed = timeStamp - prevTime;
+            const double radiusGrowth = (float)config.radiusGrowth;
+
+            for (size_t i = 0; i < count; i++) {
+                distances[i] = std::max(std::fabs(eventX - posX[i]), std::fabs(eventY - posY[i]));
+            }
+            if (!polarity) {
+                for (size_t i = 0; i < count; i++) {
+                    posX[i] = posX[i] + velX[i] * elapsed;
+                    posY[i] = posY[i] + velY[i] * elapsed;
+                }
+            }
+
+            int minCluster = -1;
+            double minDistance = resolution.width + resolution.height;
+            for (size_t i = 0; i < count; i++) {
+                if (distances[i] < minDistance) {
+                    minDistance = distances[i];
+                    minCluster = i;
+                }
+            }
+
+            if (minCluster >= 0) {
+                double distance = std::max(std::fabs(eventX - posX[minCluster]), std::fabs(eventY - posY[minCluster]));
+                if (distance < radius[minCluster]) {
+                    if (!polarity) {
+                        posX[minCluster] = (1 - alpha[minCluster]) * posX[minCluster] + alpha[minCluster] * eventX;
+                        posY[minCluster] = (1 - alpha[minCluster]) * posY[minCluster] + alpha[minCluster] * eventY;
+                        clusterEvents[minCluster]++;
+                    }
+
+                    Wingbeat &wingbeat = wingbeats[clusters.handleAt(minCluster).slot];
+                    if (polarity && !wingbeat.prevPol) {
+                        if (timeStamp - wingbeat.prevTime > 10000) {
+                            wingbeat.transitionCount = 0;
+                            wingbeat.runningAvg = 0;
+                            wingbeat.prevTime = 0;
+                        }
+                        if (wingbeat.prevTime > 0) {
+                            wingbeat.runningAvg = (7 * wingbeat.runningAvg + (timeStamp - wingbeat.prevTime)) / 8.0;
+                        }
+                        wingbeat.prevTime = timeStamp;
+                        wingbeat.transitionCount++;
+                    }
+                    wingbeat.prevPol = polarity;
+                } else if (!polarity && distance < radius[minCluster] * 1.33) {
+                    radius[minCluster] *= radiusGrowth * ((40 - radius[minCluster]) / 15);
+                }
+            }
+            if (!polarity) {
+                prevTime = timeStamp;
+            }
+
+            tsBlurred.decay();
+            return updateDue(timeStamp);
+        }
+
+    public:
+        using HandWrittenTracker::HandWrittenTracker;
+
+        void processEvents(std::span<const dv::Event> events) {
+            loadMotion();
+            for (const dv::Event &event : events) {
+                if (step(event.timestamp(), event.x(), event.y(), event.polarity())) {
+                    storeMotion();
+                    tick(event.timestamp(), true);
+                    loadMotion();
+                }
+            }
+            storeMotion();
+        }
+};
+
+template <typename TrackerType>
+void benchTrack(microbench::State &state) {
+    const std::vector<dv::Event> events = makeStream(state.arg(0), state.arg(1));
+    const cv::Size resolution(workload::width, workload::height);
+    auto tracker = std::make_unique<TrackerType>(resolution);
+
+    size_t next = 0;
+    while (state.keepRunning()) {
+        // the timestamps cannot start over with the same tracker
+        if (next + workload::blockSize > events.size()) {
+            state.pauseTiming();
+            tracker = std::make_unique<TrackerType>(resolution);
+            next = 0;
+            state.resumeTiming();
+        }
+        tracker->processEvents(std::span<const dv::Event>(events.data() + next, workload::blockSize));
+        next += workload::blockSize;
+    }
+    microbench::doNotOptimize(tracker->getTotalCrossing());
+    state.setItemsProcessed(state.iterations() * workload::blockSize);
+}
+
+template <typename TrackerType>
+void add(microbench::Suite &suite, const std::string &name) {
+    suite.add(name, benchTrack<TrackerType>).argNames({"bees", "rate"}).ranges({workload::clusterCounts, workload::eventRates});
+}
+
+int main(int argc, char *argv[]) {
+    microbench::Suite suite("cpp_live_tracking/tracker");
+    add<HandWrittenLive>(suite, "live/hand");
+    add<BasicTracker<double, LiveTrackingPolicies>>(suite, "live/policy");
+    add<HandWrittenDelayWingbeat>(suite, "delayWingbeat/hand");
+    add<BasicTracker<double, DelayWingbeatPolicies>>(suite, "delayWingbeat/policy");
+    // no hand-written loops for these, cluster_bench times the trees' own update_osc and addHistory+fft
+    add<BasicTracker<double, FourierWingbeatPolicies>>(suite, "fourierWingbeat/policy");
+    add<BasicTracker<double, ForcedOscillatorPolicies>>(suite, "forcedOscillator/policy");
+    return suite.run(argc, argv);
+}
@@ -0,0 +1,39 @@
+#include "read_ahead.hpp"
+
+#include <cstdio>
+#include <exception>
+
+std::string ReadAheadStats::summary() const {
+    char line[256];
+    snprintf(line, sizeof(line),
+        "Read-ahead: %d packets deep, %.1f queued on average (max %d), processing waited %.2f s for %llu packets, reading waited %.2f s for room",
+        depth, meanOccupancy(), maxOccupancy, processingStall, (unsigned long long)emptyWaits, readingStall);
+    return line;
+}
+
+ReadAhead::ReadAhead(dv::io::MonoCameraRecording &reader, int depth) : reader(reader), queue(depth) {
+    thread = std::thread(&ReadAhead::read, this);
+}
+
+ReadAhead::~ReadAhead() {
+    // a reader blocked on a full queue gives up, one in the middle of a packet finishes it first
+    queue.close();
+    thread.join();
+}
+
+void ReadAhead::read() {
+    // dv-processing reports a damaged file with an exception, which would end the program from this thread
+    try {
+        while (auto events = reader.getNextEventBatch()) {
+            if (events->isEmpty()) {
+                continue;
+            }
+            if (!queue.push(std::move(*events))) {
+                break;
+            }
+        }
+    } catch (const std::exception &exception) {
+        error = exception.what();
+    }
+    queue.close();
+}
@@ -0,0 +1,138 @@
+#ifndef READ_AHEAD_H
+#define READ_AHEAD_H
+
+#include <object_detection/constants.hpp>
+
+#include <dv-processing/core/core.hpp>
+#include <dv-processing/io/mono_camera_recording.hpp>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// How well reading kept ahead of processing
+// Stall times are only measured when a side actually has to wait, the fast path takes no timestamps
+struct ReadAheadStats {
+    // packets that can be decoded and waiting at once
+    int depth{0};
+    uint64_t packets{0};
+    // packets already waiting each time the processing thread took one, summed, and the most seen
+    uint64_t occupancySum{0};
+    int maxOccupancy{0};
+    // the processing thread found nothing decoded (it is waiting on the disk or the decoder),
+    // or the reader found the queue full (processing is the bottleneck, which is the good case)
+    uint64_t emptyWaits{0}, fullWaits{0};
+    double processingStall{0}, readingStall{0};
+
+    double meanOccupancy() const { return packets > 0 ? (double)occupancySum / packets : 0; }
+
+    // one line for the run summary
+    std::string summary() const;
+};
+
+// Fixed capacity queue between one reading thread and one processing thread
+template <typename T>
+class BoundedQueue {
+    private:
+        std::vector<T> items;
+        size_t head{0}, count{0};
+        bool closed{false};
+        std::mutex mutex;
+        std::condition_variable notEmpty, notFull;
+        ReadAheadStats stats;
+
+    public:
+        explicit BoundedQueue(int capacity) : items(std::max(capacity, 1)) { stats.depth = (int)items.size(); }
+
+        // waits while the queue is full, returns false (and drops item) once the queue is closed
+        bool push(T &&item) {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (count == items.size() && !closed) {
+                auto start = std::chrono::steady_clock::now();
+                notFull.wait(lock, [this]() { return count < items.size() || closed; });
+                stats.fullWaits++;
+                stats.readingStall += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
+            if (closed) {
+                return false;
+            }
+            items[(head + count) % items.size()] = std::move(item);
+            count++;
+            lock.unlock();
+            notEmpty.notify_one();
+            return true;
+        }
+
+        // waits while the queue is empty, returns false once it is closed and everything has been taken
+        bool pop(T &item) {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (count == 0 && !closed) {
+                auto start = std::chrono::steady_clock::now();
+                notEmpty.wait(lock, [this]() { return count > 0 || closed; });
+                stats.emptyWaits++;
+                stats.processingStall += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
+            if (count == 0) {
+                return false;
+            }
+            stats.packets++;
+            stats.occupancySum += count;
+            stats.maxOccupancy = std::max(stats.maxOccupancy, (int)count);
+            item = std::move(items[head]);
+            head = (head + 1) % items.size();
+            count--;
+            lock.unlock();
+            notFull.notify_one();
+            return true;
+        }
+
+        // no more pushes, pop() still drains what is queued
+        void close() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                closed = true;
+            }
+            notEmpty.notify_all();
+            notFull.notify_all();
+        }
+
+        ReadAheadStats getStats() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return stats;
+        }
+};
+
+// Reads and decodes the event packets of a recording on its own thread, up to depth packets ahead of
+// the processing thread, so slow storage and decoding overlap with tracking instead of adding to it
+// Replaces reader.run(handler) in the file front ends: the handler is called with each packet from next()
+class ReadAhead {
+    private:
+        dv::io::MonoCameraRecording &reader;
+        BoundedQueue<dv::EventStore> queue;
+        std::string error;
+        std::thread thread;
+
+        void read();
+
+    public:
+        ReadAhead(dv::io::MonoCameraRecording &reader, int depth = constants::readAhead);
+
+        ~ReadAhead();
+
+        ReadAhead(const ReadAhead &) = delete;
+        ReadAhead &operator=(const ReadAhead &) = delete;
+
+        // the next packet of events, false at the end of the recording
+        bool next(dv::EventStore &events) { return queue.pop(events); }
+
+        // why reading stopped before the end of the recording, only meaningful once next() returned false
+        const std::string &getError() const { return error; }
+
+        ReadAheadStats getStats() { return queue.getStats(); }
+};
+
+#endif
@@ -0,0 +1,149 @@
+#include "recording_compactor.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+
+bool parseCompactionArgument(const std::string &argument, CompactionConfig &config, bool &ok) {
+    size_t equals = argument.find('=');
+    std::string name = argument.substr(0, equals);
+    std::string value = equals == std::string::npos ? "" : argument.substr(equals + 1);
+    char *end = nullptr;
+    double number = std::strtod(value.c_str(), &end);
+    bool numeric = !value.empty() && *end == '\0' && number >= 0;
+
+    if (name == "--rotate-mb") {
+        config.rotateMegabytes = number;
+        ok = numeric;
+    } else if (name == "--rotate-minutes") {
+        config.rotateMinutes = number;
+        ok = numeric;
+    } else if (name == "--filter") {
+        config.filter = true;
+        ok = value.empty();
+    } else if (name == "--margin") {
+        config.margin = number;
+        ok = numeric;
+    } else if (name == "--pre-roll") {
+        config.preRoll = (int)(number * 1000);
+        ok = numeric;
+    } else if (name == "--compression") {
+        static const std::map<std::string, dv::CompressionType> types = {
+            {"none", dv::CompressionType::NONE},
+            {"lz4", dv::CompressionType::LZ4},
+            {"lz4-high", dv::CompressionType::LZ4_HIGH},
+            {"zstd", dv::CompressionType::ZSTD},
+            {"zstd-high", dv::CompressionType::ZSTD_HIGH},
+        };
+        auto type = types.find(value);
+        ok = type != types.end();
+        if (ok) {
+            config.compression = type->second;
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+RecordingCompactor::RecordingCompactor(const std::string &prefix, const std::string &cameraName, cv::Size resolution,
+    const CompactionConfig &config) : config(config), prefix(prefix), cameraName(cameraName), resolution(resolution) {
+    kept.elements.reserve(keptChunk);
+}
+
+void RecordingCompactor::write(const dv::EventStore &events, const Tracker &tracker) {
+    if (events.isEmpty()) {
+        return;
+    }
+    eventsIn += events.size();
+    if (!config.filter) {
+        eventsKept += events.size();
+        writeOut(events);
+        return;
+    }
+
+    pending.push_back(events);
+    const int64_t decideBefore = events.getHighestTime() - config.preRoll;
+    while (!pending.empty() && pending.front().getHighestTime() < decideBefore) {
+        decide(pending.front(), tracker);
+        pending.pop_front();
+    }
+}
+
+void RecordingCompactor::finish(const Tracker &tracker) {
+    while (!pending.empty()) {
+        decide(pending.front(), tracker);
+        pending.pop_front();
+    }
+    writer.reset();
+}
+
+void RecordingCompactor::decide(const dv::EventStore &events, const Tracker &tracker) {
+    const EntranceBox &entrance = tracker.getEntrance();
+    const double left = entrance.left - config.margin, right = entrance.right + config.margin;
+    const double top = entrance.top - config.margin, bottom = entrance.bottom + config.margin;
+
+    keepCircles.clear();
+    for (const Cluster &cluster : tracker.getClusters()) {
+        ClusterMotion motion = cluster.getMotion();
+        double reach = numeric::toDouble(motion.radius) + config.margin;
+        keepCircles.push_back({numeric::toDouble(motion.x), numeric::toDouble(motion.y), reach * reach});
+    }
+
+    for (const dv::Event &event : events) {
+        const double x = event.x(), y = event.y();
+        bool keep = x >= left && x <= right && y >= top && y <= bottom;
+        for (size_t i = 0; i < keepCircles.size() && !keep; i++) {
+            double dx = x - keepCircles[i].x, dy = y - keepCircles[i].y;
+            keep = dx * dx + dy * dy <= keepCircles[i].reachSquared;
+        }
+        if (keep) {
+            kept.elements.push_back(event);
+            if (kept.elements.size() == keptChunk) {
+                writeKept();
+            }
+        }
+    }
+    writeKept();
+}
+
+void RecordingCompactor::writeKept() {
+    if (kept.elements.empty()) {
+        return;
+    }
+    eventsKept += kept.elements.size();
+    prepareFile(kept.elements.front().timestamp());
+    writer->writeEventPacket(kept);
+    kept.elements.clear();
+}
+
+void RecordingCompactor::writeOut(const dv::EventStore &events) {
+    prepareFile(events.getLowestTime());
+    writer->writeEvents(events);
+}
+
+void RecordingCompactor::prepareFile(int64_t firstTime) {
+    // the size check goes by what has reached the file, the writer's buffer only adds a little on top
+    bool rotate = false;
+    if (writer && config.rotateMegabytes > 0) {
+        std::error_code error;
+        uint64_t size = std::filesystem::file_size(currentPath, error);
+        rotate = !error && size >= config.rotateMegabytes * 1e6;
+    }
+    if (writer && config.rotateMinutes > 0) {
+        rotate = rotate || firstTime - fileStart >= (int64_t)(config.rotateMinutes * 60e6);
+    }
+
+    if (!writer || rotate) {
+        // the old file is finished (and its data table written) before the next one is opened
+        writer.reset();
+        char number[16];
+        snprintf(number, sizeof(number), "_%03zu", files.size() + 1);
+        currentPath = prefix + number + ".aedat4";
+        auto writerConfig = dv::io::MonoCameraWriter::EventOnlyConfig(cameraName, resolution, config.compression);
+        writer = std::make_unique<dv::io::MonoCameraWriter>(currentPath, writerConfig);
+        files.push_back(currentPath);
+        fileStart = firstTime;
+    }
+}
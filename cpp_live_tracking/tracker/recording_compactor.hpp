@@ -0,0 +1,92 @@
+#ifndef RECORDING_COMPACTOR_H
+#define RECORDING_COMPACTOR_H
+
+#include "tracker.hpp"
+
+#include <dv-processing/core/core.hpp>
+#include <dv-processing/io/mono_camera_writer.hpp>
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+// How a recording is split into files and which events are kept
+struct CompactionConfig {
+    // start a new file once the current one reaches this size or covers this long, 0 for never
+    double rotateMegabytes{0};
+    double rotateMinutes{0};
+    // keep only the events inside the entrance box grown by margin pixels, or within margin pixels of a cluster
+    bool filter{false};
+    double margin{30};
+    // microseconds an event is held back before deciding, so the events a cluster is born from are
+    // still there to be kept once the tracker has created it
+    int preRoll{250000};
+    dv::CompressionType compression{dv::CompressionType::LZ4};
+};
+
+// Reads --rotate-mb=, --rotate-minutes=, --filter, --margin=, --pre-roll= (milliseconds) and
+// --compression=none|lz4|lz4-high|zstd|zstd-high, returns false for any other argument
+// ok is set to false if the value cannot be read
+bool parseCompactionArgument(const std::string &argument, CompactionConfig &config, bool &ok);
+
+// Writes a stream of event packets to prefix_001.aedat4, prefix_002.aedat4, ... starting a new file
+// at a packet boundary whenever the size or time limit is reached
+// With filtering on, events away from the entrance and from every cluster are dropped, these are
+// mostly noise and bees that never come near the box. The caller runs the tracker on every event and
+// passes it in with each packet, each event is then kept or dropped preRoll later using the clusters
+// the tracker has by then.
+class RecordingCompactor {
+    public:
+        static constexpr size_t keptChunk = 1 << 14;
+
+    private:
+        CompactionConfig config;
+        std::string prefix, cameraName;
+        cv::Size resolution;
+
+        std::unique_ptr<dv::io::MonoCameraWriter> writer;
+        std::string currentPath;
+        std::vector<std::string> files;
+        int64_t fileStart{-1};
+
+        // packets waiting out the pre-roll
+        std::deque<dv::EventStore> pending;
+        // the clusters at decision time, with the squared distance an event can be from them and be kept
+        struct KeepCircle {
+            double x, y, reachSquared;
+        };
+        std::vector<KeepCircle> keepCircles;
+        // the events decide() keeps, sized once and written out whenever it fills up
+        dv::EventPacket kept;
+
+        uint64_t eventsIn{0}, eventsKept{0};
+
+        void decide(const dv::EventStore &events, const Tracker &tracker);
+
+        // opens the first file, or the next one when the current one is over its limits
+        void prepareFile(int64_t firstTime);
+
+        void writeOut(const dv::EventStore &events);
+
+        void writeKept();
+
+    public:
+        RecordingCompactor(const std::string &prefix, const std::string &cameraName, cv::Size resolution, const CompactionConfig &config);
+
+        // tracker has already processed events
+        void write(const dv::EventStore &events, const Tracker &tracker);
+
+        // decides and writes everything still held back, and closes the current file
+        void finish(const Tracker &tracker);
+
+        // every file started so far, in order
+        const std::vector<std::string> &getFiles() const { return files; }
+
+        uint64_t getEventsIn() const { return eventsIn; }
+
+        uint64_t getEventsKept() const { return eventsKept; }
+};
+
+#endif
@@ -0,0 +1,318 @@
+#include "recording_index.hpp"
+#include "mapped_recording.hpp"
+#include "recording_reader.hpp"
+#include "binary_io.hpp"
+#include "checkpoint.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+const uint32_t indexVersion = 1;
+// offset, first and last timestamp and event count of one packet in the file
+const uint64_t packetBytes = 8 + 8 + 8 + 4;
+
+} // namespace
+
+std::string recordingIndexPath(const std::string &recording) {
+    return recording + ".index";
+}
+
+bool recordingStamp(const std::string &recording, uint64_t &size, int64_t &time) {
+    std::error_code error;
+    size = std::filesystem::file_size(recording, error);
+    if (error) {
+        return false;
+    }
+    time = std::filesystem::last_write_time(recording, error).time_since_epoch().count();
+    return !error;
+}
+
+bool RecordingIndex::open(const std::string &recording) {
+    uint64_t size;
+    int64_t time;
+    if (!recordingStamp(recording, size, time)) {
+        std::cerr << "Could not find recording: " << recording << std::endl;
+        return false;
+    }
+
+    const std::string indexPath = recordingIndexPath(recording);
+    if (load(indexPath) && fileSize == size && fileTime == time) {
+        return true;
+    }
+
+    std::cout << "Indexing " << recording << " (once, the index is kept in " << indexPath << ")" << std::endl;
+    if (!build(recording)) {
+        return false;
+    }
+    fileSize = size;
+    fileTime = time;
+    // the recording can still be used without a saved index, it just gets indexed again next time
+    if (!save(indexPath)) {
+        std::cerr << "Could not save the recording index to " << indexPath << std::endl;
+    }
+    return true;
+}
+
+bool RecordingIndex::build(const std::string &recording) {
+    MappedRecording reader(recording);
+    if (!reader.isOpen()) {
+        std::cerr << "Could not index " << recording << ": " << reader.getError() << std::endl;
+        return false;
+    }
+
+    packets.clear();
+    perSecond.clear();
+    int64_t start = -1;
+    std::span<const dv::Event> events;
+    while (reader.next(events)) {
+        if (events.empty()) {
+            continue;
+        }
+        packets.push_back({reader.getPacketOffset(), events.front().timestamp(), events.back().timestamp(), (uint32_t)events.size()});
+
+        if (start < 0) {
+            start = events.front().timestamp();
+        }
+        for (const dv::Event &event : events) {
+            size_t second = (size_t)std::max<int64_t>(0, (event.timestamp() - start) / 1000000);
+            if (second >= perSecond.size()) {
+                perSecond.resize(second + 1, 0);
+            }
+            perSecond[second]++;
+        }
+    }
+
+    // a damaged end still leaves everything before it usable
+    if (!reader.getError().empty()) {
+        std::cerr << "Indexed " << recording << " up to a damaged packet: " << reader.getError() << std::endl;
+    }
+    return true;
+}
+
+bool RecordingIndex::load(const std::string &indexPath) {
+    std::error_code error;
+    const uint64_t indexSize = std::filesystem::file_size(indexPath, error);
+    std::ifstream in(indexPath, std::ios::binary);
+    if (error || !in.is_open()) {
+        return false;
+    }
+    // the counts are checked against what is left of the file before anything is sized by them,
+    // so a damaged index is rebuilt instead of asking for more memory than there is
+    auto bytesLeft = [&in, indexSize]() {
+        std::streamoff position = in.tellg();
+        return position < 0 || (uint64_t)position > indexSize ? 0 : indexSize - (uint64_t)position;
+    };
+    char magic[4];
+    uint32_t version;
+    uint64_t packetCount, secondCount;
+    if (!in.read(magic, 4) || std::string(magic, 4) != "RIDX" || !readValue(in, version) || version != indexVersion
+        || !readValue(in, fileSize) || !readValue(in, fileTime) || !readValue(in, packetCount)
+        || packetCount > bytesLeft() / packetBytes) {
+        return false;
+    }
+
+    packets.resize(packetCount);
+    for (IndexedPacket &packet : packets) {
+        if (!readValue(in, packet.offset) || !readValue(in, packet.firstTime) || !readValue(in, packet.lastTime)
+            || !readValue(in, packet.events)) {
+            return false;
+        }
+    }
+    if (!readValue(in, secondCount) || secondCount > bytesLeft() / sizeof(uint32_t)) {
+        return false;
+    }
+    perSecond.resize(secondCount);
+    for (uint32_t &count : perSecond) {
+        if (!readValue(in, count)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool RecordingIndex::save(const std::string &indexPath) const {
+    // written beside the final name and renamed, so a tool stopped halfway never leaves half an index
+    const std::string partial = indexPath + ".partial";
+    {
+        std::ofstream out(partial, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            return false;
+        }
+        out.write("RIDX", 4);
+        writeValue<uint32_t>(out, indexVersion);
+        writeValue<uint64_t>(out, fileSize);
+        writeValue<int64_t>(out, fileTime);
+        writeValue<uint64_t>(out, packets.size());
+        for (const IndexedPacket &packet : packets) {
+            writeValue<uint64_t>(out, packet.offset);
+            writeValue<int64_t>(out, packet.firstTime);
+            writeValue<int64_t>(out, packet.lastTime);
+            writeValue<uint32_t>(out, packet.events);
+        }
+        writeValue<uint64_t>(out, perSecond.size());
+        for (uint32_t count : perSecond) {
+            writeValue<uint32_t>(out, count);
+        }
+        if (!out.good()) {
+            return false;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(partial, indexPath, error);
+    return !error;
+}
+
+size_t RecordingIndex::find(int64_t timestamp) const {
+    if (packets.empty()) {
+        return 0;
+    }
+    auto packet = std::lower_bound(packets.begin(), packets.end(), timestamp,
+        [](const IndexedPacket &packet, int64_t time) { return packet.lastTime < time; });
+    if (packet == packets.end()) {
+        packet--;
+    }
+    return packet - packets.begin();
+}
+
+uint64_t RecordingIndex::countEvents(int64_t from, int64_t to) const {
+    int64_t first = std::max<int64_t>(0, (from - getStartTime()) / 1000000);
+    int64_t last = std::min<int64_t>((int64_t)perSecond.size(), (to - getStartTime() + 999999) / 1000000);
+    uint64_t total = 0;
+    for (int64_t second = first; second < last; second++) {
+        total += perSecond[second];
+    }
+    return total;
+}
+
+bool parseRecordingTime(const std::string &text, int64_t &micros) {
+    // up to three fields split by ':', the last one may have a fraction
+    double total = 0;
+    size_t start = 0;
+    int fields = 0;
+    while (true) {
+        size_t colon = text.find(':', start);
+        std::string field = text.substr(start, colon == std::string::npos ? std::string::npos : colon - start);
+        char *end = nullptr;
+        double value = std::strtod(field.c_str(), &end);
+        if (field.empty() || *end != '\0' || value < 0 || ++fields > 3) {
+            return false;
+        }
+        total = total * 60 + value;
+        if (colon == std::string::npos) {
+            break;
+        }
+        start = colon + 1;
+    }
+    micros = (int64_t)(total * 1e6);
+    return true;
+}
+
+std::span<const dv::Event> clipEvents(std::span<const dv::Event> events, int64_t from, int64_t to) {
+    auto begin = std::lower_bound(events.begin(), events.end(), from,
+        [](const dv::Event &event, int64_t time) { return event.timestamp() < time; });
+    auto end = std::lower_bound(begin, events.end(), to,
+        [](const dv::Event &event, int64_t time) { return event.timestamp() < time; });
+    return events.subspan(begin - events.begin(), end - begin);
+}
+
+bool RecordingRange::parseArgument(const std::string &argument, bool &ok) {
+    int64_t *target;
+    size_t length;
+    if (argument.rfind("--start=", 0) == 0) {
+        target = &startOffset;
+        length = 8;
+    } else if (argument.rfind("--end=", 0) == 0) {
+        target = &endOffset;
+        length = 6;
+    } else {
+        return false;
+    }
+    ok = parseRecordingTime(argument.substr(length), *target);
+    if (ok && endOffset >= 0 && endOffset < startOffset) {
+        std::cerr << "The end of the range (--end=) is before its start (--start=)" << std::endl;
+        ok = false;
+    }
+    requested = true;
+    return true;
+}
+
+bool RecordingRange::seek(RecordingReader &reader, const std::string &recording) {
+    if (!requested) {
+        return true;
+    }
+    if (!reader.isMapped()) {
+        const int64_t start = reader.getStartTime();
+        from = start + startOffset;
+        to = endOffset >= 0 ? start + endOffset : std::numeric_limits<int64_t>::max();
+        printf("Reading through to %.1f s (--reader=mapped seeks there with the recording index)\n", startOffset / 1e6);
+        return true;
+    }
+
+    RecordingIndex index;
+    if (!index.open(recording)) {
+        return false;
+    }
+    from = index.getStartTime() + startOffset;
+    to = endOffset >= 0 ? index.getStartTime() + endOffset : std::numeric_limits<int64_t>::max();
+
+    const int64_t end = std::min(to, index.getEndTime() + 1);
+    printf("Seeking to %.1f s of %.1f s, about %llu events up to %.1f s\n", startOffset / 1e6,
+        (index.getEndTime() - index.getStartTime()) / 1e6, (unsigned long long)index.countEvents(from, end),
+        (end - index.getStartTime()) / 1e6);
+    if (index.isEmpty()) {
+        return true;
+    }
+    const size_t packet = index.find(from);
+    return reader.seek((int64_t)packet, index.getPackets()[packet].offset);
+}
+
+bool resumeRecording(RecordingReader &reader, const std::string &recording, const std::string &checkpoint,
+    const CheckpointPosition &position) {
+    uint64_t size;
+    int64_t time;
+    if (!recordingStamp(recording, size, time)) {
+        std::cerr << "Could not find recording: " << recording << std::endl;
+        return false;
+    }
+    if (position.recordingSize == 0) {
+        std::cerr << "The checkpoint " << checkpoint << " was not taken on a recording" << std::endl;
+        return false;
+    }
+    if (position.recordingSize != size) {
+        std::cerr << "The checkpoint " << checkpoint << " is not from " << recording << ", it was taken on a recording of "
+            << position.recordingSize << " bytes and this one has " << size << std::endl;
+        return false;
+    }
+    if (position.recordingTime != time) {
+        std::cerr << "The checkpoint " << checkpoint << " is not from " << recording << " as it is now, the recording was "
+            << "written to after the checkpoint was taken" << std::endl;
+        return false;
+    }
+
+    // the dv reader reads through to the packet, the mapped reader jumps to it and so has to land on one
+    // a checkpoint taken with the dv reader only has the packet's number, the index has where it starts
+    uint64_t offset = position.packetOffset;
+    if (reader.isMapped()) {
+        RecordingIndex index;
+        if (!index.open(recording)) {
+            return false;
+        }
+        const int64_t number = position.packetNumber;
+        if (number < 0 || (uint64_t)number >= index.getPackets().size() || (offset != 0 && !index.isPacket(number, offset))) {
+            std::cerr << "The checkpoint " << checkpoint << " stopped in packet " << number << " at byte " << offset
+                << ", which is not where the index of " << recording << " has it" << std::endl;
+            return false;
+        }
+        offset = index.getPackets()[number].offset;
+    }
+    if (!reader.seek(position.packetNumber, offset)) {
+        std::cerr << "Could not carry on from " << checkpoint << " in " << recording << ": " << reader.getError() << std::endl;
+        return false;
+    }
+    return true;
+}
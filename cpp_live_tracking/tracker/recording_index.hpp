@@ -0,0 +1,123 @@
+#ifndef RECORDING_INDEX_H
+#define RECORDING_INDEX_H
+
+#include <dv-processing/core/core.hpp>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <string>
+#include <vector>
+
+// one event packet of a recording
+struct IndexedPacket {
+    uint64_t offset;
+    int64_t firstTime, lastTime;
+    uint32_t events;
+};
+
+// Where every event packet of a recording starts and which timestamps it holds, plus how many events
+// fall in each second, so the file tools can start anywhere in a recording with the mapped reader
+// The index is kept next to the recording (event_log.aedat4.index) and built the first time it is
+// needed, it is rebuilt when the recording's size or modification time no longer match
+class RecordingIndex {
+    private:
+        std::vector<IndexedPacket> packets;
+        // events in each second from the first event on
+        std::vector<uint32_t> perSecond;
+        uint64_t fileSize{0};
+        int64_t fileTime{0};
+
+        bool load(const std::string &indexPath);
+
+        bool save(const std::string &indexPath) const;
+
+    public:
+        // loads the recording's index, or builds and saves it, returns false (after printing why) if neither works
+        bool open(const std::string &recording);
+
+        // reads the whole recording, does not touch the index file
+        bool build(const std::string &recording);
+
+        const std::vector<IndexedPacket> &getPackets() const { return packets; }
+
+        const std::vector<uint32_t> &getPerSecond() const { return perSecond; }
+
+        bool isEmpty() const { return packets.empty(); }
+
+        int64_t getStartTime() const { return packets.empty() ? 0 : packets.front().firstTime; }
+
+        int64_t getEndTime() const { return packets.empty() ? 0 : packets.back().lastTime; }
+
+        // true if packet number starts at offset, so a checkpoint's packet is one of this recording's
+        bool isPacket(int64_t number, uint64_t offset) const {
+            return number >= 0 && (uint64_t)number < packets.size() && packets[number].offset == offset;
+        }
+
+        // number of the first packet with events at or after timestamp, for RecordingReader::seek
+        // past the end of the recording it returns the last packet, which clipEvents then empties
+        size_t find(int64_t timestamp) const;
+
+        // events between two timestamps, to whole seconds
+        uint64_t countEvents(int64_t from, int64_t to) const;
+};
+
+// path of the index kept for a recording
+std::string recordingIndexPath(const std::string &recording);
+
+// a recording's size and modification time, which tell whether it is still the one an index or a
+// checkpoint was made from; false if the file is not there
+bool recordingStamp(const std::string &recording, uint64_t &size, int64_t &time);
+
+// reads a time into a recording given as seconds ("10800", "90.5"), minutes and seconds ("180:00")
+// or hours, minutes and seconds ("3:00:00"), in microseconds
+bool parseRecordingTime(const std::string &text, int64_t &micros);
+
+// the part of a packet with from <= timestamp < to, the events in a packet are in time order
+std::span<const dv::Event> clipEvents(std::span<const dv::Event> events, int64_t from, int64_t to);
+
+class RecordingReader;
+struct CheckpointPosition;
+
+// Moves reader to where a checkpoint taken on recording stopped, after checking that the checkpoint
+// is from this recording (its size and modification time) and, for the mapped reader, that its packet
+// starts where the recording's index has one. Returns false after printing why it cannot
+bool resumeRecording(RecordingReader &reader, const std::string &recording, const std::string &checkpoint,
+    const CheckpointPosition &position);
+
+// The part of a recording a file tool works on, from --start=<time> and --end=<time> arguments
+// counted from the first event of the recording. Without either one it is the whole recording
+class RecordingRange {
+    private:
+        int64_t startOffset{0}, endOffset{-1};
+        bool requested{false};
+        // absolute timestamps, worked out by seek()
+        int64_t from{std::numeric_limits<int64_t>::min()};
+        int64_t to{std::numeric_limits<int64_t>::max()};
+
+    public:
+        // takes --start= and --end= arguments, returns false for any other argument
+        // ok is set to false if the time cannot be read, or if the end is before the start
+        bool parseArgument(const std::string &argument, bool &ok);
+
+        bool isRequested() const { return requested; }
+
+        // works out where the range starts and moves reader there: the mapped reader seeks with the
+        // recording's index (building it the first time), the dv reader reads through the packets
+        // before it, which clip() empties. Does nothing for the whole recording, returns false if the
+        // index cannot be built
+        bool seek(RecordingReader &reader, const std::string &recording);
+
+        // the events of a packet that are in the range
+        std::span<const dv::Event> clip(std::span<const dv::Event> events) const {
+            return requested ? clipEvents(events, from, to) : events;
+        }
+
+        // true once the reader has gone past the end of the range
+        bool isPast(std::span<const dv::Event> events) const { return !events.empty() && events.front().timestamp() >= to; }
+
+        int64_t getFrom() const { return from; }
+
+        int64_t getTo() const { return to; }
+};
+
+#endif
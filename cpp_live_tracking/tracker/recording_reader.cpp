@@ -0,0 +1,158 @@
+#include "recording_reader.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+
+bool parseReaderArgument(const std::string &argument, ReaderKind &kind, bool &ok) {
+    if (argument.rfind("--reader=", 0) != 0) {
+        return false;
+    }
+    const std::string value = argument.substr(9);
+    ok = value == "dv" || value == "mapped";
+    kind = value == "mapped" ? ReaderKind::mapped : ReaderKind::dv;
+    return true;
+}
+
+RecordingReader::RecordingReader(const std::string &path, ReaderKind kind, int depth) {
+    if (kind == ReaderKind::mapped) {
+        mapped = std::make_unique<MappedRecording>(path, depth);
+        if (mapped->isOpen()) {
+            resolution = mapped->getEventResolution();
+        }
+        return;
+    }
+
+    // dv-processing reports a file it cannot read with an exception
+    try {
+        recording = std::make_unique<dv::io::MonoCameraRecording>(path);
+        if (!recording->isEventStreamAvailable()) {
+            error = "no event stream in " + path;
+            return;
+        }
+        resolution = recording->getEventResolution();
+    } catch (const std::exception &exception) {
+        error = exception.what();
+        resolution.reset();
+        return;
+    }
+    if (!resolution.has_value()) {
+        error = "no event resolution in " + path;
+        return;
+    }
+    readAhead = std::make_unique<ReadAhead>(*recording, depth);
+}
+
+std::string RecordingReader::getError() {
+    if (mapped) {
+        return mapped->getError();
+    }
+    // the read-ahead thread only stops writing its error once it has nothing more to hand out
+    if (error.empty() && finished) {
+        return readAhead->getError();
+    }
+    return error;
+}
+
+bool RecordingReader::nextStore(dv::EventStore &store) {
+    if (hasPending) {
+        store = std::move(pending);
+        hasPending = false;
+        return true;
+    }
+    if (!readAhead || finished) {
+        return false;
+    }
+    if (!readAhead->next(store)) {
+        finished = true;
+        return false;
+    }
+    if (startTime < 0) {
+        startTime = store.getLowestTime();
+    }
+    return true;
+}
+
+bool RecordingReader::next(std::span<const dv::Event> &events) {
+    if (mapped) {
+        while (mapped->next(events)) {
+            if (!events.empty()) {
+                packetNumber++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    if (!nextStore(packet)) {
+        return false;
+    }
+    packetNumber++;
+    // a packet read from a file is one block, a store put together from several is copied into one
+    const size_t size = packet.size();
+    const dv::Event *first = &packet.front();
+    if ((uintptr_t)&packet.back() - (uintptr_t)first == (size - 1) * sizeof(dv::Event)) {
+        events = std::span<const dv::Event>(first, size);
+    } else {
+        copy.assign(packet.begin(), packet.end());
+        events = copy;
+    }
+    return true;
+}
+
+bool RecordingReader::next(dv::EventStore &store) {
+    if (mapped) {
+        std::span<const dv::Event> events;
+        if (!next(events)) {
+            return false;
+        }
+        store = dv::EventStore();
+        for (const dv::Event &event : events) {
+            store.emplace_back(event.timestamp(), event.x(), event.y(), event.polarity());
+        }
+        return true;
+    }
+
+    if (!nextStore(store)) {
+        return false;
+    }
+    packetNumber++;
+    return true;
+}
+
+bool RecordingReader::seek(int64_t number, size_t offset) {
+    if (mapped) {
+        if (!mapped->seek(offset)) {
+            return false;
+        }
+        packetNumber = number - 1;
+        return true;
+    }
+
+    if (number <= packetNumber) {
+        error = "cannot go back to packet " + std::to_string(number) + " with the dv reader";
+        return false;
+    }
+    while (packetNumber + 1 < number) {
+        if (!nextStore(packet)) {
+            error = "the recording ends before packet " + std::to_string(number);
+            return false;
+        }
+        packetNumber++;
+    }
+    return true;
+}
+
+int64_t RecordingReader::getStartTime() {
+    if (!mapped && startTime < 0 && !hasPending) {
+        hasPending = nextStore(pending);
+    }
+    return std::max<int64_t>(startTime, 0);
+}
+
+ReadAheadStats RecordingReader::getStats() {
+    if (mapped) {
+        return mapped->getStats();
+    }
+    return readAhead ? readAhead->getStats() : ReadAheadStats{};
+}
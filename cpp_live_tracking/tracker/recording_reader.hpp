@@ -0,0 +1,95 @@
+#ifndef RECORDING_READER_H
+#define RECORDING_READER_H
+
+#include "mapped_recording.hpp"
+#include "read_ahead.hpp"
+
+#include <dv-processing/core/core.hpp>
+#include <dv-processing/io/mono_camera_recording.hpp>
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+// Which reader the file tools read a recording with
+enum class ReaderKind { dv, mapped };
+
+// Reads --reader=dv|mapped, returns false for any other argument, ok is set to false for an unknown reader
+bool parseReaderArgument(const std::string &argument, ReaderKind &kind, bool &ok);
+
+// The event packets of a recording for the file tools
+// By default they are read by dv::io::MonoCameraRecording on a ReadAhead thread, --reader=mapped reads
+// them with MappedRecording instead. The mapped reader stays opt-in until reader_bench --check has
+// passed on uncompressed, LZ4 and ZSTD recordings from the dv Recorder (see the README)
+// Either way next() hands out the events of each packet that has any, in the order they are in the file,
+// and counts them from 0 so a checkpoint finds its packet again whichever reader wrote it
+class RecordingReader {
+    private:
+        std::unique_ptr<MappedRecording> mapped;
+        std::unique_ptr<dv::io::MonoCameraRecording> recording;
+        std::unique_ptr<ReadAhead> readAhead;
+        std::optional<cv::Size> resolution;
+        std::string error;
+
+        // the packet next() handed out last, and one taken early by getStartTime()
+        dv::EventStore packet, pending;
+        bool hasPending{false};
+        // events of a packet that are not in one block of memory are copied here
+        std::vector<dv::Event> copy;
+        int64_t packetNumber{-1};
+        int64_t startTime{-1};
+        // the dv reader has handed out its last packet, its error can be read
+        bool finished{false};
+
+        // the next packet from the dv reader, with getStartTime()'s one first
+        bool nextStore(dv::EventStore &store);
+
+    public:
+        // depth is how many packets are read ahead of the caller
+        RecordingReader(const std::string &path, ReaderKind kind, int depth = constants::readAhead);
+
+        RecordingReader(const RecordingReader &) = delete;
+        RecordingReader &operator=(const RecordingReader &) = delete;
+
+        // false if the file could not be read as a recording with an event stream
+        bool isOpen() const { return resolution.has_value(); }
+
+        bool isMapped() const { return mapped != nullptr; }
+
+        // what went wrong, empty while nothing has
+        std::string getError();
+
+        std::optional<cv::Size> getEventResolution() const { return resolution; }
+
+        // the events of the next packet with any, valid until the following call to next() or seek()
+        // returns false at the end of the recording or on a damaged packet (getError() says which)
+        bool next(std::span<const dv::Event> &events);
+
+        // the next packet with any as a store the caller keeps, for a caller that holds on to packets
+        // The dv reader hands over the packet it read, sharing its memory, the mapped reader reuses its
+        // buffers so its events are copied into a new store
+        bool next(dv::EventStore &store);
+
+        // the packet handed out by the last next(), counted from 0 at the start of the recording
+        int64_t getPacketNumber() const { return packetNumber; }
+
+        // where that packet starts in the file, mapped reader only (0 for the dv reader)
+        size_t getPacketOffset() const { return mapped ? mapped->getPacketOffset() : 0; }
+
+        // moves on so the next packet handed out is packet number, which starts at offset in the file
+        // the mapped reader seeks there (offset from a RecordingIndex or a checkpoint), the dv reader
+        // reads through the packets before it and cannot go back; false if the packet is not there
+        bool seek(int64_t number, size_t offset);
+
+        // timestamp of the first event, the dv reader reads the first packet early to find it
+        // 0 for the mapped reader, which has RecordingIndex for it
+        int64_t getStartTime();
+
+        // how far reading kept ahead of the caller
+        ReadAheadStats getStats();
+};
+
+#endif
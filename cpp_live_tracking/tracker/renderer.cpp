@@ -0,0 +1,93 @@
+#include "renderer.hpp"
+#include <opencv2/highgui.hpp>
+#include <opencv2/imgproc.hpp>
+
+Renderer::Renderer(const std::string &windowName, cv::Size resolution, size_t maxClusters) {
+    this->windowName = windowName;
+    this->resolution = resolution;
+
+    this->surface = TimeSurface(resolution);
+
+    // size every buffer up front so submitting a snapshot does not allocate
+    for (RenderSnapshot &snapshot : snapshots) {
+        snapshot.surfaceEvents.reserve(maxSurfaceEvents);
+        snapshot.clusters.reserve(maxClusters);
+    }
+}
+
+void Renderer::submit(const Tracker &tracker, int64_t timestamp) {
+    RenderSnapshot &snapshot = snapshots.writeBuffer();
+
+    snapshot.timestamp = timestamp;
+    snapshot.totalCrossing = tracker.getTotalCrossing();
+    snapshot.netCrossing = tracker.getNetCrossing();
+    snapshot.entrance = tracker.getEntrance();
+
+    snapshot.clusters.clear();
+    for (const Cluster &cluster : tracker.getClusters()) {
+        snapshot.clusters.push_back({cluster.getX(), cluster.getY(), cluster.getRadius(), cluster.getID(), cluster.getColor()});
+    }
+
+    framesSubmitted++;
+    // replacing an unread snapshot would lose its events, so this one keeps them and is overwritten next time
+    if (snapshots.unread()) {
+        framesDropped++;
+        return;
+    }
+    snapshots.publish();
+
+    // the buffer handed back has been drawn, its events are already in the renderer's time surface
+    RenderSnapshot &next = snapshots.writeBuffer();
+    next.surfaceEvents.clear();
+    next.extraFrames = 0;
+}
+
+void Renderer::run() {
+    cv::namedWindow(windowName);
+    cv::Mat surfaceImg(resolution.height, resolution.width, CV_8UC1, cv::Scalar(0));
+    cv::Mat trackImg(resolution.height, resolution.width, CV_8UC3, cv::Scalar(1));
+
+    while (running) {
+        if (snapshots.acquire()) {
+            const RenderSnapshot &snapshot = snapshots.readBuffer();
+#if TRACKER_STATS
+            uint64_t begin = readTicks();
+#endif
+
+            for (uint32_t entry : snapshot.surfaceEvents) {
+                if (entry == frameEnd) {
+                    surface.nextFrame();
+                } else {
+                    surface.addEvent(entry & 0xFFFF, entry >> 16);
+                }
+            }
+            for (int i = 0; i < snapshot.extraFrames; i++) {
+                surface.nextFrame();
+            }
+
+            // the decay is only worked out here, for frames that are actually shown
+            surface.render(surfaceImg);
+            cv::cvtColor(surfaceImg, trackImg, cv::COLOR_GRAY2BGR);
+            drawEntrance(trackImg, snapshot.entrance);
+
+            // draw each cluster
+            for (const ClusterSnapshot &cluster : snapshot.clusters) {
+                cv::rectangle(
+                    trackImg,
+                    cv::Point(int(cluster.x - cluster.radius / 2), int(cluster.y - cluster.radius / 2)),
+                    cv::Point(int(cluster.x + cluster.radius / 2), int(cluster.y + cluster.radius / 2)),
+                    cluster.color);
+            }
+
+            cv::imshow(windowName, trackImg);
+            framesRendered++;
+#if TRACKER_STATS
+            if (renderCounter) {
+                renderCounter->add(readTicks() - begin);
+            }
+#endif
+        }
+        // also sleeps until the next check when there is nothing new
+        cv::waitKey(1);
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include "tracker.hpp"
+#include "time_surface.hpp"
+#include "triple_buffer.hpp"
+
+#include <opencv2/core.hpp>
+#include <opencv2/viz/types.hpp>
+#include <atomic>
+#include <string>
+#include <vector>
+
+// what the renderer needs to draw one cluster
+struct ClusterSnapshot {
+    int x, y;
+    float radius;
+    int id;
+    cv::viz::Color color;
+};
+
+// an immutable copy of the tracker state at one point in time
+struct RenderSnapshot {
+    int64_t timestamp{0};
+    // the off events and frame ends since the snapshot before, in order, for the renderer's time surface
+    std::vector<uint32_t> surfaceEvents;
+    // frames that ended once surfaceEvents was full
+    int extraFrames{0};
+    std::vector<ClusterSnapshot> clusters;
+    EntranceBox entrance{};
+    int totalCrossing{0}, netCrossing{0};
+};
+
+// Shows the tracker window on its own thread so a slow GUI never holds up tracking
+// The tracking thread hands over the off events with addEvent() and calls submit() at the display rate,
+// which copies the clusters into a triple buffer and returns straight away. The time surface is kept on
+// the thread that calls run(), from the events in each snapshot, so the tracking thread never copies the
+// whole image. While the window has not caught up with the last snapshot, the next ones are not handed
+// over: their events pile up in the one being written and the frames in between are skipped.
+// OpenCV windows have to stay on one thread (the main thread on macOS), so the front ends call run()
+// from main and move the event processing onto a separate thread instead.
+class Renderer {
+    private:
+        // marks the end of a display frame in RenderSnapshot::surfaceEvents
+        static constexpr uint32_t frameEnd = 0xFFFFFFFF;
+
+        std::string windowName;
+        cv::Size resolution;
+        TripleBuffer<RenderSnapshot> snapshots;
+        // rendering thread only
+        TimeSurface surface;
+        std::atomic<bool> running{true};
+        std::atomic<int64_t> framesSubmitted{0}, framesDropped{0}, framesRendered{0}, eventsLost{0};
+        StageCounter *renderCounter{nullptr};
+
+    public:
+        // off events and frame ends one snapshot can hold, past that the window misses events
+        static constexpr size_t maxSurfaceEvents = 1 << 18;
+
+        Renderer(const std::string &windowName, cv::Size resolution, size_t maxClusters = constants::maxClusters);
+
+        // tracking thread: an off event for the time surface
+        void addEvent(uint16_t x, uint16_t y) {
+            RenderSnapshot &snapshot = snapshots.writeBuffer();
+            if (snapshot.surfaceEvents.size() < maxSurfaceEvents) {
+                snapshot.surfaceEvents.push_back((uint32_t)y << 16 | x);
+            } else {
+                eventsLost.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        // tracking thread: the time surface moves on to the next display frame
+        void nextFrame() {
+            RenderSnapshot &snapshot = snapshots.writeBuffer();
+            if (snapshot.surfaceEvents.size() < maxSurfaceEvents) {
+                snapshot.surfaceEvents.push_back(frameEnd);
+            } else {
+                snapshot.extraFrames++;
+            }
+        }
+
+        // tracking thread: copies the clusters and counts, never waits for the renderer
+        void submit(const Tracker &tracker, int64_t timestamp);
+
+        // rendering thread: draws snapshots until stop() is called
+        void run();
+
+        void stop() { running = false; }
+
+        // times each drawn frame into the render stage of a tracker's stats, call before run()
+        void reportTo(TrackerStats &stats) { renderCounter = &stats.stage(Stage::render); }
+
+        int64_t getFramesSubmitted() const { return framesSubmitted; }
+
+        int64_t getFramesDropped() const { return framesDropped; }
+
+        int64_t getFramesRendered() const { return framesRendered; }
+
+        // off events that did not fit in a snapshot while the window was behind
+        int64_t getEventsLost() const { return eventsLost; }
+};
+
+#endif
@@ -0,0 +1,127 @@
+#include "stats.hpp"
+#include <algorithm>
+
+static const char *stageNames[(int)Stage::count] = {"decay", "nearest_cluster", "birth", "sustain", "update", "logging", "render"};
+
+const char *stageName(Stage stage) {
+    return stageNames[(int)stage];
+}
+
+int Histogram::bucketOf(uint64_t value) {
+    if (value < subCount) {
+        return value;
+    }
+    // shift the value down until it is between halfCount and subCount
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - subBits + 1;
+    return subCount + (shift - 1) * halfCount + ((value >> shift) - halfCount);
+}
+
+uint64_t Histogram::bucketTop(int bucket) {
+    if (bucket < (int)subCount) {
+        return bucket;
+    }
+    int shift = (bucket - subCount) / halfCount + 1;
+    uint64_t sub = halfCount + (bucket - subCount) % halfCount;
+    return ((sub + 1) << shift) - 1;
+}
+
+uint64_t Histogram::percentile(double p) const {
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t rank = std::max<uint64_t>(1, (uint64_t)(p / 100.0 * total + 0.5));
+    uint64_t seen = 0;
+    for (int i = 0; i < bucketCount; i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return std::min(bucketTop(i), maxValue);
+        }
+    }
+    return maxValue;
+}
+
+void Histogram::reset() {
+    std::fill(counts, counts + bucketCount, 0);
+    total = sum = maxValue = 0;
+}
+
+double TrackerStats::elapsedSeconds() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void writeHistogramJson(std::ostream &out, const Histogram &histogram) {
+    out << "{\"count\":" << histogram.count() << ",\"mean\":" << histogram.mean()
+        << ",\"p50\":" << histogram.percentile(50) << ",\"p90\":" << histogram.percentile(90)
+        << ",\"p99\":" << histogram.percentile(99) << ",\"p999\":" << histogram.percentile(99.9)
+        << ",\"max\":" << histogram.max() << "}";
+}
+
+void TrackerStats::writeJson(std::ostream &out) const {
+    double seconds = elapsedSeconds();
+
+    out << "{\"elapsed_s\":" << seconds << ",\"events\":" << events << ",\"packets\":" << packets
+        << ",\"events_per_s\":" << (seconds > 0 ? events / seconds : 0.0)
+        << ",\"tick_unit\":\"" << tickUnit() << "\",\"stages\":{";
+    for (int i = 0; i < (int)Stage::count; i++) {
+        uint64_t ticks = stages[i].ticks.load(std::memory_order_relaxed);
+        uint64_t calls = stages[i].calls.load(std::memory_order_relaxed);
+        out << (i ? "," : "") << "\"" << stageNames[i] << "\":{\"ticks\":" << ticks << ",\"calls\":" << calls
+            << ",\"ticks_per_call\":" << (calls ? (double)ticks / calls : 0.0) << "}";
+    }
+    out << "},\"packet_latency_ns\":";
+    writeHistogramJson(out, packetLatency);
+    out << ",\"clusters\":";
+    writeHistogramJson(out, clusterCount);
+    out << "}";
+}
+
+template <typename T>
+static void writeValue(std::ostream &out, T value) {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+static void writeHistogramBinary(std::ostream &out, const Histogram &histogram) {
+    writeValue<uint64_t>(out, histogram.count());
+    writeValue<double>(out, histogram.mean());
+    for (double p : {50.0, 90.0, 99.0, 99.9}) {
+        writeValue<uint64_t>(out, histogram.percentile(p));
+    }
+    writeValue<uint64_t>(out, histogram.max());
+}
+
+void TrackerStats::writeBinary(std::ostream &out) const {
+    out.write("TRST", 4);
+    writeValue<uint32_t>(out, 1);
+    writeValue<double>(out, elapsedSeconds());
+    writeValue<uint64_t>(out, events);
+    writeValue<uint64_t>(out, packets);
+    writeValue<uint32_t>(out, (uint32_t)Stage::count);
+    for (const StageCounter &counter : stages) {
+        writeValue<uint64_t>(out, counter.ticks.load(std::memory_order_relaxed));
+        writeValue<uint64_t>(out, counter.calls.load(std::memory_order_relaxed));
+    }
+    writeHistogramBinary(out, packetLatency);
+    writeHistogramBinary(out, clusterCount);
+}
+
+StatsDump::StatsDump(const std::string &path, std::chrono::steady_clock::duration period, bool binary)
+    : period(period), next(std::chrono::steady_clock::now() + period), binary(binary) {
+#if TRACKER_STATS
+    file.open(path, binary ? std::ios::binary | std::ios::app : std::ios::app);
+#endif
+}
+
+void StatsDump::write(const TrackerStats &stats) {
+    next = std::chrono::steady_clock::now() + period;
+    if (!file.is_open()) {
+        return;
+    }
+    if (binary) {
+        stats.writeBinary(file);
+    } else {
+        stats.writeJson(file);
+        file << "\n";
+    }
+    file.flush();
+}
@@ -0,0 +1,178 @@
+#ifndef TRACKER_STATS_H
+#define TRACKER_STATS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <fstream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Instrumentation for the tracking engine
+// Building with TRACKER_STATS=0 (cmake -DTRACKER_STATS=OFF) removes every timer and counter update,
+// the structures below stay so the library and the tools agree on the Tracker layout either way.
+#ifndef TRACKER_STATS
+#define TRACKER_STATS 1
+#endif
+
+// cycles on x86, nanoseconds elsewhere (the ARM generic timer is too coarse for single events)
+inline uint64_t readTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+inline const char *tickUnit() {
+#if defined(__x86_64__) || defined(__i386__)
+    return "cycles";
+#else
+    return "ns";
+#endif
+}
+
+enum class Stage { decay, nearestCluster, birth, sustain, update, logging, render, count };
+
+const char *stageName(Stage stage);
+
+// time spent in one stage, written by one thread and safe to read from any other
+struct StageCounter {
+    std::atomic<uint64_t> ticks{0};
+    std::atomic<uint64_t> calls{0};
+
+    void add(uint64_t elapsed, uint64_t count = 1) {
+        // single writer, so a plain load and store is enough and avoids a locked add
+        ticks.store(ticks.load(std::memory_order_relaxed) + elapsed, std::memory_order_relaxed);
+        calls.store(calls.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+    }
+};
+
+// Log-linear histogram in the style of HdrHistogram: values below 64 are exact, above that each
+// power of two is split into 32 buckets, so any recorded value is known to within about 3%
+// Fixed size, recording never allocates
+class Histogram {
+    private:
+        static constexpr int subBits = 6;
+        static constexpr uint64_t subCount = 1 << subBits;
+        static constexpr uint64_t halfCount = subCount / 2;
+        static constexpr int bucketCount = subCount + (64 - subBits) * halfCount;
+
+        uint64_t counts[bucketCount]{};
+        uint64_t total{0}, sum{0}, maxValue{0};
+
+        static int bucketOf(uint64_t value);
+
+        // largest value that lands in a bucket
+        static uint64_t bucketTop(int bucket);
+
+    public:
+        void record(uint64_t value) {
+            counts[bucketOf(value)]++;
+            total++;
+            sum += value;
+            maxValue = value > maxValue ? value : maxValue;
+        }
+
+        // value that p percent of the recorded values are at or below, to bucket precision
+        uint64_t percentile(double p) const;
+
+        uint64_t count() const { return total; }
+
+        uint64_t max() const { return maxValue; }
+
+        double mean() const { return total ? (double)sum / total : 0.0; }
+
+        void reset();
+};
+
+// Everything the tracker measures about itself
+// The per-event stages are only timed on every sampleRate-th event and scaled up, reading the clock
+// around every event would cost more than the stages themselves
+class TrackerStats {
+    private:
+        StageCounter stages[(int)Stage::count];
+        std::chrono::steady_clock::time_point start{std::chrono::steady_clock::now()};
+
+    public:
+        static constexpr uint32_t sampleRate = 64;
+
+        uint64_t events{0}, packets{0};
+        // nanoseconds per processEvents call
+        Histogram packetLatency;
+        // number of clusters at each cluster update
+        Histogram clusterCount;
+
+        StageCounter &stage(Stage stage) { return stages[(int)stage]; }
+
+        const StageCounter &stage(Stage stage) const { return stages[(int)stage]; }
+
+        // sampled on the tracker's own event count, so the events in between need no bookkeeping
+        static bool sampleDue(int64_t eventIndex) { return (eventIndex & (sampleRate - 1)) == 0; }
+
+        // adds the ticks since since, scaled up to stand for the events that were not sampled,
+        // and returns the current tick count for the next stage
+        uint64_t addSample(Stage stage, uint64_t since) {
+            uint64_t now = readTicks();
+            stages[(int)stage].add((now - since) * sampleRate, sampleRate);
+            return now;
+        }
+
+        double elapsedSeconds() const;
+
+        void writeJson(std::ostream &out) const;
+
+        // little endian: "TRST", version, then the same fields as the JSON in a fixed order
+        void writeBinary(std::ostream &out) const;
+};
+
+// times a block for a stage counter
+class StageTimer {
+    private:
+        StageCounter &counter;
+        uint64_t begin;
+
+    public:
+        explicit StageTimer(StageCounter &counter) : counter(counter), begin(readTicks()) {}
+
+        ~StageTimer() { counter.add(readTicks() - begin); }
+};
+
+// Appends the stats to a file every period, one JSON object per line or binary records
+class StatsDump {
+    private:
+        std::ofstream file;
+        std::chrono::steady_clock::duration period;
+        std::chrono::steady_clock::time_point next;
+        bool binary;
+
+    public:
+        StatsDump(const std::string &path, std::chrono::steady_clock::duration period, bool binary = false);
+
+        // writes if the period is up, cheap enough to call after every packet
+        void update(const TrackerStats &stats) {
+#if TRACKER_STATS
+            if (std::chrono::steady_clock::now() >= next) {
+                write(stats);
+            }
+#endif
+        }
+
+        void write(const TrackerStats &stats);
+};
+
+#define TRACKER_CONCAT_INNER(a, b) a##b
+#define TRACKER_CONCAT(a, b) TRACKER_CONCAT_INNER(a, b)
+
+#if TRACKER_STATS
+// times the rest of the enclosing block into a StageCounter
+#define TRACKER_STAGE(counter) StageTimer TRACKER_CONCAT(stageTimer, __LINE__)(counter)
+#else
+#define TRACKER_STAGE(counter)
+#endif
+
+#endif
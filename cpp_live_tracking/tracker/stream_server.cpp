@@ -0,0 +1,172 @@
+#include "stream_server.hpp"
+
+#include <algorithm>
+#include <time.h>
+
+// packets queued on a stream ahead of its tracker, the backlog beyond that stays in the source,
+// where a camera drops packets once its buffer is full
+static const size_t maxQueued = 4;
+
+// CPU seconds a stream can save up while it is idle, as a share of its budget
+static const double budgetBurst = 0.1;
+
+// CPU time of the calling thread, so a turn is not charged for the time its thread was preempted
+static double threadSeconds() {
+    timespec time;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+StreamServer::StreamServer(int threads, uint64_t quantum) : quantum(std::max<uint64_t>(1, quantum)), pool(threads) {
+}
+
+StreamServer::~StreamServer() {
+    stop();
+}
+
+size_t StreamServer::addStream(const StreamConfig &config, std::unique_ptr<EventSource> source,
+    const TrackerConfig &trackerConfig) {
+    auto stream = std::make_unique<Stream>();
+    stream->config = config;
+    stream->stats.name = config.name;
+    stream->lag = SensorLag(config.speed);
+    stream->tracker = std::make_unique<Tracker>(source->getEventResolution().value());
+    stream->tracker->setConfig(trackerConfig);
+    stream->source = std::move(source);
+    streams.push_back(std::move(stream));
+    return streams.size() - 1;
+}
+
+void StreamServer::start() {
+    Clock::time_point now = Clock::now();
+    for (auto &stream : streams) {
+        stream->earnedAt = now;
+        stream->credit = stream->config.cpuBudget * budgetBurst;
+    }
+    dispatcher = std::thread(&StreamServer::dispatch, this);
+}
+
+void StreamServer::stop() {
+    stopping = true;
+    if (dispatcher.joinable()) {
+        dispatcher.join();
+    }
+    for (auto &stream : streams) {
+        std::lock_guard<std::mutex> lock(stream->mutex);
+        stream->queued.clear();
+    }
+    done = true;
+}
+
+void StreamServer::dispatch() {
+    while (!stopping) {
+        bool busy = false, finished = true;
+        for (auto &pointer : streams) {
+            Stream &stream = *pointer;
+            // only this thread touches the sources, the lock is for what the turns share
+            bool room;
+            {
+                std::lock_guard<std::mutex> lock(stream.mutex);
+                room = !stream.sourceDone && stream.queued.size() < maxQueued;
+            }
+            if (room) {
+                std::optional<dv::EventStore> packet = stream.source->getNextEventBatch();
+                std::lock_guard<std::mutex> lock(stream.mutex);
+                if (packet.has_value()) {
+                    busy = true;
+                    if (stream.stats.packets == 0 && stream.queued.empty() && !stream.scheduled) {
+                        stream.firstPacket = Clock::now();
+                    }
+                    if (!packet.value().isEmpty()) {
+                        stream.queued.push_back(std::move(packet.value()));
+                    }
+                } else if (!stream.source->isRunning()) {
+                    stream.sourceDone = true;
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(stream.mutex);
+            if (!stream.scheduled && !stream.queued.empty()) {
+                double budget = stream.config.cpuBudget;
+                if (budget > 0) {
+                    Clock::time_point now = Clock::now();
+                    stream.credit = std::min(stream.credit + budget * std::chrono::duration<double>(now - stream.earnedAt).count(),
+                        budget * budgetBurst);
+                    stream.earnedAt = now;
+                }
+                if (budget > 0 && stream.credit < 0) {
+                    stream.stats.throttled += stream.held ? 0 : 1;
+                    stream.held = true;
+                } else {
+                    stream.held = false;
+                    stream.scheduled = true;
+                    pool.submit([this, &stream]() { turn(stream); });
+                }
+            }
+            finished = finished && stream.sourceDone && stream.queued.empty() && !stream.scheduled;
+        }
+        if (finished) {
+            done = true;
+            return;
+        }
+        if (!busy) {
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+        }
+    }
+}
+
+void StreamServer::turn(Stream &stream) {
+    double cpuStart = threadSeconds();
+    uint64_t tracked = 0;
+    while (tracked < quantum) {
+        dv::EventStore packet;
+        {
+            std::lock_guard<std::mutex> lock(stream.mutex);
+            if (stream.queued.empty()) {
+                break;
+            }
+            packet = std::move(stream.queued.front());
+            stream.queued.pop_front();
+        }
+        int64_t lag = stream.lag.update(packet.getHighestTime());
+        stream.tracker->processEvents(packet);
+        tracked += packet.size();
+
+        std::lock_guard<std::mutex> lock(stream.mutex);
+        stream.stats.packets++;
+        stream.stats.events += packet.size();
+        stream.stats.lag = lag;
+        stream.stats.maxLag = stream.lag.getMax();
+    }
+    double cpu = threadSeconds() - cpuStart;
+
+    std::lock_guard<std::mutex> lock(stream.mutex);
+    stream.stats.cpuSeconds += cpu;
+    stream.credit -= cpu;
+    stream.stats.totalCrossing = stream.tracker->getTotalCrossing();
+    stream.stats.netCrossing = stream.tracker->getNetCrossing();
+    stream.stats.seconds = std::chrono::duration<double>(Clock::now() - stream.firstPacket).count();
+    stream.scheduled = false;
+}
+
+std::vector<StreamStats> StreamServer::getStats() {
+    std::vector<StreamStats> all;
+    for (auto &stream : streams) {
+        StreamStats stats;
+        {
+            std::lock_guard<std::mutex> lock(stream->mutex);
+            stats = stream->stats;
+            stats.finished = stream->sourceDone && stream->queued.empty() && !stream->scheduled;
+            if (stats.packets > 0 && !stats.finished) {
+                stats.seconds = std::chrono::duration<double>(Clock::now() - stream->firstPacket).count();
+            }
+        }
+        if (auto *camera = dynamic_cast<VirtualCamera *>(stream->source.get())) {
+            VirtualCameraStats cameraStats = camera->getStats();
+            stats.droppedPackets = cameraStats.droppedPackets;
+            stats.droppedEvents = cameraStats.droppedEvents;
+        }
+        all.push_back(stats);
+    }
+    return all;
+}
@@ -0,0 +1,123 @@
+#ifndef STREAM_SERVER_H
+#define STREAM_SERVER_H
+
+#include "event_source.hpp"
+#include "load_governor.hpp"
+#include "tracker.hpp"
+#include "tracker_config.hpp"
+#include "work_stealing_pool.hpp"
+
+#include <dv-processing/core/core.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct StreamConfig {
+    std::string name;
+    // how fast the source plays compared with real time, for the lag, 0 for as fast as possible
+    double speed{1};
+    // share of one core the stream may use, 0 for no limit
+    // A stream over its budget waits until it has earned the time back, so one busy hive falls behind
+    // (and its camera drops packets) instead of slowing down the others.
+    double cpuBudget{0};
+};
+
+struct StreamStats {
+    std::string name;
+    uint64_t packets{0}, events{0};
+    // packets and events the source dropped because the stream did not take them in time, only known
+    // for a VirtualCamera
+    uint64_t droppedPackets{0}, droppedEvents{0};
+    // microseconds the stream is behind its sensor now and at most, see SensorLag
+    int64_t lag{0}, maxLag{0};
+    // thread CPU seconds spent tracking, and wall seconds since the first packet
+    double cpuSeconds{0}, seconds{0};
+    // times the stream had to wait for its turn because it was over its CPU budget
+    uint64_t throttled{0};
+    int totalCrossing{0}, netCrossing{0};
+    bool finished{false};
+
+    double eventRate() const { return seconds > 0 ? events / seconds : 0.0; }
+
+    // share of one core used
+    double cpuShare() const { return seconds > 0 ? cpuSeconds / seconds : 0.0; }
+};
+
+// Tracks several independent streams (hives) in one process on a shared WorkStealingPool
+// A dispatcher thread polls every source and queues the packets that arrived on their stream. A
+// stream with queued packets is handed to the pool as one task, a turn, which tracks up to quantum
+// events and then hands the stream back, so the streams take turns on the threads however busy they
+// are and a stream is only ever tracked by one thread at a time. Streams are added before start().
+class StreamServer {
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Stream {
+            StreamConfig config;
+            std::unique_ptr<EventSource> source;
+            std::unique_ptr<Tracker> tracker;
+            SensorLag lag;
+
+            std::mutex mutex;
+            std::deque<dv::EventStore> queued;
+            // a turn is queued on the pool or running
+            bool scheduled{false};
+            bool sourceDone{false};
+            // waiting for its budget, so a wait is counted once in throttled
+            bool held{false};
+            // CPU seconds the stream may still use, earned at cpuBudget per wall second
+            double credit{0};
+            Clock::time_point earnedAt, firstPacket;
+            StreamStats stats;
+        };
+
+        std::vector<std::unique_ptr<Stream>> streams;
+        uint64_t quantum;
+        WorkStealingPool pool;
+
+        std::thread dispatcher;
+        std::atomic<bool> stopping{false}, done{false};
+
+        void dispatch();
+
+        // tracks queued packets of the stream until quantum events are done or none are left
+        void turn(Stream &stream);
+
+    public:
+        // threads 0 uses every core, quantum is the events a stream tracks in a turn
+        explicit StreamServer(int threads = 0, uint64_t quantum = 65536);
+
+        ~StreamServer();
+
+        StreamServer(const StreamServer &) = delete;
+        StreamServer &operator=(const StreamServer &) = delete;
+
+        // the tracker is set up for the resolution of the source, returns the index of the stream
+        size_t addStream(const StreamConfig &config, std::unique_ptr<EventSource> source,
+            const TrackerConfig &trackerConfig);
+
+        void start();
+
+        // false once every source has finished and every packet is tracked
+        bool isRunning() const { return !done; }
+
+        // stops taking packets from the sources, the packets already queued are dropped
+        void stop();
+
+        size_t size() const { return streams.size(); }
+
+        int getThreads() const { return pool.size(); }
+
+        uint64_t getSteals() const { return pool.getSteals(); }
+
+        // can be called while the server is running
+        std::vector<StreamStats> getStats();
+};
+
+#endif
@@ -0,0 +1,145 @@
+#include "synthetic_scene.hpp"
+#include <algorithm>
+#include <sstream>
+
+bool parseSyntheticScene(const std::string &spec, SyntheticSceneConfig &config) {
+    std::stringstream list(spec);
+    std::string item;
+    while (std::getline(list, item, ',')) {
+        if (item.empty()) {
+            continue;
+        }
+        size_t equals = item.find('=');
+        if (equals == std::string::npos) {
+            return false;
+        }
+        std::string name = item.substr(0, equals);
+        std::istringstream value(item.substr(equals + 1));
+
+        bool ok;
+        if (name == "width") {
+            ok = (bool)(value >> config.resolution.width);
+        } else if (name == "height") {
+            ok = (bool)(value >> config.resolution.height);
+        } else if (name == "bees") {
+            ok = (bool)(value >> config.bees);
+        } else if (name == "seconds") {
+            ok = (bool)(value >> config.seconds);
+        } else if (name == "beeRate") {
+            ok = (bool)(value >> config.beeRate);
+        } else if (name == "noiseRate") {
+            ok = (bool)(value >> config.noiseRate);
+        } else if (name == "packetTime") {
+            ok = (bool)(value >> config.packetTime);
+        } else if (name == "seed") {
+            ok = (bool)(value >> config.seed);
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return config.resolution.width > 0 && config.resolution.height > 0 && config.packetTime > 0;
+}
+
+SyntheticScene::SyntheticScene(const SyntheticSceneConfig &config)
+    : config(config), state(config.seed * 0x9E3779B97F4A7C15ull + 1), sceneEnd((int64_t)(config.seconds * 1000000)) {
+    const double width = config.resolution.width, height = config.resolution.height;
+    const double boxCenter = width * (constants::entranceLeft + constants::entranceRight) / 2;
+
+    // spread the bees over the scene so a few are in view at once, and leave time for the last one to land
+    const int64_t flightTime = 1500000;
+    const int64_t spacing = config.bees > 0 ? std::max<int64_t>(0, sceneEnd - 2 * flightTime) / config.bees : 0;
+    for (int i = 0; i < config.bees; i++) {
+        Bee bee;
+        bee.start = i * spacing + below(500000);
+        bee.end = bee.start + flightTime - 500000 + below(1000000);
+
+        // from the open air on the left to the middle of the entrance, or back out again
+        double outsideX = width * constants::entranceLeft * (0.2 + 0.3 * unit());
+        double outsideY = height * (0.3 + 0.4 * unit());
+        double insideX = boxCenter + width * 0.05 * (unit() - 0.5);
+        double insideY = height * (0.4 + 0.2 * unit());
+        if (i % 2 == 0) {
+            bee.x0 = outsideX, bee.y0 = outsideY, bee.x1 = insideX, bee.y1 = insideY;
+        } else {
+            bee.x0 = insideX, bee.y0 = insideY, bee.x1 = outsideX, bee.y1 = outsideY;
+        }
+        bees.push_back(bee);
+    }
+}
+
+uint64_t SyntheticScene::next() {
+    // xorshift64*
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545F4914F6CDD1Dull;
+}
+
+void SyntheticScene::addEvent(int64_t timestamp, double x, double y) {
+    int px = (int)x, py = (int)y;
+    if (px < 0 || py < 0 || px >= config.resolution.width || py >= config.resolution.height) {
+        return;
+    }
+    // a third of the events are on events, as with real bees
+    pending.emplace_back(timestamp, (int16_t)px, (int16_t)py, (uint8_t)(below(3) == 0));
+}
+
+bool SyntheticScene::nextPacket(dv::EventStore &packet) {
+    if (packetStart >= sceneEnd) {
+        return false;
+    }
+    const int64_t packetEnd = std::min<int64_t>(packetStart + config.packetTime, sceneEnd);
+    const int64_t duration = packetEnd - packetStart;
+    pending.clear();
+
+    for (const Bee &bee : bees) {
+        if (bee.end <= packetStart || bee.start >= packetEnd) {
+            continue;
+        }
+        int count = (int)((int64_t)config.beeRate * duration / 1000000);
+        for (int i = 0; i < count; i++) {
+            int64_t timestamp = packetStart + below((int)duration);
+            if (timestamp < bee.start || timestamp >= bee.end) {
+                continue;
+            }
+            double progress = (double)(timestamp - bee.start) / (double)(bee.end - bee.start);
+            // a bee is about 12 pixels across
+            // (one draw per statement, the order function arguments are worked out in is up to the compiler)
+            int offsetX = below(13) - 6;
+            int offsetY = below(13) - 6;
+            addEvent(timestamp, bee.x0 + (bee.x1 - bee.x0) * progress + offsetX, bee.y0 + (bee.y1 - bee.y0) * progress + offsetY);
+        }
+    }
+
+    int noise = (int)((int64_t)config.noiseRate * duration / 1000000);
+    for (int i = 0; i < noise; i++) {
+        int64_t timestamp = packetStart + below((int)duration);
+        int x = below(config.resolution.width);
+        int y = below(config.resolution.height);
+        addEvent(timestamp, x, y);
+    }
+
+    // the full key keeps the order the same whichever sort the standard library uses
+    std::sort(pending.begin(), pending.end(), [](const dv::Event &a, const dv::Event &b) {
+        if (a.timestamp() != b.timestamp()) {
+            return a.timestamp() < b.timestamp();
+        }
+        if (a.x() != b.x()) {
+            return a.x() < b.x();
+        }
+        if (a.y() != b.y()) {
+            return a.y() < b.y();
+        }
+        return a.polarity() < b.polarity();
+    });
+
+    packet = dv::EventStore();
+    for (const dv::Event &event : pending) {
+        packet.emplace_back(event.timestamp(), event.x(), event.y(), event.polarity());
+    }
+    packetStart = packetEnd;
+    return true;
+}
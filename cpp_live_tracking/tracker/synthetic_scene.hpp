@@ -0,0 +1,65 @@
+#ifndef SYNTHETIC_SCENE_H
+#define SYNTHETIC_SCENE_H
+
+#include <object_detection/constants.hpp>
+
+#include <dv-processing/core/core.hpp>
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// What a generated recording looks like
+struct SyntheticSceneConfig {
+    cv::Size resolution{640, 480};
+    // bees over the whole scene, every bee flies straight into the entrance box or straight out of it
+    int bees{6};
+    double seconds{20};
+    // events per second from each bee, and from noise spread over the whole sensor
+    int beeRate{20000};
+    int noiseRate{20000};
+    // microseconds of events in each packet
+    int packetTime{2000};
+    uint64_t seed{1};
+};
+
+// Reads a comma separated list of settings, such as "bees=6,seconds=20,seed=1", into config
+// The names are the SyntheticSceneConfig fields plus width and height. Returns false on anything else
+bool parseSyntheticScene(const std::string &spec, SyntheticSceneConfig &config);
+
+// Generates a recording of bees crossing the default entrance box, for replaying without a camera
+// or a recording. The same config gives the same events on every platform: the random numbers come
+// from a fixed generator instead of the standard library distributions (which differ between
+// implementations) and the positions only use + - * and /.
+class SyntheticScene {
+    private:
+        // a straight flight from (x0, y0) at start to (x1, y1) at end, times in microseconds
+        struct Bee {
+            int64_t start, end;
+            double x0, y0, x1, y1;
+        };
+
+        SyntheticSceneConfig config;
+        std::vector<Bee> bees;
+        std::vector<dv::Event> pending;
+        uint64_t state;
+        int64_t packetStart{0}, sceneEnd;
+
+        uint64_t next();
+
+        int below(int limit) { return (int)(next() % (uint64_t)limit); }
+
+        double unit() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+
+        void addEvent(int64_t timestamp, double x, double y);
+
+    public:
+        explicit SyntheticScene(const SyntheticSceneConfig &config);
+
+        // fills packet with the next packetTime of events, returns false once the scene is over
+        bool nextPacket(dv::EventStore &packet);
+
+        const SyntheticSceneConfig &getConfig() const { return config; }
+};
+
+#endif
@@ -0,0 +1,48 @@
+#include "time_surface.hpp"
+#include <algorithm>
+#include <cmath>
+
+TimeSurface::TimeSurface(cv::Size resolution, double decayFactor) {
+    ageLut = cv::Mat(1, 256, CV_8UC1, cv::Scalar(0));
+    clampLut = cv::Mat(1, 256, CV_8UC1, cv::Scalar(0));
+    renderLut = cv::Mat(1, 256, CV_8UC1, cv::Scalar(0));
+
+    // an event is drawn at full brightness and loses decayFactor of it every frame after
+    double brightness = 255.0;
+    for (int age = 0; age < maxAge; age++) {
+        ageLut.at<uint8_t>(0, age) = (uint8_t)std::lround(brightness);
+        brightness *= decayFactor;
+    }
+
+    // start with every pixel old enough to be dark
+    stamps = cv::Mat(resolution, CV_8UC1, cv::Scalar((uint8_t)(frame - maxAge)));
+}
+
+void TimeSurface::nextFrame() {
+    frame++;
+    frameCount++;
+
+    // Frame numbers wrap after 256 frames, so the pixels that are already black are moved back to
+    // exactly maxAge frames old. Each frame does one band of rows, every row comes round once every
+    // maxAge frames
+    for (int stamp = 0; stamp < 256; stamp++) {
+        uint8_t age = frame - stamp;
+        clampLut.at<uint8_t>(0, stamp) = age < maxAge ? stamp : (uint8_t)(frame - maxAge);
+    }
+    const int band = (stamps.rows + maxAge - 1) / maxAge;
+    const int first = std::min(stamps.rows, (int)(frameCount % maxAge) * band);
+    const int last = std::min(stamps.rows, first + band);
+    if (first < last) {
+        cv::Mat rows = stamps.rowRange(first, last);
+        cv::LUT(rows, clampLut, rows);
+    }
+}
+
+void TimeSurface::render(cv::Mat &img) const {
+    // turn the age lookup into a lookup by frame number for the current frame
+    for (int stamp = 0; stamp < 256; stamp++) {
+        uint8_t age = frame - stamp;
+        renderLut.at<uint8_t>(0, stamp) = ageLut.at<uint8_t>(0, age);
+    }
+    cv::LUT(stamps, renderLut, img);
+}
@@ -0,0 +1,48 @@
+#ifndef TIME_SURFACE_H
+#define TIME_SURFACE_H
+
+#include <object_detection/constants.hpp>
+
+#include <opencv2/core.hpp>
+#include <cstdint>
+
+// The time surface shown in the tracker window
+// Instead of an image that is written for every event and multiplied down every frame, each pixel
+// keeps the (8 bit, wrapping) number of the display frame it last saw an OFF event in.
+// An event writes one byte, and advancing a frame bumps a counter and passes a table over one band of
+// rows. The decayed image is worked out from the age of each pixel through a lookup table, and only
+// when a frame is actually drawn.
+class TimeSurface {
+    private:
+        // pixels older than this many frames are drawn black
+        // stale pixels are pulled back to this age once every maxAge frames, a band of rows at a time, so
+        // no pixel ever looks more than 2 * maxAge frames old and the wrapping frame numbers are never ambiguous
+        static constexpr int maxAge = 64;
+
+        cv::Mat stamps;
+        // brightness of a pixel by how many frames old it is
+        cv::Mat ageLut;
+        cv::Mat clampLut;
+        // filled in by render(), kept so drawing a frame does not allocate
+        mutable cv::Mat renderLut;
+        uint8_t frame{0};
+        int64_t frameCount{0};
+
+    public:
+        TimeSurface() {}
+
+        TimeSurface(cv::Size resolution, double decayFactor = constants::imgScaleFactor);
+
+        // marks a pixel as just seen
+        void addEvent(uint16_t x, uint16_t y) { stamps.at<uint8_t>(y, x) = frame; }
+
+        // moves on to the next display frame, every pixel decays by one step
+        void nextFrame();
+
+        // the decayed 8 bit single channel image
+        void render(cv::Mat &img) const;
+
+        cv::Size size() const { return stamps.size(); }
+};
+
+#endif
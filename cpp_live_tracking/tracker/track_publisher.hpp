@@ -0,0 +1,28 @@
+#ifndef TRACK_PUBLISHER_H
+#define TRACK_PUBLISHER_H
+
+#include "track_ring.hpp"
+#include "tracker.hpp"
+
+// Publishes what the tracker did in its last processEvents or processEvent call: every crossing it
+// counted, then every cluster as it is now, then a frame message to close the update. Nothing is written
+// while the ring is not open, so a tool calls this whether or not it was given --publish
+template <typename Real, typename Policies>
+void publishTracks(TrackRingWriter &ring, const BasicTracker<Real, Policies> &tracker, int64_t timestamp) {
+    if (!ring.isOpen()) {
+        return;
+    }
+    const int total = tracker.getTotalCrossing(), net = tracker.getNetCrossing();
+    for (const CrossingRecord &crossing : tracker.getCrossings()) {
+        ring.write({crossing.timestamp, TrackMessage::crossing, crossing.clusterID, (float)crossing.x, (float)crossing.y, 0,
+            crossing.direction, crossing.velX, crossing.velY, total, net});
+    }
+    for (const BasicCluster<Real> &cluster : tracker.getClusters()) {
+        BasicClusterState<Real> state = cluster.getState();
+        ring.write({timestamp, TrackMessage::cluster, state.id, (float)numeric::toDouble(state.x), (float)numeric::toDouble(state.y),
+            (float)numeric::toDouble(state.radius), state.side, numeric::toDouble(state.velX), numeric::toDouble(state.velY), total, net});
+    }
+    ring.write({timestamp, TrackMessage::frame, (int32_t)tracker.getClusters().size(), 0, 0, 0, 0, 0, 0, total, net});
+}
+
+#endif
@@ -0,0 +1,245 @@
+#include "track_ring.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char trackRingMagic[8] = {'B', 'E', 'E', 'T', 'R', 'A', 'C', 'K'};
+static const uint32_t trackRingVersion = 2;
+
+static size_t ringBytes(uint64_t capacity) {
+    return sizeof(TrackRingHeader) + capacity * sizeof(TrackRingSlot);
+}
+
+// Checks an existing ring under the same name is not still being written, and ends its session before the
+// object is resized: a reader touching a slot past the new end would get SIGBUS, one that sees session 0
+// stops reading instead
+static bool takeOver(int fd, const std::string &name) {
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(TrackRingHeader)) {
+        return true;
+    }
+    void *memory = mmap(nullptr, sizeof(TrackRingHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (memory == MAP_FAILED) {
+        std::cerr << "Could not map the shared memory " << name << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    TrackRingHeader *old = static_cast<TrackRingHeader *>(memory);
+    bool ours = memcmp(old->magic, trackRingMagic, sizeof(trackRingMagic)) == 0 && old->version == trackRingVersion;
+    // kill with no signal only checks the process exists, EPERM means it does and belongs to someone else
+    if (ours && old->session.load(std::memory_order_acquire) != 0 && old->writerPid > 0 &&
+        (kill(old->writerPid, 0) == 0 || errno == EPERM)) {
+        std::cerr << "The shared memory " << name << " is being written by process " << old->writerPid << std::endl;
+        munmap(memory, sizeof(TrackRingHeader));
+        return false;
+    }
+    old->session.store(0, std::memory_order_release);
+    munmap(memory, sizeof(TrackRingHeader));
+    return true;
+}
+
+TrackRingWriter::~TrackRingWriter() {
+    close();
+}
+
+bool TrackRingWriter::open(const std::string &name, size_t capacity) {
+    close();
+    uint64_t slots = 1;
+    while (slots < capacity) {
+        slots <<= 1;
+    }
+
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        std::cerr << "Could not create the shared memory " << name << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    if (!takeOver(fd, name)) {
+        ::close(fd);
+        return false;
+    }
+    size_t size = ringBytes(slots);
+    void *memory = MAP_FAILED;
+    if (ftruncate(fd, size) == 0) {
+        memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        std::cerr << "Could not map the shared memory " << name << ": " << strerror(errno) << std::endl;
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    this->name = name;
+    header = static_cast<TrackRingHeader *>(memory);
+    this->slots = reinterpret_cast<TrackRingSlot *>(static_cast<char *>(memory) + sizeof(TrackRingHeader));
+    mappedSize = size;
+    mask = slots - 1;
+    next = 0;
+
+    // readers of an earlier ring under the same name wait for the new session before reading on
+    header->session.store(0, std::memory_order_release);
+    memcpy(header->magic, trackRingMagic, sizeof(trackRingMagic));
+    header->version = trackRingVersion;
+    header->messageSize = sizeof(TrackMessage);
+    header->capacity = slots;
+    header->writerPid = getpid();
+    header->written.store(0, std::memory_order_relaxed);
+    for (uint64_t i = 0; i < slots; i++) {
+        this->slots[i].sequence.store(0, std::memory_order_relaxed);
+    }
+    uint64_t session = (uint64_t)std::chrono::system_clock::now().time_since_epoch().count() ^ ((uint64_t)getpid() << 32);
+    header->session.store(session == 0 ? 1 : session, std::memory_order_release);
+    return true;
+}
+
+void TrackRingWriter::close() {
+    if (header == nullptr) {
+        return;
+    }
+    header->session.store(0, std::memory_order_release);
+    munmap(header, mappedSize);
+    shm_unlink(name.c_str());
+    header = nullptr;
+    slots = nullptr;
+}
+
+void TrackRingWriter::write(const TrackMessage &message) {
+    TrackRingSlot &slot = slots[next & mask];
+    // odd while the message is copied in, so a reader that copies it at the same time knows to drop it
+    slot.sequence.store(2 * next + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&slot.message, &message, sizeof(TrackMessage));
+    slot.sequence.store(2 * next + 2, std::memory_order_release);
+    next++;
+    header->written.store(next, std::memory_order_release);
+}
+
+TrackRingReader::~TrackRingReader() {
+    close();
+}
+
+bool TrackRingReader::open(const std::string &name, bool fromOldest) {
+    close();
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    void *memory = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(TrackRingHeader)) {
+        memory = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        return false;
+    }
+
+    const TrackRingHeader *mapped = static_cast<const TrackRingHeader *>(memory);
+    session = mapped->session.load(std::memory_order_acquire);
+    if (session == 0 || memcmp(mapped->magic, trackRingMagic, sizeof(trackRingMagic)) != 0 ||
+        mapped->version != trackRingVersion || mapped->messageSize != sizeof(TrackMessage) ||
+        ringBytes(mapped->capacity) > (size_t)info.st_size) {
+        munmap(memory, info.st_size);
+        return false;
+    }
+
+    header = mapped;
+    slots = reinterpret_cast<const TrackRingSlot *>(static_cast<const char *>(memory) + sizeof(TrackRingHeader));
+    mappedSize = info.st_size;
+    capacity = mapped->capacity;
+    mask = capacity - 1;
+    position = header->written.load(std::memory_order_acquire);
+    if (fromOldest) {
+        position = position > capacity ? position - capacity : 0;
+    }
+    lost = 0;
+    return true;
+}
+
+void TrackRingReader::close() {
+    if (header == nullptr) {
+        return;
+    }
+    munmap(const_cast<TrackRingHeader *>(header), mappedSize);
+    header = nullptr;
+    slots = nullptr;
+}
+
+bool TrackRingReader::next(TrackMessage &message) {
+    if (header == nullptr) {
+        return false;
+    }
+    while (true) {
+        // a writer that took the ring over after another one stopped starts its messages over, and so
+        // does the reader, unless the ring changed size and has to be opened again
+        uint64_t current = header->session.load(std::memory_order_acquire);
+        if (current != session) {
+            if (current == 0) {
+                return false;
+            }
+            if (header->capacity != capacity) {
+                close();
+                return false;
+            }
+            session = current;
+            position = 0;
+        }
+
+        uint64_t written = header->written.load(std::memory_order_acquire);
+        if (position >= written) {
+            return false;
+        }
+        if (written - position > capacity) {
+            lost += written - capacity - position;
+            position = written - capacity;
+        }
+
+        const TrackRingSlot &slot = slots[position & mask];
+        uint64_t expected = 2 * position + 2;
+        uint64_t before = slot.sequence.load(std::memory_order_acquire);
+        if (before == expected) {
+            memcpy(&message, &slot.message, sizeof(TrackMessage));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) == expected) {
+                position++;
+                return true;
+            }
+        }
+        // the writer has gone round the ring and is filling this slot again
+        lost++;
+        position++;
+    }
+}
+
+bool TrackRingReader::isLive() const {
+    return header != nullptr && header->session.load(std::memory_order_acquire) == session;
+}
+
+uint64_t TrackRingReader::getBacklog() const {
+    if (header == nullptr) {
+        return 0;
+    }
+    uint64_t written = header->written.load(std::memory_order_acquire);
+    return written > position ? written - position : 0;
+}
+
+bool parsePublishArgument(const std::string &argument, std::string &name, bool &ok) {
+    if (argument.rfind("--publish=", 0) != 0) {
+        return false;
+    }
+    name = argument.substr(10);
+    // shm_open wants a name starting with a slash
+    if (!name.empty() && name[0] != '/') {
+        name = "/" + name;
+    }
+    ok = name.size() > 1;
+    return true;
+}
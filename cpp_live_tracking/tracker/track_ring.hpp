@@ -0,0 +1,146 @@
+#ifndef TRACK_RING_H
+#define TRACK_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Cluster states and crossings published by a tracker into POSIX shared memory, so dashboards and
+// scripts on the same machine can follow the hive as it is tracked instead of reading the CSV files after
+// the fact
+// The memory is one header and a ring of fixed size slots, each holding one TrackMessage. There is one
+// writer (the tracker) and any number of readers, none of which take a lock or tell the writer they are
+// there: every slot has a sequence number the writer makes odd while it fills the slot and even once the
+// message is in, and a reader keeps its own position and checks the number before and after copying a
+// message out. The writer never waits, a reader that falls more than the ring behind loses the oldest
+// messages and is told how many. The layout below is fixed so readers in other languages can map the
+// file in /dev/shm themselves.
+
+// One published message, 56 bytes
+struct TrackMessage {
+    enum Kind : uint32_t {
+        // a cluster as the tracker last updated it
+        cluster = 1,
+        // a cluster crossing the entrance
+        crossing = 2,
+        // the end of one update: every cluster alive was published just before it, clusterID is how many
+        frame = 3
+    };
+
+    // sensor time in microseconds
+    int64_t timestamp;
+    uint32_t kind;
+    int32_t clusterID;
+    float x, y, radius;
+    // crossings: 1 into the entrance, -1 out of it, clusters: the side they are on
+    int32_t direction;
+    // pixels per microsecond
+    double velX, velY;
+    // the counts at the time of the message
+    int32_t totalCrossing, netCrossing;
+};
+
+// Starts the shared memory object, written once by the writer when it opens the ring
+struct TrackRingHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t messageSize;
+    // slots in the ring, a power of two
+    uint64_t capacity;
+    // different every time a writer opens the ring, 0 while it is being set up and once it is closed
+    std::atomic<uint64_t> session;
+    // process id of the writer, another writer only takes the ring over once this process is gone
+    int32_t writerPid;
+    // messages written since the writer opened the ring
+    alignas(64) std::atomic<uint64_t> written;
+};
+
+struct TrackRingSlot {
+    // 2 * (n + 1) once message n is in the slot, odd while the writer fills it
+    std::atomic<uint64_t> sequence;
+    TrackMessage message;
+};
+
+static_assert(sizeof(TrackMessage) == 56, "the shared memory layout is read by other programs");
+static_assert(sizeof(TrackRingSlot) == 64, "the shared memory layout is read by other programs");
+static_assert(sizeof(TrackRingHeader) == 128, "the shared memory layout is read by other programs");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the sequence numbers are shared between processes");
+
+// The tracker's end of the ring
+class TrackRingWriter {
+    private:
+        std::string name;
+        TrackRingHeader *header{nullptr};
+        TrackRingSlot *slots{nullptr};
+        size_t mappedSize{0};
+        uint64_t mask{0};
+        uint64_t next{0};
+
+    public:
+        TrackRingWriter() = default;
+
+        ~TrackRingWriter();
+
+        TrackRingWriter(const TrackRingWriter &) = delete;
+
+        TrackRingWriter &operator=(const TrackRingWriter &) = delete;
+
+        // creates or takes over the shared memory object name (such as "/hive"), with capacity rounded up to a
+        // power of two. Fails while a writer in a process that is still running has the ring open. Readers
+        // still mapping an older ring see a new session and start over
+        bool open(const std::string &name, size_t capacity = 1 << 16);
+
+        // removes the shared memory object, readers that have it mapped keep what is in it and see the
+        // ring is no longer live
+        void close();
+
+        bool isOpen() const { return header != nullptr; }
+
+        void write(const TrackMessage &message);
+};
+
+// A reader's end of the ring, any number of them can follow the same writer
+class TrackRingReader {
+    private:
+        const TrackRingHeader *header{nullptr};
+        const TrackRingSlot *slots{nullptr};
+        size_t mappedSize{0};
+        uint64_t mask{0};
+        uint64_t capacity{0};
+        uint64_t session{0};
+        uint64_t position{0};
+        uint64_t lost{0};
+
+    public:
+        TrackRingReader() = default;
+
+        ~TrackRingReader();
+
+        TrackRingReader(const TrackRingReader &) = delete;
+
+        TrackRingReader &operator=(const TrackRingReader &) = delete;
+
+        // maps the ring read only, fromOldest starts with the oldest message still in it instead of the
+        // next one written. Fails while no writer has set the ring up
+        bool open(const std::string &name, bool fromOldest = false);
+
+        void close();
+
+        // copies the next message into message, false when the reader has caught up with the writer
+        bool next(TrackMessage &message);
+
+        // false once the writer has closed the ring, a reader waiting for the next run opens it again
+        bool isLive() const;
+
+        // messages the writer overwrote before this reader got to them
+        uint64_t getLost() const { return lost; }
+
+        // messages written and not read yet
+        uint64_t getBacklog() const;
+};
+
+// Reads --publish=<name>, returns false for any other argument, ok is false for an empty name
+bool parsePublishArgument(const std::string &argument, std::string &name, bool &ok);
+
+#endif
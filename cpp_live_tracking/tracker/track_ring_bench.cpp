@@ -0,0 +1,138 @@
+#include "track_ring.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <sched.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// Latency of the track ring between processes: this process writes cluster messages into a ring at a
+// steady rate and forked reader processes follow it, each timing every message from the moment it was
+// written to the moment it had it. The write time travels in the message's timestamp, as CLOCK_MONOTONIC
+// nanoseconds, which every process on the machine shares
+//     track_ring_bench [--messages=N] [--interval=<microseconds>] [--readers=N] [--capacity=<slots>]
+// Build with optimisations on, see benchmark/README.md in the repository root
+
+static int64_t nowNanoseconds() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static bool readOption(const std::string &argument, const char *prefix, int64_t &value) {
+    std::string text(prefix);
+    if (argument.rfind(text, 0) != 0) {
+        return false;
+    }
+    value = std::atoll(argument.c_str() + text.size());
+    return true;
+}
+
+// follows the ring until the last of count messages came, then prints the latencies
+static int readRing(const std::string &name, int reader, int64_t count, int ready) {
+    TrackRingReader ring;
+    if (!ring.open(name)) {
+        fprintf(stderr, "reader %d could not open %s\n", reader, name.c_str());
+        return EXIT_FAILURE;
+    }
+    char signal = 1;
+    if (write(ready, &signal, 1) != 1) {
+        return EXIT_FAILURE;
+    }
+    close(ready);
+
+    std::vector<int64_t> latencies;
+    latencies.reserve(count);
+    TrackMessage message;
+    // the writer numbers its messages, the last one is never overwritten so it always arrives
+    while (true) {
+        if (!ring.next(message)) {
+            sched_yield();
+            continue;
+        }
+        latencies.push_back(nowNanoseconds() - message.timestamp);
+        if (message.clusterID == count - 1) {
+            break;
+        }
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    auto at = [&latencies](double fraction) { return latencies[(size_t)(fraction * (latencies.size() - 1))] / 1000.0; };
+    printf("%-8d %10zu %8llu %10.2f %10.2f %10.2f %10.2f %10.2f\n", reader, latencies.size(), (unsigned long long)ring.getLost(),
+        at(0), at(0.5), at(0.99), at(0.999), at(1));
+    // the reader leaves with _exit, which does not flush
+    fflush(stdout);
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+    int64_t messages = 200000, interval = 5, readers = 1, capacity = 1 << 16;
+    for (int i = 1; i < argc; i++) {
+        std::string argument(argv[i]);
+        if (!(readOption(argument, "--messages=", messages) || readOption(argument, "--interval=", interval) ||
+              readOption(argument, "--readers=", readers) || readOption(argument, "--capacity=", capacity)) ||
+            messages <= 0 || interval < 0 || readers <= 0 || capacity <= 0) {
+            fprintf(stderr, "Options: [--messages=N] [--interval=<microseconds>] [--readers=N] [--capacity=<slots>]\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    const std::string name = "/track_ring_bench_" + std::to_string(getpid());
+    TrackRingWriter ring;
+    if (!ring.open(name, capacity)) {
+        return EXIT_FAILURE;
+    }
+
+    printf("%lld messages, one every %lld us, %lld readers\n", (long long)messages, (long long)interval, (long long)readers);
+    printf("%-8s %10s %8s %10s %10s %10s %10s %10s\n", "Reader", "Messages", "Lost", "Min us", "Median us", "p99 us",
+        "p99.9 us", "Max us");
+    fflush(stdout);
+
+    std::vector<pid_t> children;
+    for (int reader = 0; reader < readers; reader++) {
+        int ready[2];
+        if (pipe(ready) != 0) {
+            return EXIT_FAILURE;
+        }
+        pid_t child = fork();
+        if (child == 0) {
+            close(ready[0]);
+            _exit(readRing(name, reader, messages, ready[1]));
+        }
+        close(ready[1]);
+        char signal;
+        if (child < 0 || read(ready[0], &signal, 1) != 1) {
+            fprintf(stderr, "reader %d did not start\n", reader);
+            return EXIT_FAILURE;
+        }
+        close(ready[0]);
+        children.push_back(child);
+    }
+
+    TrackMessage message{0, TrackMessage::cluster, 0, 320, 240, 20, 1, 0.0001, -0.0002, 0, 0};
+    int64_t next = nowNanoseconds();
+    for (int64_t i = 0; i < messages; i++) {
+        // the readers share the machine, the writer gives them its time while it waits
+        while (nowNanoseconds() < next) {
+            sched_yield();
+        }
+        next += interval * 1000;
+        message.clusterID = (int32_t)i;
+        message.timestamp = nowNanoseconds();
+        ring.write(message);
+    }
+
+    int failed = 0;
+    for (pid_t child : children) {
+        int status;
+        waitpid(child, &status, 0);
+        failed += !(WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS);
+    }
+    ring.close();
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,552 @@
+#include "tracker.hpp"
+#include "binary_io.hpp"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+
+// checkpoints from another version of the layout below are refused
+static const uint32_t checkpointVersion = 5;
+
+// choice of colors
+static const int numColors = 8;
+static const cv::viz::Color colors[numColors] = {cv::viz::Color::amethyst(), cv::viz::Color::blue(),
+                                cv::viz::Color::orange(), cv::viz::Color::red(),
+                                cv::viz::Color::yellow(), cv::viz::Color::pink(),
+                                cv::viz::Color::lime(), cv::viz::Color::cyan()};
+
+template <typename Real, typename Policies>
+BasicTracker<Real, Policies>::BasicTracker(cv::Size resolution, int blurScale, int blurLevels, int capacity)
+    : resolution(resolution),
+      tsBlurred(resolution, blurScale, blurLevels, config.scaleFactor, config.blurIncreaseFactor),
+      clusters(capacity),
+      posX(capacity), posY(capacity), distances(capacity), velX(capacity), velY(capacity), radius(capacity), alpha(capacity),
+      clusterEvents(capacity), wingbeats(capacity) {
+    config.blurScale = blurScale;
+    config.blurLevels = blurLevels;
+    config.maxClusters = std::min(config.maxClusters, capacity);
+    entrance = config.entrance(resolution);
+    // every cluster crossing back and forth this many times in one batch is far more than a packet holds
+    crossings.reserve((size_t)capacity * constants::crossingsPerCluster);
+}
+
+template <typename Real, typename Policies>
+void BasicTracker<Real, Policies>::requestConfig(const TrackerConfig &config) {
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    pendingConfig = config;
+    configPending.store(true, std::memory_order_release);
+}
+
+template <typename Real, typename Policies>
+void BasicTracker<Real, Policies>::applyPendingConfig() {
+    if (!configPending.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    TrackerConfig next;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        next = pendingConfig;
+        configPending.store(false, std::memory_order_relaxed);
+    }
+    setConfig(next);
+}
+
+template <typename Real, typename Policies>
+void BasicTracker<Real, Policies>::setConfig(const TrackerConfig &newConfig) {
+    TrackerConfig next = newConfig;
+
+    // keep values that would stop the tracker from working inside their limits
+    next.maxClusters = std::clamp(next.maxClusters, 0, (int)clusters.capacity());
+    next.blurScale = std::max(next.blurScale, 1);
+    next.blurLevels = std::max(next.blurLevels, 1);
+    next.delayTime = std::max(next.delayTime, 1);
+    next.clusterSustainTime = std::max(next.clusterSustainTime, 1);
+
+    // the surface keeps its values, clusters and counts are not touched
+    if (next.blurScale != config.blurScale || next.blurLevels != config.blurLevels) {
+        tsBlurred = tsBlurred.rescaled(next.blurScale, next.blurLevels);
+    }
+    if (next.scaleFactor != config.scaleFactor || next.blurIncreaseFactor != config.blurIncreaseFactor) {
+        tsBlurred.setFactors(next.scaleFactor, next.blurIncreaseFactor);
+    }
+
+    config = next;
+    entrance = config.entrance(resolution);
+}
+
+template <typename Real, typename Policies>
+template <typename Events>
+void BasicTracker<Real, Policies>::processBatch(const Events &events) {
+#if TRACKER_STATS
+    auto start = std::chrono::steady_clock::now();
+#endif
+    applyPendingConfig();
+    crossings.clear();
+    missedCrossings = 0;
+    loadMotion();
+    for (const dv::Event &event : events) {
+        if (step(event.timestamp(), event.x(), event.y(), event.polarity())) {
+            storeMotion();
+            tick(event.timestamp());
+            loadMotion();
+        }
+    }
+    storeMotion();
+#if TRACKER_STATS
+    stats.events += events.size();
+    stats.packets++;
+    stats.packetLatency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+#endif
+}
+
+template <typename Real, typename Policies>
+void BasicTracker<Real, Policies>::processEvents(const dv::EventStore &events) {
+    processBatch(events);
+}
+
+template <typename Real, typename Policies>
+void BasicTracker<Real, Policies>::processEvents(std::span<const dv::Event> events) {
+    processBatch(events);
+}
+
+template <typename Real, typename Policies>
+bool BasicTracker<Real, Policies>::processEvent(int64_t timeStamp, uint16_t x, uint16_t y, bool polarity) {
+#if TRACKER_STATS
+    stats.events++;
+#endif
+    applyPendingConfig();
+    crossings.clear();
+    missedCrossings = 0;
+    loadMotion();
+    bool update = step(timeStamp, x, y, polarity);
+    storeMotion();
+
+    if (update) {
+        tick(timeStamp);
+    }
+    return update;
+}
+
+template <typename Real, typename Policies>
+void BasicTracker<Real, Policies>::loadMotion() {
+    for (size_t i = 0; i < clusters.size(); i++) {
+        BasicClusterMotion<Real> motion = clusters[i].getMotion();
+        posX[i] = motion.x;
+        posY[i] = motion.y;
+        velX[i] = motion.velX;
+        velY[i] = motion.velY;
+        radius[i] = motion.radius;
+        alpha[i] = motion.alpha;
+        clusterEvents[i] = motion.eventCount;
+    }
+}
+
+template <typename Real, typename Policies>
+void BasicTracker<Real, Policies>::storeMotion() {
+    for (size_t i = 0; i < clusters.size(); i++) {
+        clusters[i].setMotion({posX[i], posY[i], velX[i], velY[i], radius[i], alpha[i], clusterEvents[i]});
+    }
+}
+
+template <typename Real, typename Policies>
+template <bool sampled>
+bool BasicTracker<Real, Policies>::step(int64_t timeStamp, uint16_t x, uint16_t y, bool polarity) {
+    using Distance = typename Policies::Distance;
+    using Wingbeat = typename Policies::Wingbeat;
+
+    eventCount++;
+
+    // set initial timestamps
+    if (prevTime < 0) {
+        prevTime = timeStamp;
+    }
+    if (nextTime < 0) {
+        nextTime = timeStamp;
+    }
+    if (nextSustain < 0) {
+        nextSustain = timeStamp;
+    }
+
+    // only update on off spikes, on spikes only look for their cluster when the policy uses them
+    if (!polarity || (Policies::Polarity::onEvents && !dropOnEvents)) {
+        [[maybe_unused]] uint64_t ticks = sampled ? readTicks() : 0;
+
+        // Increases the value of the corresponding region in the blurred time surface
+        if (!polarity) {
+            tsBlurred.increment(x, y);
+        }
+        if constexpr (sampled) {
+            ticks = stats.addSample(Stage::decay, ticks);
+        }
+
+        // the same arithmetic as Cluster::distance, contMomentum, shift and updateRadius, one array at a time
+        const size_t count = clusters.size();
+        const Real eventX = x, eventY = y;
+        // kept whole so a long gap times a velocity cannot overflow a Fixed16 on the way
+        const int64_t elapsed = timeStamp - prevTime;
+        // Cluster::updateRadius takes the growth factor as a float
+        const numeric::Fine<Real> radiusGrowth = (float)config.radiusGrowth;
+
+        // distance of the event from each cluster, before the clusters move on
+        for (size_t i = 0; i < count; i++) {
+            distances[i] = Distance::between(eventX - posX[i], eventY - posY[i]);
+        }
+
+        // continue movement based on velocity and time elapsed
+        if (!polarity) {
+            for (size_t i = 0; i < count; i++) {
+                posX[i] = posX[i] + numeric::travel<Real>(velX[i], elapsed);
+                posY[i] = posY[i] + numeric::travel<Real>(velY[i], elapsed);
+            }
+        }
+
+        // keep track of the min dist and the cluster associated with it, the first one wins a tie
+        int minCluster = -1;
+        Real minDistance = resolution.width + resolution.height;
+        for (size_t i = 0; i < count; i++) {
+            if (distances[i] < minDistance) {
+                minDistance = distances[i];
+                minCluster = i;
+            }
+        }
+
+        if (minCluster >= 0) {
+            // the closest cluster has already moved, so its range is checked from where it is now
+            // compared at the precision of the radius, a distance too far for it saturates and still compares right
+            numeric::Fine<Real> distance(Distance::between(eventX - posX[minCluster], eventY - posY[minCluster]));
+
+            // If the event is inside the closest cluster, it updates the location of that cluster
+            if (distance < radius[minCluster]) {
+                if (!polarity) {
+                    posX[minCluster] = numeric::blend<Real>(alpha[minCluster], posX[minCluster], eventX);
+                    posY[minCluster] = numeric::blend<Real>(alpha[minCluster], posY[minCluster], eventY);
+                    clusterEvents[minCluster]++;
+                }
+                if constexpr (Wingbeat::enabled) {
+                    Wingbeat::event(wingbeats[clusters.handleAt(minCluster).slot], timeStamp, polarity);
+                }
+            } // If there is an event very near but outside the cluster, increase the cluster's radius
+            else if (!polarity && distance < radius[minCluster] * 1.33) {
+                radius[minCluster] *= radiusGrowth * ((40 - radius[minCluster]) / 15);
+            }
+        }
+        if constexpr (sampled) {
+            stats.addSample(Stage::nearestCluster, ticks);
+        }
+
+        if (!polarity) {
+            prevTime = timeStamp;
+        }
+    }
+
+    // exponential decay of blurred time surface, values are kept at or below 1
+    // every event decays it, on events included, which is why load shedding never takes them out of a packet
+    tsBlurred.decay();
+
+    // only update clusters after a certain period of time
+    // this is a costly computation, so is not performed with every event
+    if (timeStamp > nextTime) {
+        nextTime += config.delayTime;
+        return true;
+    }
+    return false;
+}
+
+template <typename Real, typename Policies>
+void BasicTracker<Real, Policies>::tick(int64_t timeStamp) {
+    // check of clusters need to be deleted
+    if (timeStamp > nextSustain) {
+        nextSustain += config.clusterSustainTime;
+        sustainClusters();
+    }
+
+    birthClusters();
+    updateClusters(timeStamp);
+#if TRACKER_STATS
+    stats.clusterCount.record(clusters.size());
+#endif
+}
+
+template <typename Real, typename Policies>
+void BasicTracker<Real, Policies>::sustainClusters() {
+    TRACKER_STAGE(stats.stage(Stage::sustain));
+
+    // walk backwards so the cluster moved into a removed one's place has already been checked
+    for (size_t i = clusters.size(); i > 0; i--) {
+        // delete a cluster if it did not have enough events
+        if (!clusters[i - 1].aboveThreshold(config.clusterSustainThresh, resolution.width, resolution.height)) {
+            clusters.removeAt(i - 1);
+        } else { // if it's above the threshold, reset the number of events
+            clusters[i - 1].resetEvents();
+        }
+    }
+}
+
+template <typename Real, typename Policies>
+void BasicTracker<Real, Policies>::birthClusters() {
+    TRACKER_STAGE(stats.stage(Stage::birth));
+
+    if ((int)clusters.size() >= config.maxClusters) {
+        return;
+    }
+
+    int blurScale = tsBlurred.getBlurScale();
+
+    // Adds a new cluster if three criteria are met:
+    // The region must be greater than the cluster initialization threshold
+    // The region can't be inside an already existing cluster
+    // There can't be more clusters than the max limit
+    tsBlurred.forEachAbove(config.clusterInitThresh, [this, blurScale](int col, int row) {
+        // check that it is not inside an already existing cluster
+        for (BasicCluster<Real> &cluster : clusters) {
+            if (nearCluster(cluster, col * blurScale, row * blurScale)) {
+                return true;
+            }
+        }
+
+        ClusterHandle handle = clusters.emplace(col * blurScale, row * blurScale, colors[colorIndex++ % numColors], config.alpha);
+        if (handle.valid()) {
+            wingbeats[handle.slot] = {};
+        }
+        return (int)clusters.size() < config.maxClusters;
+    });
+}
+
+template <typename Real, typename Policies>
+void BasicTracker<Real, Policies>::updateClusters(int64_t timeStamp) {
+    TRACKER_STAGE(stats.stage(Stage::update));
+
+    // update the velocity and shrink the radius
+    for (BasicCluster<Real> &cluster : clusters) {
+        cluster.updateVelocity(config.delayTime);
+        cluster.updateRadius(config.radiusShrink);
+
+        int newCrossing = cluster.crossTo(Policies::Side::of(cluster, entrance, resolution));
+        if (newCrossing != 0) {
+            netCrossing -= newCrossing;
+            totalCrossing += abs(newCrossing);
+            lastCrossingID = cluster.getID();
+            lastCrossingTime = timeStamp;
+
+            if (crossings.size() == crossings.capacity()) {
+                missedCrossings++;
+                continue;
+            }
+            BasicClusterMotion<Real> motion = cluster.getMotion();
+            crossings.push_back({timeStamp, cluster.getID(), newCrossing, numeric::toDouble(motion.x), numeric::toDouble(motion.y),
+                numeric::toDouble(motion.velX), numeric::toDouble(motion.velY)});
+        }
+    }
+}
+
+template <typename Real, typename Policies>
+bool BasicTracker<Real, Policies>::nearCluster(const BasicCluster<Real> &cluster, int x, int y) const {
+    // Cluster::otherClusterRange with the policy's distance
+    BasicClusterMotion<Real> motion = cluster.getMotion();
+    numeric::Fine<Real> distance(Policies::Distance::between(Real(x) - motion.x, Real(y) - motion.y));
+    return distance < motion.radius * 2;
+}
+
+template <typename Real, typename Policies>
+bool BasicTracker<Real, Policies>::saveCheckpoint(const std::string &path, const CheckpointPosition &position) const {
+    using WingbeatState = typename Policies::Wingbeat::State;
+    static_assert(std::is_trivially_copyable_v<TrackerConfig> && std::is_trivially_copyable_v<WingbeatState>);
+
+    const std::string partial = path + ".partial";
+    {
+        std::ofstream out(partial, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            std::cerr << "Could not write the checkpoint " << partial << std::endl;
+            return false;
+        }
+        out.write("TCKP", 4);
+        writeValue<uint32_t>(out, checkpointVersion);
+        writeString(out, numeric::name<Real>());
+        writeString(out, Policies::name());
+        writeValue<uint32_t>(out, sizeof(WingbeatState));
+        writeValue<int32_t>(out, resolution.width);
+        writeValue<int32_t>(out, resolution.height);
+        writeValue<uint32_t>(out, clusters.capacity());
+
+        writeValue(out, position);
+        // the config as it is in memory, adding a field means a new checkpointVersion
+        writeValue(out, config);
+        tsBlurred.save(out);
+
+        writeValue<int64_t>(out, nextTime);
+        writeValue<int64_t>(out, nextSustain);
+        writeValue<int64_t>(out, prevTime);
+        writeValue<int32_t>(out, colorIndex);
+        writeValue<int32_t>(out, netCrossing);
+        writeValue<int32_t>(out, totalCrossing);
+        writeValue<int32_t>(out, lastCrossingID);
+        writeValue<int64_t>(out, lastCrossingTime);
+        writeValue<int64_t>(out, eventCount);
+        writeValue<int32_t>(out, clusterGlobId.load());
+
+        // in the packed order and in the slots they had, so the cluster log keeps its columns
+        writeValue<uint32_t>(out, clusters.size());
+        for (size_t i = 0; i < clusters.size(); i++) {
+            uint32_t slot = clusters.handleAt(i).slot;
+            writeValue<uint32_t>(out, slot);
+            writeValue(out, clusters[i].getState());
+            writeValue(out, wingbeats[slot]);
+        }
+        if (!out.good()) {
+            std::cerr << "Could not write the checkpoint " << partial << std::endl;
+            return false;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(partial, path, error);
+    if (error) {
+        std::cerr << "Could not replace the checkpoint " << path << ": " << error.message() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+template <typename Real, typename Policies>
+bool BasicTracker<Real, Policies>::loadCheckpoint(const std::string &path, CheckpointPosition &position) {
+    using WingbeatState = typename Policies::Wingbeat::State;
+
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        std::cerr << "Could not open the checkpoint " << path << std::endl;
+        return false;
+    }
+
+    char magic[4];
+    uint32_t version, wingbeatSize, capacity;
+    std::string numberType, policies;
+    int32_t width, height;
+    if (!in.read(magic, 4) || std::string(magic, 4) != "TCKP" || !readValue(in, version) || version != checkpointVersion) {
+        std::cerr << path << " is not a checkpoint of this version of the tracker" << std::endl;
+        return false;
+    }
+    if (!readString(in, numberType) || !readString(in, policies) || !readValue(in, wingbeatSize) || !readValue(in, width) || !readValue(in, height)
+        || !readValue(in, capacity)) {
+        std::cerr << "The checkpoint " << path << " is cut short" << std::endl;
+        return false;
+    }
+    if (numberType != numeric::name<Real>() || policies != Policies::name() || wingbeatSize != sizeof(WingbeatState)) {
+        std::cerr << "The checkpoint " << path << " is from a " << numberType << " " << policies << " tracker, not a "
+            << numeric::name<Real>() << " " << Policies::name() << " tracker like this one" << std::endl;
+        return false;
+    }
+    if (width != resolution.width || height != resolution.height || capacity != clusters.capacity()) {
+        std::cerr << "The checkpoint " << path << " is from a " << width << "x" << height << " tracker for " << capacity
+            << " clusters, this one is " << resolution.width << "x" << resolution.height << " for " << clusters.capacity() << std::endl;
+        return false;
+    }
+
+    // everything is read before anything is changed, so a damaged checkpoint leaves the tracker as it was
+    CheckpointPosition savedPosition;
+    TrackerConfig savedConfig;
+    if (!readValue(in, savedPosition) || !readValue(in, savedConfig)) {
+        std::cerr << "The checkpoint " << path << " is cut short" << std::endl;
+        return false;
+    }
+    BasicBlurPyramid<Real> surface(resolution, savedConfig.blurScale, savedConfig.blurLevels, savedConfig.scaleFactor,
+        savedConfig.blurIncreaseFactor);
+    int64_t savedNextTime, savedNextSustain, savedPrevTime, savedLastCrossingTime, savedEventCount;
+    int32_t savedColorIndex, savedNet, savedTotal, savedLastID, savedGlobId;
+    uint32_t count;
+    if (!surface.load(in) || !readValue(in, savedNextTime) || !readValue(in, savedNextSustain) || !readValue(in, savedPrevTime)
+        || !readValue(in, savedColorIndex) || !readValue(in, savedNet) || !readValue(in, savedTotal) || !readValue(in, savedLastID)
+        || !readValue(in, savedLastCrossingTime) || !readValue(in, savedEventCount) || !readValue(in, savedGlobId)
+        || !readValue(in, count) || count > capacity) {
+        std::cerr << "The checkpoint " << path << " is cut short or damaged" << std::endl;
+        return false;
+    }
+    std::vector<uint32_t> slots(count);
+    std::vector<BasicClusterState<Real>> states(count);
+    std::vector<WingbeatState> estimators(count);
+    for (uint32_t i = 0; i < count; i++) {
+        if (!readValue(in, slots[i]) || slots[i] >= capacity || !readValue(in, states[i]) || !readValue(in, estimators[i])) {
+            std::cerr << "The checkpoint " << path << " is cut short or damaged" << std::endl;
+            return false;
+        }
+    }
+
+    config = savedConfig;
+    entrance = config.entrance(resolution);
+    tsBlurred = std::move(surface);
+    nextTime = savedNextTime;
+    nextSustain = savedNextSustain;
+    prevTime = savedPrevTime;
+    colorIndex = savedColorIndex;
+    netCrossing = savedNet;
+    totalCrossing = savedTotal;
+    lastCrossingID = savedLastID;
+    lastCrossingTime = savedLastCrossingTime;
+    eventCount = savedEventCount;
+    // ids keep counting from where the checkpoint was, or from here if this process has handed out more
+    int expected = clusterGlobId.load();
+    while (expected < savedGlobId && !clusterGlobId.compare_exchange_weak(expected, savedGlobId)) {
+    }
+
+    clusters.clear();
+    for (uint32_t i = 0; i < count; i++) {
+        clusters.emplaceAt(slots[i], states[i]);
+        wingbeats[slots[i]] = estimators[i];
+    }
+    crossings.clear();
+    position = savedPosition;
+    return true;
+}
+
+template <typename Real, typename Policies>
+void BasicTracker<Real, Policies>::shiftTime(int64_t delta) {
+    for (int64_t *timer : {&nextTime, &nextSustain, &prevTime, &lastCrossingTime}) {
+        if (*timer >= 0) {
+            *timer += delta;
+        }
+    }
+    for (size_t i = 0; i < clusters.size(); i++) {
+        Policies::Wingbeat::shiftTime(wingbeats[clusters.handleAt(i).slot], delta);
+    }
+}
+
+template <typename Real, typename Policies>
+void BasicTracker<Real, Policies>::draw(cv::Mat img) {
+    Policies::Side::draw(img, entrance);
+
+    // draw each cluster
+    for (BasicCluster<Real> &cluster : clusters) {
+        cluster.draw(img);
+    }
+}
+
+// the number types the trackers can be built with, for each of the combinations in tracker_policies.hpp
+template class BasicTracker<double>;
+template class BasicTracker<float>;
+template class BasicTracker<Fixed16>;
+template class BasicTracker<double, CenterLinePolicies>;
+template class BasicTracker<float, CenterLinePolicies>;
+template class BasicTracker<Fixed16, CenterLinePolicies>;
+template class BasicTracker<double, DelayWingbeatPolicies>;
+template class BasicTracker<float, DelayWingbeatPolicies>;
+template class BasicTracker<Fixed16, DelayWingbeatPolicies>;
+template class BasicTracker<double, FourierWingbeatPolicies>;
+template class BasicTracker<float, FourierWingbeatPolicies>;
+template class BasicTracker<Fixed16, FourierWingbeatPolicies>;
+template class BasicTracker<double, ForcedOscillatorPolicies>;
+template class BasicTracker<float, ForcedOscillatorPolicies>;
+template class BasicTracker<Fixed16, ForcedOscillatorPolicies>;
+
+void drawCenterLine(cv::Mat img) {
+    cv::line(img, cv::Point(img.cols / 2, 0), cv::Point(img.cols / 2, img.rows), cv::viz::Color::red());
+}
+
+void drawEntrance(cv::Mat img, const EntranceBox &entrance) {
+    double margin = entrance.margin;
+
+    cv::rectangle(img, cv::Point(entrance.left, entrance.top), cv::Point(entrance.right, entrance.bottom), cv::viz::Color::red());
+    cv::rectangle(img, cv::Point(entrance.left + margin, entrance.top + margin), cv::Point(entrance.right - margin, entrance.bottom - margin), cv::viz::Color::blue());
+    cv::rectangle(img, cv::Point(entrance.left - margin, entrance.top - margin), cv::Point(entrance.right + margin, entrance.bottom + margin), cv::viz::Color::blue());
+}
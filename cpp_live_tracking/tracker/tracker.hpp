@@ -0,0 +1,218 @@
+#ifndef TRACKER_H
+#define TRACKER_H
+
+#include <cluster/cluster.hpp>
+#include <object_detection/constants.hpp>
+#include "blur_pyramid.hpp"
+#include "cluster_pool.hpp"
+#include "tracker_config.hpp"
+#include "tracker_policies.hpp"
+#include "checkpoint.hpp"
+#include "stats.hpp"
+
+#include <dv-processing/core/core.hpp>
+#include <opencv2/core.hpp>
+#include <atomic>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
+
+// one cluster crossing the entrance box
+struct CrossingRecord {
+    int64_t timestamp;
+    int clusterID;
+    // 1 into the entrance box, -1 out of it
+    int direction;
+    double x, y;
+    // pixels per microsecond
+    double velX, velY;
+};
+
+// The cluster tracking algorithm shared by the file and live front ends
+// Events go in through processEvents, the front end reads the clusters and crossing counts back out
+// The resolution comes from the camera or recording, it is not assumed to be 640 x 480
+// All storage is sized in the constructor, processing events never allocates
+// Between cluster updates the set of clusters cannot change, so for the length of a batch the position,
+// velocity and radius of every cluster are kept in one array per field and the per-event distance and
+// momentum loops run over those arrays instead of calling into each Cluster
+// Settings can be changed from any thread with requestConfig, the new config is swapped in whole at the
+// start of the next batch and the clusters, counts and blurred surface carry on from where they were
+// Real is the number type of the cluster state and the blurred surface, Tracker uses TrackerReal
+// (see numeric.hpp) and tracker.cpp holds the double, float and Fixed16 versions
+// Policies picks the distance, the counting boundary, whether on events count and the wingbeat
+// estimator (see tracker_policies.hpp), tracker.cpp builds the combinations the aliases below name
+template <typename Real, typename Policies = LiveTrackingPolicies>
+class BasicTracker {
+    private:
+        cv::Size resolution;
+        TrackerConfig config;
+        EntranceBox entrance;
+        BasicBlurPyramid<Real> tsBlurred;
+        ClusterPool<BasicCluster<Real>> clusters;
+
+        // a config handed over by requestConfig, waiting for the next batch
+        std::mutex pendingMutex;
+        TrackerConfig pendingConfig;
+        std::atomic<bool> configPending{false};
+
+        // per-event cluster state, copied out of the pool by loadMotion and back by storeMotion
+        std::vector<Real> posX, posY, distances;
+        std::vector<numeric::Fine<Real>> velX, velY, radius, alpha;
+        std::vector<unsigned int> clusterEvents;
+        // the wingbeat estimator of each cluster, by pool slot so it stays with the cluster
+        std::vector<typename Policies::Wingbeat::State> wingbeats;
+
+        // initialize to negative values to signal needed update
+        // all timestamps are 64-bit ints to avoid overflow/wraparound
+        int64_t nextTime{-1};
+        int64_t nextSustain{-1};
+        int64_t prevTime{-1};
+
+        int colorIndex{0};
+        int netCrossing{0}, totalCrossing{0}, lastCrossingID{-1};
+        int64_t lastCrossingTime{-1};
+        // crossings counted during the last processEvents or processEvent call, up to crossingsPerCluster
+        // for each cluster slot, the ones past that are only counted in missedCrossings
+        std::vector<CrossingRecord> crossings;
+        size_t missedCrossings{0};
+        int64_t eventCount{0};
+        // set by a front end that is shedding load, see setDropOnEvents
+        bool dropOnEvents{false};
+        TrackerStats stats;
+
+        void applyPendingConfig();
+
+        void loadMotion();
+
+        void storeMotion();
+
+        // runs one event against the copied out cluster state, returns true when a cluster update is due
+        // the sampled version also times its stages, the other one has no instrumentation at all
+        template <bool sampled>
+        bool step(int64_t timeStamp, uint16_t x, uint16_t y, bool polarity);
+
+        bool step(int64_t timeStamp, uint16_t x, uint16_t y, bool polarity) {
+#if TRACKER_STATS
+            if (TrackerStats::sampleDue(eventCount)) {
+                return step<true>(timeStamp, x, y, polarity);
+            }
+#endif
+            return step<false>(timeStamp, x, y, polarity);
+        }
+
+        // the batch loop, for an EventStore or a span of events
+        template <typename Events>
+        void processBatch(const Events &events);
+
+        // removes, creates and updates clusters, works on the pool
+        void tick(int64_t timeStamp);
+
+        void sustainClusters();
+
+        void birthClusters();
+
+        void updateClusters(int64_t timeStamp);
+
+        // whether a new cluster at (x, y) would be inside an existing one
+        bool nearCluster(const BasicCluster<Real> &cluster, int x, int y) const;
+
+    public:
+        // capacity is the most clusters config.maxClusters can ever allow
+        BasicTracker(cv::Size resolution, int blurScale = constants::blurScale, int blurLevels = constants::blurLevels,
+            int capacity = constants::maxClusters);
+
+        // the fast path, the cluster state is only copied in and out of the pool around cluster updates
+        void processEvents(const dv::EventStore &events);
+
+        // the same for events read in place from a recording (MappedRecording), they are not copied
+        void processEvents(std::span<const dv::Event> events);
+
+        // returns true when the event triggered a cluster update
+        bool processEvent(int64_t timeStamp, uint16_t x, uint16_t y, bool polarity);
+
+        // any thread: the config is used from the start of the next processEvents or processEvent call
+        void requestConfig(const TrackerConfig &config);
+
+        // processing thread only: switches to the config straight away
+        // changing the blur scale resamples the blurred surface, which allocates
+        void setConfig(const TrackerConfig &config);
+
+        // processing thread only
+        const TrackerConfig &getConfig() const { return config; }
+
+        // processing thread only: on events then only advance the surface decay and the update timer, the
+        // same as for policies that do not use them. They never move a cluster or add to the surface, so
+        // the counts do not change, but the wingbeat estimators stop hearing them until it is turned off
+        void setDropOnEvents(bool drop) { dropOnEvents = drop; }
+
+        // false when the policies skip on events anyway, so setDropOnEvents saves nothing
+        static constexpr bool usesOnEvents = Policies::Polarity::onEvents;
+
+        const EntranceBox &getEntrance() const { return entrance; }
+
+        // processing thread only: writes everything the tracker needs to carry on (the config, the
+        // blurred surface, the clusters with their estimators, the timers and the counts) to path, with
+        // where in its source the tracker is. Written beside path and renamed, so a tool stopped halfway
+        // keeps the checkpoint before. Returns false and prints why if it could not be written
+        bool saveCheckpoint(const std::string &path, const CheckpointPosition &position) const;
+
+        // processing thread only: carries on from a checkpoint of a tracker of the same type, resolution
+        // and capacity, and sets position to where it was taken. Returns false and prints why if it
+        // cannot, the tracker is then unchanged. Handles from before the checkpoint are not valid after it
+        bool loadCheckpoint(const std::string &path, CheckpointPosition &position);
+
+        // moves every timer by delta microseconds, for a resumed camera whose clock has started again
+        void shiftTime(int64_t delta);
+
+        // draws the counting boundary and every cluster
+        void draw(cv::Mat img);
+
+        const ClusterPool<BasicCluster<Real>> &getClusters() const { return clusters; }
+
+        // microseconds between the wing beats of the cluster at a position in getClusters(), -1 until the
+        // estimator has one and always without an estimator
+        int getWingbeatPeriod(size_t index) const {
+            return Policies::Wingbeat::period(wingbeats[clusters.handleAt(index).slot]);
+        }
+
+        int getNetCrossing() const { return netCrossing; }
+
+        int getTotalCrossing() const { return totalCrossing; }
+
+        // id of the cluster that crossed most recently
+        int getLastCrossingID() const { return lastCrossingID; }
+
+        // timestamp of the cluster update that counted the most recent crossing
+        int64_t getLastCrossingTime() const { return lastCrossingTime; }
+
+        // every crossing counted by the last call to processEvents or processEvent, oldest first
+        const std::vector<CrossingRecord> &getCrossings() const { return crossings; }
+
+        // crossings counted by the last call that getCrossings() had no room for, they are in the counts
+        // but have no record. Hand the tracker shorter batches if this is ever more than 0
+        size_t getMissedCrossings() const { return missedCrossings; }
+
+        int64_t getEventCount() const { return eventCount; }
+
+        cv::Size getResolution() const { return resolution; }
+
+        int getBlurScale() const { return tsBlurred.getBlurScale(); }
+
+        // processing thread only, front ends add their own stages (logging, render) to it
+        TrackerStats &getStats() { return stats; }
+
+        const TrackerStats &getStats() const { return stats; }
+};
+
+using Tracker = BasicTracker<TrackerReal>;
+
+using CenterLineTracker = BasicTracker<TrackerReal, CenterLinePolicies>;
+
+using DelayWingbeatTracker = BasicTracker<TrackerReal, DelayWingbeatPolicies>;
+
+using FourierWingbeatTracker = BasicTracker<TrackerReal, FourierWingbeatPolicies>;
+
+using ForcedOscillatorTracker = BasicTracker<TrackerReal, ForcedOscillatorPolicies>;
+
+#endif
@@ -0,0 +1,142 @@
+#include "tracker_config.hpp"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+// the fields of a config by their names in the settings file
+static void settingFields(TrackerConfig &config, std::map<std::string, int *> &intFields, std::map<std::string, double *> &doubleFields) {
+    intFields = {
+        {"blurScale", &config.blurScale},
+        {"blurLevels", &config.blurLevels},
+        {"delayTime", &config.delayTime},
+        {"clusterSustainTime", &config.clusterSustainTime},
+        {"maxClusters", &config.maxClusters},
+        {"clusterSustainThresh", &config.clusterSustainThresh},
+    };
+    doubleFields = {
+        {"scaleFactor", &config.scaleFactor},
+        {"blurIncreaseFactor", &config.blurIncreaseFactor},
+        {"clusterInitThresh", &config.clusterInitThresh},
+        {"alpha", &config.alpha},
+        {"radiusGrowth", &config.radiusGrowth},
+        {"radiusShrink", &config.radiusShrink},
+        {"entranceLeft", &config.entranceLeft},
+        {"entranceRight", &config.entranceRight},
+        {"entranceTop", &config.entranceTop},
+        {"entranceBottom", &config.entranceBottom},
+        {"entranceMargin", &config.entranceMargin},
+    };
+}
+
+bool isTrackerSetting(const std::string &name) {
+    TrackerConfig config;
+    std::map<std::string, int *> intFields;
+    std::map<std::string, double *> doubleFields;
+    settingFields(config, intFields, doubleFields);
+    return intFields.count(name) || doubleFields.count(name);
+}
+
+bool setTrackerSetting(TrackerConfig &config, const std::string &name, const std::string &value) {
+    TrackerConfig next = config;
+    std::map<std::string, int *> intFields;
+    std::map<std::string, double *> doubleFields;
+    settingFields(next, intFields, doubleFields);
+
+    std::istringstream text(value);
+    bool ok;
+    if (intFields.count(name)) {
+        ok = (bool)(text >> *intFields.at(name));
+    } else if (doubleFields.count(name)) {
+        ok = (bool)(text >> *doubleFields.at(name));
+    } else {
+        return false;
+    }
+    // nothing but spaces after the number
+    std::string rest;
+    ok = ok && !(text >> rest);
+
+    if (ok) {
+        config = next;
+    }
+    return ok;
+}
+
+bool readTrackerConfig(const std::string &path, TrackerConfig &config) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Could not open tracker settings: " << path << std::endl;
+        return false;
+    }
+
+    TrackerConfig next = config;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+
+        size_t equals = line.find('=');
+        std::string name;
+        std::istringstream(line.substr(0, equals)) >> name;
+        if (name.empty()) {
+            continue;
+        }
+
+        if (!isTrackerSetting(name)) {
+            std::cerr << path << ":" << lineNumber << ": unknown setting \"" << name << "\"" << std::endl;
+            return false;
+        }
+
+        if (!setTrackerSetting(next, name, equals == std::string::npos ? "" : line.substr(equals + 1))) {
+            std::cerr << path << ":" << lineNumber << ": could not read \"" << name << "\"" << std::endl;
+            return false;
+        }
+    }
+
+    config = next;
+    return true;
+}
+
+TrackerConfigWatcher::TrackerConfigWatcher(const std::string &path, TrackerConfig &initial,
+    std::function<void(const TrackerConfig &)> onChange, const TrackerSettings &overrides)
+    : path(path), onChange(onChange), overrides(overrides) {
+    std::error_code error;
+    auto lastWrite = std::filesystem::last_write_time(path, error);
+    if (!error) {
+        readTrackerConfig(path, initial);
+    }
+    for (const auto &[name, value] : overrides) {
+        if (!setTrackerSetting(initial, name, value)) {
+            std::cerr << "Ignoring the command line setting " << name << " = " << value << std::endl;
+        }
+    }
+    TrackerConfig current = initial;
+
+    thread = std::thread([this, lastWrite, current]() mutable {
+        while (running) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+            std::error_code error;
+            auto write = std::filesystem::last_write_time(this->path, error);
+            if (error || write == lastWrite) {
+                continue;
+            }
+            lastWrite = write;
+
+            if (readTrackerConfig(this->path, current)) {
+                for (const auto &[name, value] : this->overrides) {
+                    setTrackerSetting(current, name, value);
+                }
+                std::cout << "Reloaded tracker settings from " << this->path << std::endl;
+                this->onChange(current);
+            }
+        }
+    });
+}
+
+TrackerConfigWatcher::~TrackerConfigWatcher() {
+    running = false;
+    thread.join();
+}
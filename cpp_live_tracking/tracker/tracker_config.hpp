@@ -0,0 +1,87 @@
+#ifndef TRACKER_CONFIG_H
+#define TRACKER_CONFIG_H
+
+#include <cluster/cluster.hpp>
+#include <object_detection/constants.hpp>
+
+#include <opencv2/core.hpp>
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Every tuning value the tracker uses, defaulting to constants.hpp
+// A tracker takes a new config between batches without losing its clusters, see Tracker::requestConfig
+struct TrackerConfig {
+    // blurred time surface, changing the blur scale or levels resamples the current surface
+    int blurScale{constants::blurScale};
+    int blurLevels{constants::blurLevels};
+    double scaleFactor{constants::scaleFactor};
+    double blurIncreaseFactor{constants::blurIncreaseFactor};
+
+    // microseconds between cluster updates and between checks for clusters to remove
+    int delayTime{constants::delayTime};
+    int clusterSustainTime{constants::clusterSustainTime};
+
+    // limited to the capacity the tracker was built with
+    int maxClusters{constants::maxClusters};
+    double clusterInitThresh{constants::clusterInitThresh};
+    int clusterSustainThresh{constants::clusterSustainThresh};
+    // only affects clusters created after it is set
+    double alpha{constants::alpha};
+    double radiusGrowth{constants::radiusGrowth};
+    double radiusShrink{constants::radiusShrink};
+
+    // entrance box as fractions of the image, margin in pixels
+    double entranceLeft{constants::entranceLeft};
+    double entranceRight{constants::entranceRight};
+    double entranceTop{constants::entranceTop};
+    double entranceBottom{constants::entranceBottom};
+    double entranceMargin{constants::entranceMargin};
+
+    // the entrance box in pixels for a given resolution
+    EntranceBox entrance(cv::Size resolution) const {
+        return {resolution.width * entranceLeft, resolution.width * entranceRight,
+            resolution.height * entranceTop, resolution.height * entranceBottom, entranceMargin};
+    }
+};
+
+// Reads "name = value" lines into config, names are the TrackerConfig fields and # starts a comment
+// Fields that are not in the file keep their value. Returns false and prints the problem if any
+// line could not be read, config is only changed when the whole file is valid
+bool readTrackerConfig(const std::string &path, TrackerConfig &config);
+
+// true if name is one of the settings readTrackerConfig knows
+bool isTrackerSetting(const std::string &name);
+
+// sets one field by its name in the settings file, from text such as "0.35"
+// returns false if there is no such setting or the text is not a single number, config is then unchanged
+bool setTrackerSetting(TrackerConfig &config, const std::string &name, const std::string &value);
+
+// settings by name and value, as setTrackerSetting takes them
+using TrackerSettings = std::vector<std::pair<std::string, std::string>>;
+
+// Lets the standalone tools be tuned without a rebuild: polls a settings file from its own thread
+// and calls onChange with the new config every time the file is saved with valid contents
+// Settings a tool was given on its command line are passed as overrides, they are applied on top of the
+// file when it is first read and every time it changes, so the file cannot undo them
+class TrackerConfigWatcher {
+    private:
+        std::string path;
+        std::function<void(const TrackerConfig &)> onChange;
+        TrackerSettings overrides;
+        std::atomic<bool> running{true};
+        std::thread thread;
+
+    public:
+        // reads the file once straight away, onChange is not called for that first read
+        TrackerConfigWatcher(const std::string &path, TrackerConfig &initial, std::function<void(const TrackerConfig &)> onChange,
+            const TrackerSettings &overrides = {});
+
+        ~TrackerConfigWatcher();
+};
+
+#endif
@@ -0,0 +1,342 @@
+#ifndef TRACKER_POLICIES_H
+#define TRACKER_POLICIES_H
+
+#include <cluster/cluster.hpp>
+
+#include <opencv2/core.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+#include <string>
+
+// The behaviours the tracking programs in this repository differ in, as policies BasicTracker takes
+// as a template parameter. Every policy is a set of static functions, so the tracker's loops call them
+// directly and the compiler inlines the chosen ones, there is no virtual call per event.
+// Every policy also has a name, checkpoints are tagged with the names of the ones the tracker was built with.
+
+// draws the entrance box that clusters have to cross to be counted
+void drawEntrance(cv::Mat img, const EntranceBox &entrance);
+
+// draws the line the center line trackers count crossings of
+void drawCenterLine(cv::Mat img);
+
+// Distance: how far an event at (eventX - x, eventY - y) from a cluster is, compared with its radius
+
+// the largest of the two offsets, what Cluster::distance has always used
+struct ChebyshevDistance {
+    static constexpr const char *name = "chebyshev";
+
+    template <typename Real>
+    static Real between(Real dx, Real dy) {
+        return std::max(numeric::abs(dx), numeric::abs(dy));
+    }
+};
+
+// the straight line distance, commented out in Cluster::distance in favour of the cheaper one
+struct EuclideanDistance {
+    static constexpr const char *name = "euclidean";
+
+    template <typename Real>
+    static Real between(Real dx, Real dy) {
+        return numeric::hypot(dx, dy);
+    }
+};
+
+// Side: which side of the counting boundary a cluster is on, 1, -1 or 0 for on the boundary
+
+// inside (1) or outside (-1) the entrance box, the live trackers in cpp_live_tracking
+struct EntranceBoxSide {
+    static constexpr const char *name = "entrance-box";
+
+    template <typename Cluster>
+    static int of(const Cluster &cluster, const EntranceBox &entrance, cv::Size resolution) {
+        return cluster.getSide(entrance);
+    }
+
+    static void draw(cv::Mat img, const EntranceBox &entrance) {
+        drawEntrance(img, entrance);
+    }
+};
+
+// left (-1) or right (1) of the vertical center line, getSide(width) in the wingbeat trackers
+struct CenterLineSide {
+    static constexpr const char *name = "center-line";
+
+    template <typename Cluster>
+    static int of(const Cluster &cluster, const EntranceBox &entrance, cv::Size resolution) {
+        return cluster.getCenterLineSide(resolution.width);
+    }
+
+    static void draw(cv::Mat img, const EntranceBox &entrance) {
+        drawCenterLine(img);
+    }
+};
+
+// Polarity: whether on events are matched to clusters as well
+// Only off events ever move clusters, grow them or feed the blurred surface, on events only reach the
+// wingbeat estimator of the cluster they fall in
+
+struct OffEvents {
+    static constexpr const char *name = "off-events";
+    static constexpr bool onEvents = false;
+};
+
+struct AllEvents {
+    static constexpr const char *name = "all-events";
+    static constexpr bool onEvents = true;
+};
+
+// Wingbeat: an estimator fed every event inside a cluster, with a State kept per cluster
+// The State is written to checkpoints as it is in memory, so it has to be trivially copyable
+
+struct NoWingbeat {
+    static constexpr const char *name = "no-wingbeat";
+
+    struct State {};
+
+    static constexpr bool enabled = false;
+
+    static void event(State &state, int64_t timestamp, bool polarity) {}
+
+    static void shiftTime(State &state, int64_t delta) {}
+
+    static int period(const State &state) { return -1; }
+};
+
+// Cluster::updateFreq of delay_wingbeat: times the off to on transitions inside the cluster and keeps a
+// running average of the gap between them, restarting after a gap of more than 10 ms
+struct DelayWingbeat {
+    static constexpr const char *name = "delay-wingbeat";
+
+    struct State {
+        int64_t prevTime{-1};
+        int transitionCount{0};
+        float runningAvg{0.0};
+        bool prevPol{true};
+    };
+
+    static constexpr bool enabled = true;
+
+    static void event(State &state, int64_t timestamp, bool polarity) {
+        if (polarity && !state.prevPol) {
+            if (timestamp - state.prevTime > 10000) {
+                state.transitionCount = 0;
+                state.runningAvg = 0;
+                state.prevTime = 0;
+            }
+            if (state.prevTime > 0) {
+                state.runningAvg = (7 * state.runningAvg + (timestamp - state.prevTime)) / 8.0;
+            }
+            state.prevTime = timestamp;
+            state.transitionCount++;
+        }
+        state.prevPol = polarity;
+    }
+
+    static void shiftTime(State &state, int64_t delta) {
+        if (state.prevTime > 0) {
+            state.prevTime += delta;
+        }
+    }
+
+    // microseconds between wing beats once 8 transitions have been seen, delay_wingbeat printed it as Hz
+    static int period(const State &state) {
+        return state.transitionCount > 7 ? (int)state.runningAvg : -1;
+    }
+};
+
+// Cluster::addHistory and fft of fourier_wingbeat_detection: counts the on and off events inside the
+// cluster in 1 ms samples, each (on - off) / (on + off), and looks for the strongest frequency between
+// 100 and 400 Hz in every 250 samples. Samples are closed by the cluster's own events, so the ones
+// without any are zeros as before, and the DFT is only worked out for the bins in that band
+struct FourierWingbeat {
+    static constexpr const char *name = "fourier-wingbeat";
+
+    static constexpr int sampleTime = 1000;
+    static constexpr int samples = 250;
+    static constexpr int minBin = 100 * samples * sampleTime / 1000000;
+    static constexpr int maxBin = 400 * samples * sampleTime / 1000000;
+
+    struct State {
+        // start of the sample being counted
+        int64_t sampleStart{-1};
+        int onCount{0}, offCount{0};
+        int filled{0};
+        int period{-1};
+        float history[samples]{};
+    };
+
+    static constexpr bool enabled = true;
+
+    static void addSample(State &state, float value) {
+        state.history[state.filled++] = value;
+        if (state.filled == samples) {
+            state.period = transform(state.history);
+            state.filled = 0;
+        }
+    }
+
+    // period in microseconds of the bin with the most power, -1 if every bin is empty
+    static int transform(const float (&history)[samples]) {
+        // cos and sin of 2 pi k / samples, every product k n lands on one of them
+        static const std::array<std::array<double, 2>, samples> turns = [] {
+            std::array<std::array<double, 2>, samples> table;
+            for (int k = 0; k < samples; k++) {
+                table[k] = {std::cos(2 * std::numbers::pi * k / samples), std::sin(2 * std::numbers::pi * k / samples)};
+            }
+            return table;
+        }();
+
+        int maxBinFound = 0;
+        double maxMagnitude = 0;
+        for (int k = minBin; k < maxBin; k++) {
+            double re = 0, im = 0;
+            for (int n = 0; n < samples; n++) {
+                const std::array<double, 2> &turn = turns[(k * n) % samples];
+                re += history[n] * turn[0];
+                im -= history[n] * turn[1];
+            }
+            double magnitude = re * re + im * im;
+            if (magnitude > maxMagnitude) {
+                maxMagnitude = magnitude;
+                maxBinFound = k;
+            }
+        }
+        return maxBinFound > 0 ? samples * sampleTime / maxBinFound : -1;
+    }
+
+    static void event(State &state, int64_t timestamp, bool polarity) {
+        if (state.sampleStart < 0) {
+            state.sampleStart = timestamp;
+        }
+        if (timestamp >= state.sampleStart + sampleTime) {
+            int64_t passed = (timestamp - state.sampleStart) / sampleTime;
+            int total = state.onCount + state.offCount;
+            addSample(state, total == 0 ? 0.0f : (float)(state.onCount - state.offCount) / total);
+            // a cluster that heard nothing for a whole window starts a new one
+            if (passed > samples) {
+                state.filled = 0;
+            } else {
+                for (int64_t i = 1; i < passed; i++) {
+                    addSample(state, 0.0f);
+                }
+            }
+            state.sampleStart += passed * sampleTime;
+            state.onCount = 0;
+            state.offCount = 0;
+        }
+        if (polarity) {
+            state.onCount++;
+        } else {
+            state.offCount++;
+        }
+    }
+
+    static void shiftTime(State &state, int64_t delta) {
+        if (state.sampleStart >= 0) {
+            state.sampleStart += delta;
+        }
+    }
+
+    // microseconds between wing beats once a window has been transformed, the tree printed it as Hz
+    static int period(const State &state) { return state.period; }
+};
+
+// Cluster::update_osc of forced_oscillators: 12 damped oscillators from 190 to 245 Hz, every off event
+// inside the cluster drives each of them, and the one with the largest amplitude is the wing beat
+// The tree grew the drive with exp(5 pi t) and overflowed after about 45 s, here the amplitudes decay by
+// the same factor instead, which only scales all of them alike and leaves the loudest one the same
+struct ForcedOscillatorWingbeat {
+    static constexpr const char *name = "forced-oscillator";
+
+    static constexpr int oscillators = 12;
+    static constexpr int minFrequency = 190;
+    static constexpr int frequencyStep = 5;
+    static constexpr double timeConstant = 5 * std::numbers::pi;
+
+    struct State {
+        int64_t startTime{-1}, prevTime{-1};
+        double amplitude[oscillators]{}, phase[oscillators]{};
+    };
+
+    static constexpr bool enabled = true;
+
+    static void event(State &state, int64_t timestamp, bool polarity) {
+        if (polarity) {
+            return;
+        }
+        if (state.startTime < 0) {
+            state.startTime = timestamp;
+            state.prevTime = timestamp;
+        }
+        const double t = (timestamp - state.startTime) / 1e6;
+        const double decay = std::exp(-timeConstant * (timestamp - state.prevTime) / 1e6);
+        state.prevTime = timestamp;
+
+        for (int w = 0; w < oscillators; w++) {
+            // phase of the event against the oscillator, and the oscillator's amplitude and phase after it
+            double eventPhase = 2 * std::numbers::pi * (minFrequency + frequencyStep * w) * t + std::numbers::pi / 2;
+            double amplitude = state.amplitude[w] * decay;
+            double phase = state.phase[w];
+            amplitude = std::sqrt(amplitude * amplitude + 1 + 2 * amplitude * std::cos(phase - eventPhase));
+            state.phase[w] = std::atan((amplitude * std::sin(phase) + std::sin(eventPhase)) /
+                (amplitude * std::cos(phase) + std::cos(eventPhase)));
+            state.amplitude[w] = amplitude;
+        }
+    }
+
+    static void shiftTime(State &state, int64_t delta) {
+        if (state.startTime >= 0) {
+            state.startTime += delta;
+            state.prevTime += delta;
+        }
+    }
+
+    // microseconds between wing beats of the loudest oscillator, the tree printed its frequency in Hz
+    static int period(const State &state) {
+        int loudest = -1;
+        double max = 0;
+        for (int w = 0; w < oscillators; w++) {
+            if (state.amplitude[w] > max) {
+                max = state.amplitude[w];
+                loudest = w;
+            }
+        }
+        return loudest >= 0 ? 1000000 / (minFrequency + frequencyStep * loudest) : -1;
+    }
+};
+
+// one choice of each, the Policies parameter of BasicTracker
+template <typename DistancePolicy, typename SidePolicy, typename PolarityPolicy, typename WingbeatPolicy>
+struct TrackerPolicies {
+    using Distance = DistancePolicy;
+    using Side = SidePolicy;
+    using Polarity = PolarityPolicy;
+    using Wingbeat = WingbeatPolicy;
+
+    // such as "chebyshev/entrance-box/off-events/no-wingbeat"
+    static std::string name() {
+        return std::string(Distance::name) + "/" + Side::name + "/" + Polarity::name + "/" + Wingbeat::name;
+    }
+};
+
+// The combinations today's programs use, tracker.cpp builds the tracker for each of them
+
+// cpp_live_tracking: every tool and the DV module
+using LiveTrackingPolicies = TrackerPolicies<ChebyshevDistance, EntranceBoxSide, OffEvents, NoWingbeat>;
+
+// the counting of the forced_oscillators and fourier_wingbeat_detection trees, without their estimators
+using CenterLinePolicies = TrackerPolicies<ChebyshevDistance, CenterLineSide, OffEvents, NoWingbeat>;
+
+// delay_wingbeat
+using DelayWingbeatPolicies = TrackerPolicies<ChebyshevDistance, CenterLineSide, AllEvents, DelayWingbeat>;
+
+// fourier_wingbeat_detection, its clusters are fed on events too
+using FourierWingbeatPolicies = TrackerPolicies<ChebyshevDistance, CenterLineSide, AllEvents, FourierWingbeat>;
+
+// forced_oscillators, off events only
+using ForcedOscillatorPolicies = TrackerPolicies<ChebyshevDistance, CenterLineSide, OffEvents, ForcedOscillatorWingbeat>;
+
+#endif
@@ -0,0 +1,57 @@
+#include "tracking_pipeline.hpp"
+#include <opencv2/imgproc.hpp>
+
+TrackingPipeline::TrackingPipeline(cv::Size resolution, int capacity)
+    : tracker(resolution, constants::blurScale, constants::blurLevels, capacity),
+      timeSurface(resolution),
+      surfaceImg(resolution.height, resolution.width, CV_8UC1, cv::Scalar(0)),
+      trackImg(resolution.height, resolution.width, CV_8UC3, cv::Scalar(1)) {
+}
+
+template <typename Events>
+bool TrackingPipeline::processBatch(const Events &events) {
+    if (events.size() == 0) {
+        return false;
+    }
+
+    tracker.processEvents(events);
+    if (!framesEnabled) {
+        // the display clock restarts from the next packet when frames are turned back on
+        nextFrame = -1;
+        return false;
+    }
+
+    // the time surface only needs the OFF events and the display clock
+    bool frameDue = false;
+    for (const dv::Event &event : events) {
+        int64_t timeStamp = event.timestamp();
+
+        if (nextFrame < 0) {
+            nextFrame = timeStamp;
+        }
+        if (!event.polarity()) {
+            timeSurface.addEvent(event.x(), event.y());
+        }
+        if (timeStamp > nextFrame) {
+            nextFrame += constants::displayTime;
+            timeSurface.nextFrame();
+            frameDue = true;
+        }
+    }
+    return frameDue;
+}
+
+bool TrackingPipeline::processPacket(const dv::EventStore &events) {
+    return processBatch(events);
+}
+
+bool TrackingPipeline::processPacket(std::span<const dv::Event> events) {
+    return processBatch(events);
+}
+
+const cv::Mat &TrackingPipeline::drawFrame() {
+    timeSurface.render(surfaceImg);
+    cv::cvtColor(surfaceImg, trackImg, cv::COLOR_GRAY2BGR);
+    tracker.draw(trackImg);
+    return trackImg;
+}
@@ -0,0 +1,46 @@
+#ifndef TRACKING_PIPELINE_H
+#define TRACKING_PIPELINE_H
+
+#include "tracker.hpp"
+#include "time_surface.hpp"
+
+#include <dv-processing/core/core.hpp>
+#include <opencv2/core.hpp>
+#include <span>
+
+// Everything the DV module does with a packet of events, without depending on the DV SDK
+// The module hands each input packet to processPacket and sends drawFrame() out when a frame is due,
+// the harness does the same with packets read from a recording so the module can be timed offline
+class TrackingPipeline {
+    private:
+        Tracker tracker;
+        TimeSurface timeSurface;
+        // preallocated output frame, drawFrame() draws over it
+        cv::Mat surfaceImg, trackImg;
+        int64_t nextFrame{-1};
+        bool framesEnabled{true};
+
+        template <typename Events>
+        bool processBatch(const Events &events);
+
+    public:
+        TrackingPipeline(cv::Size resolution, int capacity = constants::maxClusters);
+
+        // tracks the whole packet, returns true if a display frame came due during it
+        bool processPacket(const dv::EventStore &events);
+
+        // events read in place from a recording (MappedRecording)
+        bool processPacket(std::span<const dv::Event> events);
+
+        // with frames off the time surface is not kept up at all and processPacket never asks for a frame
+        void setFramesEnabled(bool enabled) { framesEnabled = enabled; }
+
+        // time surface with the entrance and clusters drawn on top, valid until the next call
+        const cv::Mat &drawFrame();
+
+        Tracker &getTracker() { return tracker; }
+
+        const Tracker &getTracker() const { return tracker; }
+};
+
+#endif
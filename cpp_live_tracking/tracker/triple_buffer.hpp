@@ -0,0 +1,58 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+// Hands the latest value from one writer thread to one reader thread without either one waiting
+// The writer fills writeBuffer() and publishes it, the reader picks up the newest published value
+// If the reader falls behind, unread values are replaced by newer ones, so frames get dropped
+// instead of queueing up behind a slow reader
+template <typename T>
+class TripleBuffer {
+    private:
+        static constexpr uint8_t indexMask = 0x3;
+        static constexpr uint8_t freshBit = 0x4;
+
+        T buffers[3];
+        // index of the buffer between the writer and the reader, with freshBit set if it has not been read
+        std::atomic<uint8_t> middle{1};
+        uint8_t back{0};
+        uint8_t front{2};
+
+    public:
+        // all three buffers, so the caller can size them before any thread starts
+        T *begin() { return buffers; }
+
+        T *end() { return buffers + 3; }
+
+        // writer side
+        T &writeBuffer() { return buffers[back]; }
+
+        // makes the write buffer visible to the reader
+        // returns true if the value it replaces was never read
+        bool publish() {
+            uint8_t previous = middle.exchange(back | freshBit, std::memory_order_acq_rel);
+            back = previous & indexMask;
+            return previous & freshBit;
+        }
+
+        // true while the last published value has not been picked up by the reader
+        // only the reader clears this, so a writer that sees it set can leave the published value alone
+        bool unread() const { return middle.load(std::memory_order_acquire) & freshBit; }
+
+        // reader side
+        // swaps in the newest published value, returns false if nothing new was published
+        bool acquire() {
+            if (!(middle.load(std::memory_order_relaxed) & freshBit)) {
+                return false;
+            }
+            uint8_t previous = middle.exchange(front, std::memory_order_acq_rel);
+            front = previous & indexMask;
+            return true;
+        }
+
+        const T &readBuffer() const { return buffers[front]; }
+};
+
+#endif
@@ -0,0 +1,87 @@
+#include "work_stealing_pool.hpp"
+
+#include <algorithm>
+
+// the pool and queue of the thread running, so a task submitting more work keeps it on its own queue
+static thread_local const WorkStealingPool *currentPool = nullptr;
+static thread_local size_t currentQueue = 0;
+
+WorkStealingPool::WorkStealingPool(int threads) {
+    if (threads <= 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (int i = 0; i < threads; i++) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (int i = 0; i < threads; i++) {
+        this->threads.emplace_back(&WorkStealingPool::work, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::submit(std::function<void()> task) {
+    size_t queue = currentPool == this ? currentQueue : nextQueue++ % queues.size();
+    {
+        std::lock_guard<std::mutex> lock(queues[queue]->mutex);
+        queues[queue]->tasks.push_back(std::move(task));
+    }
+    {
+        // under the lock so a thread cannot check pending and go to sleep in between
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        pending++;
+    }
+    wake.notify_one();
+}
+
+bool WorkStealingPool::take(size_t queue, std::function<void()> &task) {
+    {
+        Queue &own = *queues[queue];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.front());
+            own.tasks.pop_front();
+            pending--;
+            return true;
+        }
+    }
+    for (size_t i = 1; i < queues.size(); i++) {
+        Queue &other = *queues[(queue + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(other.mutex);
+        if (!other.tasks.empty()) {
+            task = std::move(other.tasks.back());
+            other.tasks.pop_back();
+            pending--;
+            steals++;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::work(size_t queue) {
+    currentPool = this;
+    currentQueue = queue;
+    std::function<void()> task;
+    while (true) {
+        if (take(queue, task)) {
+            task();
+            task = nullptr;
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        if (pending == 0 && stopping) {
+            return;
+        }
+        wake.wait(lock, [this]() { return pending > 0 || stopping; });
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of threads, each with its own queue of tasks
+// Tasks submitted from outside are spread over the queues in turn, tasks submitted by a task go on
+// the queue of the thread running it. A thread takes the oldest task of its own queue, so the tasks
+// on it take turns, and when its queue is empty it steals the newest task of another thread's queue
+// before going to sleep. Each queue has its own lock, so threads only meet when one steals.
+class WorkStealingPool {
+    private:
+        struct Queue {
+            std::mutex mutex;
+            std::deque<std::function<void()>> tasks;
+        };
+
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::vector<std::thread> threads;
+
+        std::mutex sleepMutex;
+        std::condition_variable wake;
+        // tasks submitted and not taken yet
+        std::atomic<int64_t> pending{0};
+        std::atomic<uint64_t> nextQueue{0}, steals{0};
+        bool stopping{false};
+
+        // the next task for the thread with this queue, false if every queue is empty
+        bool take(size_t queue, std::function<void()> &task);
+
+        void work(size_t queue);
+
+    public:
+        // threads 0 uses every core
+        explicit WorkStealingPool(int threads = 0);
+
+        // runs the tasks already submitted, then stops the threads
+        ~WorkStealingPool();
+
+        WorkStealingPool(const WorkStealingPool &) = delete;
+        WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+        void submit(std::function<void()> task);
+
+        int size() const { return threads.size(); }
+
+        // tasks a thread took from another thread's queue
+        uint64_t getSteals() const { return steals; }
+};
+
+#endif
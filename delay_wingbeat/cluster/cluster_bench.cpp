@@ -0,0 +1,37 @@
+#include "cluster.hpp"
+#include <cluster_workload.hpp>
+
+// Microbenchmarks for the delay_wingbeat cluster library (cluster.cpp, the one file_naive_delay_detection uses),
+// see benchmark/README.md
+static Cluster makeCluster(unsigned int x, unsigned int y) {
+    return Cluster(x, y, cv::viz::Color::red(), workload::alpha, 0);
+}
+
+// every event from a bee goes to its cluster's polarity transition timer
+static void benchUpdateFreq(microbench::State &state) {
+    auto clusters = workload::makeClusters(state.arg(0), makeCluster);
+    std::vector<workload::SyntheticEvent> events = workload::makeEvents(workload::blockSize, state.arg(0), state.arg(1));
+    const int64_t blockTime = events.back().timestamp + 1;
+
+    int64_t offset = 0;
+    while (state.keepRunning()) {
+        // keep time moving forward from block to block, as it would on the camera
+        for (const workload::SyntheticEvent &event : events) {
+            if (event.source >= 0) {
+                clusters[event.source].updateFreq(dv::Event(event.timestamp + offset, event.x, event.y, event.polarity));
+            }
+        }
+        offset += blockTime;
+        microbench::doNotOptimize(clusters.data());
+    }
+    state.setItemsProcessed(state.iterations() * workload::blockSize);
+}
+
+int main(int argc, char *argv[]) {
+    microbench::Suite suite("delay_wingbeat/cluster");
+
+    workload::addCommonBenchmarks(suite, makeCluster, [](Cluster &cluster) { cluster.newEvent(); });
+    suite.add("updateFreq", benchUpdateFreq).argNames({"clusters", "rate"}).ranges({workload::clusterCounts, workload::eventRates});
+
+    return suite.run(argc, argv);
+}
@@ -0,0 +1,37 @@
+#include "cluster.hpp"
+#include <cluster_workload.hpp>
+
+// Microbenchmarks for the forced_oscillators cluster library, see benchmark/README.md
+static Cluster makeCluster(unsigned int x, unsigned int y) {
+    return Cluster(x, y, cv::viz::Color::red(), workload::alpha, 0);
+}
+
+// file_forced_osc drives every cluster's oscillators with every off event
+static void benchUpdateOsc(microbench::State &state) {
+    const double timeConstant = 5 * 3.14159;
+    auto clusters = workload::makeClusters(state.arg(0), makeCluster);
+    std::vector<workload::SyntheticEvent> events = workload::makeEvents(workload::blockSize, state.arg(0), state.arg(1));
+
+    // the block's timestamps are reused, the drive grows exponentially with time and would overflow
+    while (state.keepRunning()) {
+        for (const workload::SyntheticEvent &event : events) {
+            if (event.polarity) {
+                continue;
+            }
+            for (Cluster &cluster : clusters) {
+                cluster.update_osc(event.timestamp, timeConstant);
+            }
+        }
+        microbench::doNotOptimize(clusters.data());
+    }
+    state.setItemsProcessed(state.iterations() * workload::blockSize);
+}
+
+int main(int argc, char *argv[]) {
+    microbench::Suite suite("forced_oscillators/cluster");
+
+    workload::addCommonBenchmarks(suite, makeCluster, [](Cluster &cluster) { cluster.newEvent(); });
+    suite.add("update_osc", benchUpdateOsc).argNames({"clusters", "rate"}).ranges({workload::clusterCounts, workload::eventRates});
+
+    return suite.run(argc, argv);
+}
@@ -69,20 +69,22 @@ int main(void)
 
 	int beesEntering = 0, beesLeaving = 0;
 
-	// Intializes cluster frequency log
+	// Intializes cluster frequency log, it stays open for the whole recording and is written in large blocks
+	// instead of being opened, flushed line by line and closed again for every packet
+	static char clusterLogBuffer[1 << 20];
 	ofstream clusterLog;
+		clusterLog.rdbuf()->pubsetbuf(clusterLogBuffer, sizeof(clusterLogBuffer));
 		clusterLog.open("02_01_led_fc_freq.csv");
 		clusterLog << "Timestamp, Cluster ID, Returned Frequency, Noise Metric, ";
 		for (int i = 0; i < num_oscillators; i++)
 		{
 			clusterLog << omega_min + 5*i << "Hz Amplitude, ";
 		}
-		clusterLog << std::endl;
-		clusterLog.close();
+		clusterLog << "\n";
 
 	// define a function for when the file reader encounters an event packet
 	handler.mEventHandler = [&tsImg, &tsBlurred, &lastTimeStamp, &nextTime, &nextFrame, &nextSustain, &prevTime,
-							 &clusters, &imageWidth, &imageHeight, &blurScale, &colorIndex, &beesEntering, &beesLeaving](const dv::EventStore &nextEvent)
+							 &clusters, &imageWidth, &imageHeight, &blurScale, &colorIndex, &beesEntering, &beesLeaving, &clusterLog](const dv::EventStore &nextEvent)
 	{
 		// Scale factors close to 1 mean accumulation for a long time
 		const double scaleFactor = 0.995; // A scale factor of 0 means no accumulation
@@ -126,10 +128,6 @@ int main(void)
 											  viz::Color::yellow(), viz::Color::pink(),
 											  viz::Color::lime(), viz::Color::cyan()};
 
-		// Opens frequency log file
-		ofstream clusterLog;
-		clusterLog.open("02_01_led_fc_freq.csv", std::ios::app);
-
 		if (nextEvent.isEmpty())
 			return;
 
@@ -276,7 +274,7 @@ int main(void)
 					int freq = clusters.at(i).getFrequency();
 					if (freq != -1)
 					{
-						cout << "Cluster " << clusters.at(i).getID() << " Frequency:  " << freq << " Hz" << endl;
+						cout << "Cluster " << clusters.at(i).getID() << " Frequency:  " << freq << " Hz\n";
 
 						double noiseMetric = 0;
 						double* spectrumPtr = clusters.at(i).getSpectrum();
@@ -294,11 +292,11 @@ int main(void)
 							clusterLog << *(clusters.at(i).getSpectrum() + j) << ", ";
 						}
 
-						clusterLog << endl;
+						clusterLog << "\n";
 						
 					} else {
 
-						clusterLog << ", " << endl;
+						clusterLog << ", \n";
 
 					}
 
@@ -345,11 +343,10 @@ int main(void)
 				tsImg *= imgScaleFactor;
 			} // end image update
 		}	  // end event loop
-
-		clusterLog.close();
 	};		  // End event handler function
 
 	reader.run(handler);
+	clusterLog.close();
 	printf("End of recording.\n");
 
 	return 0;
@@ -0,0 +1,71 @@
+#include "cluster.hpp"
+#include <cluster_workload.hpp>
+
+// Microbenchmarks for the fourier_wingbeat_detection cluster library, see benchmark/README.md
+// The sample rate and window are the ones fourier_wingbeat_from_file uses
+static const unsigned int sampleFreq = 1000;
+static const unsigned int numPositions = 250;
+
+static Cluster makeCluster(unsigned int x, unsigned int y) {
+    return Cluster(x, y, cv::viz::Color::red(), workload::alpha, sampleFreq, numPositions);
+}
+
+// One sample period: the events of one 1/sampleFreq interval are counted by their clusters, then every
+// cluster adds a sample to its history, running the FFT once every numPositions samples
+static void benchAddHistory(microbench::State &state) {
+    auto clusters = workload::makeClusters(state.arg(0), makeCluster);
+    const size_t perSample = std::max<int64_t>(1, state.arg(1) / sampleFreq);
+    std::vector<workload::SyntheticEvent> events = workload::makeEvents(std::max(workload::blockSize, perSample), state.arg(0), state.arg(1));
+
+    size_t next = 0;
+    while (state.keepRunning()) {
+        for (size_t i = 0; i < perSample; i++) {
+            const workload::SyntheticEvent &event = events[next];
+            next = next + 1 < events.size() ? next + 1 : 0;
+            if (event.source >= 0) {
+                clusters[event.source].newEvent(event.polarity);
+            }
+        }
+        for (Cluster &cluster : clusters) {
+            cluster.addHistory();
+        }
+        microbench::doNotOptimize(clusters.data());
+    }
+    state.setItemsProcessed(state.iterations() * clusters.size());
+}
+
+// the FFT on its own, for every cluster
+static void benchFft(microbench::State &state) {
+    auto clusters = workload::makeClusters(state.arg(0), makeCluster);
+    // fill the history with a full window of samples first
+    std::vector<workload::SyntheticEvent> events = workload::makeEvents(numPositions * 8, state.arg(0), 1000000);
+    for (size_t i = 0; i < events.size(); i++) {
+        if (events[i].source >= 0) {
+            clusters[events[i].source].newEvent(events[i].polarity);
+        }
+        if (i % 8 == 7) {
+            for (Cluster &cluster : clusters) {
+                cluster.addHistory();
+            }
+        }
+    }
+
+    while (state.keepRunning()) {
+        for (Cluster &cluster : clusters) {
+            cluster.fft();
+        }
+        microbench::doNotOptimize(clusters.data());
+    }
+    state.setItemsProcessed(state.iterations() * clusters.size());
+}
+
+int main(int argc, char *argv[]) {
+    microbench::Suite suite("fourier_wingbeat_detection/cluster");
+
+    // a cluster never frees its FFTW buffers and plan, so births are capped to keep the leak small
+    workload::addCommonBenchmarks(suite, makeCluster, [](Cluster &cluster) { cluster.newEvent(false); }, 50);
+    suite.add("addHistory+fft", benchAddHistory).argNames({"clusters", "rate"}).ranges({workload::clusterCounts, workload::eventRates});
+    suite.add("fft", benchFft).argNames({"clusters"}).ranges({workload::clusterCounts});
+
+    return suite.run(argc, argv);
+}
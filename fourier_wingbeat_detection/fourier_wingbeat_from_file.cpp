@@ -44,13 +44,23 @@ int main(void) {
   	int64_t lastTimeStamp = -1;
     int colorIndex = 0;
 
-	const int imageWidth = 640, imageHeight = 480;
-  //const int imageWidth = 480, imageHeight = 640;
+	// retrieve the event resolution stored in the recording
+	std::optional<cv::Size> resolutionWrapper = reader.getEventResolution();
+	if (!resolutionWrapper.has_value()) {
+		cerr << "Could not retrieve event resolution from recording" << endl;
+		return (EXIT_FAILURE);
+	}
+
+	const int imageWidth = resolutionWrapper.value().width, imageHeight = resolutionWrapper.value().height;
 
   // This algorithm uses a "blur" to make it easier to detect a lot of events occurring in the same region
   // The algorithm breaks the time surface into 20 x 20 regions and keeps track of how many events have occurred in each region
   // The blur scale controls the size of each region
     const int blurScale = 20;
+  // Round up so the regions on the right and bottom edge cover the leftover pixels
+  // when the resolution is not a multiple of the blur scale
+    const int blurWidth = (imageWidth + blurScale - 1) / blurScale;
+    const int blurHeight = (imageHeight + blurScale - 1) / blurScale;
   // This controls how much each event contributes to the regions in the blurred time surface
   // A higher number will make each region more sensitive to individual events
 
@@ -59,13 +69,13 @@ int main(void) {
 	// Initializes a screen - its grayscale but uses 3 channels so that clusters can be drawn on the screen in RGB
     Mat tsImg(imageHeight, imageWidth, CV_8UC3, Scalar(1));
 	// Initializes the blurred time surface, used to control the creation of new clusters
-    Mat tsBlurred(imageHeight / blurScale, imageWidth / blurScale, CV_64FC1, Scalar(0));
+    Mat tsBlurred(blurHeight, blurWidth, CV_64FC1, Scalar(0));
 
     int beesEntering = 0, beesLeaving = 0;
 
 	// define a function for when the file reader encounters an event packet
   handler.mEventHandler = [&tsImg, &tsBlurred, &lastTimeStamp, &nextTime, &nextFrame, &nextSustain, &prevTime, &nextSample,
-    &clusters, &imageWidth, &imageHeight, &blurScale, &colorIndex, &beesEntering, &beesLeaving](const dv::EventStore &nextEvent) {
+    &clusters, &imageWidth, &imageHeight, &blurScale, &blurWidth, &blurHeight, &colorIndex, &beesEntering, &beesLeaving](const dv::EventStore &nextEvent) {
 
       // Scale factors close to 1 mean accumulation for a long time
         const double scaleFactor = 0.995; // A scale factor of 0 means no accumulation
@@ -212,8 +222,8 @@ int main(void) {
 						}
 					}
 
-					for (int i = 0; i < imageWidth / blurScale; i++) {
-						for (int j = 0; j < imageHeight / blurScale; j++) {
+					for (int i = 0; i < blurWidth; i++) {
+						for (int j = 0; j < blurHeight; j++) {
 							// Adds a new cluster if three criteria are met:
                            	// The region must be greater than the cluster initialization threshold
                            	// The region can't be inside an already existing cluster